@@ -1,7 +1,8 @@
 #!/bin/bash
 
 #######
-## Script for manually generating the set of (normal) files under each directory in Redis
+## Script for manually generating the set of (normal) files under each directory in Redis,
+## and the list and index of directories
 #######
 
 redis-cli EVAL "
@@ -18,5 +19,6 @@ redis-cli EVAL "
         name='//pf_' .. name;
         redis.call('SADD',name,struct.pack('c0',names[i]));
         redis.call('SADD',KEYS[1],name);
+        redis.call('ZADD',KEYS[2],0,name);
     end
-" 1 //snccDirList
+" 2 //snccDirList //snccDirIndex
@@ -0,0 +1,115 @@
+#!/bin/bash
+
+#######
+## Script for converting the chunk and block metadata of all files in Redis from one field per chunk or block to the
+## packed form (see src/proxy/metastore/file_meta_codec.hh), for Proxy with 'packed_file_meta' enabled under 'metastore'
+##
+## Usage: pack_file_meta.sh [redis-cli options, e.g., -h 127.0.0.1 -p 6379]
+##
+## Files are converted in batches (of keys scanned), and the script can be re-run safely, e.g., after interruption.
+#######
+
+batch_size=${BATCH_SIZE:-100}
+
+script=$(mktemp)
+trap 'rm -f "${script}"' EXIT
+
+cat > "${script}" << 'EOF'
+local res = redis.call('SCAN', ARGV[1], 'COUNT', ARGV[2])
+local converted = 0
+
+local function deleteFields(key, fields)
+    for i = 1, #fields, 1000 do
+        redis.call('HDEL', key, unpack(fields, i, math.min(i + 999, #fields)))
+    end
+end
+
+-- pack the blocks with the given field prefix ('ub' for unique blocks, 'db' for duplicate blocks)
+local function packBlocks(key, prefix, num, unique, fields)
+    local offsets, lengths, physicalOffsets, fpLengths, fps = {}, {}, {}, {}, {}
+    local trailer = unique and 4 or 0
+    for i = 0, num - 1 do
+        local v = redis.call('HGET', key, prefix .. i)
+        if not v or #v < 12 + trailer then
+            return nil
+        end
+        local fp = string.sub(v, 13, #v - trailer)
+        offsets[#offsets + 1] = string.sub(v, 1, 8)
+        lengths[#lengths + 1] = string.sub(v, 9, 12)
+        if unique then
+            physicalOffsets[#physicalOffsets + 1] = string.sub(v, #v - 3)
+        end
+        fpLengths[#fpLengths + 1] = string.char(#fp)
+        fps[#fps + 1] = fp
+        fields[#fields + 1] = prefix .. i
+    end
+    return struct.pack('II', 1, num) .. table.concat(offsets) .. table.concat(lengths) ..
+        table.concat(physicalOffsets) .. table.concat(fpLengths) .. table.concat(fps)
+end
+
+for _, key in ipairs(res[2]) do
+    -- skip system keys, and files already in the packed form
+    if string.sub(key, 1, 2) ~= '//' and redis.call('TYPE', key)['ok'] == 'hash' and
+            redis.call('HEXISTS', key, 'ver') == 1 and redis.call('HEXISTS', key, 'mfmt') == 0 then
+        local h = redis.call('HMGET', key, 'numC', 'numUB', 'numDB')
+        local numChunks = h[1] and struct.unpack('i', h[1]) or 0
+        local numUniqueBlocks = h[2] and struct.unpack('L', h[2]) or 0
+        local numDuplicateBlocks = h[3] and struct.unpack('L', h[3]) or 0
+        local fields = {}
+
+        -- chunks
+        local containerIds, sizes, md5s, bad = {}, {}, {}, {}
+        for i = 0, numChunks - 1 do
+            local c = 'c' .. i
+            local v = redis.call('HMGET', key, c .. '-cid', c .. '-size', c .. '-md5', c .. '-bad')
+            containerIds[#containerIds + 1] = v[1] or struct.pack('i', 0)
+            sizes[#sizes + 1] = v[2] or struct.pack('i', 0)
+            md5s[#md5s + 1] = (v[3] and #v[3] == 16) and v[3] or string.rep('\0', 16)
+            local byte = math.floor(i / 8)
+            bad[byte + 1] = bad[byte + 1] or 0
+            if v[4] and tonumber(v[4]) ~= 0 then
+                bad[byte + 1] = bit.bor(bad[byte + 1], bit.lshift(1, i % 8))
+            end
+            fields[#fields + 1] = c .. '-cid'
+            fields[#fields + 1] = c .. '-size'
+            fields[#fields + 1] = c .. '-md5'
+            fields[#fields + 1] = c .. '-bad'
+        end
+        for i = 1, #bad do
+            bad[i] = string.char(bad[i])
+        end
+        local packedChunks = struct.pack('II', 1, numChunks) .. table.concat(containerIds) .. table.concat(sizes) ..
+            table.concat(md5s) .. table.concat(bad)
+
+        -- blocks
+        local packedUniqueBlocks = packBlocks(key, 'ub', numUniqueBlocks, true, fields)
+        local packedDuplicateBlocks = packBlocks(key, 'db', numDuplicateBlocks, false, fields)
+
+        if packedUniqueBlocks and packedDuplicateBlocks then
+            redis.call('HMSET', key, 'mfmt', struct.pack('I', 1), 'pc', packedChunks, 'pub', packedUniqueBlocks,
+                'pdb', packedDuplicateBlocks)
+            deleteFields(key, fields)
+            converted = converted + 1
+        end
+    end
+end
+
+return { res[1], converted }
+EOF
+
+cursor=0
+total=0
+while true; do
+    reply=($(redis-cli "$@" --raw --eval "${script}" , ${cursor} ${batch_size}))
+    if [ ${#reply[@]} -ne 2 ]; then
+        echo "Failed to convert file metadata: ${reply[*]}"
+        exit 1
+    fi
+    cursor=${reply[0]}
+    total=$((total + reply[1]))
+    if [ "${cursor}" == "0" ]; then
+        break
+    fi
+done
+
+echo "Converted metadata of ${total} files"
@@ -331,8 +331,11 @@ void *Agent::handleChunkEvent(void *arg) {
             // start repair after getting all required chunks
             if (allsuccess) {
                 for (int i = 0; i < event.numChunks; i++) {
-                    event.chunks[i].data = (unsigned char *) malloc (chunkSize);
-                    event.chunks[i].size = chunkSize;
+                    // use pooled buffers, which can be sent without copying
+                    if (!event.chunks[i].allocateData(chunkSize)) {
+                        LOG(ERROR) << "Failed to allocate memory for " << event.numChunks << " repaired chunks";
+                        exit(1);
+                    }
                     output[i] = event.chunks[i].data;
                 }
                 // do decoding
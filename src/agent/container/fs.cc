@@ -2,6 +2,7 @@
 
 #include <stdio.h> // ftell(), rewind(), sprintf()
 #include <string.h> // strlen()
+#include <algorithm>
 #include <string>
 #include <time.h>
 #include <unistd.h>
@@ -10,20 +11,56 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <sys/file.h> // flock()
-#include <boost/filesystem.hpp>
+#include <dirent.h> // opendir(), readdir()
 
 #include <boost/timer/timer.hpp>
 
 #include <glog/logging.h>
 
+#include "../../common/checksum_calculator.hh"
 #include "../../common/config.hh"
 #include "fs.hh"
+#include "fs_io.hh"
+
+#define FS_WRITE_SLICE_SIZE (1 << 20) // size of data to write before adding it to the checksum (while it is still in cache)
+#define FS_SUMMARY_FILE ".summary" // name of the summary file in the container directory (file names starting with '.' are not chunks)
+
+/**
+ * Hash a chunk name (32-bit FNV-1a) to place the chunk file, which must not change across releases
+ **/
+static unsigned int hashChunkName(const char *name, size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char) name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
 
 FsContainer::FsContainer(int id, const char *dir, unsigned long int capacity) :
         Container(id, capacity) {
     strcpy(_dir, dir);
+    // remove the ending slashes, to compare paths under the directory
+    for (size_t length = strlen(_dir); length > 1 && _dir[length - 1] == '/'; length--)
+        _dir[length - 1] = 0;
+    _ioEngine = Config::getInstance().getAgentFsIoEngine();
+    _dirLevels = Config::getInstance().getAgentFsDirLevels();
+    _chunkUsage = 0;
     // create the directory for chunk files
     mkdir(dir, 0755);
+
+    // load the usage and old chunks from the summary, or scan the directory if the summary is not up-to-date
+    int levels = -1;
+    bool clean = false;
+    bool loaded = loadSummary(levels, clean);
+    _layoutReady = loaded && levels == _dirLevels;
+    if (!loaded || !clean || !_layoutReady) {
+        LOG(INFO) << "Scan chunk files in container directory " << _dir << (loaded? (clean? ", layout changed" : ", not shut down cleanly") : ", no summary found");
+        _layoutReady = scanChunkFiles(/* migrate */ !_layoutReady);
+        LOG_IF(ERROR, !_layoutReady) << "Failed to scan all chunk files in container directory " << _dir;
+    }
+    // mark the summary as outdated until the container shuts down
+    saveSummary(/* clean */ false);
     updateUsage();
 
     _running = true;
@@ -35,16 +72,25 @@ FsContainer::FsContainer(int id, const char *dir, unsigned long int capacity) :
 }
 
 FsContainer::~FsContainer() {
-    // signal the background cleaning thread to terminate now
+    // signal the background cleaning thread to terminate now, under the lock so the signal is not lost before the thread waits
+    pthread_mutex_lock(&_chunkCleanUp.lock);
     _running = false;
     pthread_cond_signal(&_chunkCleanUp.cond);
+    pthread_mutex_unlock(&_chunkCleanUp.lock);
     pthread_join(_chunkCleanUp.th, NULL);
     pthread_cond_destroy(&_chunkCleanUp.cond);
     pthread_mutex_destroy(&_chunkCleanUp.lock);
+    // save the usage and old chunks for the next start
+    saveSummary(/* clean */ true);
 }
 
 bool FsContainer::getChunkPath(char *fpath, std::string chunkName) {
-    return snprintf(fpath, PATH_MAX, "%s/%s", _dir, chunkName.c_str()) < PATH_MAX;
+    int length = snprintf(fpath, PATH_MAX, "%s/", _dir);
+    // spread the chunk files over subdirectories named by the bytes of the hash of chunk names
+    unsigned int hash = hashChunkName(chunkName.c_str(), chunkName.size());
+    for (int i = 0; i < _dirLevels && length < PATH_MAX; i++)
+        length += snprintf(fpath + length, PATH_MAX - length, "%02x/", (hash >> (i * 8)) & 0xff);
+    return length < PATH_MAX && snprintf(fpath + length, PATH_MAX - length, "%s", chunkName.c_str()) < PATH_MAX - length;
 }
 
 void FsContainer::getOldChunkPath(std::string &ofpath, char *fpath, const char *ctime) {
@@ -54,14 +100,57 @@ void FsContainer::getOldChunkPath(std::string &ofpath, char *fpath, const char *
     ofpath += ctime;
 }
 
+bool FsContainer::makeChunkDir(const char fpath[]) {
+    if (_dirLevels == 0)
+        return true;
+
+    std::string dir(fpath, strrchr(fpath, '/') - fpath);
+    if (mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST)
+        return true;
+
+    // create the subdirectories from the top level
+    for (size_t pos = dir.find('/', strlen(_dir) + 1); pos != std::string::npos; pos = dir.find('/', pos + 1))
+        mkdir(dir.substr(0, pos).c_str(), 0755);
+    if (mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST)
+        return true;
+
+    LOG(ERROR) << "Failed to create directory " << dir << " for chunk files, " << strerror(errno);
+    return false;
+}
+
+void FsContainer::addUsage(long int before, long int after) {
+    _chunkUsage += after - before;
+}
+
+void FsContainer::addOldChunk(const std::string &ofpath, time_t mtime) {
+    std::lock_guard<std::mutex> lk(_oldChunksLock);
+    _oldChunks[ofpath] = mtime;
+}
+
+void FsContainer::removeOldChunk(const std::string &ofpath) {
+    std::lock_guard<std::mutex> lk(_oldChunksLock);
+    _oldChunks.erase(ofpath);
+}
+
+long int FsContainer::getFileSize(const char *fpath, time_t *mtime) {
+    struct stat sbuf;
+    if (stat(fpath, &sbuf) != 0)
+        return 0;
+    if (mtime != NULL)
+        *mtime = sbuf.st_mtime;
+    return sbuf.st_size;
+}
+
 bool FsContainer::putChunk(Chunk &chunk) {
     char fpath[PATH_MAX];
-    if (getChunkPath(fpath, chunk.getChunkName()) == false)
+    if (getChunkPath(fpath, chunk.getChunkName()) == false || makeChunkDir(fpath) == false)
         return false;
 
     std::string ofpath(fpath);
+    struct stat sbuf;
+    long int prevSize = 0;
     // backup the chunk first if exists
-    if (boost::filesystem::is_regular_file(ofpath)) {
+    if (stat(fpath, &sbuf) == 0 && S_ISREG(sbuf.st_mode)) {
         // use the current time as the version of the previous chunk
         snprintf(chunk.chunkVersion, CHUNK_VERSION_MAX_LEN, "%ld", time(NULL));
         // generate the old chunk's path
@@ -71,6 +160,8 @@ bool FsContainer::putChunk(Chunk &chunk) {
             LOG(ERROR) << "Failed to backup chunk " << fpath << " to " << ofpath << " before write";
             return false;
         }
+        addOldChunk(ofpath, sbuf.st_mtime);
+        prevSize = sbuf.st_size;
     } else {
         // no previous version found
         chunk.chunkVersion[0] = 0;
@@ -78,6 +169,37 @@ bool FsContainer::putChunk(Chunk &chunk) {
 
     boost::timer::cpu_timer mytimer;
 
+    // compute the checksum over the data in memory as it is written, instead of reading the data back after write
+    MD5Calculator md5;
+    bool success = _ioEngine == FsIoEngine::DIRECT_FS_IO? writeChunkFileDirect(fpath, chunk, md5) : writeChunkFile(fpath, chunk, md5);
+    addUsage(prevSize, getFileSize(fpath));
+
+    // benchmark
+    double elapsed = mytimer.elapsed().wall * 1.0 / 1e9;
+    DLOG(INFO) << "<WRITE> Write chunk, size: " << (chunk.size * 1.0 / (1 << 20)) << " MB, time: " << elapsed << " s, speed: " << (chunk.size * 1.0 / (1 << 20)) / elapsed << " MB/s";
+
+    // check if all chunk data is successfully written
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    unsigned int digestLength = MD5_DIGEST_LENGTH;
+    success = success && md5.finalize(digest, digestLength);
+    // verify the checksum if needed
+    if (success && Config::getInstance().verifyChunkChecksum() && memcmp(digest, chunk.md5, MD5_DIGEST_LENGTH) != 0) {
+        LOG(ERROR) << "Checksum mismatched for chunk " << chunk.getChunkName() << " written to path " << fpath;
+        success = false;
+    }
+    // read chunk data back to verify the data on disk if asked
+    success = success && (!Config::getInstance().getAgentReadBackOnWrite() || readBackAndCompareMD5(chunk, digest));
+
+    if (success) {
+        memcpy(chunk.md5, digest, MD5_DIGEST_LENGTH);
+        elapsed = mytimer.elapsed().wall * 1.0 / 1e9;
+        LOG(INFO) << "Put chunk " << chunk.getChunkName() << " to path " << fpath << " size " << (chunk.size * 1.0 / (1 << 20)) << " MB in " << elapsed << "s, " << (chunk.size * 1.0 / (1 << 20)) / elapsed << " MB/s";
+    }
+
+    return success;
+}
+
+bool FsContainer::writeChunkFile(const char fpath[], const Chunk &chunk, MD5Calculator &md5) {
     // open (and truncate) the file for write
     FILE *chunkFile = fopen(fpath, "w");
     if (chunkFile == NULL) {
@@ -90,25 +212,18 @@ bool FsContainer::putChunk(Chunk &chunk) {
     ssize_t written = 0;
     while (written < chunk.size) {
         ssize_t ret = 0;
-        ret = fwrite(chunk.data + written, 1, chunk.size - written, chunkFile);
+        ret = fwrite(chunk.data + written, 1, std::min(chunk.size - written, (ssize_t) FS_WRITE_SLICE_SIZE), chunkFile);
         if (ret <= 0) {
             LOG(ERROR) << "Failed to write chunk data " << chunk.getChunkName() << " error = " << strerror(errno);
             flock(fileno(chunkFile), LOCK_UN);
             fclose(chunkFile);
             return false;
         }
+        md5.appendData(chunk.data + written, ret);
         written += ret;
     }
 
-    if (Config::getInstance().getAgentFlushOnClose()) {
-        fflush(chunkFile);
-        fsync(fileno(chunkFile));
-    }
-
-    // benchmark
-    double elapsed = mytimer.elapsed().wall * 1.0 / 1e9;
-    DLOG(INFO) << "<WRITE> Write chunk, size: " << (chunk.size * 1.0 / (1 << 20)) << " MB, time: " << elapsed << " s, speed: " << (chunk.size * 1.0 / (1 << 20)) / elapsed << " MB/s";
-
+    bool synced = !Config::getInstance().getAgentFlushOnClose() || (fflush(chunkFile) == 0 && syncChunkFile(fileno(chunkFile)));
 
     // unlock file after write
     flock(fileno(chunkFile), LOCK_UN);
@@ -116,23 +231,49 @@ bool FsContainer::putChunk(Chunk &chunk) {
     // close the chunk file
     fclose(chunkFile);
 
-    // check if all chunk data is successfully written
-    bool success = written == chunk.size;
-    // read chunk data back to get checksum, and verify the checksum if needed
-    Chunk readChunk;
-    readChunk.copyMeta(chunk);
-    success = success && (getChunkInternal(readChunk) || !Config::getInstance().verifyChunkChecksum());
+    return written == chunk.size && synced;
+}
 
-    if (success) {
-        readChunk.computeMD5();
-        chunk.copyMD5(readChunk);
-        elapsed = mytimer.elapsed().wall * 1.0 / 1e9;
-        LOG(INFO) << "Put chunk " << chunk.getChunkName() << " to path " << fpath << " size " << (chunk.size * 1.0 / (1 << 20)) << " MB in " << elapsed << "s, " << (chunk.size * 1.0 / (1 << 20)) / elapsed << " MB/s";
+bool FsContainer::writeChunkFileDirect(const char fpath[], const Chunk &chunk, MD5Calculator &md5) {
+    // open (and truncate) the file for write
+    int fd = openChunkFileDirect(fpath, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd == -1) {
+        LOG(ERROR) << "Failed to open chunk file " << fpath << " for write, " << strerror(errno);
+        return false;
     }
 
+    // lock file for write
+    flock(fd, LOCK_EX);
+
+    bool success = FsDirectIO::getInstance().writeChunk(fd, chunk, md5);
+    LOG_IF(ERROR, !success) << "Failed to write chunk data " << chunk.getChunkName();
+
+    success = success && (!Config::getInstance().getAgentFlushOnClose() || syncChunkFile(fd));
+
+    // unlock file after write
+    flock(fd, LOCK_UN);
+
+    close(fd);
+
     return success;
 }
 
+int FsContainer::openChunkFileDirect(const char fpath[], int flags) {
+    int fd = open(fpath, flags | O_DIRECT, 0666);
+    // fall back to buffered I/O on file systems without direct I/O support (e.g., tmpfs)
+    if (fd == -1 && errno == EINVAL) {
+        LOG_FIRST_N(WARNING, 1) << "Direct I/O is not supported for chunk file " << fpath << ", fall back to buffered I/O";
+        fd = open(fpath, flags, 0666);
+    }
+    return fd;
+}
+
+bool FsContainer::syncChunkFile(int fd) {
+    if (Config::getInstance().getAgentFsSyncBatching())
+        return FsSyncBatcher::getInstance().sync(fd);
+    return fsync(fd) == 0;
+}
+
 bool FsContainer::getChunk(Chunk &chunk, bool skipVerification) {
     char fpath[PATH_MAX];
     if (getChunkPath(fpath, chunk.getChunkName()) == false)
@@ -158,6 +299,9 @@ bool FsContainer::getChunkInternal(Chunk &chunk, bool skipVerification) {
 }
 
 bool FsContainer::readChunkFile(const char fpath[], Chunk &chunk) {
+    if (_ioEngine == FsIoEngine::DIRECT_FS_IO)
+        return readChunkFileDirect(fpath, chunk);
+
     FILE *chunkFile = fopen(fpath, "r");
     if (chunkFile == NULL) {
         LOG(ERROR) << "Failed to open chunk file " << fpath;
@@ -176,8 +320,13 @@ bool FsContainer::readChunkFile(const char fpath[], Chunk &chunk) {
     rewind(chunkFile);
     chunk.size = fsize;
 
-    // get chunk (file) data
-    chunk.data = (unsigned char*) malloc (fsize * sizeof(char));
+    // get chunk (file) data, into a pooled buffer which can be sent without copying
+    if (!chunk.allocateData(fsize)) {
+        LOG(ERROR) << "Failed to allocate memory for reading chunk file " << fpath;
+        flock(fileno(chunkFile), LOCK_UN);
+        fclose(chunkFile);
+        return false;
+    }
     size_t ret = 1;
     while (ret != 0) {
         ret = fread(chunk.data + read, 1, fsize - read, chunkFile);
@@ -200,12 +349,48 @@ bool FsContainer::readChunkFile(const char fpath[], Chunk &chunk) {
     return true;
 }
 
+bool FsContainer::readChunkFileDirect(const char fpath[], Chunk &chunk) {
+    int fd = openChunkFileDirect(fpath, O_RDONLY);
+    if (fd == -1) {
+        LOG(ERROR) << "Failed to open chunk file " << fpath;
+        return false;
+    }
+
+    boost::timer::cpu_timer mytimer;
+
+    // lock file for read
+    flock(fd, LOCK_SH);
+
+    bool success = FsDirectIO::getInstance().readChunk(fd, chunk);
+
+    // unlock file after read
+    flock(fd, LOCK_UN);
+
+    close(fd);
+
+    double elapsed = mytimer.elapsed().wall * 1.0 / 1e9;
+    LOG_IF(INFO, success) << "Get chunk " << chunk.getChunkName() << " to path " << fpath << " size " << (chunk.size * 1.0 / (1 << 20)) << " MB in " << elapsed << "s, " << (chunk.size * 1.0 / (1 << 20)) / elapsed << " MB/s";
+
+    return success;
+}
+
+bool FsContainer::readBackAndCompareMD5(const Chunk &chunk, const unsigned char md5[MD5_DIGEST_LENGTH]) {
+    Chunk readChunk;
+    readChunk.copyMeta(chunk);
+    memcpy(readChunk.md5, md5, MD5_DIGEST_LENGTH);
+    bool matched = getChunkInternal(readChunk, /* skip verification */ true) && readChunk.verifyMD5();
+    LOG_IF(ERROR, !matched) << "Checksum mismatched for chunk " << chunk.getChunkName() << " read back from disk";
+    return matched;
+}
+
 bool FsContainer::deleteChunk(const Chunk &chunk) {
     char fpath[PATH_MAX];
     if (getChunkPath(fpath, chunk.getChunkName()) == false)
         return false;
 
-    unlink(fpath);
+    long int size = getFileSize(fpath);
+    if (unlink(fpath) == 0)
+        addUsage(size, 0);
     LOG(INFO) << "Delete chunk " << chunk.getChunkName() << " at path " << fpath;
 
     return true;
@@ -215,21 +400,29 @@ bool FsContainer::copyChunk(const Chunk &src, Chunk &dst) {
     char sfpath[PATH_MAX], dfpath[PATH_MAX];
     if (getChunkPath(sfpath, src.getChunkName()) == false)
         return false;
-    if (getChunkPath(dfpath, dst.getChunkName()) == false)
+    if (getChunkPath(dfpath, dst.getChunkName()) == false || makeChunkDir(dfpath) == false)
         return false;
     
     unsigned long int copyBlockSize = Config::getInstance().getCopyBlockSize();
+    long int prevSize = getFileSize(dfpath);
     char buffer[copyBlockSize];
     FILE *srcFile = fopen(sfpath, "r");
     FILE *dstFile = fopen(dfpath, "w");
 
-    if (srcFile == NULL || dstFile == NULL)
+    if (srcFile == NULL || dstFile == NULL) {
+        if (srcFile != NULL)
+            fclose(srcFile);
+        if (dstFile != NULL)
+            fclose(dstFile);
         return false;
+    }
 
     // lock files for read/write
     flock(fileno(srcFile), LOCK_SH);
     flock(fileno(dstFile), LOCK_EX);
 
+    // compute the checksum over the data copied, instead of reading the copied chunk back
+    MD5Calculator md5;
     size_t ret = 0;
     int size = 0;
     while (1) {
@@ -240,6 +433,7 @@ bool FsContainer::copyChunk(const Chunk &src, Chunk &dst) {
             LOG(ERROR) << "Failed to copy a file (not enough storage space?)";
             break;
         }
+        md5.appendData((unsigned char *) buffer, ret);
         size += ret;
     }
 
@@ -250,13 +444,21 @@ bool FsContainer::copyChunk(const Chunk &src, Chunk &dst) {
     fclose(srcFile);
     fclose(dstFile);
 
+    addUsage(prevSize, getFileSize(dfpath));
+
     // check if the whole chuck is copied
     bool success = size == src.size;
 
-    // always compute and copy the MD5 of the copied chunk, and verify the checksum if needed
-    Chunk readChunk;
-    readChunk.copyMeta(dst);
-    success = success && (getChunkInternal(readChunk) || !Config::getInstance().verifyChunkChecksum());
+    // always copy the MD5 of the copied chunk, and verify the checksum against that of the source chunk if needed
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    unsigned int digestLength = MD5_DIGEST_LENGTH;
+    success = success && md5.finalize(digest, digestLength);
+    if (success && Config::getInstance().verifyChunkChecksum() && memcmp(digest, src.md5, MD5_DIGEST_LENGTH) != 0) {
+        LOG(ERROR) << "Checksum mismatched for chunk " << src.getChunkName() << " copied to path " << dfpath;
+        success = false;
+    }
+    // read the copied chunk back to verify the data on disk if asked
+    success = success && (!Config::getInstance().getAgentReadBackOnWrite() || readBackAndCompareMD5(dst, digest));
 
     // remove newly copied chunk if (checksum verification) failed
     if (!success) {
@@ -265,8 +467,7 @@ bool FsContainer::copyChunk(const Chunk &src, Chunk &dst) {
         // mark the size copied
         dst.size = size;
         // mark the md5 of the copied chunk
-        readChunk.computeMD5();
-        dst.copyMD5(readChunk);
+        memcpy(dst.md5, digest, MD5_DIGEST_LENGTH);
         LOG(INFO) << "Copy chunk " << src.getChunkName() << " to " << dst.getChunkName() << " from path " << sfpath << " to path " << dfpath;
     }
 
@@ -277,31 +478,44 @@ bool FsContainer::moveChunk(const Chunk &src, Chunk &dst) {
     char sfpath[PATH_MAX], dfpath[PATH_MAX];
     if (getChunkPath(sfpath, src.getChunkName()) == false)
         return false;
-    if (getChunkPath(dfpath, dst.getChunkName()) == false)
+    if (getChunkPath(dfpath, dst.getChunkName()) == false || makeChunkDir(dfpath) == false)
         return false;
 
     struct stat sbuf;
     if (stat(sfpath, &sbuf) != 0) 
         return false;
+    long int prevSize = sbuf.st_size + getFileSize(dfpath);
     
     bool success = rename(sfpath, dfpath) == 0;
 
-    // read the chunk for checksum computation if the request is successful
-    Chunk readChunk;
-    readChunk.copyMeta(dst);
-    success = success && (getChunkInternal(readChunk) || !Config::getInstance().verifyChunkChecksum());
+    // the data is not changed by the rename, so the checksum of the source chunk applies to the moved chunk;
+    // read the moved chunk only if the checksum of the source chunk is unknown, or to verify the checksum if needed
+    static const unsigned char noMD5[MD5_DIGEST_LENGTH] = { 0 };
+    bool hasMD5 = memcmp(src.md5, noMD5, MD5_DIGEST_LENGTH) != 0;
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    memcpy(digest, src.md5, MD5_DIGEST_LENGTH);
+    if (success && !hasMD5) {
+        Chunk readChunk;
+        readChunk.copyMeta(dst);
+        success = getChunkInternal(readChunk, /* skip verification */ true);
+        readChunk.computeMD5();
+        memcpy(digest, readChunk.md5, MD5_DIGEST_LENGTH);
+    } else if (success && (Config::getInstance().verifyChunkChecksum() || Config::getInstance().getAgentReadBackOnWrite())) {
+        success = readBackAndCompareMD5(dst, digest);
+    }
 
     if (success) {
         // mark the size moved
         dst.size = sbuf.st_size;
         // mark the md5 of the moved chunk
-        readChunk.computeMD5();
-        dst.copyMD5(readChunk);
+        memcpy(dst.md5, digest, MD5_DIGEST_LENGTH);
         LOG(INFO) << "Move chunk " << src.getChunkName() << " to " << dst.getChunkName() << " from path " << sfpath << " to path " << dfpath;
     } else { // revert the change if (checksum verification) failed
         rename(dfpath, sfpath);
     }
 
+    addUsage(prevSize, getFileSize(sfpath) + getFileSize(dfpath));
+
     return success;
 }
 
@@ -327,6 +541,7 @@ bool FsContainer::revertChunk(const Chunk &chunk) {
 
     getOldChunkPath(ofpath, fpath, chunk.chunkVersion);
     getOldChunkPath(tfpath, fpath, "0");
+    long int prevSize = getFileSize(fpath);
 
     rename(fpath, tfpath.c_str());
     bool okay = rename(ofpath.c_str(), fpath) == 0;
@@ -335,8 +550,11 @@ bool FsContainer::revertChunk(const Chunk &chunk) {
         LOG(ERROR) << "Failed to revert chunk " << fpath << " back to version "  << chunk.chunkVersion << " (" << ofpath << ")";
     } else {
         unlink(tfpath.c_str());
+        removeOldChunk(ofpath);
     }
 
+    addUsage(prevSize, getFileSize(fpath));
+
     return okay;
 }
 
@@ -358,21 +576,151 @@ bool FsContainer::verifyChunk(const Chunk &chunk) {
         
 }
 
-bool FsContainer::getTotalSize(unsigned long int &total, bool needsLock) {
-    total = 0;
-    // sum up the size of all files
-    try {
-        for (boost::filesystem::directory_entry &f : boost::filesystem::recursive_directory_iterator(boost::filesystem::path(_dir))) {
-            if (boost::filesystem::is_regular_file(f.path()) && !isOldChunks(f.path().c_str()))
-                total += boost::filesystem::file_size(f.path());
+bool FsContainer::scanChunkFiles(bool migrate) {
+    bool okay = true;
+
+    // move the chunk files not in the configured layout, e.g., all files directly in the directory for the flat layout
+    if (migrate) {
+        std::vector<std::string> dirs;
+        unsigned long int numMoved = 0;
+        char fpath[PATH_MAX];
+        okay = walkChunkFiles([&](const std::string &path, const struct stat &sbuf) {
+            // old versions follow the current version, which is placed by the chunk name before the version
+            size_t nameOfs = path.rfind('/') + 1;
+            size_t versionOfs = path.find('.', nameOfs);
+            std::string name = path.substr(nameOfs, versionOfs == std::string::npos? std::string::npos : versionOfs - nameOfs);
+            if (getChunkPath(fpath, name) == false)
+                return;
+            std::string npath(fpath);
+            if (versionOfs != std::string::npos)
+                npath.append(path, versionOfs, std::string::npos);
+            if (npath == path)
+                return;
+            if (makeChunkDir(npath.c_str()) == false || rename(path.c_str(), npath.c_str()) != 0) {
+                LOG(ERROR) << "Failed to move chunk file " << path << " to " << npath;
+                okay = false;
+                return;
+            }
+            numMoved++;
+            LOG_IF(INFO, numMoved % 100000 == 0) << "Moved " << numMoved << " chunk files in container directory " << _dir;
+        }, &dirs) && okay;
+        // remove the subdirectories left empty, children before parents
+        for (auto it = dirs.rbegin(); it != dirs.rend(); it++)
+            rmdir(it->c_str());
+        LOG(INFO) << "Moved " << numMoved << " chunk files in container directory " << _dir << " to " << _dirLevels << " levels of subdirectories";
+    }
+
+    // sum up the size of current chunks, and find the old chunks
+    long int usage = 0;
+    std::map<std::string, time_t> oldChunks;
+    okay = walkChunkFiles([&](const std::string &path, const struct stat &sbuf) {
+        if (isOldChunks(path.c_str()))
+            oldChunks[path] = sbuf.st_mtime;
+        else
+            usage += sbuf.st_size;
+    }) && okay;
+
+    _chunkUsage = usage;
+    std::lock_guard<std::mutex> lk(_oldChunksLock);
+    _oldChunks.swap(oldChunks);
+
+    return okay;
+}
+
+bool FsContainer::walkChunkFiles(std::function<void(const std::string &, const struct stat &)> visit, std::vector<std::string> *dirs) {
+    bool okay = true;
+    std::vector<std::string> toList (1, std::string(_dir));
+    while (!toList.empty()) {
+        std::string dpath = toList.back();
+        toList.pop_back();
+        DIR *dir = opendir(dpath.c_str());
+        if (dir == NULL) {
+            LOG(ERROR) << "Failed to list directory " << dpath << ", " << strerror(errno);
+            okay = false;
+            continue;
+        }
+        struct dirent *entry = NULL;
+        while ((entry = readdir(dir)) != NULL) {
+            // skip the current and parent directories, and the summary files
+            if (entry->d_name[0] == '.')
+                continue;
+            std::string path = dpath + "/" + entry->d_name;
+            struct stat sbuf;
+            if (lstat(path.c_str(), &sbuf) != 0)
+                continue;
+            if (S_ISDIR(sbuf.st_mode)) {
+                toList.push_back(path);
+                if (dirs != NULL)
+                    dirs->push_back(path);
+            } else if (S_ISREG(sbuf.st_mode)) {
+                visit(path, sbuf);
+            }
         }
-    } catch (std::exception &e) {
-        LOG(ERROR) << "Failed to list directory " << _dir << ", " << e.what();
+        closedir(dir);
+    }
+    return okay;
+}
+
+bool FsContainer::loadSummary(int &levels, bool &clean) {
+    std::string path = std::string(_dir) + "/" + FS_SUMMARY_FILE;
+    FILE *summary = fopen(path.c_str(), "r");
+    if (summary == NULL)
+        return false;
+
+    long int usage = 0;
+    int isClean = 0;
+    bool okay = fscanf(summary, "levels %d\nusage %ld\nclean %d\n", &levels, &usage, &isClean) == 3;
+
+    // old chunks, with paths relative to the container directory
+    std::map<std::string, time_t> oldChunks;
+    char opath[PATH_MAX];
+    long int mtime = 0;
+    while (okay && fscanf(summary, "old %ld %4095s\n", &mtime, opath) == 2)
+        oldChunks[std::string(_dir) + "/" + opath] = mtime;
+    okay = okay && feof(summary);
+
+    fclose(summary);
+
+    if (!okay) {
+        LOG(WARNING) << "Failed to parse the summary " << path << " of container directory";
         return false;
     }
+
+    clean = isClean != 0;
+    _chunkUsage = usage;
+    std::lock_guard<std::mutex> lk(_oldChunksLock);
+    _oldChunks.swap(oldChunks);
+
     return true;
 }
 
+bool FsContainer::saveSummary(bool clean) {
+    std::string path = std::string(_dir) + "/" + FS_SUMMARY_FILE;
+    std::string tpath = path + ".tmp";
+    FILE *summary = fopen(tpath.c_str(), "w");
+    if (summary == NULL) {
+        LOG(ERROR) << "Failed to open the summary " << tpath << " of container directory, " << strerror(errno);
+        return false;
+    }
+
+    // mark an unknown layout if the chunk files are not all moved to the configured layout, to retry on the next start
+    fprintf(summary, "levels %d\nusage %ld\nclean %d\n", _layoutReady? _dirLevels : -1, _chunkUsage.load(), clean? 1 : 0);
+    size_t dirLength = strlen(_dir) + 1;
+    {
+        std::lock_guard<std::mutex> lk(_oldChunksLock);
+        for (auto &oldChunk : _oldChunks)
+            fprintf(summary, "old %ld %s\n", (long int) oldChunk.second, oldChunk.first.c_str() + dirLength);
+    }
+
+    bool okay = fflush(summary) == 0 && fsync(fileno(summary)) == 0;
+    okay = fclose(summary) == 0 && okay;
+    // replace the summary atomically
+    okay = okay && rename(tpath.c_str(), path.c_str()) == 0;
+    LOG_IF(ERROR, !okay) << "Failed to save the summary " << path << " of container directory";
+
+    return okay;
+}
+
 bool FsContainer::isOldChunks(const char *fpath) {
     // find the flie name in the path
     const char *idx = strrchr(fpath, '/');
@@ -381,12 +729,9 @@ bool FsContainer::isOldChunks(const char *fpath) {
 }
 
 void FsContainer::updateUsage() {
-    unsigned long int total = 0;
-    if (getTotalSize(total)) {
-        _usage = total;
-    } else {
-        LOG(WARNING) << "Failed to update usage for container id = " << _id;
-    }
+    // the usage is tracked on every change instead of scanning the directory
+    long int usage = _chunkUsage;
+    _usage = usage > 0? usage : 0;
 }
 
 void *FsContainer::cleanUpOldChunks(void *arg) {
@@ -399,31 +744,26 @@ void *FsContainer::cleanUpOldChunks(void *arg) {
     do {
         clock_gettime(CLOCK_REALTIME, &nextSchTime);
         nextSchTime.tv_sec += timeout;
-        // wait for signal or timeout before next checking and cleaning
-        pthread_cond_timedwait(&container->_chunkCleanUp.cond, &container->_chunkCleanUp.lock, &nextSchTime);
-        // check and clean up
-        bool removed = false;
-        do {
-            // work-around for exception throw of invalid pointer after file removal
-            removed = false;
-            try {
-                // go over the directory
-                for (boost::filesystem::directory_entry &f : boost::filesystem::recursive_directory_iterator(boost::filesystem::path(container->_dir))) {
-                    //LOG(INFO) << "Clean up check path " << f.path();
-                    // skip (1) non-regular files, (2) files that are not old ones, and (3) old chunks that is yet expired (10mins)
-                    if (!boost::filesystem::is_regular_file(f.path()) ||
-                        !isOldChunks(f.path().c_str()) ||
-                        boost::filesystem::last_write_time(f.path()) + timeout * 10 > time(NULL))
-                        continue;
-                    // clean the chunk
-                    LOG(INFO) << "Clean chunk at " << f.path() << " of size " << boost::filesystem::file_size(f.path());
-                    unlink(f.path().c_str());
-                    removed = true;
-                }
-            } catch (std::exception &e) {
-                //LOG(ERROR) << "Failed to list directory " << container->_dir << " for cleaning up old chunks, " << e.what();
+        // wait for signal or timeout before next checking and cleaning, unless the container is already stopping
+        if (container->_running)
+            pthread_cond_timedwait(&container->_chunkCleanUp.cond, &container->_chunkCleanUp.lock, &nextSchTime);
+        // clean up the old chunks that are expired (10mins)
+        std::vector<std::string> expired;
+        time_t now = time(NULL);
+        container->_oldChunksLock.lock();
+        for (auto it = container->_oldChunks.begin(); it != container->_oldChunks.end(); ) {
+            if (it->second + timeout * 10 > now) {
+                it++;
+                continue;
             }
-        } while (removed);
+            expired.push_back(it->first);
+            it = container->_oldChunks.erase(it);
+        }
+        container->_oldChunksLock.unlock();
+        for (std::string &path : expired) {
+            LOG(INFO) << "Clean chunk at " << path;
+            unlink(path.c_str());
+        }
     } while (container->_running);
     pthread_mutex_unlock(&container->_chunkCleanUp.lock);
 
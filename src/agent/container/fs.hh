@@ -3,13 +3,38 @@
 #ifndef __FS_CONTAINER_HH__
 #define __FS_CONTAINER_HH__
 
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <pthread.h>
+#include <sys/stat.h>
 #include <linux/limits.h>
 
 #include "container.hh"
+#include "../../common/checksum_calculator.hh"
 #include "../../ds/chunk.hh"
 
+/**
+ * Container of chunk files on a local file system
+ *
+ * Chunk files are spread over misc.fs_dir_levels levels of subdirectories
+ * (none by default, i.e., all in the container directory), named by
+ * consecutive bytes (in hex) of the hash of the chunk name, e.g.,
+ * "<dir>/3f/a0/<chunk name>" for two levels. Old versions of a chunk (named
+ * "<chunk name>.<version>") are kept next to the current one until they are
+ * cleaned up.
+ *
+ * The total size of the current chunk files is updated on every change
+ * instead of scanning the directory. It is saved together with the layout and
+ * the list of old versions in a summary file in the container directory,
+ * which is loaded on start. The container directory is scanned only if the
+ * summary is missing or not saved on a clean shutdown, and chunk files are
+ * moved to the configured layout if the layout changes (e.g., from the flat
+ * layout of previous releases).
+ **/
 class FsContainer : public Container {
 public:
     FsContainer(int id, const char* dir, unsigned long int capacity);
@@ -69,6 +94,12 @@ private:
     } _chunkCleanUp;
 
     bool _running; /**< whether the container is "running" */
+    int _ioEngine; /**< I/O engine for chunk files (see FsIoEngine) */
+    int _dirLevels; /**< number of levels of hashed subdirectories for chunk files */
+    bool _layoutReady; /**< whether all chunk files are in the configured layout */
+    std::atomic<long int> _chunkUsage; /**< total size of the current chunk files */
+    std::mutex _oldChunksLock; /**< lock on the list of old chunks */
+    std::map<std::string, time_t> _oldChunks; /**< path of old chunk versions to their last modification time */
 
     /**
      * Get the path of chunk file
@@ -82,12 +113,143 @@ private:
 
     void getOldChunkPath(std::string &ofpath, char *fpath, const char *ctime);
 
-    bool getTotalSize(unsigned long int &total, bool needsLock = true);
+    /**
+     * Create the subdirectories of a chunk file if they do not exist
+     *
+     * @param[in] fpath       path of the chunk file
+     *
+     * @return whether the subdirectories exist
+     **/
+    bool makeChunkDir(const char fpath[]);
+
+    /**
+     * Add the change in size of current chunk files to the container usage
+     *
+     * @param[in] before      total size of the files before the change
+     * @param[in] after       total size of the files after the change
+     **/
+    void addUsage(long int before, long int after);
+
+    /**
+     * Track an old chunk version for clean up
+     *
+     * @param[in] ofpath      path of the old chunk version
+     * @param[in] mtime       last modification time of the old chunk version
+     **/
+    void addOldChunk(const std::string &ofpath, time_t mtime);
+
+    /**
+     * Stop tracking an old chunk version, e.g., after it is reverted to
+     *
+     * @param[in] ofpath      path of the old chunk version
+     **/
+    void removeOldChunk(const std::string &ofpath);
+
+    /**
+     * Scan the container directory for the total size of current chunk files and the old chunk versions
+     *
+     * @param[in] migrate     whether to move chunk files not in the configured layout first
+     *
+     * @return whether the scan completes
+     **/
+    bool scanChunkFiles(bool migrate);
+
+    /**
+     * Go over the files under the container directory, except the summary files
+     *
+     * @param[in] visit       function called with the path of each regular file and its status
+     * @param[out] dirs       subdirectories visited (parents first), if not NULL
+     *
+     * @return whether all directories are listed
+     **/
+    bool walkChunkFiles(std::function<void(const std::string &, const struct stat &)> visit, std::vector<std::string> *dirs = NULL);
+
+    /**
+     * Load the summary of the container directory saved
+     *
+     * @param[out] levels     number of levels of hashed subdirectories of the chunk files
+     * @param[out] clean      whether the summary is saved on a clean shutdown
+     *
+     * @return whether the summary is loaded
+     **/
+    bool loadSummary(int &levels, bool &clean);
+
+    /**
+     * Save the summary of the container directory, including the container usage and the old chunk versions
+     *
+     * @param[in] clean       whether the container is shutting down
+     *
+     * @return whether the summary is saved
+     **/
+    bool saveSummary(bool clean);
+
+    /**
+     * Get the size of a file
+     *
+     * @param[in] fpath       path of the file
+     * @param[out] mtime      last modification time of the file, if not NULL
+     *
+     * @return size of the file, 0 if the file does not exist
+     **/
+    static long int getFileSize(const char *fpath, time_t *mtime = NULL);
 
     bool getChunkInternal(Chunk &chunk, bool skipVerification = false);
 
+    /**
+     * Write the data of a chunk to a file via buffered I/O
+     *
+     * @param[in] fpath     path of the chunk file
+     * @param[in] chunk     chunk to write
+     * @param[out] md5      checksum calculator to append the chunk data written to
+     *
+     * @return whether all chunk data is written (and synced if needed)
+     **/
+    bool writeChunkFile(const char fpath[], const Chunk &chunk, MD5Calculator &md5);
+
+    /**
+     * Write the data of a chunk to a file via direct I/O (see FsDirectIO)
+     *
+     * @param[in] fpath     path of the chunk file
+     * @param[in] chunk     chunk to write
+     * @param[out] md5      checksum calculator to append the chunk data written to
+     *
+     * @return whether all chunk data is written (and synced if needed)
+     **/
+    bool writeChunkFileDirect(const char fpath[], const Chunk &chunk, MD5Calculator &md5);
+
     bool readChunkFile(const char fpath[], Chunk &chunk);
 
+    bool readChunkFileDirect(const char fpath[], Chunk &chunk);
+
+    /**
+     * Open a chunk file for direct I/O, or for buffered I/O if the file system does not support direct I/O
+     *
+     * @param[in] fpath     path of the chunk file
+     * @param[in] flags     flags for open()
+     *
+     * @return the file descriptor, -1 on failure
+     **/
+    static int openChunkFileDirect(const char fpath[], int flags);
+
+    /**
+     * Sync the data of a chunk file to disk, in a batch with other chunk files if misc.fs_sync_batching is enabled
+     *
+     * @param[in] fd        descriptor of the chunk file
+     *
+     * @return whether the chunk file is synced
+     **/
+    static bool syncChunkFile(int fd);
+
+    /**
+     * Read a chunk file back and compare the checksum of its data with the expected one
+     *
+     * @param[in] chunk     chunk to read
+     * @param[in] md5       expected checksum of the chunk data
+     *
+     * @return whether the chunk file is read and its checksum matches
+     **/
+    bool readBackAndCompareMD5(const Chunk &chunk, const unsigned char md5[MD5_DIGEST_LENGTH]);
+
     static bool isOldChunks(const char *fpath);
 
     static void *cleanUpOldChunks(void *arg);
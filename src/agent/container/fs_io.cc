@@ -0,0 +1,269 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <errno.h>
+#include <fcntl.h> // sync_file_range()
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include "../../common/config.hh"
+#include "fs_io.hh"
+
+static_assert(CHUNK_BUFFER_ALIGNMENT % FS_DIRECT_IO_ALIGNMENT == 0, "Pooled chunk buffers must be aligned for direct I/O");
+
+static size_t alignUp(size_t length) {
+    return (length + FS_DIRECT_IO_ALIGNMENT - 1) / FS_DIRECT_IO_ALIGNMENT * FS_DIRECT_IO_ALIGNMENT;
+}
+
+/**
+ * Transfer data to or from a file until all data is transferred, or the end of file is reached on read
+ *
+ * @return number of bytes transferred, -1 on error
+ **/
+static ssize_t transferFully(int fd, unsigned char *buf, size_t length, off_t offset, bool write) {
+    size_t transferred = 0;
+    while (transferred < length) {
+        ssize_t ret = write?
+                pwrite(fd, buf + transferred, length - transferred, offset + transferred) :
+                pread(fd, buf + transferred, length - transferred, offset + transferred);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret < 0) {
+            LOG(ERROR) << "Failed to " << (write? "write" : "read") << " chunk file at offset " << offset + transferred << ", " << strerror(errno);
+            return -1;
+        }
+        if (ret == 0)
+            break;
+        transferred += ret;
+    }
+    return transferred;
+}
+
+FsDirectIO::FsDirectIO() {
+    Config &config = Config::getInstance();
+    _ioDepth = config.getAgentFsIoDepth();
+    _running = true;
+    // enough threads to keep the requests of all agent workers in flight
+    int numThreads = std::min(config.getAgentNumWorkers() * _ioDepth, MAX_NUM_WORKERS);
+    for (int i = 0; i < numThreads; i++)
+        _ioThreads.emplace_back(&FsDirectIO::runIoThread, this);
+    LOG(INFO) << "Direct I/O engine started with " << numThreads << " I/O threads and I/O depth " << _ioDepth;
+}
+
+FsDirectIO::~FsDirectIO() {
+    {
+        std::lock_guard<std::mutex> lk(_queueLock);
+        _running = false;
+    }
+    _hasRequest.notify_all();
+    for (std::thread &t : _ioThreads)
+        t.join();
+}
+
+bool FsDirectIO::writeChunk(int fd, const Chunk &chunk, MD5Calculator &md5) {
+    size_t size = chunk.size > 0? chunk.size : 0;
+    std::vector<Segment> segments((size + FS_DIRECT_IO_SEGMENT_SIZE - 1) / FS_DIRECT_IO_SEGMENT_SIZE);
+
+    Transfer transfer;
+    transfer.numInflight = 0;
+    transfer.okay = true;
+
+    bool okay = true;
+    size_t numSetup = 0;
+    for (; numSetup < segments.size() && okay; numSetup++) {
+        Segment &seg = segments.at(numSetup);
+        off_t offset = numSetup * FS_DIRECT_IO_SEGMENT_SIZE;
+        size_t length = std::min(size - offset, (size_t) FS_DIRECT_IO_SEGMENT_SIZE);
+        if (!setupSegment(seg, chunk.data + offset, length, length, offset)) {
+            okay = false;
+            break;
+        }
+        // stage the data, with the padding zeroed
+        if (seg.staging != NULL) {
+            memcpy(seg.buf, seg.data, seg.length);
+            memset(seg.buf + seg.length, 0, seg.ioLength - seg.length);
+        }
+        okay = submit(transfer, [fd, &seg]() {
+            return transferFully(fd, seg.buf, seg.ioLength, seg.offset, /* write */ true) == (ssize_t) seg.ioLength;
+        });
+        // compute the checksum while the segment (and those before) are written
+        md5.appendData(seg.data, seg.length);
+    }
+    okay = wait(transfer) && okay;
+
+    for (size_t i = 0; i < numSetup; i++) {
+        if (segments.at(i).staging != NULL)
+            segments.at(i).staging->release();
+    }
+
+    // remove the padding of the last segment
+    if (okay && size % FS_DIRECT_IO_ALIGNMENT != 0 && ftruncate(fd, size) != 0) {
+        LOG(ERROR) << "Failed to truncate chunk file to size " << size << ", " << strerror(errno);
+        okay = false;
+    }
+
+    return okay;
+}
+
+bool FsDirectIO::readChunk(int fd, Chunk &chunk) {
+    struct stat sbuf;
+    if (fstat(fd, &sbuf) != 0)
+        return false;
+    size_t size = sbuf.st_size;
+
+    // read into a pooled buffer, which is aligned for direct I/O and can be sent without copying
+    if (!chunk.allocateData(alignUp(size))) {
+        LOG(ERROR) << "Failed to allocate memory for reading chunk file of size " << size;
+        return false;
+    }
+    chunk.size = size;
+
+    std::vector<Segment> segments((size + FS_DIRECT_IO_SEGMENT_SIZE - 1) / FS_DIRECT_IO_SEGMENT_SIZE);
+
+    Transfer transfer;
+    transfer.numInflight = 0;
+    transfer.okay = true;
+
+    bool okay = true;
+    size_t numSetup = 0;
+    for (; numSetup < segments.size() && okay; numSetup++) {
+        Segment &seg = segments.at(numSetup);
+        off_t offset = numSetup * FS_DIRECT_IO_SEGMENT_SIZE;
+        size_t length = std::min(size - offset, (size_t) FS_DIRECT_IO_SEGMENT_SIZE);
+        if (!setupSegment(seg, chunk.data + offset, length, alignUp(length), offset)) {
+            okay = false;
+            break;
+        }
+        okay = submit(transfer, [fd, &seg]() {
+            if (transferFully(fd, seg.buf, seg.ioLength, seg.offset, /* write */ false) < (ssize_t) seg.length)
+                return false;
+            if (seg.staging != NULL)
+                memcpy(seg.data, seg.buf, seg.length);
+            return true;
+        });
+    }
+    okay = wait(transfer) && okay;
+
+    for (size_t i = 0; i < numSetup; i++) {
+        if (segments.at(i).staging != NULL)
+            segments.at(i).staging->release();
+    }
+
+    return okay;
+}
+
+bool FsDirectIO::setupSegment(Segment &seg, unsigned char *data, size_t length, size_t capacity, off_t offset) {
+    seg.data = data;
+    seg.length = length;
+    seg.ioLength = alignUp(length);
+    seg.offset = offset;
+    seg.staging = NULL;
+    seg.buf = data;
+
+    // transfer the chunk data directly if it is aligned and the aligned length fits in the buffer
+    if ((uintptr_t) data % FS_DIRECT_IO_ALIGNMENT == 0 && seg.ioLength <= capacity)
+        return true;
+
+    seg.staging = ChunkBufferPool::getInstance().get(seg.ioLength);
+    if (seg.staging == NULL) {
+        LOG(ERROR) << "Failed to allocate a staging buffer for direct I/O of size " << seg.ioLength;
+        return false;
+    }
+    seg.buf = seg.staging->getData();
+    return true;
+}
+
+bool FsDirectIO::submit(Transfer &transfer, std::function<bool()> request) {
+    {
+        std::unique_lock<std::mutex> lk(transfer.lock);
+        transfer.done.wait(lk, [this, &transfer] { return transfer.numInflight < _ioDepth; });
+        // stop submitting once a request has failed
+        if (!transfer.okay)
+            return false;
+        transfer.numInflight++;
+    }
+
+    Transfer *t = &transfer;
+    {
+        std::lock_guard<std::mutex> lk(_queueLock);
+        _requests.emplace_back([t, request]() {
+            bool okay = request();
+            std::lock_guard<std::mutex> tlk(t->lock);
+            t->okay = t->okay && okay;
+            t->numInflight--;
+            t->done.notify_all();
+        });
+    }
+    _hasRequest.notify_one();
+
+    return true;
+}
+
+bool FsDirectIO::wait(Transfer &transfer) {
+    std::unique_lock<std::mutex> lk(transfer.lock);
+    transfer.done.wait(lk, [&transfer] { return transfer.numInflight == 0; });
+    return transfer.okay;
+}
+
+void FsDirectIO::runIoThread() {
+    std::unique_lock<std::mutex> lk(_queueLock);
+    while (true) {
+        _hasRequest.wait(lk, [this] { return !_running || !_requests.empty(); });
+        // drain the pending requests before exit
+        if (_requests.empty())
+            break;
+        std::function<void()> request = std::move(_requests.front());
+        _requests.pop_front();
+        lk.unlock();
+        request();
+        lk.lock();
+    }
+}
+
+FsSyncBatcher::FsSyncBatcher() {
+    _syncing = false;
+}
+
+bool FsSyncBatcher::sync(int fd) {
+    Request req;
+    req.fd = fd;
+    req.done = false;
+    req.okay = false;
+
+    std::unique_lock<std::mutex> lk(_lock);
+    _pending.push_back(&req);
+    while (!req.done) {
+        // wait for the batch in progress, which may include this request
+        if (_syncing) {
+            _batchDone.wait(lk);
+            continue;
+        }
+
+        // lead a new batch of all requests waiting
+        _syncing = true;
+        std::vector<Request *> batch;
+        batch.swap(_pending);
+        lk.unlock();
+
+        // start the write-back of all files first, so they are written to disk in parallel
+        for (Request *r : batch)
+            sync_file_range(r->fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+        for (Request *r : batch) {
+            r->okay = fdatasync(r->fd) == 0;
+            LOG_IF(ERROR, !r->okay) << "Failed to sync chunk file, " << strerror(errno);
+        }
+        DLOG(INFO) << "Synced a batch of " << batch.size() << " chunk files";
+
+        lk.lock();
+        for (Request *r : batch)
+            r->done = true;
+        _syncing = false;
+        _batchDone.notify_all();
+    }
+
+    return req.okay;
+}
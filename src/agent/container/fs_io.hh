@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __FS_IO_HH__
+#define __FS_IO_HH__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../../common/checksum_calculator.hh"
+#include "../../ds/chunk.hh"
+
+#define FS_DIRECT_IO_ALIGNMENT    (4096)     // alignment of buffers, offsets, and lengths of direct I/O requests
+#define FS_DIRECT_IO_SEGMENT_SIZE (1 << 20)  // max. size of data transferred by a direct I/O request
+
+/**
+ * Direct I/O engine for chunk files of file system containers
+ *
+ * A chunk is transferred in segments of up to FS_DIRECT_IO_SEGMENT_SIZE bytes
+ * via pread() and pwrite() on a file opened with O_DIRECT, which bypasses the
+ * page cache. Segments are served by a pool of I/O threads shared by all
+ * containers, with up to misc.fs_io_depth segments of a chunk in flight, and
+ * the checksum of a segment is computed while the previous ones are written.
+ *
+ * Data not aligned to FS_DIRECT_IO_ALIGNMENT in memory (e.g., data in network
+ * messages) is staged through pooled buffers. The last segment of a file is
+ * padded to the alignment on write, and the file is truncated to the chunk
+ * size afterwards.
+ **/
+class FsDirectIO {
+public:
+    static FsDirectIO &getInstance() {
+        static FsDirectIO instance;
+        return instance;
+    }
+
+    /**
+     * Write the data of a chunk to a file, from the beginning of the file
+     *
+     * @param[in] fd        descriptor of the file, opened for write
+     * @param[in] chunk     chunk to write
+     * @param[out] md5      checksum calculator to append the chunk data to
+     *
+     * @return whether all chunk data is written
+     **/
+    bool writeChunk(int fd, const Chunk &chunk, MD5Calculator &md5);
+
+    /**
+     * Read the whole file into the data of a chunk
+     *
+     * @param[in] fd        descriptor of the file, opened for read
+     * @param[out] chunk    chunk to read into, Chunk::data and Chunk::size are filled on success
+     *
+     * @return whether the whole file is read
+     **/
+    bool readChunk(int fd, Chunk &chunk);
+
+private:
+    /**
+     * Direct I/O request on a segment of a file
+     **/
+    struct Segment {
+        unsigned char *data;        /**< segment of chunk data */
+        unsigned char *buf;         /**< aligned buffer to transfer, either the chunk data or a staging buffer */
+        ChunkBuffer *staging;       /**< staging buffer, NULL if the chunk data is transferred directly */
+        size_t length;              /**< length of chunk data in the segment */
+        size_t ioLength;            /**< length of data to transfer, aligned */
+        off_t offset;               /**< offset of the segment in the file */
+    };
+
+    /**
+     * State of the I/O requests of a chunk in flight
+     **/
+    struct Transfer {
+        std::mutex lock;
+        std::condition_variable done;
+        int numInflight;            /**< number of requests in flight */
+        bool okay;                  /**< whether all completed requests succeeded */
+    };
+
+    FsDirectIO();
+    ~FsDirectIO();
+    FsDirectIO(const FsDirectIO&) = delete;
+    void operator=(const FsDirectIO&) = delete;
+
+    /**
+     * Set up a segment of chunk data for transfer, with a staging buffer if the data is not aligned
+     *
+     * @param[out] seg      segment to set up
+     * @param[in] data      segment of chunk data
+     * @param[in] length    length of chunk data in the segment
+     * @param[in] capacity  number of bytes accessible from the start of the segment of chunk data
+     * @param[in] offset    offset of the segment in the file
+     *
+     * @return whether the segment is set up
+     **/
+    bool setupSegment(Segment &seg, unsigned char *data, size_t length, size_t capacity, off_t offset);
+
+    /**
+     * Submit a request to the I/O threads, after waiting for the number of requests in flight to drop below the I/O depth
+     *
+     * @return whether the request is submitted, false if a previous request of the transfer has failed
+     **/
+    bool submit(Transfer &transfer, std::function<bool()> request);
+
+    /**
+     * Wait for all requests of a transfer to complete
+     *
+     * @return whether all requests succeeded
+     **/
+    bool wait(Transfer &transfer);
+
+    void runIoThread();
+
+    int _ioDepth;                                       /**< max. number of requests in flight per chunk */
+    bool _running;                                      /**< whether the I/O threads are running */
+    std::mutex _queueLock;                              /**< lock on the request queue */
+    std::condition_variable _hasRequest;                /**< signal on new requests */
+    std::deque<std::function<void()>> _requests;        /**< requests pending */
+    std::vector<std::thread> _ioThreads;                /**< I/O threads */
+};
+
+/**
+ * Batching of file syncs
+ *
+ * Syncs of chunk files written at around the same time are issued together,
+ * as in a group commit: the first thread to sync becomes the leader which
+ * starts the write-back of all files waiting via sync_file_range(), before
+ * waiting for each of them via fdatasync(), so the files are flushed in
+ * parallel and share the file system journal commits. Threads arriving
+ * during a batch wait for the next one.
+ **/
+class FsSyncBatcher {
+public:
+    static FsSyncBatcher &getInstance() {
+        static FsSyncBatcher instance;
+        return instance;
+    }
+
+    /**
+     * Sync the data of a file to disk, together with the other files waiting
+     *
+     * @param[in] fd        descriptor of the file
+     *
+     * @return whether the file is synced
+     **/
+    bool sync(int fd);
+
+private:
+    struct Request {
+        int fd;                     /**< descriptor of the file to sync */
+        bool done;                  /**< whether the sync has completed */
+        bool okay;                  /**< whether the sync succeeded */
+    };
+
+    FsSyncBatcher();
+    FsSyncBatcher(const FsSyncBatcher&) = delete;
+    void operator=(const FsSyncBatcher&) = delete;
+
+    std::mutex _lock;                                   /**< lock on the requests and batch state */
+    std::condition_variable _batchDone;                 /**< signal on completion of a batch */
+    std::vector<Request *> _pending;                    /**< requests waiting for the next batch */
+    bool _syncing;                                      /**< whether a batch is in progress */
+};
+
+#endif // define __FS_IO_HH__
@@ -0,0 +1,1080 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h> // strtol()
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h> // open(), fallocate()
+#include <dirent.h> // opendir(), readdir()
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h> // pwritev()
+#include <algorithm>
+
+#include <boost/crc.hpp>
+#include <boost/timer/timer.hpp>
+
+#include <glog/logging.h>
+
+#include "../../common/checksum_calculator.hh"
+#include "../../common/config.hh"
+#include "fs_io.hh"
+#include "segment.hh"
+
+#define SEGMENT_FILE_PREFIX "segment_" // prefix of segment file names, followed by the segment id in 8 hex digits
+#define SEGMENT_CHECKPOINT_FILE ".index" // name of the index checkpoint in the container directory
+#define SEGMENT_READ_SLICE_SIZE (1 << 20) // size of data to read at once when verifying records on replay
+
+/**
+ * Write vectors of data to a file until all data is written
+ *
+ * @return whether all data is written
+ **/
+static bool writeFully(int fd, struct iovec *iov, int iovcnt, off_t offset) {
+    while (iovcnt > 0) {
+        ssize_t ret = pwritev(fd, iov, iovcnt, offset);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        offset += ret;
+        // skip the vectors written
+        for (; iovcnt > 0 && (size_t) ret >= iov->iov_len; iov++, iovcnt--)
+            ret -= iov->iov_len;
+        if (iovcnt > 0) {
+            iov->iov_base = (char *) iov->iov_base + ret;
+            iov->iov_len -= ret;
+        }
+    }
+    return true;
+}
+
+/**
+ * Read data from a file until the buffer is filled
+ *
+ * @return whether the buffer is filled
+ **/
+static bool readFully(int fd, void *buf, size_t length, off_t offset) {
+    size_t read = 0;
+    while (read < length) {
+        ssize_t ret = pread(fd, (char *) buf + read, length - read, offset + read);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        read += ret;
+    }
+    return true;
+}
+
+SegmentContainer::SegmentFile::~SegmentFile() {
+    close(fd);
+}
+
+SegmentContainer::SegmentContainer(int id, const char *dir, unsigned long int capacity) :
+        Container(id, capacity) {
+    static_assert(sizeof(RecordHeader) == 56, "Record header must have no padding");
+
+    strcpy(_dir, dir);
+    // remove the ending slashes
+    for (size_t length = strlen(_dir); length > 1 && _dir[length - 1] == '/'; length--)
+        _dir[length - 1] = 0;
+    Config &config = Config::getInstance();
+    _segmentSize = (unsigned long int) config.getAgentSegmentSize() << 20;
+    _compactionThreshold = config.getAgentSegmentCompactionThreshold();
+    _activeSegment = 0;
+    _appliedSegment = 0;
+    _checkpointSegment = 0;
+    _numChanges = 0;
+    _nextAppendSeq = 0;
+    _nextApplySeq = 0;
+    // create the directory for segment files
+    mkdir(_dir, 0755);
+
+    boost::timer::cpu_timer mytimer;
+
+    // load the index checkpoint, or replay all segments if there is none
+    uint32_t replayFrom = 0;
+    uint64_t replayOffset = 0;
+    if (!loadCheckpoint(replayFrom, replayOffset)) {
+        LOG(INFO) << "No index checkpoint found in container directory " << _dir << ", replay all segments";
+        _index.clear();
+        _segments.clear();
+        replayFrom = 0;
+        replayOffset = 0;
+    }
+    _activeSegment = replayFrom;
+
+    std::vector<uint32_t> ids;
+    if (!listSegments(ids))
+        LOG(ERROR) << "Failed to list segment files in container directory " << _dir;
+    char spath[PATH_MAX];
+    unsigned long int numReplayed = 0;
+    for (uint32_t sid : ids) {
+        // remove the segments compacted before the checkpoint, but not yet removed
+        if (sid < replayFrom && _segments.count(sid) == 0) {
+            if (getSegmentPath(spath, sid)) {
+                LOG(INFO) << "Remove compacted segment file " << spath;
+                unlink(spath);
+            }
+            continue;
+        }
+        std::shared_ptr<SegmentFile> file = openSegment(sid, /* create */ false);
+        if (file == NULL)
+            continue;
+        Segment &segment = _segments[sid];
+        segment.file = file;
+        // replay the records appended after the checkpoint
+        if (sid >= replayFrom) {
+            segment.used = replaySegment(sid, sid == replayFrom? replayOffset : 0);
+            numReplayed++;
+            _activeSegment = std::max(_activeSegment, sid);
+        }
+    }
+
+    // drop the segments missing, and the chunks in them
+    for (auto it = _segments.begin(); it != _segments.end(); ) {
+        if (it->second.file != NULL) {
+            it->second.live = 0;
+            it->second.appendOffset = it->second.used;
+            it++;
+            continue;
+        }
+        LOG(ERROR) << "Segment " << it->first << " in container directory " << _dir << " is missing, chunks in the segment are lost";
+        it = _segments.erase(it);
+    }
+    // count the live records in each segment
+    for (auto it = _index.begin(); it != _index.end(); ) {
+        Entry &entry = it->second;
+        if (entry.hasCurrent) {
+            auto sit = _segments.find(entry.current.segment);
+            entry.hasCurrent = sit != _segments.end();
+            if (entry.hasCurrent)
+                sit->second.live += entry.current.recordLength;
+        }
+        for (auto vit = entry.oldVersions.begin(); vit != entry.oldVersions.end(); ) {
+            auto sit = _segments.find(vit->second.segment);
+            if (sit == _segments.end()) {
+                vit = entry.oldVersions.erase(vit);
+                continue;
+            }
+            sit->second.live += vit->second.recordLength;
+            vit++;
+        }
+        if (!entry.hasCurrent && entry.oldVersions.empty())
+            it = _index.erase(it);
+        else
+            it++;
+    }
+
+    // create the active segment if it is not found
+    if (_segments.count(_activeSegment) == 0) {
+        std::shared_ptr<SegmentFile> file = openSegment(_activeSegment, /* create */ true);
+        LOG_IF(ERROR, file == NULL) << "Failed to create segment file in container directory " << _dir;
+        _segments[_activeSegment] = { file, 0, 0 };
+    }
+    _appliedSegment = _activeSegment;
+
+    LOG(INFO) << "Loaded " << _index.size() << " chunks in " << _segments.size() << " segments from container directory " << _dir
+              << ", replayed " << numReplayed << " segments in " << mytimer.elapsed().wall * 1.0 / 1e9 << "s";
+
+    // save the index of replayed records, so they are not replayed again
+    _checkpointSegment = replayFrom;
+    if (_numChanges > 0)
+        saveCheckpoint();
+
+    updateUsage();
+
+    _running = true;
+
+    // background compaction thread
+    pthread_cond_init(&_compaction.cond, NULL);
+    pthread_mutex_init(&_compaction.lock, NULL);
+    pthread_create(&_compaction.th, NULL, SegmentContainer::runCompaction, (SegmentContainer *) this);
+}
+
+SegmentContainer::~SegmentContainer() {
+    // signal the background compaction thread to terminate now
+    _running = false;
+    pthread_mutex_lock(&_compaction.lock);
+    pthread_cond_signal(&_compaction.cond);
+    pthread_mutex_unlock(&_compaction.lock);
+    pthread_join(_compaction.th, NULL);
+    pthread_cond_destroy(&_compaction.cond);
+    pthread_mutex_destroy(&_compaction.lock);
+    // save the index for the next start
+    saveCheckpoint();
+}
+
+bool SegmentContainer::putChunk(Chunk &chunk) {
+    std::string name = chunk.getChunkName();
+    if (name.size() > SEGMENT_MAX_NAME_LENGTH || chunk.size < 0)
+        return false;
+
+    boost::timer::cpu_timer mytimer;
+
+    // compute the checksum over the data in memory, before the data is appended
+    MD5Calculator md5;
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    unsigned int digestLength = MD5_DIGEST_LENGTH;
+    if (!md5.appendData(chunk.data, chunk.size) || !md5.finalize(digest, digestLength))
+        return false;
+    // verify the checksum if needed
+    if (Config::getInstance().verifyChunkChecksum() && memcmp(digest, chunk.md5, MD5_DIGEST_LENGTH) != 0) {
+        LOG(ERROR) << "Checksum mismatched for chunk " << name << " to write";
+        return false;
+    }
+
+    Location loc;
+    bool success = false;
+    {
+        std::unique_lock<std::mutex> wlk(_writeLock);
+        bool exists = false;
+        {
+            std::lock_guard<std::mutex> lk(_lock);
+            auto it = _index.find(name);
+            exists = it != _index.end() && it->second.hasCurrent;
+        }
+        // keep the current version as an old one, using the current time as its version
+        if (exists)
+            snprintf(chunk.chunkVersion, CHUNK_VERSION_MAX_LEN, "%ld", time(NULL));
+        else
+            chunk.chunkVersion[0] = 0;
+        success = appendRecord(wlk, PUT_RECORD, name, chunk.chunkVersion, chunk.data, chunk.size, digest, NULL, &loc);
+    }
+    success = success && syncSegment(loc.segment);
+
+    // read chunk data back to verify the data on disk if asked
+    if (success && Config::getInstance().getAgentReadBackOnWrite()) {
+        Chunk readChunk;
+        readChunk.copyMeta(chunk);
+        memcpy(readChunk.md5, digest, MD5_DIGEST_LENGTH);
+        success = getChunkInternal(readChunk, /* skip verification */ true) && readChunk.verifyMD5();
+        LOG_IF(ERROR, !success) << "Checksum mismatched for chunk " << name << " read back from disk";
+    }
+
+    if (success) {
+        memcpy(chunk.md5, digest, MD5_DIGEST_LENGTH);
+        double elapsed = mytimer.elapsed().wall * 1.0 / 1e9;
+        LOG(INFO) << "Put chunk " << name << " to segment " << loc.segment << " offset " << loc.offset << " size " << (chunk.size * 1.0 / (1 << 20)) << " MB in " << elapsed << "s, " << (chunk.size * 1.0 / (1 << 20)) / elapsed << " MB/s";
+    }
+
+    return success;
+}
+
+bool SegmentContainer::getChunk(Chunk &chunk, bool skipVerification) {
+    bool success = getChunkInternal(chunk, skipVerification);
+    LOG_IF(INFO, success) << "Get chunk " << chunk.getChunkName() << " size " << (chunk.size * 1.0 / (1 << 20)) << " MB";
+    return success;
+}
+
+bool SegmentContainer::getChunkInternal(Chunk &chunk, bool skipVerification) {
+    Location loc;
+    std::shared_ptr<SegmentFile> file;
+    if (!findChunk(chunk.getChunkName(), "", loc, file) || !readData(loc, file, chunk)) {
+        DLOG(WARNING) << "Failed to read chunk " << chunk.getChunkName();
+        return false;
+    }
+
+    // verify checksum if needed
+    return skipVerification || !Config::getInstance().verifyChunkChecksum() || chunk.verifyMD5();
+}
+
+bool SegmentContainer::deleteChunk(const Chunk &chunk) {
+    std::string name = chunk.getChunkName();
+    std::unique_lock<std::mutex> wlk(_writeLock);
+    bool exists = false;
+    {
+        std::lock_guard<std::mutex> lk(_lock);
+        auto it = _index.find(name);
+        exists = it != _index.end() && it->second.hasCurrent;
+    }
+    LOG(INFO) << "Delete chunk " << name;
+    // as for chunk files, deleting a chunk which does not exist succeeds
+    return !exists || appendRecord(wlk, DELETE_RECORD, name, "", NULL, 0, NULL);
+}
+
+bool SegmentContainer::copyChunk(const Chunk &src, Chunk &dst) {
+    std::string name = dst.getChunkName();
+    if (name.size() > SEGMENT_MAX_NAME_LENGTH)
+        return false;
+
+    Chunk readChunk;
+    readChunk.copyMeta(src);
+    if (!getChunkInternal(readChunk, /* skip verification */ true))
+        return false;
+
+    // always copy the MD5 of the copied chunk, and verify the checksum against that of the source chunk if needed
+    MD5Calculator md5;
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    unsigned int digestLength = MD5_DIGEST_LENGTH;
+    bool success = readChunk.size == src.size && md5.appendData(readChunk.data, readChunk.size) && md5.finalize(digest, digestLength);
+    if (success && Config::getInstance().verifyChunkChecksum() && memcmp(digest, src.md5, MD5_DIGEST_LENGTH) != 0) {
+        LOG(ERROR) << "Checksum mismatched for chunk " << src.getChunkName() << " copied to " << name;
+        success = false;
+    }
+    if (!success)
+        return false;
+
+    // overwrite the destination chunk without keeping its current version, as for chunk files
+    Location loc;
+    {
+        std::unique_lock<std::mutex> wlk(_writeLock);
+        success = appendRecord(wlk, PUT_RECORD, name, "", readChunk.data, readChunk.size, digest, NULL, &loc);
+    }
+    success = success && syncSegment(loc.segment);
+
+    // read the copied chunk back to verify the data on disk if asked
+    if (success && Config::getInstance().getAgentReadBackOnWrite()) {
+        Chunk copiedChunk;
+        copiedChunk.copyMeta(dst);
+        memcpy(copiedChunk.md5, digest, MD5_DIGEST_LENGTH);
+        success = getChunkInternal(copiedChunk, /* skip verification */ true) && copiedChunk.verifyMD5();
+        LOG_IF(ERROR, !success) << "Checksum mismatched for chunk " << name << " read back from disk";
+    }
+
+    // remove newly copied chunk if (checksum verification) failed
+    if (!success) {
+        deleteChunk(dst);
+    } else {
+        // mark the size copied
+        dst.size = readChunk.size;
+        // mark the md5 of the copied chunk
+        memcpy(dst.md5, digest, MD5_DIGEST_LENGTH);
+        LOG(INFO) << "Copy chunk " << src.getChunkName() << " to " << name << " in segment " << loc.segment << " offset " << loc.offset;
+    }
+
+    return success;
+}
+
+bool SegmentContainer::moveChunk(const Chunk &src, Chunk &dst) {
+    std::string sname = src.getChunkName(), dname = dst.getChunkName();
+    if (dname.size() > SEGMENT_MAX_NAME_LENGTH)
+        return false;
+
+    // the data is not changed by the move, only the chunk name in the index
+    Location loc;
+    std::shared_ptr<SegmentFile> file;
+    {
+        std::unique_lock<std::mutex> wlk(_writeLock);
+        if (!findChunk(sname, "", loc, file))
+            return false;
+        if (sname != dname && !appendRecord(wlk, MOVE_RECORD, sname, dname, NULL, 0, NULL))
+            return false;
+    }
+
+    // read the moved chunk to verify the checksum if needed
+    bool success = true;
+    if (Config::getInstance().verifyChunkChecksum() || Config::getInstance().getAgentReadBackOnWrite()) {
+        Chunk readChunk;
+        readChunk.copyMeta(dst);
+        memcpy(readChunk.md5, loc.md5, MD5_DIGEST_LENGTH);
+        success = getChunkInternal(readChunk, /* skip verification */ true) && readChunk.verifyMD5();
+        LOG_IF(ERROR, !success) << "Checksum mismatched for chunk " << dname << " read back from disk";
+    }
+
+    if (success) {
+        // mark the size and md5 of the moved chunk
+        dst.size = loc.length;
+        memcpy(dst.md5, loc.md5, MD5_DIGEST_LENGTH);
+        LOG(INFO) << "Move chunk " << sname << " to " << dname << " in segment " << loc.segment << " offset " << loc.offset;
+    }
+
+    return success;
+}
+
+bool SegmentContainer::hasChunk(const Chunk &chunk) {
+    Location loc;
+    std::shared_ptr<SegmentFile> file;
+    if (!findChunk(chunk.getChunkName(), "", loc, file))
+        return false;
+
+    Chunk readChunk;
+    readChunk.copyMeta(chunk);
+    bool checksumPassed = !Config::getInstance().verifyChunkChecksum() || getChunk(readChunk);
+
+    return chunk.size == (int) loc.length && checksumPassed;
+}
+
+bool SegmentContainer::revertChunk(const Chunk &chunk) {
+    std::string name = chunk.getChunkName();
+    std::string version(chunk.chunkVersion);
+
+    std::unique_lock<std::mutex> wlk(_writeLock);
+    Location loc;
+    std::shared_ptr<SegmentFile> file;
+    bool okay = !version.empty() && findChunk(name, version, loc, file) && appendRecord(wlk, REVERT_RECORD, name, version, NULL, 0, NULL);
+    LOG_IF(ERROR, !okay) << "Failed to revert chunk " << name << " back to version " << version;
+
+    return okay;
+}
+
+bool SegmentContainer::verifyChunk(const Chunk &chunk) {
+    bool matched = false;
+    Chunk readChunk;
+    readChunk.copyMeta(chunk);
+    // either verified when reading chunk data back (if checksum verification is enabled), or manual verification
+    matched = getChunkInternal(readChunk) && (Config::getInstance().verifyChunkChecksum() || readChunk.verifyMD5());
+    LOG_IF(WARNING, !matched) << "Check chunk " << chunk.getChunkName() << " by reading data and computing checksum, result = " << matched;
+
+    return matched;
+}
+
+void SegmentContainer::updateUsage() {
+    unsigned long int usage = 0;
+    std::lock_guard<std::mutex> lk(_lock);
+    for (auto &segment : _segments)
+        usage += segment.second.used;
+    _usage = usage;
+}
+
+bool SegmentContainer::appendRecord(std::unique_lock<std::mutex> &wlk, RecordType type, const std::string &name, const std::string &aux, const unsigned char *data, uint32_t length, const unsigned char *md5, const Location *src, Location *appended) {
+    if (name.size() > SEGMENT_MAX_NAME_LENGTH || aux.size() > SEGMENT_MAX_NAME_LENGTH)
+        return false;
+
+    RecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SEGMENT_RECORD_MAGIC;
+    header.type = type;
+    header.nameLength = name.size();
+    header.auxLength = aux.size();
+    header.dataLength = length;
+    // keep the time of the original write for data relocated
+    header.timestamp = src != NULL? src->mtime : time(NULL);
+    if (src != NULL) {
+        header.srcSegment = src->segment;
+        header.srcOffset = src->offset;
+    }
+    if (md5 != NULL)
+        memcpy(header.md5, md5, MD5_DIGEST_LENGTH);
+    header.checksum = computeHeaderChecksum(header, name.data(), aux.data());
+
+    Location loc;
+    loc.dataOffset = sizeof(header) + name.size() + aux.size();
+    loc.recordLength = loc.dataOffset + length;
+    loc.length = length;
+    loc.mtime = header.timestamp;
+    memcpy(loc.md5, header.md5, MD5_DIGEST_LENGTH);
+
+    // seal the active segment if the record does not fit, or a record failed to be written to it,
+    // records larger than a segment are put in a segment of their own
+    std::shared_ptr<SegmentFile> file;
+    bool failed = false;
+    {
+        std::lock_guard<std::mutex> lk(_lock);
+        Segment &segment = _segments[_activeSegment];
+        file = segment.file;
+        failed = segment.failed;
+        loc.segment = _activeSegment;
+        loc.offset = segment.appendOffset;
+    }
+    if (file == NULL || failed || (loc.offset > 0 && loc.offset + loc.recordLength > _segmentSize)) {
+        uint32_t next = file == NULL? loc.segment : loc.segment + 1;
+        file = openSegment(next, /* create */ true);
+        if (file == NULL)
+            return false;
+        std::lock_guard<std::mutex> lk(_lock);
+        _activeSegment = next;
+        _segments[next] = { file, 0, 0 };
+        loc.segment = next;
+        loc.offset = 0;
+    }
+
+    // reserve the space of the record, and write the record without blocking other appends
+    {
+        std::lock_guard<std::mutex> lk(_lock);
+        _segments[loc.segment].appendOffset = loc.offset + loc.recordLength;
+    }
+    uint64_t seq = _nextAppendSeq++;
+    wlk.unlock();
+
+    struct iovec iov[4];
+    iov[0].iov_base = &header;
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = (void *) name.data();
+    iov[1].iov_len = name.size();
+    iov[2].iov_base = (void *) aux.data();
+    iov[2].iov_len = aux.size();
+    iov[3].iov_base = (void *) data;
+    iov[3].iov_len = length;
+    bool written = writeFully(file->fd, iov, 4, loc.offset);
+    LOG_IF(ERROR, !written) << "Failed to append record of chunk " << name << " to segment " << loc.segment << " offset " << loc.offset << ", " << strerror(errno);
+
+    // apply the records in the order of their space reserved, which is the order of replay
+    wlk.lock();
+    _recordWritten.wait(wlk, [this, seq] { return _nextApplySeq == seq; });
+    bool applied = false;
+    {
+        std::lock_guard<std::mutex> lk(_lock);
+        auto it = _segments.find(loc.segment);
+        // replay stops at a record failed to be written, so the records after it are not applied either
+        if (it != _segments.end() && !it->second.failed && written) {
+            it->second.used = loc.offset + loc.recordLength;
+            applyRecord(header, name, aux, loc);
+            _appliedSegment = loc.segment;
+            _numChanges++;
+            applied = true;
+        } else if (it != _segments.end()) {
+            it->second.failed = true;
+        }
+    }
+    _nextApplySeq++;
+    _recordWritten.notify_all();
+    LOG_IF(ERROR, written && !applied) << "Failed to append record of chunk " << name << " to segment " << loc.segment << " offset " << loc.offset << " after a record failed to be written";
+
+    if (applied && appended != NULL)
+        *appended = loc;
+
+    return applied;
+}
+
+uint32_t SegmentContainer::computeHeaderChecksum(RecordHeader header, const char *name, const char *aux) {
+    header.checksum = 0;
+    boost::crc_32_type crc;
+    crc.process_bytes(&header, sizeof(header));
+    crc.process_bytes(name, header.nameLength);
+    crc.process_bytes(aux, header.auxLength);
+    return crc.checksum();
+}
+
+void SegmentContainer::applyRecord(const RecordHeader &header, const std::string &name, const std::string &aux, const Location &loc) {
+    switch (header.type) {
+    case PUT_RECORD:
+        {
+            Entry &entry = _index[name];
+            if (entry.hasCurrent && !aux.empty()) {
+                // keep the current version as an old one
+                auto it = entry.oldVersions.find(aux);
+                if (it != entry.oldVersions.end())
+                    addGarbage(it->second);
+                entry.oldVersions[aux] = entry.current;
+            } else if (entry.hasCurrent) {
+                addGarbage(entry.current);
+            }
+            entry.current = loc;
+            entry.hasCurrent = true;
+            _segments[loc.segment].live += loc.recordLength;
+        }
+        break;
+
+    case DELETE_RECORD:
+        {
+            auto it = _index.find(name);
+            if (it == _index.end() || !it->second.hasCurrent)
+                break;
+            addGarbage(it->second.current);
+            it->second.hasCurrent = false;
+            removeIfEmpty(name);
+        }
+        break;
+
+    case REVERT_RECORD:
+        {
+            auto it = _index.find(name);
+            if (it == _index.end())
+                break;
+            Entry &entry = it->second;
+            auto vit = entry.oldVersions.find(aux);
+            if (vit == entry.oldVersions.end())
+                break;
+            if (entry.hasCurrent)
+                addGarbage(entry.current);
+            entry.current = vit->second;
+            entry.hasCurrent = true;
+            entry.oldVersions.erase(vit);
+        }
+        break;
+
+    case MOVE_RECORD:
+        {
+            auto it = _index.find(name);
+            if (it == _index.end() || !it->second.hasCurrent || name == aux)
+                break;
+            // references to entries remain valid on insertion
+            Entry &src = it->second;
+            Entry &dst = _index[aux];
+            if (dst.hasCurrent)
+                addGarbage(dst.current);
+            dst.current = src.current;
+            dst.hasCurrent = true;
+            src.hasCurrent = false;
+            removeIfEmpty(name);
+        }
+        break;
+
+    case RELOCATE_RECORD:
+        {
+            // compaction only relocates the versions in the index, so a version missing here is one
+            // removed with the checkpoint (and segment) before the relocation
+            Entry &entry = _index[name];
+            Location *target = NULL;
+            bool exists = false;
+            if (aux.empty()) {
+                exists = entry.hasCurrent;
+                target = &entry.current;
+                entry.hasCurrent = true;
+            } else {
+                auto vit = entry.oldVersions.find(aux);
+                exists = vit != entry.oldVersions.end();
+                target = &entry.oldVersions[aux];
+            }
+            // skip the version changed after the relocation
+            if (exists && (target->segment != header.srcSegment || target->offset != header.srcOffset))
+                break;
+            if (exists)
+                addGarbage(*target);
+            *target = loc;
+            _segments[loc.segment].live += loc.recordLength;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void SegmentContainer::addGarbage(const Location &loc) {
+    auto it = _segments.find(loc.segment);
+    if (it != _segments.end())
+        it->second.live -= std::min(it->second.live, (uint64_t) loc.recordLength);
+}
+
+void SegmentContainer::removeIfEmpty(const std::string &name) {
+    auto it = _index.find(name);
+    if (it != _index.end() && !it->second.hasCurrent && it->second.oldVersions.empty())
+        _index.erase(it);
+}
+
+bool SegmentContainer::findChunk(const std::string &name, const std::string &version, Location &loc, std::shared_ptr<SegmentFile> &file) {
+    std::lock_guard<std::mutex> lk(_lock);
+    auto it = _index.find(name);
+    if (it == _index.end())
+        return false;
+    if (version.empty()) {
+        if (!it->second.hasCurrent)
+            return false;
+        loc = it->second.current;
+    } else {
+        auto vit = it->second.oldVersions.find(version);
+        if (vit == it->second.oldVersions.end())
+            return false;
+        loc = vit->second;
+    }
+    auto sit = _segments.find(loc.segment);
+    if (sit == _segments.end() || sit->second.file == NULL)
+        return false;
+    // hold the segment file, in case the segment is removed by compaction during read
+    file = sit->second.file;
+    return true;
+}
+
+bool SegmentContainer::readData(const Location &loc, const std::shared_ptr<SegmentFile> &file, Chunk &chunk) {
+    if (loc.length == 0) {
+        chunk.release();
+        chunk.size = 0;
+        return true;
+    }
+
+    // read into a pooled buffer which can be sent without copying
+    if (!chunk.allocateData(loc.length)) {
+        LOG(ERROR) << "Failed to allocate memory for reading chunk " << chunk.getChunkName() << " of size " << loc.length;
+        return false;
+    }
+    chunk.size = loc.length;
+
+    if (!readFully(file->fd, chunk.data, loc.length, loc.offset + loc.dataOffset)) {
+        LOG(ERROR) << "Failed to read chunk " << chunk.getChunkName() << " from segment " << loc.segment << " offset " << loc.offset;
+        return false;
+    }
+    return true;
+}
+
+bool SegmentContainer::syncSegment(uint32_t segment) {
+    if (!Config::getInstance().getAgentFlushOnClose())
+        return true;
+
+    std::shared_ptr<SegmentFile> file;
+    {
+        std::lock_guard<std::mutex> lk(_lock);
+        auto it = _segments.find(segment);
+        if (it == _segments.end())
+            return false;
+        file = it->second.file;
+    }
+    // records appended at around the same time share the sync of the segment file
+    bool okay = Config::getInstance().getAgentFsSyncBatching()? FsSyncBatcher::getInstance().sync(file->fd) : fdatasync(file->fd) == 0;
+    LOG_IF(ERROR, !okay) << "Failed to sync segment " << segment << " in container directory " << _dir;
+    return okay;
+}
+
+std::shared_ptr<SegmentContainer::SegmentFile> SegmentContainer::openSegment(uint32_t segment, bool create) {
+    char spath[PATH_MAX];
+    if (!getSegmentPath(spath, segment))
+        return NULL;
+    int fd = open(spath, O_RDWR | (create? O_CREAT : 0), 0644);
+    if (fd == -1) {
+        LOG(ERROR) << "Failed to open segment file " << spath << ", " << strerror(errno);
+        return NULL;
+    }
+    // preallocate the space of the segment to keep it contiguous on disk, without changing the file size,
+    // so replay stops at the end of records
+    if (create && fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, _segmentSize) != 0) {
+        LOG_FIRST_N(WARNING, 1) << "Failed to preallocate segment file " << spath << ", " << strerror(errno);
+    }
+    return std::make_shared<SegmentFile>(fd);
+}
+
+bool SegmentContainer::getSegmentPath(char *spath, uint32_t segment) {
+    return snprintf(spath, PATH_MAX, "%s/%s%08x", _dir, SEGMENT_FILE_PREFIX, segment) < PATH_MAX;
+}
+
+bool SegmentContainer::listSegments(std::vector<uint32_t> &segments) {
+    DIR *dir = opendir(_dir);
+    if (dir == NULL)
+        return false;
+    struct dirent *entry = NULL;
+    size_t prefixLength = strlen(SEGMENT_FILE_PREFIX);
+    while ((entry = readdir(dir)) != NULL) {
+        unsigned int segment = 0;
+        if (strncmp(entry->d_name, SEGMENT_FILE_PREFIX, prefixLength) == 0 && strlen(entry->d_name) == prefixLength + 8 && sscanf(entry->d_name + prefixLength, "%08x", &segment) == 1)
+            segments.push_back(segment);
+    }
+    closedir(dir);
+    std::sort(segments.begin(), segments.end());
+    return true;
+}
+
+uint64_t SegmentContainer::replaySegment(uint32_t segment, uint64_t offset) {
+    int fd = _segments[segment].file->fd;
+    struct stat sbuf;
+    if (fstat(fd, &sbuf) != 0)
+        return offset;
+
+    RecordHeader header;
+    char name[SEGMENT_MAX_NAME_LENGTH * 2];
+    std::vector<unsigned char> buf(SEGMENT_READ_SLICE_SIZE);
+    unsigned long int numRecords = 0;
+    while (offset + sizeof(header) <= (uint64_t) sbuf.st_size) {
+        // stop at the first invalid record, e.g., the end of records, or one partially written before a crash
+        if (!readFully(fd, &header, sizeof(header), offset)
+                || header.magic != SEGMENT_RECORD_MAGIC
+                || header.type < PUT_RECORD || header.type > RELOCATE_RECORD
+                || header.nameLength > SEGMENT_MAX_NAME_LENGTH || header.auxLength > SEGMENT_MAX_NAME_LENGTH)
+            break;
+        Location loc;
+        loc.segment = segment;
+        loc.offset = offset;
+        loc.dataOffset = sizeof(header) + header.nameLength + header.auxLength;
+        loc.recordLength = loc.dataOffset + header.dataLength;
+        loc.length = header.dataLength;
+        loc.mtime = header.timestamp;
+        memcpy(loc.md5, header.md5, MD5_DIGEST_LENGTH);
+        if (offset + loc.recordLength > (uint64_t) sbuf.st_size || !readFully(fd, name, header.nameLength + header.auxLength, offset + sizeof(header))
+                || computeHeaderChecksum(header, name, name + header.nameLength) != header.checksum)
+            break;
+
+        // verify the data of the record
+        MD5Calculator md5;
+        bool okay = true;
+        for (uint32_t read = 0; read < loc.length && okay; read += buf.size()) {
+            uint32_t length = std::min(loc.length - read, (uint32_t) buf.size());
+            okay = readFully(fd, buf.data(), length, offset + loc.dataOffset + read) && md5.appendData(buf.data(), length);
+        }
+        unsigned char digest[MD5_DIGEST_LENGTH];
+        unsigned int digestLength = MD5_DIGEST_LENGTH;
+        if (loc.length > 0 && (!okay || !md5.finalize(digest, digestLength) || memcmp(digest, header.md5, MD5_DIGEST_LENGTH) != 0))
+            break;
+
+        std::lock_guard<std::mutex> lk(_lock);
+        applyRecord(header, std::string(name, header.nameLength), std::string(name + header.nameLength, header.auxLength), loc);
+        _numChanges++;
+        numRecords++;
+        offset += loc.recordLength;
+    }
+
+    LOG(INFO) << "Replayed " << numRecords << " records in segment " << segment << " of container directory " << _dir << " up to offset " << offset;
+
+    return offset;
+}
+
+bool SegmentContainer::loadCheckpoint(uint32_t &replaySegment, uint64_t &replayOffset) {
+    std::string path = std::string(_dir) + "/" + SEGMENT_CHECKPOINT_FILE;
+    FILE *checkpoint = fopen(path.c_str(), "r");
+    if (checkpoint == NULL)
+        return false;
+
+    unsigned int segment = 0, recordLength = 0, dataOffset = 0, length = 0;
+    unsigned long int offset = 0, used = 0;
+    long int mtime = 0;
+    bool okay = fscanf(checkpoint, "segment %u offset %lu\n", &segment, &offset) == 2;
+    replaySegment = segment;
+    replayOffset = offset;
+
+    // segments, with the length of records appended
+    while (okay && fscanf(checkpoint, "s %u %lu\n", &segment, &used) == 2)
+        _segments[segment] = { NULL, used, 0 };
+
+    // current (c) and old (o) versions of chunks, with their locations
+    char type[2], name[SEGMENT_MAX_NAME_LENGTH + 1], version[SEGMENT_MAX_NAME_LENGTH + 1], md5[MD5_DIGEST_LENGTH * 2 + 1];
+    while (okay && fscanf(checkpoint, "%1s %1024s", type, name) == 2) {
+        version[0] = 0;
+        okay = (type[0] == 'c' || (type[0] == 'o' && fscanf(checkpoint, " %1024s", version) == 1))
+            && fscanf(checkpoint, " %u %lu %u %u %u %ld %32s\n", &segment, &offset, &recordLength, &dataOffset, &length, &mtime, md5) == 7;
+        if (!okay)
+            break;
+        Location loc = { segment, offset, recordLength, dataOffset, length, (time_t) mtime, { 0 } };
+        okay = ChecksumCalculator::unHex(md5, loc.md5, MD5_DIGEST_LENGTH);
+        Entry &entry = _index[name];
+        if (type[0] == 'c') {
+            entry.current = loc;
+            entry.hasCurrent = true;
+        } else {
+            entry.oldVersions[version] = loc;
+        }
+    }
+    okay = okay && feof(checkpoint);
+
+    fclose(checkpoint);
+
+    if (!okay) {
+        LOG(WARNING) << "Failed to parse the index checkpoint " << path << " of container directory";
+        return false;
+    }
+
+    return true;
+}
+
+bool SegmentContainer::saveCheckpoint() {
+    std::string path = std::string(_dir) + "/" + SEGMENT_CHECKPOINT_FILE;
+    std::string tpath = path + ".tmp";
+
+    // save one checkpoint at a time, so an older snapshot never replaces a newer one
+    std::lock_guard<std::mutex> clk(_checkpointLock);
+
+    // take a snapshot of the index, and only block changes to the index while it is copied
+    uint32_t activeSegment = 0;
+    uint64_t activeUsed = 0;
+    unsigned long int numChanges = 0;
+    std::map<uint32_t, uint64_t> segments;
+    std::vector<std::shared_ptr<SegmentFile> > files;
+    std::unordered_map<std::string, Entry> index;
+    {
+        std::lock_guard<std::mutex> wlk(_writeLock);
+        std::lock_guard<std::mutex> lk(_lock);
+        // records being written are not applied yet, and are replayed from the end of the records applied
+        activeSegment = _appliedSegment;
+        numChanges = _numChanges;
+        for (auto &segment : _segments) {
+            segments[segment.first] = segment.second.used;
+            if (segment.first >= _checkpointSegment && segment.second.file != NULL)
+                files.push_back(segment.second.file);
+        }
+        auto active = _segments.find(_appliedSegment);
+        activeUsed = active == _segments.end()? 0 : active->second.used;
+        index = _index;
+    }
+
+    // sync the records appended since the last checkpoint, before the checkpoint refers to them
+    bool okay = true;
+    for (size_t i = 0; i < files.size() && okay; i++)
+        okay = fdatasync(files.at(i)->fd) == 0;
+    if (!okay) {
+        LOG(ERROR) << "Failed to sync segments in container directory " << _dir << " for the index checkpoint, " << strerror(errno);
+        return false;
+    }
+
+    FILE *checkpoint = fopen(tpath.c_str(), "w");
+    if (checkpoint == NULL) {
+        LOG(ERROR) << "Failed to open the index checkpoint " << tpath << " of container directory, " << strerror(errno);
+        return false;
+    }
+
+    // records after the end of the active segment (in the snapshot) are replayed on the next start
+    fprintf(checkpoint, "segment %u offset %lu\n", activeSegment, (unsigned long int) activeUsed);
+    for (auto &segment : segments)
+        fprintf(checkpoint, "s %u %lu\n", segment.first, (unsigned long int) segment.second);
+    auto printLocation = [checkpoint](const Location &loc) {
+        fprintf(checkpoint, " %u %lu %u %u %u %ld %s\n", loc.segment, (unsigned long int) loc.offset, loc.recordLength, loc.dataOffset, loc.length, (long int) loc.mtime, ChecksumCalculator::toHex(loc.md5, MD5_DIGEST_LENGTH).c_str());
+    };
+    for (auto &entry : index) {
+        if (entry.second.hasCurrent) {
+            fprintf(checkpoint, "c %s", entry.first.c_str());
+            printLocation(entry.second.current);
+        }
+        for (auto &version : entry.second.oldVersions) {
+            fprintf(checkpoint, "o %s %s", entry.first.c_str(), version.first.c_str());
+            printLocation(version.second);
+        }
+    }
+
+    okay = fflush(checkpoint) == 0 && fsync(fileno(checkpoint)) == 0;
+    okay = fclose(checkpoint) == 0 && okay;
+    // replace the checkpoint atomically, and sync the directory so the replacement is durable
+    okay = okay && rename(tpath.c_str(), path.c_str()) == 0;
+    if (okay) {
+        int dfd = open(_dir, O_RDONLY | O_DIRECTORY);
+        okay = dfd != -1 && fsync(dfd) == 0;
+        if (dfd != -1)
+            close(dfd);
+    }
+    LOG_IF(ERROR, !okay) << "Failed to save the index checkpoint " << path << " of container directory";
+
+    if (okay) {
+        // changes after the snapshot are left for the next checkpoint
+        std::lock_guard<std::mutex> wlk(_writeLock);
+        _checkpointSegment = activeSegment;
+        _numChanges -= numChanges;
+    }
+
+    return okay;
+}
+
+bool SegmentContainer::compactSegment(uint32_t segment) {
+    boost::timer::cpu_timer mytimer;
+
+    // find the versions in the segment
+    std::vector<std::pair<std::string, std::string> > versions;
+    {
+        std::lock_guard<std::mutex> lk(_lock);
+        for (auto &entry : _index) {
+            if (entry.second.hasCurrent && entry.second.current.segment == segment)
+                versions.emplace_back(entry.first, "");
+            for (auto &version : entry.second.oldVersions)
+                if (version.second.segment == segment)
+                    versions.emplace_back(entry.first, version.first);
+        }
+    }
+
+    // copy the versions to the active segment
+    unsigned long int numRelocated = 0;
+    for (auto &version : versions) {
+        if (!_running)
+            return false;
+        Location loc, cloc;
+        std::shared_ptr<SegmentFile> file;
+        Chunk chunk;
+        if (!findChunk(version.first, version.second, loc, file) || loc.segment != segment)
+            continue;
+        if (!readData(loc, file, chunk))
+            return false;
+        std::unique_lock<std::mutex> wlk(_writeLock);
+        // skip the version if it is changed during the read
+        if (!findChunk(version.first, version.second, cloc, file) || cloc.segment != loc.segment || cloc.offset != loc.offset)
+            continue;
+        if (!appendRecord(wlk, RELOCATE_RECORD, version.first, version.second, chunk.data, loc.length, loc.md5, &loc))
+            return false;
+        numRelocated++;
+    }
+
+    // drop the segment, so the next checkpoint no longer lists it
+    {
+        std::lock_guard<std::mutex> wlk(_writeLock);
+        std::lock_guard<std::mutex> lk(_lock);
+        auto it = _segments.find(segment);
+        if (it == _segments.end() || it->second.live > 0)
+            return false;
+        // the segment file is closed once no reader holds it
+        _segments.erase(it);
+        _numChanges++;
+    }
+    // remove the segment file only after the checkpoint is durable, or leave it to be removed on the next start
+    if (!saveCheckpoint())
+        return false;
+    char spath[PATH_MAX];
+    if (getSegmentPath(spath, segment))
+        unlink(spath);
+
+    LOG(INFO) << "Compacted segment " << segment << " of container directory " << _dir << ", relocated " << numRelocated << " chunks in " << mytimer.elapsed().wall * 1.0 / 1e9 << "s";
+
+    return true;
+}
+
+void SegmentContainer::removeExpiredVersions() {
+    time_t now = time(NULL);
+    unsigned long int numExpired = 0;
+
+    std::lock_guard<std::mutex> wlk(_writeLock);
+    std::lock_guard<std::mutex> lk(_lock);
+    for (auto it = _index.begin(); it != _index.end(); ) {
+        auto &versions = it->second.oldVersions;
+        // versions are the time when the versions are replaced
+        for (auto vit = versions.begin(); vit != versions.end(); ) {
+            if (strtol(vit->first.c_str(), NULL, 10) + SEGMENT_OLD_CHUNK_TTL > now) {
+                vit++;
+                continue;
+            }
+            addGarbage(vit->second);
+            vit = versions.erase(vit);
+            numExpired++;
+        }
+        if (!it->second.hasCurrent && versions.empty())
+            it = _index.erase(it);
+        else
+            it++;
+    }
+
+    // expiry is not logged in segments, but saved with the next checkpoint
+    _numChanges += numExpired;
+    LOG_IF(INFO, numExpired > 0) << "Clean " << numExpired << " old chunk versions in container directory " << _dir;
+}
+
+void SegmentContainer::compact() {
+    pthread_mutex_lock(&_compaction.lock);
+    compactSegments();
+    pthread_mutex_unlock(&_compaction.lock);
+}
+
+void SegmentContainer::compactSegments() {
+    removeExpiredVersions();
+
+    // find the sealed segments with enough garbage
+    std::vector<uint32_t> segments;
+    {
+        std::lock_guard<std::mutex> lk(_lock);
+        for (auto &segment : _segments) {
+            const Segment &s = segment.second;
+            // skip the segments which may have records being written
+            if (segment.first < _appliedSegment && (s.used - s.live) * 100 >= s.used * _compactionThreshold)
+                segments.push_back(segment.first);
+        }
+    }
+    for (uint32_t segment : segments) {
+        if (!_running)
+            break;
+        LOG_IF(WARNING, !compactSegment(segment) && _running) << "Failed to compact segment " << segment << " of container directory " << _dir;
+    }
+
+    // save the index changed
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> wlk(_writeLock);
+        changed = _numChanges > 0;
+    }
+    if (changed)
+        saveCheckpoint();
+}
+
+void *SegmentContainer::runCompaction(void *arg) {
+    SegmentContainer *container = (SegmentContainer *) arg;
+    struct timespec nextSchTime;
+
+    const time_t timeout = 60; // timeout for checking and compacting segments (1min)
+
+    pthread_mutex_lock(&container->_compaction.lock);
+    while (container->_running) {
+        clock_gettime(CLOCK_REALTIME, &nextSchTime);
+        nextSchTime.tv_sec += timeout;
+        // wait for signal or timeout before next checking and compaction
+        pthread_cond_timedwait(&container->_compaction.cond, &container->_compaction.lock, &nextSchTime);
+        if (!container->_running)
+            break;
+
+        container->compactSegments();
+    }
+    pthread_mutex_unlock(&container->_compaction.lock);
+
+    LOG(WARNING) << "Segment container compaction thread exists now";
+
+    return 0;
+}
@@ -0,0 +1,352 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __SEGMENT_CONTAINER_HH__
+#define __SEGMENT_CONTAINER_HH__
+
+#include <stdint.h>
+#include <time.h>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <pthread.h>
+#include <linux/limits.h>
+
+#include "container.hh"
+#include "../../ds/chunk.hh"
+
+#define SEGMENT_RECORD_MAGIC      (0x4e534547)  // "GESN" in little-endian
+#define SEGMENT_OLD_CHUNK_TTL     (600)         // time (in seconds) to keep old chunk versions for revert, as in FsContainer
+#define SEGMENT_MAX_NAME_LENGTH   (1024)        // max. length of chunk names and versions in records
+
+/**
+ * Container which packs chunks into large segment files on a local file system
+ *
+ * Each change of chunks is appended as a record to the active segment file,
+ * which is preallocated to misc.segment_size MiB, so small chunks do not cost
+ * one file (and inode) each. The space of a record is reserved under a lock,
+ * but the record is written without holding it, so records are written
+ * concurrently. Records are applied to the index in the order of their space
+ * reserved, i.e., the order they are replayed.
+ *
+ * The index maps each chunk name to the location of the current version and
+ * the old versions kept for revert (see revertChunk()). It is kept in memory,
+ * and saved as a checkpoint file in the container directory periodically and
+ * on shutdown. On start, the checkpoint is loaded and the records appended
+ * after it are replayed. Replay of a segment stops at the first invalid record,
+ * e.g., one not (fully) written before a crash, as detected by the checksums of
+ * the record header and the data.
+ *
+ * Records which are no longer referenced (e.g., deleted, overwritten or
+ * expired chunks) are garbage. A background thread copies the live records
+ * out of a sealed segment when the garbage reaches
+ * misc.segment_compaction_threshold percent of the segment, and removes the
+ * segment once the index without the segment is checkpointed.
+ **/
+class SegmentContainer : public Container {
+public:
+    SegmentContainer(int id, const char* dir, unsigned long int capacity);
+    ~SegmentContainer();
+
+    /**
+     * See Container::putChunk()
+     **/
+    bool putChunk(Chunk &chunk);
+
+    /**
+     * See Container::getChunk()
+     **/
+    bool getChunk(Chunk &chunk, bool skipVerification = false);
+
+    /**
+     * See Container::deleteChunk()
+     **/
+    bool deleteChunk(const Chunk &chunk);
+
+    /**
+     * See Container::copyChunk()
+     **/
+    bool copyChunk(const Chunk &src, Chunk &dst);
+
+    /**
+     * See Container::moveChunk()
+     **/
+    bool moveChunk(const Chunk &src, Chunk &dst);
+
+    /**
+     * See Container::hasChunk()
+     **/
+    bool hasChunk(const Chunk &chunk);
+
+    /**
+     * See Container::revertChunk()
+     **/
+    bool revertChunk(const Chunk &chunk);
+
+    /**
+     * See Container::verifyChunk()
+     **/
+    bool verifyChunk(const Chunk &chunk);
+
+    /**
+     * See Container::updateUsage()
+     *
+     * @remark the usage is the total size of records in the segments, including garbage not compacted yet
+     **/
+    void updateUsage();
+
+    /**
+     * Remove the expired old versions, compact the sealed segments with enough garbage, and save the index if changed
+     *
+     * @remark the background compaction thread runs this periodically
+     **/
+    void compact();
+
+private:
+    enum RecordType {
+        PUT_RECORD = 1,         /**< chunk data written, the previous version is kept as an old version */
+        DELETE_RECORD,          /**< current version removed */
+        REVERT_RECORD,          /**< old version (in the auxiliary field) restored as the current version */
+        MOVE_RECORD,            /**< current version renamed to the chunk name in the auxiliary field */
+        RELOCATE_RECORD,        /**< data of a version (in the auxiliary field, empty for the current version) copied by compaction */
+    };
+
+    /**
+     * Header of a record, followed by the chunk name, the auxiliary field, and the chunk data (all in host byte order)
+     **/
+    struct RecordHeader {
+        uint32_t magic;         /**< SEGMENT_RECORD_MAGIC */
+        uint8_t type;           /**< record type (see RecordType) */
+        uint8_t reserved;
+        uint16_t nameLength;    /**< length of the chunk name */
+        uint16_t auxLength;     /**< length of the auxiliary field */
+        uint16_t reserved2;
+        uint32_t dataLength;    /**< length of the chunk data */
+        int64_t timestamp;      /**< time of the change, which is the version of the chunk it backs up on put */
+        uint32_t srcSegment;    /**< segment of the data relocated */
+        uint32_t checksum;      /**< CRC-32 of the header (with this field zeroed), the chunk name, and the auxiliary field */
+        uint64_t srcOffset;     /**< offset of the record relocated */
+        unsigned char md5[MD5_DIGEST_LENGTH]; /**< checksum of the chunk data */
+    };
+
+    /**
+     * Location of a version of a chunk
+     **/
+    struct Location {
+        uint32_t segment;       /**< segment id */
+        uint64_t offset;        /**< offset of the record in the segment */
+        uint32_t recordLength;  /**< length of the whole record */
+        uint32_t dataOffset;    /**< offset of the data in the record */
+        uint32_t length;        /**< length of the chunk data */
+        time_t mtime;           /**< time of the write */
+        unsigned char md5[MD5_DIGEST_LENGTH]; /**< checksum of the chunk data */
+    };
+
+    /**
+     * Versions of a chunk
+     **/
+    struct Entry {
+        bool hasCurrent = false;                    /**< whether there is a current version */
+        Location current;                           /**< location of the current version */
+        std::map<std::string, Location> oldVersions; /**< versions to the location of old versions */
+    };
+
+    /**
+     * Opened segment file, which is closed when it is no longer used by the container or readers
+     **/
+    struct SegmentFile {
+        int fd;
+        SegmentFile(int fdt) : fd(fdt) {}
+        ~SegmentFile();
+    };
+
+    struct Segment {
+        std::shared_ptr<SegmentFile> file;          /**< segment file */
+        uint64_t used;                              /**< total length of records appended and applied */
+        uint64_t live;                              /**< total length of records referenced by the index */
+        uint64_t appendOffset = 0;                  /**< offset to append the next record, after the records being written */
+        bool failed = false;                        /**< whether a record failed to be written, so no more records are applied or appended */
+    };
+
+    char _dir[PATH_MAX];                            /**< container folder path */
+    unsigned long int _segmentSize;                 /**< size to preallocate for each segment */
+    int _compactionThreshold;                       /**< percentage of garbage in a segment to compact it */
+
+    std::mutex _checkpointLock;                     /**< lock on saving checkpoints, always taken before _writeLock */
+    std::mutex _writeLock;                          /**< lock on record appends and index changes, always taken before _lock */
+    std::condition_variable _recordWritten;         /**< signal on a record written or applied, with _writeLock */
+    uint64_t _nextAppendSeq;                        /**< sequence number of the next record to append */
+    uint64_t _nextApplySeq;                         /**< sequence number of the next record to apply */
+    std::mutex _lock;                               /**< lock on the index and segments */
+    std::unordered_map<std::string, Entry> _index;  /**< chunk name to the versions of the chunk */
+    std::map<uint32_t, Segment> _segments;          /**< segment id to segments */
+    uint32_t _activeSegment;                        /**< id of the segment to append to */
+    uint32_t _appliedSegment;                       /**< id of the segment of the last record applied */
+    uint32_t _checkpointSegment;                    /**< id of the segment active at the last checkpoint */
+    unsigned long int _numChanges;                  /**< number of index changes since the last checkpoint */
+
+    bool _running;                                  /**< whether the container is "running" */
+    struct {
+        pthread_t th;                               /**< background compaction and clean up thread */
+        pthread_cond_t cond;
+        pthread_mutex_t lock;
+    } _compaction;
+
+    /**
+     * Append a record to the active segment, and apply the change to the index
+     *
+     * @param[in] wlk           lock on _writeLock, which is released while the record is written
+     * @param[in] type          record type
+     * @param[in] name          chunk name
+     * @param[in] aux           auxiliary field
+     * @param[in] data          chunk data, NULL if none
+     * @param[in] length        length of chunk data
+     * @param[in] md5           checksum of the chunk data, NULL if none
+     * @param[in] src           location relocated, for RELOCATE_RECORD only
+     * @param[out] appended     location of the record appended, if not NULL
+     *
+     * @return whether the record is appended
+     *
+     * @remark _writeLock must be held by wlk, and is held again on return; the index may be changed by the records appended concurrently while the record is written
+     **/
+    bool appendRecord(std::unique_lock<std::mutex> &wlk, RecordType type, const std::string &name, const std::string &aux, const unsigned char *data, uint32_t length, const unsigned char *md5, const Location *src = NULL, Location *appended = NULL);
+
+    /**
+     * Apply a record to the index
+     *
+     * @param[in] header        record header
+     * @param[in] name          chunk name
+     * @param[in] aux           auxiliary field
+     * @param[in] loc           location of the record
+     *
+     * @remark _lock must be held
+     **/
+    void applyRecord(const RecordHeader &header, const std::string &name, const std::string &aux, const Location &loc);
+
+    /**
+     * Compute the checksum of a record header
+     *
+     * @param[in] header        record header, whose checksum field is ignored
+     * @param[in] name          chunk name
+     * @param[in] aux           auxiliary field
+     *
+     * @return CRC-32 of the header (with the checksum field zeroed), the chunk name, and the auxiliary field
+     **/
+    static uint32_t computeHeaderChecksum(RecordHeader header, const char *name, const char *aux);
+
+    /**
+     * Mark a version as no longer referenced by the index
+     *
+     * @remark _lock must be held
+     **/
+    void addGarbage(const Location &loc);
+
+    /**
+     * Remove an index entry if it has no version left
+     *
+     * @remark _lock must be held
+     **/
+    void removeIfEmpty(const std::string &name);
+
+    /**
+     * Find the location of a chunk version
+     *
+     * @param[in] name          chunk name
+     * @param[in] version       version, empty for the current version
+     * @param[out] loc          location of the version
+     * @param[out] file         segment file of the version
+     *
+     * @return whether the version is found
+     **/
+    bool findChunk(const std::string &name, const std::string &version, Location &loc, std::shared_ptr<SegmentFile> &file);
+
+    /**
+     * Read the data of a chunk version
+     *
+     * @param[in] loc           location of the version
+     * @param[in] file          segment file of the version
+     * @param[out] chunk        chunk to read into, Chunk::data and Chunk::size are filled on success
+     *
+     * @return whether the data is read
+     **/
+    bool readData(const Location &loc, const std::shared_ptr<SegmentFile> &file, Chunk &chunk);
+
+    bool getChunkInternal(Chunk &chunk, bool skipVerification = false);
+
+    /**
+     * Sync the records appended to a segment to disk if misc.flush_on_close is enabled
+     **/
+    bool syncSegment(uint32_t segment);
+
+    /**
+     * Open a segment file, or create and preallocate it
+     *
+     * @return the segment file, NULL on failure
+     **/
+    std::shared_ptr<SegmentFile> openSegment(uint32_t segment, bool create);
+
+    bool getSegmentPath(char *spath, uint32_t segment);
+
+    /**
+     * List the ids of segment files in the container directory, in ascending order
+     **/
+    bool listSegments(std::vector<uint32_t> &segments);
+
+    /**
+     * Replay the records in a segment from an offset
+     *
+     * @param[in] segment       segment id
+     * @param[in] offset        offset of the first record to replay
+     *
+     * @return offset after the last valid record
+     **/
+    uint64_t replaySegment(uint32_t segment, uint64_t offset);
+
+    /**
+     * Load the index checkpoint
+     *
+     * @param[out] replaySegment segment to replay the records from
+     * @param[out] replayOffset  offset in the segment to replay the records from
+     *
+     * @return whether the checkpoint is loaded
+     **/
+    bool loadCheckpoint(uint32_t &replaySegment, uint64_t &replayOffset);
+
+    /**
+     * Save the index as a checkpoint, replacing the previous one atomically
+     *
+     * Changes to the index are blocked only while it is copied, not while the
+     * segments are synced and the checkpoint is written
+     *
+     * @return whether the checkpoint is saved
+     **/
+    bool saveCheckpoint();
+
+    /**
+     * Copy the live records out of a segment, and remove the segment after a checkpoint without it is saved
+     *
+     * @param[in] segment       segment id
+     *
+     * @return whether the segment is removed
+     **/
+    bool compactSegment(uint32_t segment);
+
+    /**
+     * Remove old versions kept longer than SEGMENT_OLD_CHUNK_TTL
+     **/
+    void removeExpiredVersions();
+
+    /**
+     * See compact()
+     *
+     * @remark _compaction.lock must be held
+     **/
+    void compactSegments();
+
+    static void *runCompaction(void *arg);
+};
+
+#endif // define __SEGMENT_CONTAINER_HH__
@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: Apache-2.0
 
+#include <atomic>
 #include <stdexcept>
 #include <unistd.h>
 #include <linux/limits.h>
@@ -31,6 +32,10 @@ ContainerManager::ContainerManager() {
             _containerPtrs[i] = new FsContainer(cid, cstr.c_str(), capacity);
             DLOG(INFO) << "FS container with id = " << cid << " folder name = " << cstr << " capacity = " << capacity;
             break;
+        case ContainerType::SEGMENT_CONTAINER:
+            _containerPtrs[i] = new SegmentContainer(cid, cstr.c_str(), capacity);
+            DLOG(INFO) << "Segment container with id = " << cid << " folder name = " << cstr << " capacity = " << capacity;
+            break;
         case ContainerType::AWS_CONTAINER:
             _containerPtrs[i] = new AwsContainer(cid, cstr, region, keyId, key, capacity, "", proxyIP, proxyPort);
             DLOG(INFO) << "AWS container with id = " << cid << " bucket name = " << cstr << " capacity = " << capacity;
@@ -52,11 +57,29 @@ ContainerManager::ContainerManager() {
             LOG(ERROR) << "Found container with duplicated id = " << cid;
             exit(1);
         }
+        _containerIndices[cid] = i;
     }
+
+    // start the workers of containers, as many as the agent workers which may access a container at the same time,
+    // except with one container, where the chunks are always handled by the agent workers
+    _running = true;
+    int numWorkers = _numContainers > 1? config.getAgentNumWorkers() : 0;
+    for (int i = 0; i < _numContainers; i++)
+        for (int j = 0; j < numWorkers; j++)
+            _queues[i].workers.emplace_back(&ContainerManager::runWorker, this, std::ref(_queues[i]));
 }
 
 ContainerManager::~ContainerManager() {
     LOG(WARNING) << "Terminating Container Manager ...";
+    // stop the workers of containers
+    for (int i = 0; i < _numContainers; i++) {
+        std::lock_guard<std::mutex> lk(_queues[i].lock);
+        _running = false;
+        _queues[i].hasTask.notify_all();
+    }
+    for (int i = 0; i < _numContainers; i++)
+        for (std::thread &t : _queues[i].workers)
+            t.join();
     // release the containers
     for (int i = 0; i < _numContainers; i++)
         delete _containerPtrs[i];
@@ -64,92 +87,94 @@ ContainerManager::~ContainerManager() {
 }
 
 bool ContainerManager::putChunks(int containerId[], Chunk chunks[], int numChunks) {
-    bool ret = true;
-    int i = 0;
-
     bool verifyChecksum = Config::getInstance().verifyChunkChecksum();
+    std::vector<char> stored(numChunks, false);
+    std::atomic<bool> failed(false);
 
     // store chunks to containers
-    for (i = 0; i < numChunks && ret; i++) {
-        try {
-            // verify checksum before write
-            if (verifyChecksum && !chunks[i].verifyMD5()) {
-                ret = false;
+    bool ret = runOnContainers(containerId, numChunks, [&](Container *container, const std::vector<int> &indices) {
+        for (int i : indices) {
+            // stop once any chunk fails
+            if (failed)
                 break;
-            }
-            // write chunk
-            if ((ret = _containers.at(containerId[i])->putChunk(chunks[i])) == false) {
-                ret = false;
+            // verify checksum before write, and write chunk
+            if ((verifyChecksum && !chunks[i].verifyMD5()) || !container->putChunk(chunks[i])) {
+                failed = true;
                 break;
             }
-            _containers.at(containerId[i])->bgUpdateUsage();
-        } catch (std::exception &e) {
-            LOG(ERROR) << "Cannot find container " << containerId[i] << " to write chunk";
-            ret = false;
-            break;
+            stored[i] = true;
         }
-    }
+        container->bgUpdateUsage();
+    }) && !failed;
+
     // remove stored chunks once failed
-    for (int j = 0; j < i && !ret; j++) { 
+    for (int i = 0; i < numChunks && !ret; i++) {
+        if (!stored[i])
+            continue;
         try {
-            _containers.at(containerId[j])->deleteChunk(chunks[i]);
+            _containers.at(containerId[i])->deleteChunk(chunks[i]);
             _containers.at(containerId[i])->bgUpdateUsage();
         } catch (std::exception &e) {
-            LOG(ERROR) << "Cannot find container " << containerId[j] << " to remove chunk after write failure";
+            LOG(ERROR) << "Cannot find container " << containerId[i] << " to remove chunk after write failure";
         }
     }
     return ret;
 }
 
 bool ContainerManager::getChunks(int containerId[], Chunk chunks[], int numChunks) {
-    bool ret = true;
+    std::atomic<bool> failed(false);
     // get chunks from containers
-    for (int i = 0; i < numChunks; i++ ) {
-        try {
-            if ((ret = _containers.at(containerId[i])->getChunk(chunks[i])) == false) {
-                throw std::invalid_argument("");
+    bool ret = runOnContainers(containerId, numChunks, [&](Container *container, const std::vector<int> &indices) {
+        for (int i : indices) {
+            if (failed || !container->getChunk(chunks[i])) {
+                failed = true;
+                break;
             }
-        } catch (std::exception &e) {
-            ret = false;
-            break;
         }
-    }
-    return ret;
+    });
+    return ret && !failed;
 }
 
 bool ContainerManager::deleteChunks(int containerId[], Chunk chunks[], int numChunks) {
     // delete chunks from containers
-    for (int i = 0; i < numChunks; i++ ) {
-        try {
-            _containers.at(containerId[i])->deleteChunk(chunks[i]);
-            _containers.at(containerId[i])->bgUpdateUsage();
-        } catch (std::exception &e) {
-            LOG(ERROR) << "Cannot find container " << containerId[i] << " to remove chunk";
+    runOnContainers(containerId, numChunks, [&](Container *container, const std::vector<int> &indices) {
+        // keep deleting the other chunks if one fails
+        for (int i : indices) {
+            try {
+                container->deleteChunk(chunks[i]);
+            } catch (std::exception &e) {
+                LOG(ERROR) << "Failed to remove chunk " << chunks[i].getChunkName() << " in container " << container->getId() << ", " << e.what();
+            }
         }
-    }
+        container->bgUpdateUsage();
+    });
     return true;
 }
 
 bool ContainerManager::copyChunks(int containerId[], Chunk srcChunks[], Chunk dstChunks[], int numChunks) {
+    std::vector<char> copied(numChunks, false);
+    std::atomic<bool> failed(false);
+
     // copy chunks within containers
-    bool ret = true;
-    for (int i = 0; i < numChunks; i++) {
+    bool ret = runOnContainers(containerId, numChunks, [&](Container *container, const std::vector<int> &indices) {
+        for (int i : indices) {
+            copied[i] = container->copyChunk(srcChunks[i], dstChunks[i]);
+            failed = failed || !copied[i];
+        }
+        container->bgUpdateUsage();
+    });
+
+    // remove already copied chunks upon error
+    for (int i = 0; i < numChunks && !ret; i++) {
+        if (!copied[i])
+            continue;
         try {
-            ret = _containers.at(containerId[i])->copyChunk(srcChunks[i], dstChunks[i]) && ret;
-            _containers.at(containerId[i])->bgUpdateUsage();
+            _containers.at(containerId[i])->deleteChunk(dstChunks[i]);
         } catch (std::exception &e) {
-            ret = false;
-            // remove already copied chunks upon error
-            for (int j = 0; j < i; j++)
-                try {
-                    _containers.at(containerId[j])->deleteChunk(dstChunks[j]);
-                } catch (std::exception &e) {
-                    LOG(ERROR) << "Cannot find container " << containerId[j] << " to remove chunk after copy failure";
-                }
-            break;
-        } 
+            LOG(ERROR) << "Cannot find container " << containerId[i] << " to remove chunk after copy failure";
+        }
     }
-    return ret;
+    return ret && !failed;
 }
 
 bool ContainerManager::moveChunks(int containerId[], Chunk srcChunks[], Chunk dstChunks[], int numChunks) {
@@ -221,38 +246,38 @@ bool ContainerManager::revertChunks(int containerId[], Chunk chunks[], int numCh
 Chunk ContainerManager::getEncodedChunks(int containerId[], Chunk chunks[], int numChunks, unsigned char matrix[]) {
     Chunk codedChunk, rawChunks[numChunks];
     unsigned char *rawData[numChunks];
-    bool ret = false;
     for (int i = 0; i < numChunks; i++) {
         rawChunks[i].setId(chunks[i].getNamespaceId(), chunks[i].getFileUUID(), chunks[i].getChunkId());
         rawChunks[i].fileVersion = chunks[i].fileVersion;
-        // get the chunk
-        try {
-            if ((ret = _containers.at(containerId[i])->getChunk(rawChunks[i], true)) == false) {
+    }
+
+    // get the chunks
+    std::atomic<bool> failed(false);
+    bool ret = runOnContainers(containerId, numChunks, [&](Container *container, const std::vector<int> &indices) {
+        for (int i : indices) {
+            if (failed)
+                break;
+            if (!container->getChunk(rawChunks[i], true)) {
                 LOG(ERROR) << "Failed to get chunk id = " << chunks[i].getChunkName() << " from container " << containerId[i];
-                throw std::invalid_argument("");
+                failed = true;
+                break;
             }
             rawData[i] = rawChunks[i].data;
-        } catch (std::exception &e) {
-            LOG(ERROR) << "Failed to find container / chunk for chunk id = (" << (unsigned int) chunks[i].getNamespaceId() << "," << chunks[i].getFileUUID() << "," << (int) chunks[i].getChunkId() << ") from container " << containerId[i];
-            ret = false;
-            break;
         }
+    }) && !failed && numChunks > 0;
+
+    if (ret) {
+        codedChunk.data = (unsigned char *) malloc (rawChunks[0].size);
         if (codedChunk.data == NULL) {
-            codedChunk.data = (unsigned char *) malloc (rawChunks[i].size);
-            if (codedChunk.data == NULL) {
-                LOG(ERROR) << "Failed to allocate memory for data of the encoded chunk";
-                return codedChunk;
-            }
-            codedChunk.size = rawChunks[i].size;
+            LOG(ERROR) << "Failed to allocate memory for data of the encoded chunk";
+            return codedChunk;
         }
-    }
-    if (ret) {
+        codedChunk.size = rawChunks[0].size;
         // encode the chunk
         CodingUtils::encode(rawData, numChunks, &codedChunk.data, 1, codedChunk.size, matrix);
         codedChunk.freeData = false;
     } else {
         codedChunk.size = 0;
-        free(codedChunk.data);
     }
     return codedChunk;
 }
@@ -268,8 +293,12 @@ void ContainerManager::getContainerIds(int containerIds[]) {
 
 void ContainerManager::getContainerType(unsigned char containerType[]) {
     Config &config = Config::getInstance();
-    for (int i = 0; i < _numContainers; i++)
+    for (int i = 0; i < _numContainers; i++) {
         containerType[i] = config.getContainerType(i);
+        // segment containers are on-premises storage like file system containers, see HostType in common/define.hh
+        if (containerType[i] == ContainerType::SEGMENT_CONTAINER)
+            containerType[i] = ContainerType::FS_CONTAINER;
+    }
 }
 
 void ContainerManager::getContainerUsage(unsigned long int containerUsage[], unsigned long int containerCapacity[]) {
@@ -279,3 +308,74 @@ void ContainerManager::getContainerUsage(unsigned long int containerUsage[], uns
         _containerPtrs[i]->bgUpdateUsage();
     }
 }
+
+bool ContainerManager::runOnContainers(int containerId[], int numChunks, std::function<void(Container *, const std::vector<int> &)> task) {
+    bool okay = true;
+
+    // group the chunks by container
+    std::map<int, std::vector<int> > groups;
+    for (int i = 0; i < numChunks; i++) {
+        auto it = _containerIndices.find(containerId[i]);
+        if (it == _containerIndices.end()) {
+            LOG(ERROR) << "Cannot find container " << containerId[i] << " for chunk " << i;
+            okay = false;
+            continue;
+        }
+        groups[it->second].push_back(i);
+    }
+    if (groups.empty())
+        return okay;
+
+    std::mutex lock;
+    std::condition_variable done;
+    int numPending = 0;
+
+    auto run = [this, &task, &lock, &okay](int index, const std::vector<int> &indices) {
+        bool success = true;
+        try {
+            task(_containerPtrs[index], indices);
+        } catch (std::exception &e) {
+            LOG(ERROR) << "Failed to process chunks in container " << _containerPtrs[index]->getId() << ", " << e.what();
+            success = false;
+        }
+        std::lock_guard<std::mutex> lk(lock);
+        okay = okay && success;
+    };
+
+    // hand over the chunks of the other containers to their workers
+    for (auto it = std::next(groups.begin()); it != groups.end(); it++) {
+        numPending++;
+        WorkerQueue &queue = _queues[it->first];
+        std::lock_guard<std::mutex> lk(queue.lock);
+        queue.tasks.emplace_back([&run, &lock, &done, &numPending, it]() {
+            run(it->first, it->second);
+            std::lock_guard<std::mutex> lk(lock);
+            numPending--;
+            done.notify_all();
+        });
+        queue.hasTask.notify_one();
+    }
+
+    // process the chunks of the first container in place
+    run(groups.begin()->first, groups.begin()->second);
+
+    std::unique_lock<std::mutex> lk(lock);
+    done.wait(lk, [&numPending] { return numPending == 0; });
+
+    return okay;
+}
+
+void ContainerManager::runWorker(WorkerQueue &queue) {
+    std::unique_lock<std::mutex> lk(queue.lock);
+    while (true) {
+        queue.hasTask.wait(lk, [this, &queue] { return !_running || !queue.tasks.empty(); });
+        // drain the pending tasks before exit
+        if (queue.tasks.empty())
+            break;
+        std::function<void()> task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        lk.unlock();
+        task();
+        lk.lock();
+    }
+}
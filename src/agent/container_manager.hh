@@ -3,7 +3,13 @@
 #ifndef __CONTAINER_MANAGER_HH__
 #define __CONTAINER_MANAGER_HH__
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "../ds/chunk.hh"
 #include "container/container.hh"
@@ -161,9 +167,40 @@ public:
     void getContainerUsage(unsigned long int containerUsage[], unsigned long int containerCapacity[]);
 
 private:
+    /**
+     * Queue of tasks on a container, served by the workers of the container
+     **/
+    struct WorkerQueue {
+        std::mutex lock;                             /**< lock on the task queue */
+        std::condition_variable hasTask;             /**< signal on new tasks */
+        std::deque<std::function<void()>> tasks;     /**< tasks pending */
+        std::vector<std::thread> workers;            /**< workers of the container */
+    };
+
+    /**
+     * Run a task on the chunks of each container, with the chunks of different containers processed concurrently
+     *
+     * The chunks of one container are handled by the calling thread, and
+     * those of the other containers are handed over to the workers of the
+     * containers. Chunks of the same container are passed to the task in
+     * their order in the list. Chunks of containers not found are skipped.
+     *
+     * @param[in] containerId        ids of containers storing the corresponding chunks
+     * @param[in] numChunks          number of chunks
+     * @param[in] task               task to run on a container, given the container and the indices of its chunks in the list
+     *
+     * @return whether all containers are found and the task completes on all of them without exceptions
+     **/
+    bool runOnContainers(int containerId[], int numChunks, std::function<void(Container *, const std::vector<int> &)> task);
+
+    void runWorker(WorkerQueue &queue);
+
     int _numContainers;                              /**< number of containers */
     std::map<int, Container*> _containers;           /**< mapping of containers id to container */
+    std::map<int, int> _containerIndices;            /**< mapping of containers id to index in the list of containers */
     Container *_containerPtrs[MAX_NUM_CONTAINERS];   /**< list of containers */
+    WorkerQueue _queues[MAX_NUM_CONTAINERS];         /**< task queues of containers */
+    bool _running;                                   /**< whether the workers are running */
 };
 
 #endif // define __CONTAINER_MANAGER_HH__
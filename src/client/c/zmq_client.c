@@ -210,11 +210,20 @@ int listObjects(const char *ip, int port) {
     ncloud_conn_t conn;
     ncloud_conn_t_init(ip, port, &conn, 1);
 
-    set_get_file_list_request(&req, namespaceId, "");
-    if (send_request(&conn, &req) == -1) {
-        printf("> Request failed\n");
-    } else {
-        printf("Get a total of %u files\n", req.file_list.total);
+    unsigned int total = 0;
+    char *cursor = NULL;
+
+    // list the files page by page
+    do {
+        set_get_file_list_page_request(&req, namespaceId, "", cursor, 0);
+        if (send_request(&conn, &req) == -1) {
+            printf("> Request failed\n");
+            request_t_release(&req);
+            break;
+        }
+        free(cursor);
+        cursor = req.file_list.cursor.length > 0? strdup(req.file_list.cursor.name) : NULL;
+        total += req.file_list.total;
         for (unsigned int i = 0; i < req.file_list.total; i++) {
             printf("Get file [%s] of size %lu\n\tcreate at %s",
                 req.file_list.list[i].fname,
@@ -228,9 +237,12 @@ int listObjects(const char *ip, int port) {
                 ctime(&req.file_list.list[i].mtime)
             );
         }
-    }
+        request_t_release(&req);
+    } while (cursor != NULL);
 
-    request_t_release(&req);
+    printf("Get a total of %u files\n", total);
+
+    free(cursor);
     ncloud_conn_t_release(&conn);
 
     return 0;
@@ -129,6 +129,9 @@ int file_list_head_t_init(file_list_head_t *head) {
 
     head->list = 0;
     head->total = 0;
+    name_t_init(&head->cursor);
+    head->page_size = 0;
+    head->free_cursor = 0;
     return 0;
 }
 
@@ -140,6 +143,10 @@ void file_list_head_t_release(file_list_head_t *head) {
         file_list_item_t_release(&head->list[i]);
     free(head->list);
 
+    if (head->free_cursor)
+        free(head->cursor.name);
+    name_t_release(&head->cursor);
+
     file_list_head_t_init(head);
 }
 
@@ -479,6 +486,18 @@ int set_get_file_list_request(request_t *req, unsigned char namespace_id, char *
     return 0;
 }
 
+int set_get_file_list_page_request(request_t *req, unsigned char namespace_id, char *prefix, char *cursor, unsigned int page_size) {
+    if (set_get_file_list_request(req, namespace_id, prefix) != 0)
+        return -1;
+
+    req->opcode = GET_FILE_LIST_PAGE_REQ;
+    req->file_list.cursor.name = cursor == 0? "" : cursor;
+    req->file_list.cursor.length = strlen(req->file_list.cursor.name);
+    req->file_list.page_size = page_size;
+
+    return 0;
+}
+
 int set_get_append_size_request(request_t *req, char *storage_class) {
     if (request_t_init(req) != 0)
         return -1;
@@ -617,6 +636,7 @@ static int issue_request(void *socket, int opcode, unsigned char namespace_id, f
         (!has_opcode_only(opcode) && !has_namespace_id_only(opcode) && file == NULL) ||
         (opcode == GET_CAPACITY_REQ && stats == NULL) ||
         (opcode == GET_FILE_LIST_REQ && flist == NULL && file == NULL) ||
+        (opcode == GET_FILE_LIST_PAGE_REQ && flist == NULL) ||
         (opcode == GET_AGENT_STATUS_REQ && alist == NULL) ||
         (opcode == GET_PROXY_STATUS_REQ && pstatus == NULL)
     ) {
@@ -658,6 +678,28 @@ static int issue_request(void *socket, int opcode, unsigned char namespace_id, f
                 return -1;
             }
             log_info("Send file name = %s\n", file->filename.name);
+        } else if (opcode == GET_FILE_LIST_PAGE_REQ) {
+            // send file prefix
+            msg_length = file->filename.length;
+            if (!send_field(file->filename.name, ZMQ_SNDMORE)) {
+                log_error("Failed to send the request file name, err = %d\n", errno);
+                return -1;
+            }
+            log_info("Send file name = %s\n", file->filename.name);
+            // send continuation token
+            msg_length = flist->cursor.length;
+            if (!send_field(flist->cursor.name, ZMQ_SNDMORE)) {
+                log_error("Failed to send the request file list cursor, err = %d\n", errno);
+                return -1;
+            }
+            log_info("Send file list cursor = %s\n", flist->cursor.name);
+            // send page size
+            msg_length = sizeof(flist->page_size);
+            if (!send_field(&flist->page_size, 0)) {
+                log_error("Failed to send the request file list page size, err = %d\n", errno);
+                return -1;
+            }
+            log_info("Send file list page size = %u\n", flist->page_size);
         } else {
             // send file name
             msg_length = file->filename.length;
@@ -828,7 +870,7 @@ static int issue_request(void *socket, int opcode, unsigned char namespace_id, f
         // get file max count
         check_more_msg();
         get_field(&stats->file_limit);
-    } else if (reply_opcode == GET_FILE_LIST_REP_SUCCESS) {
+    } else if (reply_opcode == GET_FILE_LIST_REP_SUCCESS || reply_opcode == GET_FILE_LIST_PAGE_REP_SUCCESS) {
         // get file count
         check_more_msg();
         get_field(&flist->total);
@@ -867,6 +909,25 @@ static int issue_request(void *socket, int opcode, unsigned char namespace_id, f
             check_more_msg();
             get_field(&flist->list[i].mtime);
         }
+        // get the continuation token of the next page
+        if (reply_opcode == GET_FILE_LIST_PAGE_REP_SUCCESS) {
+            check_more_msg();
+            get_new_msg();
+            if (flist->free_cursor == 1)
+                free(flist->cursor.name);
+            flist->cursor.length = zmq_msg_size(&msg);
+            flist->cursor.name = (char *) malloc (flist->cursor.length + 1);
+            if (flist->cursor.name == NULL) {
+                log_error("Failed to allocate memory for file list cursor\n");
+                name_t_init(&flist->cursor);
+                flist->free_cursor = 0;
+                zmq_msg_close(&msg);
+                return -1;
+            }
+            memcpy(flist->cursor.name, zmq_msg_data(&msg), flist->cursor.length);
+            flist->cursor.name[flist->cursor.length] = 0;
+            flist->free_cursor = 1;
+        }
     } else if (
             reply_opcode == GET_APPEND_SIZE_REP_SUCCESS ||
             reply_opcode == GET_READ_SIZE_REP_SUCCESS
@@ -79,6 +79,9 @@ typedef struct {
 typedef struct {
     file_list_item_t *list;
     unsigned int total;
+    name_t cursor;                /**< continuation token of a page (for paged listing); to request, or of the next page (empty after the last page) on reply */
+    unsigned int page_size;       /**< approx. number of files per page (for paged listing) */
+    int free_cursor;              /**< whether the continuation token needs to be freed upon release */
 } file_list_head_t;
 
 typedef struct {
@@ -140,6 +143,7 @@ void ncloud_conn_t_release(ncloud_conn_t *conn);
 // system (metadata) operations
 int set_get_storage_capacity_request(request_t *req);
 int set_get_file_list_request(request_t *req, unsigned char namespace_id, char *preifx);
+int set_get_file_list_page_request(request_t *req, unsigned char namespace_id, char *prefix, char *cursor, unsigned int page_size);
 int set_get_agent_status_request(request_t *req);
 int set_get_proxy_status_request(request_t *req);
 int set_get_repair_stats_request(request_t *req);
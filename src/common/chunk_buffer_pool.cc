@@ -0,0 +1,199 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <stdlib.h>
+
+#include <glog/logging.h>
+
+#include "chunk_buffer_pool.hh"
+#include "config.hh"
+#include "define.hh"
+
+ChunkBuffer::ChunkBuffer(unsigned char *data, size_t capacity) {
+    _data = data;
+    _capacity = capacity;
+    _refs = 1;
+}
+
+ChunkBuffer::~ChunkBuffer() {
+    free(_data);
+}
+
+void ChunkBuffer::ref() {
+    _refs.fetch_add(1);
+}
+
+void ChunkBuffer::release() {
+    if (_refs.fetch_sub(1) == 1)
+        ChunkBufferPool::getInstance().put(this);
+}
+
+void ChunkBuffer::releaseFromMessage(void *data, void *hint) {
+    ((ChunkBuffer *) hint)->release();
+}
+
+bool ChunkBuffer::isExclusive() const {
+    return _refs.load() == 1;
+}
+
+unsigned char *ChunkBuffer::getData() const {
+    return _data;
+}
+
+size_t ChunkBuffer::getCapacity() const {
+    return _capacity;
+}
+
+std::string ChunkBufferPoolStats::toString() const {
+    return std::string("requests = ").append(std::to_string(numRequests))
+        .append(", thread cache hits = ").append(std::to_string(numThreadCacheHits))
+        .append(", pool hits = ").append(std::to_string(numPoolHits))
+        .append(", allocs = ").append(std::to_string(numAllocs))
+        .append(", frees = ").append(std::to_string(numFrees))
+        .append(", live bytes = ").append(std::to_string(liveBytes))
+        .append(", idle bytes = ").append(std::to_string(idleBytes))
+        .append(", thread cached bytes = ").append(std::to_string(threadCachedBytes));
+}
+
+/**
+ * Idle buffers cached by a thread
+ **/
+struct ChunkBufferThreadCache {
+    std::map<size_t, std::vector<ChunkBuffer*>> buffers;  /**< buffer capacity to idle buffers mapping */
+    size_t bytes = 0;                                     /**< total capacity of idle buffers */
+    bool requested = false;                               /**< whether the thread has requested any buffer */
+    bool active = true;                                   /**< whether the cache is usable (false once the thread exits) */
+
+    ~ChunkBufferThreadCache() {
+        // return all cached buffers to the shared pool
+        active = false;
+        ChunkBufferPool &pool = ChunkBufferPool::getInstance();
+        for (auto &c : buffers)
+            for (ChunkBuffer *buffer : c.second)
+                pool.putShared(buffer);
+        buffers.clear();
+        pool._threadCachedBytes -= bytes;
+        bytes = 0;
+    }
+};
+
+static thread_local ChunkBufferThreadCache threadCache;
+
+ChunkBufferPool::ChunkBufferPool() {
+    Config &config = Config::getInstance();
+    _idleBytes = 0;
+    _maxIdleBytes = (size_t) config.getChunkBufferPoolSize() << 20;
+    _threadCachedBytes = 0;
+    _maxThreadCacheBytes = (size_t) config.getChunkBufferThreadCacheSize() << 20;
+    _maxTotalThreadCacheBytes = (size_t) config.getChunkBufferTotalThreadCacheSize() << 20;
+    _numRequests = 0;
+    _numThreadCacheHits = 0;
+    _numPoolHits = 0;
+    _numAllocs = 0;
+    _numFrees = 0;
+    _liveBytes = 0;
+}
+
+size_t ChunkBufferPool::getSizeClass(size_t size) {
+    if (size <= CHUNK_BUFFER_MIN_SIZE)
+        return CHUNK_BUFFER_MIN_SIZE;
+    // round up to a multiple of a fraction of the largest power of two below the size
+    int shift = sizeof(unsigned long) * 8 - 1 - __builtin_clzl(size - 1);
+    size_t step = (1UL << shift) / CHUNK_BUFFER_CLASSES_PER_DOUBLE;
+    return (size + step - 1) / step * step;
+}
+
+ChunkBuffer *ChunkBufferPool::get(size_t size) {
+    size_t capacity = getSizeClass(size);
+    ChunkBuffer *buffer = NULL;
+
+    _numRequests++;
+
+    // reuse an idle buffer cached by this thread if any
+    ChunkBufferThreadCache &cache = threadCache;
+    if (cache.active) {
+        cache.requested = true;
+        auto it = cache.buffers.find(capacity);
+        if (it != cache.buffers.end() && !it->second.empty()) {
+            buffer = it->second.back();
+            it->second.pop_back();
+            cache.bytes -= capacity;
+            _threadCachedBytes -= capacity;
+            _numThreadCacheHits++;
+        }
+    }
+
+    // reuse an idle buffer in the shared pool if any
+    if (buffer == NULL) {
+        _lock.lock();
+        auto it = _idleBuffers.find(capacity);
+        if (it != _idleBuffers.end() && !it->second.empty()) {
+            buffer = it->second.back();
+            it->second.pop_back();
+            _idleBytes -= capacity;
+            _numPoolHits++;
+        }
+        _lock.unlock();
+    }
+
+    // allocate a new one otherwise
+    if (buffer == NULL) {
+        unsigned char *data = NULL;
+        if (posix_memalign((void **) &data, CHUNK_BUFFER_ALIGNMENT, capacity) != 0 || data == NULL) {
+            LOG(ERROR) << "Failed to allocate chunk buffer of size " << capacity;
+            return NULL;
+        }
+        buffer = new ChunkBuffer(data, capacity);
+        _numAllocs++;
+    }
+
+    buffer->_refs = 1;
+    _liveBytes += capacity;
+    return buffer;
+}
+
+ChunkBufferPoolStats ChunkBufferPool::getStats() const {
+    ChunkBufferPoolStats stats;
+    stats.numRequests = _numRequests;
+    stats.numThreadCacheHits = _numThreadCacheHits;
+    stats.numPoolHits = _numPoolHits;
+    stats.numAllocs = _numAllocs;
+    stats.numFrees = _numFrees;
+    stats.liveBytes = _liveBytes;
+    stats.idleBytes = _idleBytes;
+    stats.threadCachedBytes = _threadCachedBytes;
+    return stats;
+}
+
+void ChunkBufferPool::put(ChunkBuffer *buffer) {
+    _liveBytes -= buffer->_capacity;
+
+    // keep the buffer in this thread's cache, unless the thread never requests
+    // buffers (e.g., network I/O threads releasing buffers sent), or the
+    // thread's cache or all thread caches together are full
+    ChunkBufferThreadCache &cache = threadCache;
+    if (cache.active && cache.requested && cache.bytes + buffer->_capacity <= _maxThreadCacheBytes) {
+        if (_threadCachedBytes.fetch_add(buffer->_capacity) + buffer->_capacity <= _maxTotalThreadCacheBytes) {
+            cache.buffers[buffer->_capacity].push_back(buffer);
+            cache.bytes += buffer->_capacity;
+            return;
+        }
+        _threadCachedBytes -= buffer->_capacity;
+    }
+
+    putShared(buffer);
+}
+
+void ChunkBufferPool::putShared(ChunkBuffer *buffer) {
+    _lock.lock();
+    if (_idleBytes + buffer->_capacity <= _maxIdleBytes) {
+        _idleBuffers[buffer->_capacity].push_back(buffer);
+        _idleBytes += buffer->_capacity;
+        buffer = NULL;
+    }
+    _lock.unlock();
+    // free the buffer if the pool is full
+    if (buffer != NULL) {
+        delete buffer;
+        _numFrees++;
+    }
+}
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __CHUNK_BUFFER_POOL_HH__
+#define __CHUNK_BUFFER_POOL_HH__
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define CHUNK_BUFFER_ALIGNMENT          (4096)   // alignment of pooled buffers (page, for direct I/O, cache line, and SIMD coding)
+#define CHUNK_BUFFER_MIN_SIZE           (4096)   // smallest size class of pooled buffers
+#define CHUNK_BUFFER_CLASSES_PER_DOUBLE (4)      // number of size classes per doubling of buffer size
+
+class ChunkBufferPool;
+
+/**
+ * Holder of a chunk data buffer which is not allocated by malloc() (e.g., a
+ * network message or a pooled buffer), and is released via the holder instead
+ **/
+class ChunkDataHolder {
+public:
+    virtual ~ChunkDataHolder() {}
+
+    /**
+     * Release the reference to the data buffer held
+     **/
+    virtual void release() = 0;
+};
+
+/**
+ * Reference-counted chunk data buffer from the chunk buffer pool
+ *
+ * A buffer is referenced by the chunk holding it, and by every network message
+ * sending it without copying (see IO::sendChunkEventMessage()). The buffer
+ * returns to the pool when the last reference is released.
+ **/
+class ChunkBuffer : public ChunkDataHolder {
+public:
+    /**
+     * Add a reference to the buffer
+     **/
+    void ref();
+
+    /**
+     * Release a reference to the buffer, and return the buffer to the pool on the last reference
+     **/
+    void release();
+
+    /**
+     * Free callback of network messages referencing the buffer
+     *
+     * @param[in] data   data buffer (unused)
+     * @param[in] hint   pointer to the ChunkBuffer
+     **/
+    static void releaseFromMessage(void *data, void *hint);
+
+    /**
+     * Tell whether the buffer is only referenced by a single holder (and can be overwritten)
+     *
+     * @return whether the buffer has exactly one reference
+     **/
+    bool isExclusive() const;
+
+    unsigned char *getData() const;
+    size_t getCapacity() const;
+
+private:
+    friend class ChunkBufferPool;
+
+    ChunkBuffer(unsigned char *data, size_t capacity);
+    ~ChunkBuffer();
+
+    unsigned char *_data;                     /**< data buffer */
+    size_t _capacity;                         /**< capacity of the data buffer */
+    std::atomic<int> _refs;                   /**< number of references */
+};
+
+/**
+ * Statistics of the chunk buffer pool
+ **/
+struct ChunkBufferPoolStats {
+    unsigned long int numRequests;            /**< number of buffer requests */
+    unsigned long int numThreadCacheHits;     /**< number of requests served by the per-thread caches */
+    unsigned long int numPoolHits;            /**< number of requests served by the shared pool */
+    unsigned long int numAllocs;              /**< number of buffers allocated from the system */
+    unsigned long int numFrees;               /**< number of buffers freed to the system */
+    unsigned long int liveBytes;              /**< total capacity of buffers in use */
+    unsigned long int idleBytes;              /**< total capacity of idle buffers in the shared pool */
+    unsigned long int threadCachedBytes;      /**< total capacity of idle buffers in the per-thread caches */
+
+    std::string toString() const;
+};
+
+/**
+ * Pool of chunk data buffers, which avoids repeated allocation of large
+ * buffers and allows the buffers to be sent without copying
+ *
+ * Buffers are aligned to CHUNK_BUFFER_ALIGNMENT bytes, and are rounded up to
+ * size classes (CHUNK_BUFFER_CLASSES_PER_DOUBLE classes between consecutive
+ * powers of two) so that buffers of similar sizes are interchangeable. Each
+ * thread caches a limited amount of idle buffers to avoid contention on the
+ * shared pool, and returns them to the shared pool on exit. The total amount
+ * cached by all threads is also limited, beyond which idle buffers return to
+ * the shared pool. The limits are set in general.ini (see chunk_buffer).
+ **/
+class ChunkBufferPool {
+public:
+    static ChunkBufferPool &getInstance() {
+        // never destroyed, as buffers may be released by network messages at any time
+        static ChunkBufferPool *instance = new ChunkBufferPool();
+        return *instance;
+    }
+
+    /**
+     * Get a buffer of at least the given size, with one reference held by the caller
+     *
+     * @param[in] size   minimum size of the buffer
+     *
+     * @return the buffer, NULL if out of memory
+     **/
+    ChunkBuffer *get(size_t size);
+
+    /**
+     * Get the current statistics of the pool
+     *
+     * @return statistics of the pool
+     **/
+    ChunkBufferPoolStats getStats() const;
+
+    /**
+     * Get the size class of a buffer request
+     *
+     * @param[in] size   requested size
+     *
+     * @return the capacity of buffers serving the request
+     **/
+    static size_t getSizeClass(size_t size);
+
+private:
+    friend class ChunkBuffer;
+    friend struct ChunkBufferThreadCache;
+
+    ChunkBufferPool();
+    ChunkBufferPool(const ChunkBufferPool&) = delete;
+    void operator=(const ChunkBufferPool&) = delete;
+
+    /**
+     * Return a buffer without references to the pool, or free it if the pool is full
+     *
+     * @param[in] buffer buffer to return
+     **/
+    void put(ChunkBuffer *buffer);
+
+    /**
+     * Return a buffer to the shared pool, or free it if the pool is full
+     *
+     * @param[in] buffer buffer to return
+     **/
+    void putShared(ChunkBuffer *buffer);
+
+    std::mutex _lock;                                              /**< lock on the idle buffers */
+    std::map<size_t, std::vector<ChunkBuffer*>> _idleBuffers;      /**< buffer capacity to idle buffers mapping */
+    std::atomic<size_t> _idleBytes;                                /**< total capacity of idle buffers */
+    size_t _maxIdleBytes;                                          /**< max. total capacity of idle buffers */
+    std::atomic<size_t> _threadCachedBytes;                        /**< total capacity of idle buffers in thread caches */
+    size_t _maxThreadCacheBytes;                                   /**< max. total capacity of idle buffers cached by each thread */
+    size_t _maxTotalThreadCacheBytes;                              /**< max. total capacity of idle buffers cached by all threads */
+
+    std::atomic<unsigned long int> _numRequests;                   /**< number of buffer requests */
+    std::atomic<unsigned long int> _numThreadCacheHits;            /**< number of requests served by thread caches */
+    std::atomic<unsigned long int> _numPoolHits;                   /**< number of requests served by the shared pool */
+    std::atomic<unsigned long int> _numAllocs;                     /**< number of buffers allocated from the system */
+    std::atomic<unsigned long int> _numFrees;                      /**< number of buffers freed to the system */
+    std::atomic<unsigned long int> _liveBytes;                     /**< total capacity of buffers in use */
+};
+
+#endif // define __CHUNK_BUFFER_POOL_HH__
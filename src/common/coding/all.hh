@@ -1,3 +1,5 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "rs.hh"
+#include "cauchy_rs.hh"
+#include "lrc.hh"
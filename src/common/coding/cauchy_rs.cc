@@ -0,0 +1,22 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include "cauchy_rs.hh"
+
+extern "C" {
+#include <isa-l/erasure_code.h>
+}
+
+#include <glog/logging.h>
+
+CauchyRSCode::CauchyRSCode(CodingOptions options) : RSCode(options) {
+    coding_param_t n = options.getN();
+    coding_param_t k = options.getK();
+
+    _name = "CauchyRS";
+
+    // replace the RS matrix with a Cauchy one for coding
+    gf_gen_cauchy1_matrix(_encodeMatrix, n, k);
+    ec_init_tables(k, n - k, &_encodeMatrix[k * k], _gftbl);
+
+    DLOG(INFO) << "Cauchy RS codes init with n=" << (int) n << ",k=" << (int) k << ",useCAR=" << (bool) _options.repairUsingCAR();
+}
@@ -0,0 +1,22 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __CAUCHY_RS_CODE_HH__
+#define __CAUCHY_RS_CODE_HH__
+
+#include "rs.hh"
+
+/**
+ * Reed-Solomon codes with a Cauchy generator matrix
+ *
+ * Unlike the Vandermonde-based matrix in RSCode, any k rows of the Cauchy
+ * matrix are invertible, so the codes are MDS for all valid (n, k). Encoding,
+ * decoding, and repair follow RSCode.
+ **/
+class CauchyRSCode : public RSCode {
+public:
+
+    CauchyRSCode(CodingOptions options);
+    ~CauchyRSCode() {}
+};
+
+#endif // define __CAUCHY_RS_CODE_HH__
@@ -156,10 +156,11 @@ public:
      * @param[in] dataSize               size of the buffered data
      * @param[out] stripe                chunks in the stripe; the coding implementation should set the chunk id (using Chunk::setChunkId()) and data for all chunks
      * @param[out] codingState           a pointer to the placeholder of coding state; the coding state, if any, will be allocated by the function
+     * @param[in] inPlace                whether data chunks may reference the buffered data instead of a copy; if set, the caller must keep the buffered data intact until the chunks are released
      *
      * @return if data is successfully encoded 
      **/
-    virtual bool encode(data_t *data, length_t dataSize, std::vector<Chunk> &stripe, data_t **codingState) = 0;
+    virtual bool encode(data_t *data, length_t dataSize, std::vector<Chunk> &stripe, data_t **codingState, bool inPlace = false) = 0;
 
     /**
      * Decode data chunks using input chunks
@@ -15,6 +15,10 @@ public:
             switch (codingScheme) {
             case CodingScheme::RS:
                 return new RSCode(options);
+            case CodingScheme::CAUCHY_RS:
+                return new CauchyRSCode(options);
+            case CodingScheme::LRC:
+                return new LRCCode(options);
             }
         } catch (std::exception &e) {
             LOG(ERROR) << "Failed to init coding, " << e.what();
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <string.h>
+
+#include "coding_table_cache.hh"
+#include "../define.hh"
+
+std::string CodingTableCacheStats::toString() const {
+    return std::string("hits = ").append(std::to_string(numHits))
+        .append(", misses = ").append(std::to_string(numMisses))
+        .append(", entries = ").append(std::to_string(numEntries));
+}
+
+CodingTableCache::CodingTableCache() {
+    _maxEntries = DEFAULT_CODING_TABLE_CACHE_SIZE;
+    _numHits = 0;
+    _numMisses = 0;
+}
+
+bool CodingTableCache::get(const std::string &key, uint8_t *table, size_t size) {
+    _lock.lock();
+    auto it = _index.find(key);
+    if (it == _index.end() || it->second->second.size() != size) {
+        _lock.unlock();
+        _numMisses++;
+        return false;
+    }
+
+    // mark as the most recently used
+    _tables.splice(_tables.begin(), _tables, it->second);
+    memcpy(table, it->second->second.data(), size);
+    _lock.unlock();
+    _numHits++;
+
+    return true;
+}
+
+void CodingTableCache::put(const std::string &key, const uint8_t *table, size_t size) {
+    _lock.lock();
+
+    // replace the existing table
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+        it->second->second.assign(table, table + size);
+        _tables.splice(_tables.begin(), _tables, it->second);
+        _lock.unlock();
+        return;
+    }
+
+    // evict the least recently used table
+    if (_tables.size() >= _maxEntries && !_tables.empty()) {
+        _index.erase(_tables.back().first);
+        _tables.pop_back();
+    }
+
+    _tables.emplace_front(key, std::vector<uint8_t>(table, table + size));
+    _index[key] = _tables.begin();
+
+    _lock.unlock();
+}
+
+CodingTableCacheStats CodingTableCache::getStats() {
+    CodingTableCacheStats stats;
+    stats.numHits = _numHits;
+    stats.numMisses = _numMisses;
+    _lock.lock();
+    stats.numEntries = _tables.size();
+    _lock.unlock();
+    return stats;
+}
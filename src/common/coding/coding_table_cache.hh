@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __CODING_TABLE_CACHE_HH__
+#define __CODING_TABLE_CACHE_HH__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Statistics of the coding table cache
+ **/
+struct CodingTableCacheStats {
+    unsigned long int numHits;                /**< number of lookups served by the cache */
+    unsigned long int numMisses;              /**< number of lookups not served by the cache */
+    unsigned long int numEntries;             /**< number of cached tables */
+
+    std::string toString() const;
+};
+
+/**
+ * LRU cache of coding tables shared across threads, e.g., inverted decoding
+ * matrices and their expanded GF tables, which are costly to derive but only
+ * depend on the coding parameters and the failure pattern
+ *
+ * Tables are identified by keys built with appendKey(), which should begin with
+ * the table type and the coding parameters.
+ **/
+class CodingTableCache {
+public:
+    static CodingTableCache &getInstance() {
+        // never destroyed, as coding may still run in other threads upon exit
+        static CodingTableCache *instance = new CodingTableCache();
+        return *instance;
+    }
+
+    /**
+     * Look up a table
+     *
+     * @param[in] key       key of the table
+     * @param[out] table    buffer to hold a copy of the table
+     * @param[in] size      size of the table
+     *
+     * @return whether the table of the given size is found
+     **/
+    bool get(const std::string &key, uint8_t *table, size_t size);
+
+    /**
+     * Add (or replace) a table, and evict the least recently used one if the cache is full
+     *
+     * @param[in] key       key of the table
+     * @param[in] table     table to cache
+     * @param[in] size      size of the table
+     **/
+    void put(const std::string &key, const uint8_t *table, size_t size);
+
+    /**
+     * Get the current statistics of the cache
+     *
+     * @return statistics of the cache
+     **/
+    CodingTableCacheStats getStats();
+
+    /**
+     * Append a value to a table key
+     *
+     * @param[in,out] key   key to extend
+     * @param[in] value     value to append
+     **/
+    static void appendKey(std::string &key, int value) {
+        key.append((const char *) &value, sizeof(value));
+    }
+
+private:
+    CodingTableCache();
+    CodingTableCache(const CodingTableCache&) = delete;
+    void operator=(const CodingTableCache&) = delete;
+
+    typedef std::list<std::pair<std::string, std::vector<uint8_t>>> TableList;
+
+    std::mutex _lock;                                               /**< lock on the cached tables */
+    TableList _tables;                                              /**< cached tables, in the order of most recently used first */
+    std::unordered_map<std::string, TableList::iterator> _index;    /**< key to cached table mapping */
+    size_t _maxEntries;                                             /**< max. number of cached tables */
+
+    std::atomic<unsigned long int> _numHits;                        /**< number of lookups served by the cache */
+    std::atomic<unsigned long int> _numMisses;                      /**< number of lookups not served by the cache */
+};
+
+#endif // define __CODING_TABLE_CACHE_HH__
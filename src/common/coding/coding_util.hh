@@ -7,6 +7,10 @@ extern "C" {
 #include <isa-l/erasure_code.h>
 }
 
+#include <string>
+
+#include "coding_table_cache.hh"
+
 class CodingUtils {
 public:
     static bool encode(unsigned char *data, int numDataChunks, unsigned char *code, int numCodeChunks, int chunkSize, unsigned char *matrix) {
@@ -17,18 +21,41 @@ public:
             codep[i] = (unsigned char *) code + i * chunkSize;
 
         uint8_t gftbl[numDataChunks * numCodeChunks * 32];
-        ec_init_tables(numDataChunks, numCodeChunks, matrix, gftbl);
+        initTables(numDataChunks, numCodeChunks, matrix, gftbl);
         ec_encode_data(chunkSize, numDataChunks, numCodeChunks, gftbl, datap, codep);
 
         return true;
     }
     static bool encode(unsigned char **data, int numDataChunks, unsigned char **code, int numCodeChunks, int chunkSize, unsigned char *matrix) {
         uint8_t gftbl[numDataChunks * numCodeChunks * 32];
-        ec_init_tables(numDataChunks, numCodeChunks, matrix, gftbl);
+        initTables(numDataChunks, numCodeChunks, matrix, gftbl);
         ec_encode_data(chunkSize, numDataChunks, numCodeChunks, gftbl, data, code);
 
         return true;
     }
+
+private:
+    /**
+     * Expand the coding matrix into GF tables, or reuse the cached ones of the same matrix (e.g., in repeated repairs of the same failure pattern)
+     *
+     * @param[in] numDataChunks    number of input chunks
+     * @param[in] numCodeChunks    number of output chunks
+     * @param[in] matrix           coding matrix of size numCodeChunks * numDataChunks
+     * @param[out] gftbl           GF tables of size numDataChunks * numCodeChunks * 32
+     **/
+    static void initTables(int numDataChunks, int numCodeChunks, unsigned char *matrix, uint8_t *gftbl) {
+        size_t matrixSize = numDataChunks * numCodeChunks;
+        std::string tableKey(1, 'E');
+        CodingTableCache::appendKey(tableKey, numDataChunks);
+        CodingTableCache::appendKey(tableKey, numCodeChunks);
+        tableKey.append((const char *) matrix, matrixSize);
+
+        CodingTableCache &tableCache = CodingTableCache::getInstance();
+        if (tableCache.get(tableKey, gftbl, matrixSize * 32))
+            return;
+        ec_init_tables(numDataChunks, numCodeChunks, matrix, gftbl);
+        tableCache.put(tableKey, gftbl, matrixSize * 32);
+    }
 };
 
 #endif // define __CODING_UTIL_HH__
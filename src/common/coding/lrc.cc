@@ -0,0 +1,452 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include "lrc.hh"
+
+extern "C" {
+#include <isa-l/erasure_code.h>
+}
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+LRCCode::LRCCode(CodingOptions options) {
+    coding_param_t n = options.getN();
+    coding_param_t k = options.getK();
+
+    // check the coding parameters
+    if (n <= 0 || k <= 0 || n < k || n > CODING_MAX_N) {
+        throw std::invalid_argument("LRC codes only support n>=k, n > 0, k > 0, and n <= 128");
+    }
+
+    // set the coding options
+    _options = options;
+
+    _name = "LRC";
+
+    // keep at least one global parity, and at least one data chunk per local group
+    num_t numParities = n - k;
+    _numLocalGroups = std::min(std::min((num_t) LRC_MAX_NUM_LOCAL_GROUPS, numParities > 0? numParities - 1 : 0), (num_t) k);
+    num_t numGlobalParities = numParities - _numLocalGroups;
+
+    // generator matrix: identity for data chunks
+    memset(_encodeMatrix, 0, n * k);
+    for (coding_param_t i = 0; i < k; i++) {
+        _encodeMatrix[i * k + i] = 1;
+    }
+    // local parities: xor of the data chunks in the group
+    for (coding_param_t i = 0; i < k && _numLocalGroups > 0; i++) {
+        _encodeMatrix[(k + getLocalGroup(i)) * k + i] = 1;
+    }
+    // global parities: cauchy-coded from all data chunks
+    if (numGlobalParities > 0) {
+        std::vector<uint8_t> cauchyMatrix((k + numGlobalParities) * k);
+        gf_gen_cauchy1_matrix(cauchyMatrix.data(), k + numGlobalParities, k);
+        memcpy(_encodeMatrix + (k + _numLocalGroups) * k, cauchyMatrix.data() + k * k, numGlobalParities * k);
+    }
+    ec_init_tables(k, n - k, &_encodeMatrix[k * k], _gftbl);
+
+    DLOG(INFO) << "LRC codes init with n=" << (int) n << ",k=" << (int) k << ",l=" << _numLocalGroups << ",g=" << numGlobalParities;
+}
+
+num_t LRCCode::getNumDataChunks() {
+    return _options.getK();
+}
+
+num_t LRCCode::getNumCodeChunks() {
+    return _options.getN() - _options.getK();
+}
+
+num_t LRCCode::getNumChunks() {
+    return _options.getN();
+}
+
+num_t LRCCode::getNumChunksPerNode() {
+    return 1;
+}
+
+length_t LRCCode::getCodingStateSize() {
+    return 0;
+}
+
+length_t LRCCode::getChunkSize(length_t dataSize) {
+    coding_param_t k = _options.getK();
+    return (dataSize + k - 1) / k;
+}
+
+num_t LRCCode::getNumLocalGroups() {
+    return _numLocalGroups;
+}
+
+int LRCCode::getLocalGroup(chunk_id_t chunkId) {
+    coding_param_t k = _options.getK();
+
+    if (_numLocalGroups == 0) {
+        return -1;
+    }
+
+    // data chunks, the first (k % l) groups hold one more chunk than the others
+    if (chunkId < k) {
+        num_t groupSize = k / _numLocalGroups, numLargerGroups = k % _numLocalGroups;
+        if (chunkId < numLargerGroups * (groupSize + 1))
+            return chunkId / (groupSize + 1);
+        return numLargerGroups + (chunkId - numLargerGroups * (groupSize + 1)) / groupSize;
+    }
+
+    // local parities
+    if (chunkId < k + _numLocalGroups) {
+        return chunkId - k;
+    }
+
+    // global parities
+    return -1;
+}
+
+void LRCCode::getLocalGroupPeers(chunk_id_t chunkId, std::vector<chunk_id_t> &members) {
+    coding_param_t k = _options.getK();
+    int group = getLocalGroup(chunkId);
+
+    members.clear();
+    if (group < 0) {
+        return;
+    }
+    for (chunk_id_t i = 0; i < k; i++) {
+        if (i != chunkId && getLocalGroup(i) == group)
+            members.push_back(i);
+    }
+    if (chunkId != k + group) {
+        members.push_back(k + group);
+    }
+}
+
+bool LRCCode::selectIndependentChunks(const std::vector<chunk_id_t> &candidates, std::vector<chunk_id_t> &selected) {
+    coding_param_t k = _options.getK();
+
+    // rows of the generator matrix in row echelon form, and their pivot columns
+    uint8_t basis[k * k];
+    int pivots[k];
+    num_t rank = 0;
+    uint8_t row[k];
+
+    selected.clear();
+    for (size_t c = 0; c < candidates.size() && rank < k; c++) {
+        memcpy(row, _encodeMatrix + candidates.at(c) * k, k);
+        // eliminate the pivot columns of selected rows
+        for (num_t b = 0; b < rank; b++) {
+            uint8_t s = row[pivots[b]];
+            if (s == 0) continue;
+            for (coding_param_t j = 0; j < k; j++)
+                row[j] ^= gf_mul(s, basis[b * k + j]);
+        }
+        // skip rows which are linearly dependent on the selected ones
+        int pivot = -1;
+        for (coding_param_t j = 0; j < k && pivot < 0; j++) {
+            if (row[j] != 0) pivot = j;
+        }
+        if (pivot < 0) continue;
+        // normalize the row and add it to the selected ones
+        uint8_t inv = gf_inv(row[pivot]);
+        for (coding_param_t j = 0; j < k; j++)
+            basis[rank * k + j] = gf_mul(inv, row[j]);
+        pivots[rank++] = pivot;
+        selected.push_back(candidates.at(c));
+    }
+
+    return rank == k;
+}
+
+bool LRCCode::genDecodeMatrix(const std::vector<chunk_id_t> &inputChunkIds, const std::vector<chunk_id_t> &targets, uint8_t *matrix) {
+    coding_param_t k = _options.getK(), n = _options.getN();
+    num_t numInputs = inputChunkIds.size();
+
+    // chunk id to input index mapping
+    int inputIdx[n];
+    for (coding_param_t i = 0; i < n; i++) {
+        inputIdx[i] = -1;
+    }
+    for (num_t i = 0; i < numInputs; i++) {
+        if (inputChunkIds.at(i) >= n) {
+            LOG(ERROR) << "Invalid input chunk id " << inputChunkIds.at(i) << " for LRC with n=" << (int) n;
+            return false;
+        }
+        inputIdx[inputChunkIds.at(i)] = i;
+    }
+
+    memset(matrix, 0, targets.size() * numInputs);
+
+    std::vector<chunk_id_t> peers, selected;
+    uint8_t decodeMatrix[k * k], invertedMatrix[k * k];
+    bool inverted = false;
+
+    for (size_t t = 0; t < targets.size(); t++) {
+        chunk_id_t target = targets.at(t);
+        uint8_t *coefficients = matrix + t * numInputs;
+
+        if (target >= n) {
+            LOG(ERROR) << "Invalid target chunk id " << target << " for LRC with n=" << (int) n;
+            return false;
+        }
+
+        // the target is an input
+        if (inputIdx[target] >= 0) {
+            coefficients[inputIdx[target]] = 1;
+            continue;
+        }
+
+        // xor of the other chunks in the local group if they are all available
+        getLocalGroupPeers(target, peers);
+        bool local = !peers.empty();
+        for (size_t i = 0; i < peers.size() && local; i++) {
+            local = inputIdx[peers.at(i)] >= 0;
+        }
+        if (local) {
+            for (size_t i = 0; i < peers.size(); i++)
+                coefficients[inputIdx[peers.at(i)]] = 1;
+            continue;
+        }
+
+        // otherwise, decode using k independent inputs
+        if (!inverted) {
+            if (!selectIndependentChunks(inputChunkIds, selected)) {
+                LOG(ERROR) << "Failed to find " << (int) k << " independent chunks among " << numInputs << " input chunks for decoding";
+                return false;
+            }
+            for (coding_param_t i = 0; i < k; i++) {
+                memcpy(decodeMatrix + i * k, _encodeMatrix + selected.at(i) * k, k);
+            }
+            if (gf_invert_matrix(decodeMatrix, invertedMatrix, k) < 0) {
+                LOG(ERROR) << "Failed to invert the matrix for decoding";
+                return false;
+            }
+            inverted = true;
+        }
+        for (coding_param_t j = 0; j < k; j++) {
+            uint8_t s = 0;
+            for (coding_param_t l = 0; l < k; l++)
+                s ^= gf_mul(invertedMatrix[l * k + j], _encodeMatrix[target * k + l]);
+            coefficients[inputIdx[selected.at(j)]] = s;
+        }
+    }
+
+    return true;
+}
+
+bool LRCCode::encode(data_t *data, length_t dataSize, std::vector<Chunk> &stripe, data_t **codingState, bool inPlace) {
+    coding_param_t k = _options.getK(), n = _options.getN();
+
+    unsigned char *codep[n - k], *datap[k];
+
+    length_t chunkSize = getChunkSize(dataSize);
+
+    // init the stripe with n chunks
+    stripe.clear();
+    stripe.resize(n);
+
+    // set the pointers for data and code chunks
+    for (coding_param_t i = 0; i < n; i++) {
+        stripe.at(i).setChunkId(i);
+        // reference the data directly for data chunks fully within the buffered data
+        if (inPlace && i < k && (unsigned long int) (i + 1) * chunkSize <= dataSize) {
+            stripe.at(i).data = data + i * chunkSize;
+            stripe.at(i).size = chunkSize;
+            stripe.at(i).freeData = false;
+            datap[i] = stripe.at(i).data;
+            continue;
+        }
+        // try allocate space for chunks and revert previous ones if fails
+        if (!stripe.at(i).allocateData(chunkSize)) {
+            LOG(ERROR) << "Failed to allocate memory for chunk " << i << " in stripe with " << n << " chunks of size " << chunkSize;
+            stripe.clear();
+            return false;
+        }
+        if (i < k) {
+            // copy data to chunk output (padded with zeros beyond the buffered data) and set the buffer pointers for encoding
+            unsigned char *datacp = stripe.at(i).data;
+            unsigned long int offset = (unsigned long int) i * chunkSize;
+            length_t copySize = offset >= dataSize? 0 : std::min(chunkSize, (length_t) (dataSize - offset));
+            memcpy(datacp, data + offset, copySize);
+            memset(datacp + copySize, 0, chunkSize - copySize);
+            datap[i] = datacp;
+        } else {
+            // set the buffer pointers for encoding
+            codep[i - k] = (unsigned char *) stripe.at(i).data;
+        }
+    }
+
+    // encode data chunks to local and global parities
+    if (n > k) {
+        ec_encode_data(chunkSize, k, n - k, _gftbl, datap, codep);
+    }
+
+    return true;
+}
+
+bool LRCCode::decode(std::vector<Chunk> &inputChunks, data_t **decodedData, length_t &decodedSize, DecodingPlan &plan, data_t *codingState, bool isRepair, std::vector<chunk_id_t> repairTargets) {
+    coding_param_t k = _options.getK(), n = _options.getN();
+
+    num_t numInputChunks = inputChunks.size();
+    length_t chunkSize = inputChunks.empty()? 0 : inputChunks.at(0).size;
+
+    // input chunks
+    std::vector<chunk_id_t> inputChunkIds;
+    bool isInput[n];
+    memset(isInput, 0, n);
+    for (num_t i = 0; i < numInputChunks; i++) {
+        inputChunkIds.push_back(inputChunks.at(i).chunkId);
+        if (inputChunks.at(i).chunkId < n)
+            isInput[inputChunks.at(i).chunkId] = true;
+    }
+
+    // chunks to decode: data chunks for decoding, and failed chunks for repair
+    if (!isRepair) {
+        repairTargets.clear();
+        for (coding_param_t i = 0; i < k; i++)
+            repairTargets.push_back(i);
+    } else if (repairTargets.empty()) {
+        DLOG(INFO) << "Repair all missing chunks by default";
+        for (coding_param_t i = 0; i < n; i++) {
+            if (!isInput[i])
+                repairTargets.push_back(i);
+        }
+    }
+    num_t numDecodedChunks = repairTargets.size();
+
+    // find the coefficients for decoding
+    std::vector<uint8_t> matrix(numDecodedChunks * numInputChunks);
+    if (!genDecodeMatrix(inputChunkIds, repairTargets, matrix.data())) {
+        LOG(ERROR) << "Failed to find a way to decode " << numDecodedChunks << " chunks from " << numInputChunks << " input chunks";
+        return false;
+    }
+
+    // only use the input chunks required
+    std::vector<num_t> usedChunks;
+    unsigned char *inputp[numInputChunks];
+    for (num_t i = 0; i < numInputChunks; i++) {
+        bool used = false;
+        for (num_t t = 0; t < numDecodedChunks && !used; t++)
+            used = matrix.at(t * numInputChunks + i) != 0;
+        if (!used)
+            continue;
+        inputp[usedChunks.size()] = inputChunks.at(i).data;
+        usedChunks.push_back(i);
+    }
+    num_t numUsedChunks = usedChunks.size();
+    std::vector<uint8_t> finalMatrix(numDecodedChunks * numUsedChunks);
+    for (num_t t = 0; t < numDecodedChunks; t++) {
+        for (num_t u = 0; u < numUsedChunks; u++)
+            finalMatrix.at(t * numUsedChunks + u) = matrix.at(t * numInputChunks + usedChunks.at(u));
+    }
+
+    // allocate the decode buffer if nill, or reuse existing one
+    data_t *decodedDataTmp = *decodedData;
+    if (decodedDataTmp == NULL) {
+        decodedDataTmp = (data_t*) malloc (sizeof(data_t) * numDecodedChunks * chunkSize);
+        if (decodedDataTmp == NULL) {
+            LOG(ERROR) << "Failed to allocate memory for decoded data of size " << numDecodedChunks * chunkSize;
+            return false;
+        }
+    }
+    unsigned char *decodep[numDecodedChunks];
+    for (num_t i = 0; i < numDecodedChunks; i++) {
+        decodep[i] = decodedDataTmp + i * chunkSize;
+    }
+
+    // decode
+    if (numUsedChunks > 0 && numDecodedChunks > 0) {
+        std::vector<uint8_t> gftbl(numUsedChunks * numDecodedChunks * 32);
+        ec_init_tables(numUsedChunks, numDecodedChunks, finalMatrix.data(), gftbl.data());
+        ec_encode_data(chunkSize, numUsedChunks, numDecodedChunks, gftbl.data(), inputp, decodep);
+    }
+
+    // set decode output
+    *decodedData = decodedDataTmp;
+    decodedSize = numDecodedChunks * chunkSize;
+
+    return true;
+}
+
+bool LRCCode::preDecode(const std::vector<chunk_id_t> &failedChunkIdx, DecodingPlan &plan, data_t *codingState, bool isRepair) {
+    coding_param_t k = _options.getK(), n = _options.getN();
+    num_t numFailedChunks = failedChunkIdx.size();
+
+    // cannot decode if there is less than k chunks available
+    if (numFailedChunks > (uint32_t) n - k) {
+        LOG(ERROR) << "The number of failure = " << numFailedChunks << " is greater than n-k=" << n - k;
+        return false;
+    }
+
+    plan.release();
+
+    bool failed[n];
+    memset(failed, 0, n);
+    for (num_t i = 0; i < numFailedChunks; i++) {
+        if (failedChunkIdx.at(i) >= n) {
+            LOG(ERROR) << "Invalid failed chunk id " << failedChunkIdx.at(i) << " for LRC with n=" << (int) n;
+            return false;
+        }
+        failed[failedChunkIdx.at(i)] = true;
+    }
+
+    std::vector<chunk_id_t> inputChunkIds;
+
+    // repair with local groups only, if each failed chunk is in a distinct local group
+    bool localRepair = isRepair && numFailedChunks > 0;
+    bool groupFailed[_numLocalGroups + 1];
+    memset(groupFailed, 0, _numLocalGroups + 1);
+    for (num_t i = 0; i < numFailedChunks && localRepair; i++) {
+        int group = getLocalGroup(failedChunkIdx.at(i));
+        localRepair = group >= 0 && !groupFailed[group];
+        if (localRepair)
+            groupFailed[group] = true;
+    }
+    if (localRepair) {
+        std::vector<chunk_id_t> peers;
+        for (num_t i = 0; i < numFailedChunks; i++) {
+            getLocalGroupPeers(failedChunkIdx.at(i), peers);
+            inputChunkIds.insert(inputChunkIds.end(), peers.begin(), peers.end());
+        }
+        std::sort(inputChunkIds.begin(), inputChunkIds.end());
+    } else {
+        // select k independent chunks, preferring data chunks, then local parities, then global parities
+        std::vector<chunk_id_t> candidates;
+        for (coding_param_t i = 0; i < n; i++) {
+            if (!failed[i])
+                candidates.push_back(i);
+        }
+        if (!selectIndependentChunks(candidates, inputChunkIds)) {
+            LOG(ERROR) << "Failed to find " << (int) k << " independent chunks for decode with " << numFailedChunks << " failed chunks";
+            return false;
+        }
+        std::sort(inputChunkIds.begin(), inputChunkIds.end());
+    }
+
+    // input chunks selected, followed by other alive chunks as alternatives
+    for (size_t i = 0; i < inputChunkIds.size(); i++) {
+        plan.addInputChunkId(inputChunkIds.at(i));
+    }
+    for (coding_param_t i = 0; i < n; i++) {
+        if (!failed[i] && std::find(inputChunkIds.begin(), inputChunkIds.end(), i) == inputChunkIds.end())
+            plan.addInputChunkId(i);
+    }
+    plan.setMinNumInputChunks(inputChunkIds.size());
+
+    // only proceed to generate the repair matrix in plan when preparing for a repair
+    if (!isRepair) {
+        return true;
+    }
+
+    // allocate space for outputting repair matrix
+    if (!plan.allocateRepairMatrix(numFailedChunks * inputChunkIds.size())) {
+        LOG(ERROR) << "Failed to allocate space for repair matrix";
+        plan.release();
+        return false;
+    }
+
+    // rows for repairing the failed chunks from the selected input chunks
+    if (!genDecodeMatrix(inputChunkIds, failedChunkIdx, plan.getRepairMatrix())) {
+        plan.release();
+        return false;
+    }
+
+    return true;
+}
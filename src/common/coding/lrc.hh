@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __LRC_CODE_HH__
+#define __LRC_CODE_HH__
+
+#include <stdint.h> // uint8_t
+#include "coding.hh"
+
+#define LRC_MAX_NUM_LOCAL_GROUPS  ( 2 )
+
+/**
+ * Locally repairable codes (Azure-style), with l local groups and g global parities
+ *
+ * The k data chunks are split into l local groups of (almost) equal sizes,
+ * each protected by a local parity, which is the XOR of the data chunks in
+ * the group. The g = n - k - l global parities are Cauchy-coded from all data
+ * chunks. Chunks are ordered as data chunks, local parities, then global
+ * parities.
+ *
+ * A single failure of a data chunk or a local parity is repaired using only the
+ * other chunks in its local group, instead of k chunks as in RS codes. The
+ * number of local groups l is LRC_MAX_NUM_LOCAL_GROUPS, but is reduced to keep
+ * at least one global parity (and at most one group per data chunk), so the
+ * codes degenerate to RS-like codes when n - k is small.
+ **/
+class LRCCode : public Coding {
+public:
+
+    LRCCode(CodingOptions options);
+    ~LRCCode() {}
+
+    /**
+     * see Coding::getNumDataChunks()
+     **/
+    num_t getNumDataChunks();
+
+    /**
+     * see Coding::getNumCodeChunks()
+     **/
+    num_t getNumCodeChunks();
+
+    /**
+     * see Coding::getNumChunks()
+     **/
+    num_t getNumChunks();
+
+    /**
+     * see Coding::getNumChunksPerNode()
+     **/
+    num_t getNumChunksPerNode();
+
+    /**
+     * see Coding::getCodingStateSize()
+     **/
+    length_t getCodingStateSize();
+
+    /**
+     * see Coding::encode()
+     *
+     * @remark coding state is ignored for LRC
+     **/
+    bool encode(data_t *data, length_t dataSize, std::vector<Chunk> &stripe, data_t **codingState, bool inPlace = false);
+
+    /**
+     * see Coding::decode()
+     *
+     * @remark coding state is ignored for LRC
+     **/
+    bool decode(std::vector<Chunk> &inputChunks, data_t **decodedData, length_t &decodedSize, DecodingPlan &plan, data_t *codingState, bool isRepair = false, std::vector<chunk_id_t> repairTargets = std::vector<chunk_id_t>());
+
+    /**
+     * see Coding::preDecode()
+     *
+     * @remark coding state is ignored for LRC
+     * @remark for repair, the plan reads only the local groups when each failed chunk is a data chunk or local parity in a distinct local group
+     **/
+    bool preDecode(const std::vector<chunk_id_t> &failedChunkIdx, DecodingPlan &plan, data_t *codingState, bool isRepair = false);
+
+    /**
+     * see Coding::getChunkSize()
+     **/
+    length_t getChunkSize(length_t dataSize);
+
+    /**
+     * Tell the number of local groups
+     *
+     * @return number of local groups
+     **/
+    num_t getNumLocalGroups();
+
+    /**
+     * Tell the local group of a chunk
+     *
+     * @param[in] chunkId       id of the chunk
+     *
+     * @return the local group of a data chunk or a local parity, -1 for a global parity
+     **/
+    int getLocalGroup(chunk_id_t chunkId);
+
+private:
+
+    /**
+     * Find the chunks in the local group of a chunk, other than the chunk itself
+     *
+     * @param[in] chunkId       id of the chunk (a data chunk or a local parity)
+     * @param[out] members      ids of the other chunks in the local group
+     **/
+    void getLocalGroupPeers(chunk_id_t chunkId, std::vector<chunk_id_t> &members);
+
+    /**
+     * Select k linearly independent chunks from the candidates, in the order of the candidates
+     *
+     * @param[in] candidates    ids of candidate chunks
+     * @param[out] selected     ids of the selected chunks
+     *
+     * @return whether k independent chunks are found
+     **/
+    bool selectIndependentChunks(const std::vector<chunk_id_t> &candidates, std::vector<chunk_id_t> &selected);
+
+    /**
+     * Find the coefficients to compute chunks from the input chunks
+     *
+     * @param[in] inputChunkIds ids of input chunks
+     * @param[in] targets       ids of chunks to compute
+     * @param[out] matrix       coefficient matrix of size targets.size() * inputChunkIds.size(), row i for computing targets[i]
+     *
+     * @return whether all targets can be computed from the input chunks
+     **/
+    bool genDecodeMatrix(const std::vector<chunk_id_t> &inputChunkIds, const std::vector<chunk_id_t> &targets, uint8_t *matrix);
+
+    num_t _numLocalGroups;                                  /**< number of local groups */
+    uint8_t _encodeMatrix[CODING_MAX_N * CODING_MAX_N];     /**< generator matrix (systematic) */
+    uint8_t _gftbl[CODING_MAX_N * CODING_MAX_N * 32];       /**< expanded GF tables of the parity rows in the generator matrix */
+
+};
+
+#endif // define __LRC_CODE_HH__
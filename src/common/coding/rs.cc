@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "rs.hh"
+#include "coding_table_cache.hh"
 
 extern "C" {
 #include <isa-l/erasure_code.h>
@@ -54,7 +55,7 @@ length_t RSCode::getChunkSize(length_t dataSize) {
     return (dataSize + k - 1) / k;
 }
 
-bool RSCode::encode(data_t *data, length_t dataSize, std::vector<Chunk> &stripe, data_t **codingState) {
+bool RSCode::encode(data_t *data, length_t dataSize, std::vector<Chunk> &stripe, data_t **codingState, bool inPlace) {
     coding_param_t k = _options.getK(), n = _options.getN();
 
     unsigned char *codep[n - k], *datap[k];
@@ -68,16 +69,27 @@ bool RSCode::encode(data_t *data, length_t dataSize, std::vector<Chunk> &stripe,
     // set the pointers for data and code chunks
     for (coding_param_t i = 0; i < n; i++) {
         stripe.at(i).setChunkId(i); 
+        // reference the data directly for data chunks fully within the buffered data
+        if (inPlace && i < k && (unsigned long int) (i + 1) * chunkSize <= dataSize) {
+            stripe.at(i).data = data + i * chunkSize;
+            stripe.at(i).size = chunkSize;
+            stripe.at(i).freeData = false;
+            datap[i] = stripe.at(i).data;
+            continue;
+        }
         // try allocate space for chunks and revert previous ones if fails
-        if (!stripe.at(i).allocateData(chunkSize, /* aligned */ true)) {
+        if (!stripe.at(i).allocateData(chunkSize)) {
             LOG(ERROR) << "Failed to allocate memory for chunk " << i << " in stripe with " << n << " chunks of size " << chunkSize;
             stripe.clear();
             return false;
         }
         if (i < k) {
-            // copy data to chunk output and set the buffer pointers for encoding
+            // copy data to chunk output (padded with zeros beyond the buffered data) and set the buffer pointers for encoding
             unsigned char *datacp = stripe.at(i).data;
-            memcpy(datacp, data + i * chunkSize, chunkSize);
+            unsigned long int offset = (unsigned long int) i * chunkSize;
+            length_t copySize = offset >= dataSize? 0 : std::min(chunkSize, (length_t) (dataSize - offset));
+            memcpy(datacp, data + offset, copySize);
+            memset(datacp + copySize, 0, chunkSize - copySize);
             datap[i] = datacp;
         } else {
             // set the buffer pointers for encoding
@@ -125,6 +137,12 @@ bool RSCode::decode(std::vector<Chunk> &inputChunks, data_t **decodedData, lengt
     bool allDataInput = true;
     bool repairTargetSpecified = !repairTargets.empty();
 
+    // key of the decoding tables, i.e., the coding parameters, the input chunks for decoding, and the chunks to repair
+    std::string tableKey = _name;
+    tableKey.append(1, isRepair? 'R' : 'D');
+    CodingTableCache::appendKey(tableKey, n);
+    CodingTableCache::appendKey(tableKey, k);
+
     DLOG_IF(INFO, isRepair && !repairTargetSpecified) << "Repair all missing chunks by default";
     DLOG_IF(INFO, isRepair && repairTargetSpecified) << "Repair specific chunks";
 
@@ -148,6 +166,8 @@ bool RSCode::decode(std::vector<Chunk> &inputChunks, data_t **decodedData, lengt
             allDataInput &= inputIdx == i;
             // prepare matrix for inversion and decoding
             memcpy(decodeMatrix + inputIdx * k, _encodeMatrix + chunkId * k, k);
+            if (inputIdx < k)
+                CodingTableCache::appendKey(tableKey, chunkId);
             // increment the input index
             inputIdx++;
         } else if (isRepair && !repairTargetSpecified) { // failed chunk that should be the repair targets
@@ -192,41 +212,53 @@ bool RSCode::decode(std::vector<Chunk> &inputChunks, data_t **decodedData, lengt
     }
 
     // normal decoding flow (invert the encoding matrix of input chunks and apply it for decoding)
-    // get the inverse of the encoding matrix
-    if (gf_invert_matrix(decodeMatrix, invertedMatrix, k) < 0) {
-        LOG(ERROR) << "Failed to invert the matrix for decoding";
-        // if unsuccessful, free locally allocated buffer
-        if (*decodedData != decodedDataTmp) free(decodedDataTmp);
-        return false;
+    // reuse the decoding tables of the same failure pattern if cached
+    uint8_t gftbl [matrixSize * 32];
+    size_t gftblSize = k * numDecodedChunks * 32;
+    if (isRepair) {
+        for (num_t i = 0; i < numDecodedChunks; i++)
+            CodingTableCache::appendKey(tableKey, repairTargets.at(i));
     }
+    CodingTableCache &tableCache = CodingTableCache::getInstance();
+
+    if (!tableCache.get(tableKey, gftbl, gftblSize)) {
+        // get the inverse of the encoding matrix
+        if (gf_invert_matrix(decodeMatrix, invertedMatrix, k) < 0) {
+            LOG(ERROR) << "Failed to invert the matrix for decoding";
+            // if unsuccessful, free locally allocated buffer
+            if (*decodedData != decodedDataTmp) free(decodedDataTmp);
+            return false;
+        }
 
-    // final matrix to apply for decoding, which is the inverted one by default
-    finalMatrix = invertedMatrix;
+        // final matrix to apply for decoding, which is the inverted one by default
+        finalMatrix = invertedMatrix;
 
-    // generate a new matrix for repair 
-    if (isRepair) {
-        // copy the rows for decoding
-        num_t i = 0, j = 0, l = 0;
-        uint8_t s;
-        for (i = 0; i < numDecodedChunks && repairTargets.at(i) < k; i++) {
-            memcpy(decodeMatrix + k * i, invertedMatrix + k * repairTargets.at(i), k);
-        }
-        // code chunks
-        for (; i < numDecodedChunks; i++) {
-            for (j = 0; j < k; j++) {
-                s = 0;
-                for (l = 0; l < k; l++)
-                    s ^= gf_mul(invertedMatrix[l * k + j], _encodeMatrix[repairTargets.at(i) * k + l]);
-                decodeMatrix[i * k + j] = s;
+        // generate a new matrix for repair 
+        if (isRepair) {
+            // copy the rows for decoding
+            num_t i = 0, j = 0, l = 0;
+            uint8_t s;
+            for (i = 0; i < numDecodedChunks && repairTargets.at(i) < k; i++) {
+                memcpy(decodeMatrix + k * i, invertedMatrix + k * repairTargets.at(i), k);
             }
+            // code chunks
+            for (; i < numDecodedChunks; i++) {
+                for (j = 0; j < k; j++) {
+                    s = 0;
+                    for (l = 0; l < k; l++)
+                        s ^= gf_mul(invertedMatrix[l * k + j], _encodeMatrix[repairTargets.at(i) * k + l]);
+                    decodeMatrix[i * k + j] = s;
+                }
+            }
+            // use the generated matrix for decoding instead
+            finalMatrix = decodeMatrix;
         }
-        // use the generated matrix for decoding instead
-        finalMatrix = decodeMatrix;
+
+        ec_init_tables(k, numDecodedChunks, finalMatrix, gftbl);
+        tableCache.put(tableKey, gftbl, gftblSize);
     }
 
     // decode
-    uint8_t gftbl [matrixSize * 32];
-    ec_init_tables(k, numDecodedChunks, finalMatrix, gftbl);
     ec_encode_data(chunkSize, k, numDecodedChunks, gftbl, inputp, decodep);
 
     // set decode output
@@ -276,6 +308,26 @@ bool RSCode::preDecode(const std::vector<chunk_id_t> &failedChunkIdx, DecodingPl
         return true;
     }
 
+    // allocate space for outputting repair matrix
+    if (!plan.allocateRepairMatrix(e * k)) {
+        LOG(ERROR) << "Failed to allocate space for repair matrix";
+        plan.release();
+        return false;
+    }
+    data_t *repairMatrix = plan.getRepairMatrix();
+
+    // reuse the repair matrix of the same failure pattern if cached
+    std::string tableKey = _name;
+    tableKey.append(1, 'P');
+    CodingTableCache::appendKey(tableKey, n);
+    CodingTableCache::appendKey(tableKey, k);
+    for (i = 0; i < e; i++)
+        CodingTableCache::appendKey(tableKey, erasures[i]);
+    CodingTableCache &tableCache = CodingTableCache::getInstance();
+    if (tableCache.get(tableKey, repairMatrix, e * k)) {
+        return true;
+    }
+
     // find the invert matrix for decoding first
     int matrixSize = n * n;
     uint8_t decodeMatrix [matrixSize];
@@ -293,15 +345,7 @@ bool RSCode::preDecode(const std::vector<chunk_id_t> &failedChunkIdx, DecodingPl
         return false;
     }
 
-    // allocate space for outputting repair matrix
-    if (!plan.allocateRepairMatrix(e * k)) {
-        LOG(ERROR) << "Failed to allocate space for repair matrix";
-        plan.release();
-        return false;
-    }
-
     // copy the rows for decoding failed strips into extraInfo
-    data_t *repairMatrix = plan.getRepairMatrix();
     int j = 0, l = 0;
     uint8_t s = 0;
     // data chunks
@@ -318,5 +362,7 @@ bool RSCode::preDecode(const std::vector<chunk_id_t> &failedChunkIdx, DecodingPl
         }
     }
 
+    tableCache.put(tableKey, repairMatrix, e * k);
+
     return true;
 }
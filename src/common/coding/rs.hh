@@ -42,7 +42,7 @@ public:
      * 
      * @remark coding state is ignored for RS
      **/
-    bool encode(data_t *data, length_t dataSize, std::vector<Chunk> &stripe, data_t **codingState);
+    bool encode(data_t *data, length_t dataSize, std::vector<Chunk> &stripe, data_t **codingState, bool inPlace = false);
 
     /**
      * see Coding::decode()
@@ -64,7 +64,7 @@ public:
     length_t getChunkSize(length_t dataSize);
 
 
-private:
+protected:
 
     /**
      * Final decoding step for repair using CAR (xor all chunks)
@@ -78,8 +78,8 @@ private:
      **/
     bool carRepairFinalize(unsigned char *inputp[], num_t numInputChunks, length_t chunkSize, unsigned char *decodep[]);
 
-    uint8_t _encodeMatrix[CODING_MAX_N * CODING_MAX_N];
-    uint8_t _gftbl[CODING_MAX_N * CODING_MAX_N * 32];
+    uint8_t _encodeMatrix[CODING_MAX_N * CODING_MAX_N];     /**< generator matrix (systematic) */
+    uint8_t _gftbl[CODING_MAX_N * CODING_MAX_N * 32];       /**< expanded GF tables of the code rows in the generator matrix */
 
 };
 
@@ -18,6 +18,7 @@ const char *Config::ContainerTypeName[] = {
     "Alibaba",
     "AWS",
     "Azure",
+    "Segment",
 
     "Unknown"
 };
@@ -54,6 +55,15 @@ const char *Config::ChunkScanSamplingPolicyName[] = {
 // see MetaStore in common/define.hh
 const char *Config::MetaStoreName[] = {
     "Redis",
+    "Local",
+
+    "Unknown"
+};
+
+// see FsIoEngine in common/define.hh
+const char *Config::FsIoEngineName[] = {
+    "Buffered",
+    "Direct",
 
     "Unknown"
 };
@@ -133,6 +143,11 @@ void Config::setConfigPath (const char *generalPath, const char *proxyPath, cons
         // benchmark
         _general.benchmark.stripeEnabled = readBool(_generalPt, "benchmark.stripe_enabled");
 
+        // chunk buffer
+        _general.chunkBuffer.poolSize = readIntWithBoundsAndDefault(_generalPt, "chunk_buffer.pool_size", DEFAULT_CHUNK_BUFFER_POOL_SIZE, 0, 1 << 16);
+        _general.chunkBuffer.threadCacheSize = readIntWithBoundsAndDefault(_generalPt, "chunk_buffer.thread_cache_size", DEFAULT_CHUNK_BUFFER_THREAD_CACHE_SIZE, 0, 1 << 16);
+        _general.chunkBuffer.totalThreadCacheSize = readIntWithBoundsAndDefault(_generalPt, "chunk_buffer.total_thread_cache_size", DEFAULT_CHUNK_BUFFER_TOTAL_THREAD_CACHE_SIZE, 0, 1 << 16);
+
         // proxy hosts
         _proxy.numProxy = readInt(_generalPt, "proxy.num_proxy");
         if (_proxy.numProxy < 1 || _proxy.numProxy > MAX_NUM_PROXY) {
@@ -177,6 +192,21 @@ void Config::setConfigPath (const char *generalPath, const char *proxyPath, cons
             _agent.misc.numZmqThread = 1;
         _agent.misc.copyBlockSize = readULL(_agentPt, "misc.copy_block_size");
         _agent.misc.flushOnClose = readBool(_agentPt, "misc.flush_on_close");
+        _agent.misc.readBackOnWrite = readBoolWithDefault(_agentPt, "misc.read_back_on_write", false);
+        try {
+            _agent.misc.fsIoEngine = parseFsIoEngine(readString(_agentPt, "misc.fs_io_engine"));
+        } catch (std::exception &e) {
+            _agent.misc.fsIoEngine = FsIoEngine::BUFFERED_FS_IO;
+        }
+        if (_agent.misc.fsIoEngine == FsIoEngine::UNKNOWN_FS_IO) {
+            LOG(WARNING) << "Unknown I/O engine for file system containers, fall back to " << FsIoEngineName[FsIoEngine::BUFFERED_FS_IO];
+            _agent.misc.fsIoEngine = FsIoEngine::BUFFERED_FS_IO;
+        }
+        _agent.misc.fsIoDepth = readIntWithBoundsAndDefault(_agentPt, "misc.fs_io_depth", DEFAULT_FS_IO_DEPTH, 1, 64);
+        _agent.misc.fsSyncBatching = readBoolWithDefault(_agentPt, "misc.fs_sync_batching", false);
+        _agent.misc.fsDirLevels = readIntWithBoundsAndDefault(_agentPt, "misc.fs_dir_levels", DEFAULT_FS_DIR_LEVELS, 0, 3);
+        _agent.misc.segmentSize = readIntWithBoundsAndDefault(_agentPt, "misc.segment_size", DEFAULT_SEGMENT_SIZE, 1, 4095);
+        _agent.misc.segmentCompactionThreshold = readIntWithBoundsAndDefault(_agentPt, "misc.segment_compaction_threshold", DEFAULT_SEGMENT_COMPACTION_THRESHOLD, 1, 100);
         _agent.misc.registerToProxy = readBool(_agentPt, "misc.register_to_proxy");
         // agent containers
         _agent.numContainers = readInt(_agentPt, "agent.num_containers");
@@ -279,10 +309,24 @@ void Config::setConfigPath (const char *generalPath, const char *proxyPath, cons
                 LOG(ERROR) << "Port number for metastore must be within 0 and 65536";
                 exit(-1);
             }
+            _proxy.metastore.redis.numConnections = readIntWithBoundsAndDefault(_proxyPt, "metastore.num_connections", DEFAULT_NUM_METASTORE_CONNECTIONS, 1, MAX_NUM_WORKERS);
+            _proxy.metastore.redis.packedFileMeta = readBoolWithDefault(_proxyPt, "metastore.packed_file_meta", true);
+            break;
+        case MetaStoreType::LOCAL:
+            _proxy.metastore.local.path = readString(_proxyPt, "metastore.path");
+            _proxy.metastore.local.syncWrites = readBoolWithDefault(_proxyPt, "metastore.sync_writes", true);
             break;
         default:
             break;
         }
+        _proxy.metastore.fileLockLease = readIntWithBoundsAndDefault(_proxyPt, "metastore.file_lock_lease", DEFAULT_FILE_LOCK_LEASE, 1000, 3600 * 1000);
+        _proxy.metastore.fileLockWait = readIntWithBoundsAndDefault(_proxyPt, "metastore.file_lock_wait", 0, 0, 3600 * 1000);
+        _proxy.metastore.fileMetaCacheSize = readIntWithBoundsAndDefault(_proxyPt, "metastore.file_meta_cache_size", DEFAULT_FILE_META_CACHE_SIZE, 0, 1 << 16);
+        try {
+            _proxy.metastore.statsFile = readString(_proxyPt, "metastore.stats_file");
+        } catch (std::exception &e) {
+            _proxy.metastore.statsFile = "";
+        }
         // auto recovery
         _proxy.recovery.enabled = readBool(_proxyPt, "recovery.trigger_enabled");
         _proxy.recovery.recoverIntv = std::max(readInt(_proxyPt, "recovery.trigger_start_interval"), 5);
@@ -302,6 +346,11 @@ void Config::setConfigPath (const char *generalPath, const char *proxyPath, cons
         _proxy.misc.numZmqThread = readInt(_proxyPt, "misc.zmq_thread");
         if (_proxy.misc.numZmqThread < 1)
             _proxy.misc.numZmqThread = 1;
+        _proxy.misc.numIOWorkers = readIntWithBoundsAndDefault(_proxyPt, "misc.num_io_workers", DEFAULT_NUM_PROXY_IO_WORKERS, 1, MAX_NUM_WORKERS);
+        _proxy.misc.asyncDataTransport = readBoolWithDefault(_proxyPt, "misc.async_data_transport", false);
+        _proxy.misc.numReadAheadStripes = readIntWithBoundsAndDefault(_proxyPt, "misc.read_ahead_stripes", DEFAULT_NUM_PROXY_READ_AHEAD_STRIPES, 1, MAX_NUM_WORKERS);
+        _proxy.misc.numDecodeWorkers = readIntWithBoundsAndDefault(_proxyPt, "misc.num_decode_workers", DEFAULT_NUM_PROXY_DECODE_WORKERS, 1, MAX_NUM_WORKERS);
+        _proxy.misc.numEncodeWorkers = readIntWithBoundsAndDefault(_proxyPt, "misc.num_encode_workers", DEFAULT_NUM_PROXY_ENCODE_WORKERS, 1, MAX_NUM_WORKERS);
         _proxy.misc.repairAtProxy = readBool(_proxyPt, "misc.repair_at_proxy");
         _proxy.misc.repairUsingCAR = readBool(_proxyPt, "misc.repair_using_car");
         _proxy.misc.overwriteFiles = readBool(_proxyPt, "misc.overwrite_files");
@@ -455,6 +504,21 @@ bool Config::getBenchmarkStripeEnabled() const{
     return _general.benchmark.stripeEnabled;
 }
 
+int Config::getChunkBufferPoolSize() const {
+    assert(!_generalPt.empty());
+    return _general.chunkBuffer.poolSize;
+}
+
+int Config::getChunkBufferThreadCacheSize() const {
+    assert(!_generalPt.empty());
+    return _general.chunkBuffer.threadCacheSize;
+}
+
+int Config::getChunkBufferTotalThreadCacheSize() const {
+    assert(!_generalPt.empty());
+    return _general.chunkBuffer.totalThreadCacheSize;
+}
+
 
 // Agent
 std::string Config::getAgentIP() const {
@@ -560,6 +624,41 @@ bool Config::getAgentFlushOnClose() const {
     return _agent.misc.flushOnClose;
 }
 
+bool Config::getAgentReadBackOnWrite() const {
+    assert(!_agentPt.empty());
+    return _agent.misc.readBackOnWrite;
+}
+
+int Config::getAgentFsIoEngine() const {
+    assert(!_agentPt.empty());
+    return _agent.misc.fsIoEngine;
+}
+
+int Config::getAgentFsIoDepth() const {
+    assert(!_agentPt.empty());
+    return _agent.misc.fsIoDepth;
+}
+
+bool Config::getAgentFsSyncBatching() const {
+    assert(!_agentPt.empty());
+    return _agent.misc.fsSyncBatching;
+}
+
+int Config::getAgentFsDirLevels() const {
+    assert(!_agentPt.empty());
+    return _agent.misc.fsDirLevels;
+}
+
+int Config::getAgentSegmentSize() const {
+    assert(!_agentPt.empty());
+    return _agent.misc.segmentSize;
+}
+
+int Config::getAgentSegmentCompactionThreshold() const {
+    assert(!_agentPt.empty());
+    return _agent.misc.segmentCompactionThreshold;
+}
+
 bool Config::getAgentRegisterToProxy() const {
     assert(!_agentPt.empty());
     return _agent.misc.registerToProxy;
@@ -652,8 +751,8 @@ int Config::getStorageClassConfig(std::string storageClass, std::string config,
 }
 
 int Config::readIntWithBounds(const boost::property_tree::ptree &pt, const char *key, int min, int max) const {
-    assert(!_storageClassPt.empty());
-    int value = readInt(_storageClassPt, key);
+    assert(!pt.empty());
+    int value = readInt(pt, key);
     return value <= min ? min : (value > max? max : value);
 }
 
@@ -666,6 +765,15 @@ int Config::readIntWithBoundsAndDefault(const boost::property_tree::ptree &pt, c
     return value;
 }
 
+bool Config::readBoolWithDefault(const boost::property_tree::ptree &pt, const char *key, bool dv) const {
+    bool value = dv;
+    try {
+        value = readBool(pt, key);
+    } catch (std::exception &e) {
+    }
+    return value;
+}
+
 int Config::getProxyMetaStoreType() const {
     assert(!_proxyPt.empty());
     return _proxy.metastore.type;
@@ -681,11 +789,76 @@ unsigned short Config::getProxyMetaStorePort() const {
     return _proxy.metastore.redis.port;
 }
 
+int Config::getProxyMetaStoreNumConnections() const {
+    assert(!_proxyPt.empty());
+    return _proxy.metastore.redis.numConnections;
+}
+
+bool Config::usePackedFileMeta() const {
+    assert(!_proxyPt.empty());
+    return _proxy.metastore.redis.packedFileMeta;
+}
+
+std::string Config::getProxyMetaStorePath() const {
+    assert(!_proxyPt.empty());
+    return _proxy.metastore.local.path;
+}
+
+bool Config::syncMetaStoreWrites() const {
+    assert(!_proxyPt.empty());
+    return _proxy.metastore.local.syncWrites;
+}
+
+int Config::getProxyFileLockLease() const {
+    assert(!_proxyPt.empty());
+    return _proxy.metastore.fileLockLease;
+}
+
+int Config::getProxyFileLockWait() const {
+    assert(!_proxyPt.empty());
+    return _proxy.metastore.fileLockWait;
+}
+
+int Config::getProxyFileMetaCacheSize() const {
+    assert(!_proxyPt.empty());
+    return _proxy.metastore.fileMetaCacheSize;
+}
+
+std::string Config::getProxyMetaStoreStatsFile() const {
+    assert(!_proxyPt.empty());
+    return _proxy.metastore.statsFile;
+}
+
 int Config::getProxyNumZmqThread() const {
     assert(!_proxyPt.empty());
     return _proxy.misc.numZmqThread;
 }
 
+int Config::getProxyNumIOWorkers() const {
+    assert(!_proxyPt.empty());
+    return _proxy.misc.numIOWorkers;
+}
+
+bool Config::useAsyncDataTransport() const {
+    assert(!_proxyPt.empty());
+    return _proxy.misc.asyncDataTransport;
+}
+
+int Config::getProxyNumReadAheadStripes() const {
+    assert(!_proxyPt.empty());
+    return _proxy.misc.numReadAheadStripes;
+}
+
+int Config::getProxyNumDecodeWorkers() const {
+    assert(!_proxyPt.empty());
+    return _proxy.misc.numDecodeWorkers;
+}
+
+int Config::getProxyNumEncodeWorkers() const {
+    assert(!_proxyPt.empty());
+    return _proxy.misc.numEncodeWorkers;
+}
+
 bool Config::isRepairAtProxy() const {
     assert(!_proxyPt.empty());
     return _proxy.misc.repairAtProxy;
@@ -919,6 +1092,10 @@ void Config::printConfig() const {
         " Num of proxy                : %d\n"
         " - Benchmark\n"
         "   - Stripe level enabled    : %s\n"
+        " - Chunk Buffer\n"
+        "   - Pool size               : %dMiB\n"
+        "   - Thread cache size       : %dMiB\n"
+        "   - Total thread cache size : %dMiB\n"
         , LogLevelName[getLogLevel()]
         , glogToConsole()? "true" : "false" 
         , getGlogDir().c_str()
@@ -935,6 +1112,9 @@ void Config::printConfig() const {
         , getEventProbeTimeout()
         , getNumProxy()
         , getBenchmarkStripeEnabled() ? "true" : "false"
+        , getChunkBufferPoolSize()
+        , getChunkBufferThreadCacheSize()
+        , getChunkBufferTotalThreadCacheSize()
     );
     LOG(ERROR) << buf;
     
@@ -959,11 +1139,33 @@ void Config::printConfig() const {
             length += snprintf(buf + length, bufSize - length,
                 "   - IP                      : %s\n"
                 "   - Port                    : %d\n"
+                "   - Num. of connections     : %d\n"
+                "   - Packed file metadata    : %s\n"
                 , getProxyMetaStoreIP().c_str()
                 , getProxyMetaStorePort()
+                , getProxyMetaStoreNumConnections()
+                , usePackedFileMeta()? "true" : "false"
+            );
+            break;
+        case MetaStoreType::LOCAL:
+            length += snprintf(buf + length, bufSize - length,
+                "   - Path                    : %s\n"
+                "   - Sync writes             : %s\n"
+                , getProxyMetaStorePath().c_str()
+                , syncMetaStoreWrites()? "true" : "false"
             );
             break;
         }
+        length += snprintf(buf + length, bufSize - length,
+            "   - File lock lease         : %dms\n"
+            "   - File lock wait          : %dms\n"
+            "   - File metadata cache     : %dMiB\n"
+            "   - Latency stats file      : %s\n"
+            , getProxyFileLockLease()
+            , getProxyFileLockWait()
+            , getProxyFileMetaCacheSize()
+            , getProxyMetaStoreStatsFile().empty()? "(disabled)" : getProxyMetaStoreStatsFile().c_str()
+        );
         int numClasses = getNumStorageClasses();
         length += snprintf(buf + length, bufSize - length,
             " - Storage classes (%d)\n"
@@ -1016,6 +1218,11 @@ void Config::printConfig() const {
         length += snprintf(buf + length, bufSize - length,
             " - Misc\n"
             "   - Num zmq threads         : %d\n"
+            "   - Num I/O workers         : %d\n"
+            "   - Async data transport    : %s\n"
+            "   - Read-ahead stripes      : %d\n"
+            "   - Num decode workers      : %d\n"
+            "   - Num encode workers      : %d\n"
             "   - Repair at Proxy         : %s\n"
             "   - Repair using CAR (RS)   : %s\n"
             "   - Overwrite files         : %s\n"
@@ -1023,6 +1230,11 @@ void Config::printConfig() const {
             "   - Liveness Cache Time     : %ds\n"
             "   - Journal check interval  : %ds\n"
             , getProxyNumZmqThread()
+            , getProxyNumIOWorkers()
+            , useAsyncDataTransport()? "true" : "false"
+            , getProxyNumReadAheadStripes()
+            , getProxyNumDecodeWorkers()
+            , getProxyNumEncodeWorkers()
             , isRepairAtProxy()? "true" : "false"
             , isRepairUsingCAR()? "true" : "false"
             , overwriteFiles()? "true" : "false"
@@ -1119,6 +1331,13 @@ void Config::printConfig() const {
             " Num of containers           : %d\n"
             " Num zmq threads             : %d\n"
             " Copy block size             : %luB\n"
+            " Read back on write          : %s\n"
+            " FS I/O engine               : %s\n"
+            " FS I/O depth                : %d\n"
+            " FS sync batching            : %s\n"
+            " FS directory levels         : %d\n"
+            " Segment size                : %dMiB\n"
+            " Segment compaction threshold: %d%%\n"
             , getAgentIP().c_str()
             , getAgentPort()
             , getAgentCPort()
@@ -1126,6 +1345,13 @@ void Config::printConfig() const {
             , getNumContainers()
             , getAgentNumZmqThread()
             , getCopyBlockSize()
+            , getAgentReadBackOnWrite()? "true" : "false"
+            , FsIoEngineName[getAgentFsIoEngine()]
+            , getAgentFsIoDepth()
+            , getAgentFsSyncBatching()? "true" : "false"
+            , getAgentFsDirLevels()
+            , getAgentSegmentSize()
+            , getAgentSegmentCompactionThreshold()
         );
         for (int i = 0; i < getNumContainers(); i++) {
             int type = getContainerType(i);
@@ -1234,3 +1460,11 @@ int Config::parseMetaStoreType(std::string storeName) const {
     return MetaStoreType::UNKNOWN_METASTORE;
 }
 
+int Config::parseFsIoEngine(std::string engineName) const {
+    for (int i = 0; i < FsIoEngine::UNKNOWN_FS_IO; i++) {
+        if (boost::algorithm::to_lower_copy(std::string(FsIoEngineName[i])) == boost::algorithm::to_lower_copy(engineName))
+            return i;
+    }
+    return FsIoEngine::UNKNOWN_FS_IO;
+}
+
@@ -47,6 +47,10 @@ public:
     bool verifyChunkChecksum() const;
     // general.benchmark
     bool getBenchmarkStripeEnabled() const;
+    // general.chunkBuffer
+    int getChunkBufferPoolSize() const;
+    int getChunkBufferThreadCacheSize() const;
+    int getChunkBufferTotalThreadCacheSize() const;
 
     // agent
     std::string getAgentIP() const;
@@ -67,6 +71,13 @@ public:
     int getAgentNumZmqThread() const;
     unsigned long int getCopyBlockSize() const;
     bool getAgentFlushOnClose() const;
+    bool getAgentReadBackOnWrite() const;
+    int getAgentFsIoEngine() const;
+    int getAgentFsIoDepth() const;
+    bool getAgentFsSyncBatching() const;
+    int getAgentFsDirLevels() const;
+    int getAgentSegmentSize() const;
+    int getAgentSegmentCompactionThreshold() const;
     bool getAgentRegisterToProxy() const;
 
     // proxy
@@ -91,8 +102,21 @@ public:
     int getProxyMetaStoreType() const;
     std::string getProxyMetaStoreIP() const;
     unsigned short getProxyMetaStorePort() const;
+    int getProxyMetaStoreNumConnections() const;
+    bool usePackedFileMeta() const;
+    std::string getProxyMetaStorePath() const;
+    bool syncMetaStoreWrites() const;
+    int getProxyFileLockLease() const;
+    int getProxyFileLockWait() const;
+    int getProxyFileMetaCacheSize() const;
+    std::string getProxyMetaStoreStatsFile() const;
     // proxy.misc
     int getProxyNumZmqThread() const;
+    int getProxyNumIOWorkers() const;
+    bool useAsyncDataTransport() const;
+    int getProxyNumReadAheadStripes() const;
+    int getProxyNumDecodeWorkers() const;
+    int getProxyNumEncodeWorkers() const;
     bool isRepairAtProxy() const;
     bool isRepairUsingCAR() const;
     bool overwriteFiles() const;
@@ -157,6 +181,7 @@ private:
 
     int readIntWithBounds (const boost::property_tree::ptree &pt, const char *key, int min = 0, int max = INT32_MAX) const;
     int readIntWithBoundsAndDefault (const boost::property_tree::ptree &pt, const char *key, int dv = 0, int min = 0, int max = INT32_MAX) const;
+    bool readBoolWithDefault (const boost::property_tree::ptree &pt, const char *key, bool dv = false) const;
 
     unsigned short parseContainerType(std::string typeName) const;
     int parseLogLevel(std::string levelName) const;
@@ -164,6 +189,7 @@ private:
     int parseCodingScheme(std::string schemeName) const;
     int parseChunkScanSamplingPolicy(std::string policyName) const;
     int parseMetaStoreType(std::string storeName) const;
+    int parseFsIoEngine(std::string engineName) const;
 
     int getStorageClassConfig(std::string storageClass, std::string config, int dv = 0, int min = 0, int max = INT32_MAX) const;
 
@@ -172,6 +198,7 @@ private:
     static const char *DistributionPolicyName[];
     static const char *ChunkScanSamplingPolicyName[];
     static const char *MetaStoreName[];
+    static const char *FsIoEngineName[];
 
     boost::property_tree::ptree _agentPt;
     boost::property_tree::ptree _proxyPt;
@@ -227,6 +254,11 @@ private:
         struct {
             bool stripeEnabled;
         } benchmark;
+        struct {
+            int poolSize;
+            int threadCacheSize;
+            int totalThreadCacheSize;
+        } chunkBuffer;
     } _general;
 
     struct {
@@ -240,6 +272,13 @@ private:
             int numZmqThread;
             unsigned long int copyBlockSize;
             bool flushOnClose;
+            bool readBackOnWrite;
+            int fsIoEngine;
+            int fsIoDepth;
+            bool fsSyncBatching;
+            int fsDirLevels;
+            int segmentSize;
+            int segmentCompactionThreshold;
             bool registerToProxy;
         } misc;
     } _agent;
@@ -260,10 +299,25 @@ private:
             struct {
                 std::string ip;
                 unsigned short port;
+                int numConnections;
+                bool packedFileMeta;
             } redis;
+            struct {
+                std::string path;
+                bool syncWrites;
+            } local;
+            int fileLockLease;
+            int fileLockWait;
+            int fileMetaCacheSize;
+            std::string statsFile;
         } metastore;
         struct {
             int numZmqThread;
+            int numIOWorkers;
+            bool asyncDataTransport;
+            int numReadAheadStripes;
+            int numDecodeWorkers;
+            int numEncodeWorkers;
             bool repairAtProxy;
             bool repairUsingCAR;
             bool overwriteFiles;
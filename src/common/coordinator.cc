@@ -6,6 +6,8 @@
 
 #include "coordinator.hh"
 #include "../common/define.hh"
+#include "chunk_buffer_pool.hh"
+#include "coding/coding_table_cache.hh"
 
 #include <glog/logging.h>
 #include <curl/curl.h>
@@ -260,6 +262,10 @@ void Coordinator::updateSysInfo() {
     _sysinfo[nextIdx].mem.free = info.freeram / (1 << 20);
     //DLOG(INFO) << "Memory (free/total) " << _sysinfo[nextIdx].mem.free << "MB /" << _sysinfo[nextIdx].mem.total << "MB";
 
+    // chunk buffer pool and coding table cache (every minute)
+    DLOG_EVERY_N(INFO, 60) << "Chunk buffer pool: " << ChunkBufferPool::getInstance().getStats().toString();
+    DLOG_EVERY_N(INFO, 60) << "Coding table cache: " << CodingTableCache::getInstance().getStats().toString();
+
     // mark this as the latest
     _latestInfoIdx = nextIdx;
 
@@ -4,6 +4,8 @@
 
 const char *CodingSchemeName[] = {
     "RS",
+    "CauchyRS",
+    "LRC",
 
     "Unknown"
 };
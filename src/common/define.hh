@@ -39,13 +39,34 @@ typedef uint32_t                   num_t;
 #define MAX_NUM_PROXY              (int)(100)
 #define MAX_NUM_WORKERS            (int)(256)
 #define MAX_NUM_NEAR_IP_RANGES     (16)
+#define MAX_FILE_LIST_PAGE_SIZE    (unsigned int)(10000)
+
+// defaults
+#define DEFAULT_NUM_PROXY_IO_WORKERS (int)(64)
+#define DEFAULT_NUM_PROXY_READ_AHEAD_STRIPES (int)(4)
+#define DEFAULT_NUM_PROXY_DECODE_WORKERS (int)(8)
+#define DEFAULT_NUM_PROXY_ENCODE_WORKERS (int)(4)
+#define DEFAULT_NUM_METASTORE_CONNECTIONS (int)(16)
+#define DEFAULT_CHUNK_BUFFER_POOL_SIZE (int)(256) // max. total size (in MiB) of idle chunk buffers in the shared pool
+#define DEFAULT_CHUNK_BUFFER_THREAD_CACHE_SIZE (int)(32) // max. total size (in MiB) of idle chunk buffers cached by each thread
+#define DEFAULT_CHUNK_BUFFER_TOTAL_THREAD_CACHE_SIZE (int)(256) // max. total size (in MiB) of idle chunk buffers cached by all threads
+#define DEFAULT_CODING_TABLE_CACHE_SIZE (int)(1024) // max. number of cached coding tables (decoding matrices and GF tables)
+#define DEFAULT_FILE_LOCK_LEASE (int)(30000) // lease of a file lock (in milliseconds), which is renewed while the lock is held
+#define DEFAULT_FILE_META_CACHE_SIZE (int)(64) // size of the in-memory cache of file metadata (in MiB) in front of the metadata store
+#define DEFAULT_FILE_LIST_PAGE_SIZE (unsigned int)(1000) // number of files per page (and per batch of attribute lookups) in file listing
+#define DEFAULT_FS_IO_DEPTH (int)(4) // max. number of in-flight direct I/O requests per chunk in file system containers
+#define DEFAULT_FS_DIR_LEVELS (int)(0) // number of levels of hashed subdirectories for chunk files in file system containers (0 for the flat layout)
+#define DEFAULT_SEGMENT_SIZE (int)(256) // size (in MiB) of segment files in segment containers
+#define DEFAULT_SEGMENT_COMPACTION_THRESHOLD (int)(50) // percentage of garbage in a segment file to compact it in segment containers
 
 #define HOUR_IN_SECONDS            (3600)
 //#define HOUR_IN_SECONDS            (30) // for code testing
 
-// see also CodingSchemeName in common/config.cc
+// see also CodingSchemeName in common/define.cc
 enum CodingScheme {
     RS,
+    CAUCHY_RS,
+    LRC,
     UNKNOWN_CODE
 };
 
@@ -118,6 +139,7 @@ enum ContainerType {
     ALI_CONTAINER,
     AWS_CONTAINER,
     AZURE_CONTAINER,
+    SEGMENT_CONTAINER,
 
     UNKNOWN_CONTAINER,
 };
@@ -163,10 +185,19 @@ enum HostType {
 
 enum MetaStoreType {
     REDIS,
+    LOCAL,
 
     UNKNOWN_METASTORE
 };
 
+// see also FsIoEngineName in common/config.cc
+enum FsIoEngine {
+    BUFFERED_FS_IO,
+    DIRECT_FS_IO,
+
+    UNKNOWN_FS_IO
+};
+
 extern const char *CodingSchemeName[];
 extern const char EmptyStringMD5[];
 
@@ -6,6 +6,7 @@
 #include <glog/logging.h>
 
 #include "io.hh"
+#include "chunk_buffer_pool.hh"
 #include "../common/define.hh"
 #include "../common/util.hh"
 
@@ -210,8 +211,13 @@ unsigned long int IO::getChunkEventMessage(zmq::socket_t &socket, ChunkEvent &ev
         if (hasChunkData(event.opcode)) {
             if (!req.more()) return 0;
             getNextMsg();
-            event.chunks[i].data = (unsigned char*) malloc (event.chunks[i].size);
-            memcpy(event.chunks[i].data, req.data(), event.chunks[i].size);
+            if ((int) req.size() < event.chunks[i].size) {
+                LOG(ERROR) << "Chunk data size (" << req.size() << ") is smaller than the chunk size (" << event.chunks[i].size << ")";
+                return 0;
+            }
+            // keep the data in the message to avoid copying
+            MessageDataHolder *holder = new MessageDataHolder(req);
+            event.chunks[i].setHeldData((unsigned char *) holder->message.data(), event.chunks[i].size, holder);
         } else {
             event.chunks[i].data = 0;
         }
@@ -333,7 +339,7 @@ unsigned long int IO::sendChunkEventMessage(zmq::socket_t &socket, const ChunkEv
         bytes += socket.send(&event.chunks[i].size, sizeof(event.chunks[i].size), (!hasChunkData(event.opcode) && !needsCoding(event.opcode) && i + 1 == actualNumChunks)? 0: ZMQ_SNDMORE);
         // chunk data
         if (hasChunkData(event.opcode)) {
-            bytes += socket.send(event.chunks[i].data, event.chunks[i].size, (!needsCoding(event.opcode) && i + 1 == actualNumChunks)? 0 : ZMQ_SNDMORE);
+            bytes += sendChunkData(socket, event.chunks[i], (!needsCoding(event.opcode) && i + 1 == actualNumChunks)? 0 : ZMQ_SNDMORE);
         }
     }
 
@@ -367,6 +373,24 @@ unsigned long int IO::sendChunkEventMessage(zmq::socket_t &socket, const ChunkEv
     return bytes;
 }
 
+unsigned long int IO::sendChunkData(zmq::socket_t &socket, const Chunk &chunk, int flags) {
+    zmq::message_t msg;
+    MessageDataHolder *message = dynamic_cast<MessageDataHolder *>(chunk.dataHolder);
+    ChunkBuffer *buffer = dynamic_cast<ChunkBuffer *>(chunk.dataHolder);
+    if (message && message->message.data() == chunk.data && message->message.size() == (size_t) chunk.size) {
+        // share the data with the received message
+        msg.copy(&message->message);
+    } else if (buffer && chunk.size > 0) {
+        // reference the pooled buffer until the message is sent
+        buffer->ref();
+        msg.rebuild(chunk.data, chunk.size, ChunkBuffer::releaseFromMessage, buffer);
+    } else {
+        // copy the data otherwise
+        msg.rebuild(chunk.data, chunk.size);
+    }
+    return socket.send(msg, flags)? chunk.size : 0;
+}
+
 std::string IO::genAddr(std::string ip, unsigned port) {
     char portstr[8];
     portstr[0] = ':';
@@ -69,6 +69,28 @@ public:
     } RequestMeta;
 
 private:
+    /**
+     * Holder of chunk data received in a network message, which keeps the message instead of copying the data out
+     **/
+    class MessageDataHolder : public ChunkDataHolder {
+    public:
+        MessageDataHolder(zmq::message_t &msg) { message.copy(&msg); } // shares (but not copies) the data of large messages
+        void release() { delete this; }
+
+        zmq::message_t message;           /**< message containing the chunk data */
+    };
+
+    /**
+     * Send chunk data over a socket, without copying the data if the data buffer is held by a network message or the chunk buffer pool
+     *
+     * @param[in] socket socket to send the data
+     * @param[in] chunk  chunk with data to send
+     * @param[in] flags  flags for sending the message
+     *
+     * @return number of bytes sent
+     **/
+    static unsigned long int sendChunkData(zmq::socket_t &socket, const Chunk &chunk, int flags);
+
     /** *
      * Tell whether the chunk event message should be from proxy
      * 
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <limits.h>
+#include <stdio.h>
+
+#include "latency_histogram.hh"
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::record(unsigned long int us) {
+    // bucket index is the number of significant bits of the latency
+    int bucket = us == 0 ? 0 : 64 - __builtin_clzl(us);
+    if (bucket >= LATENCY_HISTOGRAM_NUM_BUCKETS)
+        bucket = LATENCY_HISTOGRAM_NUM_BUCKETS - 1;
+
+    _buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(us, std::memory_order_relaxed);
+
+    unsigned long int max = _max.load(std::memory_order_relaxed);
+    while (us > max && !_max.compare_exchange_weak(max, us, std::memory_order_relaxed));
+}
+
+unsigned long int LatencyHistogram::getCount() const {
+    return _count.load(std::memory_order_relaxed);
+}
+
+unsigned long int LatencyHistogram::getSum() const {
+    return _sum.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::getAvg() const {
+    unsigned long int count = getCount();
+    return count == 0 ? 0 : _sum.load(std::memory_order_relaxed) * 1.0 / count;
+}
+
+unsigned long int LatencyHistogram::getMax() const {
+    return _max.load(std::memory_order_relaxed);
+}
+
+unsigned long int LatencyHistogram::getPercentile(double p) const {
+    unsigned long int counts[LATENCY_HISTOGRAM_NUM_BUCKETS], total = 0;
+    for (int i = 0; i < LATENCY_HISTOGRAM_NUM_BUCKETS; i++) {
+        counts[i] = getBucketCount(i);
+        total += counts[i];
+    }
+    if (total == 0)
+        return 0;
+
+    // rank of the percentile among the latencies (1-based)
+    unsigned long int rank = (unsigned long int) (total * p / 100.0 + 0.5);
+    if (rank == 0) rank = 1;
+    if (rank > total) rank = total;
+
+    unsigned long int max = getMax();
+    unsigned long int seen = 0;
+    for (int i = 0; i < LATENCY_HISTOGRAM_NUM_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            unsigned long int bound = getBucketUpperBound(i);
+            return bound - 1 < max ? bound - 1 : max;
+        }
+    }
+    return max;
+}
+
+unsigned long int LatencyHistogram::getBucketCount(int bucket) const {
+    if (bucket < 0 || bucket >= LATENCY_HISTOGRAM_NUM_BUCKETS)
+        return 0;
+    return _buckets[bucket].load(std::memory_order_relaxed);
+}
+
+unsigned long int LatencyHistogram::getBucketUpperBound(int bucket) {
+    if (bucket >= LATENCY_HISTOGRAM_NUM_BUCKETS - 1)
+        return ULONG_MAX;
+    return 1ul << bucket;
+}
+
+std::string LatencyHistogram::toString() const {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "count = %lu avg = %.1lfus p50 = %luus p90 = %luus p99 = %luus max = %luus"
+        , getCount()
+        , getAvg()
+        , getPercentile(50)
+        , getPercentile(90)
+        , getPercentile(99)
+        , getMax()
+    );
+    return std::string(buf);
+}
+
+void LatencyHistogram::reset() {
+    for (int i = 0; i < LATENCY_HISTOGRAM_NUM_BUCKETS; i++)
+        _buckets[i].store(0, std::memory_order_relaxed);
+    _count.store(0, std::memory_order_relaxed);
+    _sum.store(0, std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+}
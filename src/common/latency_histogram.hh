@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __LATENCY_HISTOGRAM_HH__
+#define __LATENCY_HISTOGRAM_HH__
+
+#include <atomic>
+#include <string>
+
+#define LATENCY_HISTOGRAM_NUM_BUCKETS (32)   // bucket i holds latencies in [2^(i-1), 2^i) us, and the last bucket holds all longer ones
+
+/**
+ * Histogram of latencies in power-of-two buckets of microseconds
+ *
+ * Recording is lock-free and can be done concurrently by multiple threads.
+ * Percentiles are estimated as the upper bound of the bucket they fall into.
+ **/
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    /**
+     * Record a latency
+     *
+     * @param[in] us        latency in microseconds
+     **/
+    void record(unsigned long int us);
+
+    /**
+     * Get the number of latencies recorded
+     *
+     * @return number of latencies recorded
+     **/
+    unsigned long int getCount() const;
+
+    /**
+     * Get the sum of latencies recorded
+     *
+     * @return sum of latencies in microseconds
+     **/
+    unsigned long int getSum() const;
+
+    /**
+     * Get the average latency
+     *
+     * @return average latency in microseconds, 0 if nothing is recorded
+     **/
+    double getAvg() const;
+
+    /**
+     * Get the max. latency recorded
+     *
+     * @return max. latency in microseconds
+     **/
+    unsigned long int getMax() const;
+
+    /**
+     * Estimate a percentile of the latencies
+     *
+     * @param[in] p         percentile in (0, 100]
+     *
+     * @return upper bound of the bucket with the percentile in microseconds (at most the max. latency recorded), 0 if nothing is recorded
+     **/
+    unsigned long int getPercentile(double p) const;
+
+    /**
+     * Get the number of latencies in a bucket
+     *
+     * @param[in] bucket    bucket index, within [0, LATENCY_HISTOGRAM_NUM_BUCKETS)
+     *
+     * @return number of latencies in the bucket
+     **/
+    unsigned long int getBucketCount(int bucket) const;
+
+    /**
+     * Get the upper bound (exclusive) of a bucket
+     *
+     * @param[in] bucket    bucket index, within [0, LATENCY_HISTOGRAM_NUM_BUCKETS)
+     *
+     * @return upper bound of the bucket in microseconds, ULONG_MAX for the last bucket
+     **/
+    static unsigned long int getBucketUpperBound(int bucket);
+
+    /**
+     * Summarize the histogram, e.g., for logging
+     *
+     * @return a line of the count, average, percentiles (p50, p90, p99), and max. of latencies
+     **/
+    std::string toString() const;
+
+    /**
+     * Clear all latencies recorded
+     **/
+    void reset();
+
+private:
+    std::atomic<unsigned long int> _buckets[LATENCY_HISTOGRAM_NUM_BUCKETS]; /**< number of latencies in each bucket */
+    std::atomic<unsigned long int> _count;                                  /**< number of latencies */
+    std::atomic<unsigned long int> _sum;                                    /**< sum of latencies */
+    std::atomic<unsigned long int> _max;                                    /**< max. latency */
+};
+
+#endif // define __LATENCY_HISTOGRAM_HH__
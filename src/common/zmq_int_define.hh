@@ -83,6 +83,11 @@ enum ClientOpcode {
     GET_PROXY_STATUS_REP_SUCCESS,
     GET_PROXY_STATUS_REP_FAIL,
 
+    // list files by pages
+    GET_FILE_LIST_PAGE_REQ,
+    GET_FILE_LIST_PAGE_REP_SUCCESS,
+    GET_FILE_LIST_PAGE_REP_FAIL,
+
     UNKNOWN_CLIENT_OP,
 };
 
@@ -11,6 +11,7 @@
 
 #include "../common/define.hh"
 #include "../common/checksum_calculator.hh"
+#include "../common/chunk_buffer_pool.hh"
 
 struct Chunk {
     unsigned char  namespaceId;  /**< namespace id */
@@ -19,6 +20,7 @@ struct Chunk {
     unsigned char *data;         /**< chunk data */
     int size;                    /**< chunk size */
     bool freeData;               /**< whether to free data upon destruction */
+    ChunkDataHolder *dataHolder; /**< holder of the data buffer (if not allocated by malloc()) */
 
     int fileVersion;             /**< file version number */
     char chunkVersion[CHUNK_VERSION_MAX_LEN];  /**< chunk version number for revert */
@@ -52,42 +54,53 @@ struct Chunk {
         chunkId = chunkIdt;
     }
 
-    bool allocateData(int sizet, bool aligned = false) {
+    /**
+     * Allocate a data buffer from the chunk buffer pool, which is always aligned to CHUNK_BUFFER_ALIGNMENT bytes
+     *
+     * @param[in] sizet    size of data
+     *
+     * @return whether the allocation is successful
+     **/
+    bool allocateData(int sizet) {
         // do not allocate data buffer if size is zero or less (invalid length)
         if (sizet <= 0) return false;
 
-        // skip allocation if existing data buffer is allocated (not shadowed) and is of the requested size, and no buffer alignment is requested
-        if (data != NULL && size == sizet && freeData && !aligned) return true;
-
-        // try allocate the new data buffer
-        unsigned char *datat = NULL;
-        bool ret = 0;
-        if (aligned) {
-            ret = posix_memalign((void**) &datat, 32, sizet);
-        } else {
-            datat = (unsigned char *) malloc (sizet);
+        // skip allocation if existing data buffer is pooled, not shared (or shadowed), and fits the requested size
+        ChunkBuffer *buffer = dynamic_cast<ChunkBuffer *>(dataHolder);
+        if (data != NULL && freeData && buffer != NULL && buffer->isExclusive() && data == buffer->getData() && ChunkBufferPool::getSizeClass(sizet) == buffer->getCapacity()) {
+            size = sizet;
+            return true;
         }
 
-        // report failure if out-of-memory
-        if (datat == NULL || ret != 0) {
-            free(datat);
-            return false;
-        }
+        // try allocate the new data buffer, report failure if out-of-memory
+        buffer = ChunkBufferPool::getInstance().get(sizet);
+        if (buffer == NULL) return false;
 
-        // free any existing data buffer
-        if (freeData) free(data);
+        // free any existing data buffer, and hold the new one
+        setHeldData(buffer->getData(), sizet, buffer);
+
+        return true;
+    }
 
+    /**
+     * Take over a data buffer held by a holder, e.g., without copying the data out of a network message
+     *
+     * @param[in] datat   data buffer
+     * @param[in] sizet   size of data
+     * @param[in] holder  holder of the data buffer, released when the chunk releases the data
+     **/
+    void setHeldData(unsigned char *datat, int sizet, ChunkDataHolder *holder) {
+        if (freeData) releaseData();
         data = datat;
         size = sizet;
         freeData = true;
-
-        return true;
+        dataHolder = holder;
     }
 
-    bool copy(const Chunk &src, bool aligned = false) {
+    bool copy(const Chunk &src) {
         release();
         copyMeta(src);
-        if (!allocateData(src.size, aligned)) {
+        if (!allocateData(src.size)) {
             return false;
         }
         memcpy(data, src.data, size);
@@ -100,8 +113,10 @@ struct Chunk {
         data = src.data;
         size = src.size;
         freeData = src.freeData;
+        dataHolder = src.dataHolder;
         src.data = 0;
         src.freeData = false;
+        src.dataHolder = 0;
         return true;
     }
 
@@ -176,13 +191,23 @@ struct Chunk {
         data = 0;
         size = 0;
         freeData = true;
+        dataHolder = 0;
         resetMD5();
     }
 
     void release() {
-        if (freeData) free(data);
+        if (freeData) releaseData();
         reset();
     }
+
+private:
+    void releaseData() {
+        if (dataHolder) {
+            dataHolder->release();
+        } else {
+            free(data);
+        }
+    }
 };
 
 
@@ -95,14 +95,13 @@ void* BgChunkHandler::runWorker(void *arg) {
                 // issue the request
                 for (int i = startIdx; i < task.numReqs; i++) {
                     task.meta[i].io = self->_io;
-                    pthread_create(&task.wt[i], NULL, ProxyIO::sendChunkRequestToAgent, &task.meta[i]);
+                    self->_io->submitChunkRequest(&task.meta[i]);
                 }
             }
             // check the status of requests
             for (int i = startIdx; i < task.numReqs; i++) {
-                void *ptr = 0;
                 bool okay = true;
-                pthread_join(task.wt[i], &ptr);
+                void *ptr = ProxyIO::waitForChunkRequest(&task.meta[i]);
                 if (ptr != 0) {
                     LOG(ERROR) << "Failed to store chunk " << i << " due to internal failure, container id = " << task.meta[i].containerId << ", " << ptr;
                     okay = false;
@@ -130,8 +129,8 @@ void* BgChunkHandler::runWorker(void *arg) {
                 if (cfile.version > task.file->version) {
                     for (int i = startIdx; i < task.numReqs ; i++) {
                         task.meta[i].request->opcode = Opcode::DEL_CHUNK_REQ;
-                        pthread_create(&task.wt[i], NULL, ProxyIO::sendChunkRequestToAgent, &task.meta[i]);
-                        pthread_join(task.wt[i], 0);
+                        self->_io->submitChunkRequest(&task.meta[i]);
+                        ProxyIO::waitForChunkRequest(&task.meta[i]);
                     }
                     error = "Revert task: version of file is too old";
                     break;
@@ -172,7 +171,6 @@ void* BgChunkHandler::runWorker(void *arg) {
         lk.unlock();
         // clean up
         delete task.file;
-        delete [] task.wt;
         delete [] task.meta;
         delete [] task.events;
         // lock before waiting for task again
@@ -29,17 +29,15 @@ public:
         File *file;
         int numReqs;
         int numBgReqs;
-        pthread_t *wt;
         ProxyIO::RequestMeta *meta;
         ChunkEvent *events;
         void *codebuf;
         
-        ChunkTask(Opcode op, File *file, int num, int numBg, pthread_t *wt, ProxyIO::RequestMeta *meta, ChunkEvent *events, void *codebuf) {
+        ChunkTask(Opcode op, File *file, int num, int numBg, ProxyIO::RequestMeta *meta, ChunkEvent *events, void *codebuf) {
             this->op = op;
             this->file = file;
             this->numReqs = num;
             this->numBgReqs = numBg;
-            this->wt = wt;
             this->meta = meta;
             this->events = events;
             this->codebuf = codebuf;
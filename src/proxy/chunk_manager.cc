@@ -119,18 +119,15 @@ bool ChunkManager::writeFileStripe(File &file, int spareContainers[], int numSpa
     int numFgReqs = bgack ? numDataChunks / numChunksPerNode : numReqs;
     int numBgReqs = numSpare / numChunksPerNode - numFgReqs;
 
-    pthread_t *wt = 0;
     ProxyIO::RequestMeta *meta = 0;
     ChunkEvent *events = 0;
     try {
-        wt = new pthread_t[numReqs];
         meta = new ProxyIO::RequestMeta[numReqs];
         events = new ChunkEvent[numReqs * 2];
     } catch (std::bad_alloc &e) {
-        delete [] wt;
         delete [] meta;
         delete [] events;
-        LOG(ERROR) << "Failed to allocate memory for events metadata and threads";
+        LOG(ERROR) << "Failed to allocate memory for events metadata";
         return false;
     }
 
@@ -153,7 +150,6 @@ bool ChunkManager::writeFileStripe(File &file, int spareContainers[], int numSpa
         try {
             events[i].chunks = new Chunk[numChunksPerNode];
         } catch (std::bad_alloc &e) {
-            delete [] wt;
             delete [] meta;
             delete [] events;
             LOG(ERROR) << "Failed to allocate memory for event chunks";
@@ -162,7 +158,6 @@ bool ChunkManager::writeFileStripe(File &file, int spareContainers[], int numSpa
         try {
             events[i].containerIds = new int[numChunksPerNode];
         } catch (std::bad_alloc &e) {
-            delete [] wt;
             delete [] meta;
             delete [] events;
             delete [] events[i].chunks;
@@ -199,9 +194,9 @@ bool ChunkManager::writeFileStripe(File &file, int spareContainers[], int numSpa
             meta[i].network = &(bmStripe->network->at(i));
         }
 
-        // send the requests in separate threads
+        // send the requests via the I/O workers
         if (!bgwrite || i < numFgReqs)
-            pthread_create(&wt[i], NULL, ProxyIO::sendChunkRequestToAgent, &meta[i]);
+            _io->submitChunkRequest(&meta[i]);
     }
 
     DLOG(INFO) << "Write file " << file.name << ", finish issuing chunk requests for block " << file.blockId << ", stripe " << file.stripeId;
@@ -214,7 +209,6 @@ bool ChunkManager::writeFileStripe(File &file, int spareContainers[], int numSpa
     try {
         file.containerIds = new int[numDataChunks + numCodeChunks];
     } catch (std::bad_alloc &e) {
-        delete [] wt;
         delete [] meta;
         delete [] events;
         LOG(ERROR) << "Failed to allocate memory for container Ids";
@@ -239,9 +233,9 @@ bool ChunkManager::writeFileStripe(File &file, int spareContainers[], int numSpa
                 if (i > numDataChunks)
                     numBgReqs--;
                 // issue the request if it was designated to background
-                if (bgwrite && i > numFgReqs)
-                    pthread_create(&wt[i], NULL, ProxyIO::sendChunkRequestToAgent, &meta[i]);
-                pthread_join(wt[i], &ptr);
+                if (bgwrite && i >= numFgReqs)
+                    _io->submitChunkRequest(&meta[i]);
+                ptr = ProxyIO::waitForChunkRequest(&meta[i]);
                 // proxy internal error
                 if (ptr != 0) {
                     long errNum = static_cast<long>(reinterpret_cast<unsigned long>(ptr));
@@ -331,11 +325,10 @@ bool ChunkManager::writeFileStripe(File &file, int spareContainers[], int numSpa
             File *bgfile = new File();
             bgfile->status = FileStatus::BG_TASK_PENDING;
             bgfile->copyAllMeta(file);
-            BgChunkHandler::ChunkTask task(PUT_CHUNK_REQ, bgfile, numSpare / numChunksPerNode, numBgReqs, wt, meta, events, codebuf);
+            BgChunkHandler::ChunkTask task(PUT_CHUNK_REQ, bgfile, numSpare / numChunksPerNode, numBgReqs, meta, events, codebuf);
             LOG(INFO) << "Put task with " << numBgReqs << " requests into background";
             _bgChunkHandler->addChunkTask(task);
         } catch (std::bad_alloc &e) {
-            delete [] wt;
             delete [] meta;
             delete [] events;
             LOG(ERROR) << "Failed to allocate memory for background task with " << numBgReqs << " requests";
@@ -343,7 +336,6 @@ bool ChunkManager::writeFileStripe(File &file, int spareContainers[], int numSpa
     } else {
         // if all requests are done in foreground, clean up now
         free(codebuf);
-        delete [] wt;
         delete [] meta;
         delete [] events;
     }
@@ -424,9 +416,9 @@ bool ChunkManager::encodeFile(File &file, int spareContainers[], int numSpare, b
         }
     }
     
-    // encode
+    // encode, with data chunks referencing the file data buffer instead of copies
     std::vector<Chunk> stripe;
-    if (coding->encode(file.data, encodingSize, stripe, &file.codingMeta.codingState) == false) {
+    if (coding->encode(file.data, encodingSize, stripe, &file.codingMeta.codingState, /* inPlace */ true) == false) {
         LOG(ERROR) << "Failed to encode data of size " << file.length << " of " << file.size;
         if (isCodeBufLocal) free(codebuf);
         return false;
@@ -514,7 +506,6 @@ bool ChunkManager::fullFileModify(File &srcFile, File &dstFile, bool isCopy, int
     // copy the chunks
     int numReqs = (endIdx - startIdx) * numChunksPerStripe / numChunksPerNode;
     int numReqsPerStripe = numChunksPerStripe / numChunksPerNode;
-    pthread_t wt[numReqs];
     ProxyIO::RequestMeta meta[numReqs];
     ChunkEvent events[numReqs * 2];
 
@@ -568,8 +559,8 @@ bool ChunkManager::fullFileModify(File &srcFile, File &dstFile, bool isCopy, int
         meta[i].request = &events[i];
         meta[i].reply = &events[i + numReqs];
 
-        // send the requests via threads
-        pthread_create(&wt[i], NULL, ProxyIO::sendChunkRequestToAgent, &meta[i]);
+        // send the requests via the I/O workers
+        _io->submitChunkRequest(&meta[i]);
 
         // continue issuing requests until the end of a stripe
         if ((i + 1) % numReqsPerStripe != 0) 
@@ -579,7 +570,7 @@ bool ChunkManager::fullFileModify(File &srcFile, File &dstFile, bool isCopy, int
         for (int j = 0; j < numReqsPerStripe; j++) {
             void *ptr;
             int reqIdx = i - (numReqsPerStripe - 1) + j;
-            pthread_join(wt[reqIdx], &ptr);
+            ptr = ProxyIO::waitForChunkRequest(&meta[reqIdx]);
             if (ptr != 0) {
                 LOG(ERROR) << "Failed to store chunk due to internal failure, container id = " << meta[reqIdx].containerId;
             }
@@ -914,7 +905,8 @@ bool ChunkManager::repairFile(File &file, bool *chunkIndicator, int *spareContai
     }
 
     bool isRepairAtProxy = Config::getInstance().isRepairAtProxy() || numFailedNodes > 1;
-    bool isRepairUsingCAR = Config::getInstance().isRepairUsingCAR() && numFailedNodes == 1;
+    // LRC repairs a single failure within the local group instead (see LRCCode::preDecode())
+    bool isRepairUsingCAR = Config::getInstance().isRepairUsingCAR() && numFailedNodes == 1 && file.codingMeta.coding != CodingScheme::LRC;
     int numFailedChunks = numFailedNodes * numChunksPerNode;
     // number of failed chunks can be greater than input, e.g., replication
     int maxNumChunkReqs = std::max(numInputChunks, numFailedChunks);
@@ -926,6 +918,8 @@ bool ChunkManager::repairFile(File &file, bool *chunkIndicator, int *spareContai
     int subContainerGroups[numInputChunks];
     switch (file.codingMeta.coding) {
         case CodingScheme::RS:
+        case CodingScheme::CAUCHY_RS:
+        case CodingScheme::LRC:
             if (isRepairUsingCAR) { // single failure, encode partial chunks for decode
                 std::map<int, int> selectedChunks; // chunk id to index at inputChunkIndices
                 // update the chunk group according to selected chunks
@@ -1024,6 +1018,8 @@ bool ChunkManager::repairFile(File &file, bool *chunkIndicator, int *spareContai
     if (isRepairAtProxy) { // repair at Proxy
         switch (file.codingMeta.coding) {
             case CodingScheme::RS:
+            case CodingScheme::CAUCHY_RS:
+            case CodingScheme::LRC:
                 if (isRepairUsingCAR) {
                     // request encoded chunks from agents
                     if (!accessGroupedChunks(events, file.containerIds, numInputChunks, subChunkGroups, numSubChunkGroups, file.namespaceId, file.uuid, submatrix, file.chunks[0].getChunkId())) {
@@ -1086,11 +1082,10 @@ bool ChunkManager::repairFile(File &file, bool *chunkIndicator, int *spareContai
         meta.request = &events[0];
         meta.reply = &events[1];
 
-        pthread_t rt;
         void *ptr;
-        // use a thread to send the request, and check if the request succeeded
-        pthread_create(&rt, NULL, ProxyIO::sendChunkRequestToAgent, &meta);
-        pthread_join(rt, &ptr);
+        // use an I/O worker to send the request, and check if the request succeeded
+        _io->submitChunkRequest(&meta);
+        ptr = ProxyIO::waitForChunkRequest(&meta);
 
         //if (ProxyIO::sendChunkRequestToAgent(&meta) != NULL || meta.reply->opcode != RPR_CHUNK_REP_SUCCESS) {
         if (ptr != NULL || meta.reply->opcode != RPR_CHUNK_REP_SUCCESS) {
@@ -1144,7 +1139,6 @@ bool ChunkManager::repairFile(File &file, bool *chunkIndicator, int *spareContai
         return false;
     }
 
-    pthread_t wt[numRepairedChunks];
     ProxyIO::RequestMeta meta[numRepairedChunks];
     //for (int i = 0; i < file.numChunks; i++) DLOG(INFO) << "Chunk " << i << " size = " << file.chunks[i].size;
     // redistribute the repaired chunks
@@ -1185,8 +1179,8 @@ bool ChunkManager::repairFile(File &file, bool *chunkIndicator, int *spareContai
         meta[i].io = _io;
         meta[i].request = &events[i];
         meta[i].reply = &events[i + numInputChunks * 2];
-        // send the requests via threads
-        pthread_create(&wt[i], NULL, ProxyIO::sendChunkRequestToAgent, &meta[i]);
+        // send the requests via the I/O workers
+        _io->submitChunkRequest(&meta[i]);
     }
 
     // benchmark: set repair size of this stripe
@@ -1197,8 +1191,7 @@ bool ChunkManager::repairFile(File &file, bool *chunkIndicator, int *spareContai
     // TODO handle partial success, e.g., remove chunk already set?
     bool allsuccess = true;
     for (int i = 0; i < numRepairedChunks / numChunksPerNode; i++) {
-        void *ptr;
-        pthread_join(wt[i], &ptr);
+        void *ptr = ProxyIO::waitForChunkRequest(&meta[i]);
         // journal the replied change
         //for (int j = 0; j < numChunksPerNode; j++) {
         //    int containerId = meta[i].containerId;
@@ -1256,7 +1249,6 @@ int ChunkManager::checkFile(File &file, bool chunkIndicator[]) {
 int ChunkManager::verifyFileChecksums(File &file, bool chunkIndicator[]) {
     ChunkEvent events[2];
 
-    pthread_t ct;
     ProxyIO::RequestMeta meta;
 
     // construct the request event
@@ -1285,8 +1277,8 @@ int ChunkManager::verifyFileChecksums(File &file, bool chunkIndicator[]) {
     void *ptr = 0;
 
     // send the request
-    pthread_create(&ct, NULL, ProxyIO::sendChunkRequestToAgent, &meta);
-    pthread_join(ct, &ptr);
+    _io->submitChunkRequest(&meta);
+    ptr = ProxyIO::waitForChunkRequest(&meta);
 
     // check if verification request fails over the network / at agent
     if (ptr != 0 || events[1].opcode != Opcode::VRF_CHUNK_REP_SUCCESS) {
@@ -1475,7 +1467,6 @@ bool ChunkManager::accessChunks(ChunkEvent events[], const File &f, int numChunk
     int numSuccess = 0;
     bool allsuccess = false;
 
-    pthread_t wt[numChunks];
     ProxyIO::RequestMeta meta[numChunks];
 
     // retry others if number of chunks get in last iteration is less than required, and there is more chunks to try
@@ -1518,8 +1509,8 @@ bool ChunkManager::accessChunks(ChunkEvent events[], const File &f, int numChunk
                 meta[i].network = &(bmStripe->network->at(i));
             }
 
-            // send the requests via threads
-            pthread_create(&wt[i], NULL, ProxyIO::sendChunkRequestToAgent, &meta[i]);
+            // send the requests via the I/O workers
+            _io->submitChunkRequest(&meta[i]);
         }
 
         // the event chunks are init (no need to init upon retry)
@@ -1529,8 +1520,7 @@ bool ChunkManager::accessChunks(ChunkEvent events[], const File &f, int numChunk
         // TODO check reply while waiting for others
         bool sentNoError[numChunks];
         for (int i = numSuccess; i < numChunks; i++) {
-            void *ptr;
-            pthread_join(wt[i], &ptr);
+            void *ptr = ProxyIO::waitForChunkRequest(&meta[i]);
             sentNoError[i] = ptr == 0;
             
             if (benchmark && bmStripe->agentProcess && bmStripe->agentProcess->size() > (size_t) i) {
@@ -1675,7 +1665,6 @@ bool ChunkManager::accessChunks(ChunkEvent events[], const File &f, int numChunk
 }
 
 bool ChunkManager::accessGroupedChunks(ChunkEvent events[], int containerIds[], int numChunks, int chunkGroups[], int numChunkGroups, unsigned char  namespaceId, boost::uuids::uuid fuuid, std::string matrix, int chunkIdOffset) {
-    pthread_t wt[numChunkGroups];
     ProxyIO::RequestMeta meta[numChunkGroups];
     DLOG(INFO) << "Get grouped chunks from " << numChunkGroups << " groups of " << numChunks << " chunks";
 
@@ -1716,16 +1705,15 @@ bool ChunkManager::accessGroupedChunks(ChunkEvent events[], int containerIds[],
         meta[i].io = _io;
         meta[i].request = &events[i];
         meta[i].reply = &events[i + numChunkGroups];
-        // send the requests via threads
-        pthread_create(&wt[i], NULL, ProxyIO::sendChunkRequestToAgent, &meta[i]);
+        // send the requests via the I/O workers
+        _io->submitChunkRequest(&meta[i]);
     }
 
     // check the reply
     bool allsuccess = true;
 
     for (int i = 0; i < numChunkGroups; i++) {
-        void *ptr;
-        pthread_join(wt[i], &ptr);
+        void *ptr = ProxyIO::waitForChunkRequest(&meta[i]);
         if (ptr != 0 || meta[i].reply->opcode != ENC_CHUNK_REP_SUCCESS) {
             LOG(ERROR) << "Failed to operate on chunk (" << ENC_CHUNK_REQ << ") due to internal failure, container id = " << meta[i].containerId << ", return opcode =" << meta[i].reply->opcode;
             allsuccess = false;
@@ -45,6 +45,8 @@ public:
      * @param[in] alignDataBuf      whether data buffer needs internal alignment, caller should adjust it manually to the size returned by ChunkManager::getDataStripeSize() before disabling this
      * @param[in] codebuf           optional buffer to hold the coded chunks, caller should pre-allocate it to the size of number of coded chunks * chunk size
      *
+     * @remark data chunks may reference the file data buffer instead of a copy, so the buffer must stay intact until file.chunks are released
+     *
      * @return whether the file is successfully encoded
     */
     bool encodeFile(File &file, int spareContainers[], int numSpare, bool alignDataBuf = true, unsigned char *codebuf = 0);
@@ -134,6 +134,9 @@ void *ProxyZMQIntegration::handleRequests(void *arg) {
             break;
         }
 
+        // count only the metadata operations of this request in its statistics
+        InstrumentedMetaStore::resetThreadOpTimes();
+
         switch(req.opcode) {
         case ClientOpcode::WRITE_FILE_REQ:
             DLOG(INFO) << "Get a write file request";
@@ -407,6 +410,12 @@ void *ProxyZMQIntegration::handleRequests(void *arg) {
             rep.opcode = ClientOpcode::GET_FILE_LIST_REP_SUCCESS;
             break;
 
+        case GET_FILE_LIST_PAGE_REQ:
+            rep.list.cursor = req.list.cursor;
+            rep.list.numFiles = proxy->getFileListPage(&rep.list.fileInfo, rep.list.cursor, req.list.pageSize, /* withSize */ true, /* withVersions */ false, req.file.namespaceId, req.file.name);
+            rep.opcode = ClientOpcode::GET_FILE_LIST_PAGE_REP_SUCCESS;
+            break;
+
         case GET_APPEND_SIZE_REQ:
             {
             rep.file.length = proxy->getExpectedAppendSize(req.file.storageClass);
@@ -513,6 +522,20 @@ int ProxyZMQIntegration::getRequest(zmq::socket_t &socket, Request &req) {
 
     if (req.opcode == GET_READ_SIZE_REQ || req.opcode == GET_FILE_LIST_REQ)
         return 0;
+
+    if (req.opcode == GET_FILE_LIST_PAGE_REQ) {
+        // get the continuation token
+        if (!msg.more()) return 1;
+        getNextMsg();
+        req.list.cursor = std::string((char *) msg.data(), msg.size());
+        DLOG(INFO) << "Cursor = " << req.list.cursor;
+        // get the page size
+        if (!msg.more()) return 1;
+        getNextMsg();
+        req.list.pageSize = *((unsigned int *) msg.data());
+        DLOG(INFO) << "Page size = " << req.list.pageSize;
+        return 0;
+    }
     
     if (hasFileSize(req.opcode)) {
         // get file size
@@ -645,15 +668,17 @@ bool ProxyZMQIntegration::sendReply(zmq::socket_t &socket, Reply &rep) {
         }
         DLOG(INFO) << "file limit = " << rep.stats.fileLimit;
     } else if (replyFileList(rep.opcode)) {
+        // the continuation token follows the files in a page
+        bool withCursor = rep.opcode == GET_FILE_LIST_PAGE_REP_SUCCESS;
         // file list count
         msgLength = sizeof(rep.list.numFiles);
-        if (socket.send(&rep.list.numFiles, msgLength, rep.list.numFiles > 0? ZMQ_SNDMORE : 0) != msgLength) {
+        if (socket.send(&rep.list.numFiles, msgLength, rep.list.numFiles > 0 || withCursor? ZMQ_SNDMORE : 0) != msgLength) {
             LOG(ERROR) << "Failed to send file list count on reply";
             return false;
         }
         DLOG(INFO) << "num files = " << rep.list.numFiles;
         for (unsigned int i = 0; i < rep.list.numFiles; i++) {
-            bool isLast = i + 1 == rep.list.numFiles;
+            bool isLast = i + 1 == rep.list.numFiles && !withCursor;
             // file name
             msgLength = rep.list.fileInfo[i].nameLength;
             if (socket.send(rep.list.fileInfo[i].name, msgLength, ZMQ_SNDMORE) != msgLength) {
@@ -686,6 +711,15 @@ bool ProxyZMQIntegration::sendReply(zmq::socket_t &socket, Reply &rep) {
             }
             DLOG(INFO) << "file " << i << " name = " << rep.list.fileInfo[i].name << " size = " << rep.list.fileInfo[i].size << " {c,a,m}times (" << rep.list.fileInfo[i].ctime << "," << rep.list.fileInfo[i].atime << "," << rep.list.fileInfo[i].mtime << ")";
         }
+        if (withCursor) {
+            // continuation token (empty after the last page)
+            msgLength = rep.list.cursor.size();
+            if (socket.send(rep.list.cursor.data(), msgLength, 0) != msgLength) {
+                LOG(ERROR) << "Failed to send file list cursor on reply";
+                return false;
+            }
+            DLOG(INFO) << "cursor = " << rep.list.cursor;
+        }
     } else if (rep.opcode == GET_APPEND_SIZE_REP_SUCCESS || rep.opcode == GET_READ_SIZE_REP_SUCCESS) {
         // append length 
         msgLength = sizeof(rep.file.length);
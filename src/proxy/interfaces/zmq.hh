@@ -197,7 +197,11 @@ private:
      * @return whether the file list needs to be sent
      **/
     static bool replyFileList(int op) {
-        return (op == GET_FILE_LIST_REP_SUCCESS);
+        return (
+            op == GET_FILE_LIST_REP_SUCCESS ||
+            op == GET_FILE_LIST_PAGE_REP_SUCCESS ||
+            false
+        );
     }
 };
 
@@ -1,5 +1,9 @@
 // SPDX-License-Identifier: Apache-2.0
 
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <glog/logging.h>
 
 #include "io.hh"
@@ -9,10 +13,51 @@
 ProxyIO::ProxyIO(std::map<int, std::string> *containerToAgentMap) {
     _cxt = zmq::context_t(Config::getInstance().getProxyNumZmqThread());
     _containerToAgentMap = containerToAgentMap;
+    _running = true;
+    _numWorkers = 0;
+    _workers = 0;
+    // id 0 is left for replies which do not carry a valid id
+    _nextAsyncEventId = 1;
+    // init the event loop of asynchronous transport, or fall back to I/O workers if the wake-up pipe is not available
+    _asyncTransport = Config::getInstance().useAsyncDataTransport();
+    if (_asyncTransport && pipe(_wakeupPipe) != 0) {
+        LOG(ERROR) << "Failed to create pipe for the asynchronous transport, fall back to I/O workers, " << strerror(errno);
+        _asyncTransport = false;
+    }
+    if (_asyncTransport) {
+        fcntl(_wakeupPipe[0], F_SETFL, fcntl(_wakeupPipe[0], F_GETFL) | O_NONBLOCK);
+        fcntl(_wakeupPipe[1], F_SETFL, fcntl(_wakeupPipe[1], F_GETFL) | O_NONBLOCK);
+        pthread_create(&_eventLoop, 0, runAsyncEventLoop, this);
+        return;
+    }
+    // init I/O workers
+    _numWorkers = Config::getInstance().getProxyNumIOWorkers();
+    _workers = new pthread_t[_numWorkers];
+    for (int i = 0; i < _numWorkers; i++)
+        pthread_create(&_workers[i], 0, runIOWorker, this);
 }
 
 ProxyIO::~ProxyIO() {
     LOG(WARNING) << "Terminating Proxy IO";
+    // let the workers finish all pending requests before exit
+    _requestsLock.lock();
+    _running = false;
+    _requestsLock.unlock();
+    _newRequest.notify_all();
+    for (int i = 0; i < _numWorkers; i++)
+        pthread_join(_workers[i], 0);
+    delete [] _workers;
+    if (_asyncTransport) {
+        if (write(_wakeupPipe[1], "", 1) != 1 && errno != EAGAIN)
+            LOG(WARNING) << "Failed to wake up the event loop of asynchronous transport, " << strerror(errno);
+        pthread_join(_eventLoop, 0);
+        for (auto it : _agentToAsyncSocketMap) {
+            it.second->close();
+            delete it.second;
+        }
+        close(_wakeupPipe[0]);
+        close(_wakeupPipe[1]);
+    }
     for (auto it : _containerToSocketMap) {
         it.second->close();
         delete it.second;
@@ -68,7 +113,337 @@ void *ProxyIO::sendChunkRequestToAgent(void *arg) {
     if (meta.network != NULL) {
         meta.network->markEnd();
     }
-    
-    pthread_exit(retVal);
+
+    return retVal;
+}
+
+bool ProxyIO::submitChunkRequest(RequestMeta *meta) {
+    if (meta == NULL)
+        return false;
+
+    // mark the request as pending
+    meta->completionLock.lock();
+    meta->pending = true;
+    meta->ret = 0;
+    meta->completionLock.unlock();
+
+    // queue the request for workers (or the event loop)
+    _requestsLock.lock();
+    _requests.push_back(meta);
+    _requestsLock.unlock();
+    if (_asyncTransport) {
+        if (write(_wakeupPipe[1], "", 1) != 1 && errno != EAGAIN)
+            LOG(WARNING) << "Failed to wake up the event loop of asynchronous transport, " << strerror(errno);
+    } else {
+        _newRequest.notify_one();
+    }
+
+    return true;
+}
+
+void *ProxyIO::waitForChunkRequest(RequestMeta *meta) {
+    std::unique_lock<std::mutex> lk (meta->completionLock);
+    meta->completed.wait(lk, [meta] { return !meta->pending; });
+    return meta->ret;
+}
+
+void *ProxyIO::runIOWorker(void *arg) {
+    ProxyIO *self = (ProxyIO *) arg;
+    std::unique_lock<std::mutex> lk (self->_requestsLock);
+    while (true) {
+        self->_newRequest.wait(lk, [self] { return !self->_running || !self->_requests.empty(); });
+        // stop only when there is no more pending request
+        if (self->_requests.empty())
+            break;
+        RequestMeta *meta = self->_requests.front();
+        self->_requests.pop_front();
+        // no longer modifying the queue, unlock to allow request submission
+        lk.unlock();
+        completeChunkRequest(meta, sendChunkRequestToAgent(meta));
+        // lock before waiting for request again
+        lk.lock();
+    }
+    return 0;
+}
+
+void ProxyIO::completeChunkRequest(RequestMeta *meta, void *ret) {
+    // notify the waiting caller
+    meta->completionLock.lock();
+    meta->ret = ret;
+    meta->pending = false;
+    meta->completed.notify_all();
+    meta->completionLock.unlock();
+}
+
+void *ProxyIO::runAsyncEventLoop(void *arg) {
+    ProxyIO *self = (ProxyIO *) arg;
+    std::vector<RequestMeta*> requests;
+    std::vector<zmq_pollitem_t> items;
+    std::vector<zmq::socket_t*> sockets;
+    char buf[256];
+
+    while (true) {
+        // take all pending requests
+        self->_requestsLock.lock();
+        requests.assign(self->_requests.begin(), self->_requests.end());
+        self->_requests.clear();
+        bool running = self->_running;
+        self->_requestsLock.unlock();
+
+        for (RequestMeta *meta : requests) {
+            if (!self->sendAsyncChunkRequest(meta))
+                completeChunkRequest(meta, (void *) -1);
+        }
+        requests.clear();
+
+        // stop only when there is no more pending request
+        if (!running && self->_inFlightRequests.empty() && self->_pendingSends.empty())
+            break;
+
+        // wait for replies until the earliest deadline of in-flight and queued requests
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        long timeout = -1;
+        auto updateTimeout = [&timeout, &now](const InFlightRequest &req) {
+            long remains = std::chrono::duration_cast<std::chrono::milliseconds>(req.deadline - now).count();
+            if (timeout == -1 || remains < timeout)
+                timeout = std::max(remains, 0L);
+        };
+        for (auto &it : self->_inFlightRequests)
+            updateTimeout(it.second);
+        for (auto &it : self->_pendingSends)
+            updateTimeout(it.second.front());
+
+        items.clear();
+        sockets.clear();
+        items.push_back({ NULL, self->_wakeupPipe[0], ZMQ_POLLIN, 0 });
+        for (auto &it : self->_agentToAsyncSocketMap) {
+            // wait for the socket to take more messages only if requests are queued on it
+            short events = ZMQ_POLLIN | (self->_pendingSends.count(it.second) > 0 ? ZMQ_POLLOUT : 0);
+            items.push_back({ (void *) *it.second, 0, events, 0 });
+            sockets.push_back(it.second);
+        }
+
+        try {
+            zmq::poll(items.data(), items.size(), timeout);
+        } catch (zmq::error_t &e) {
+            LOG(ERROR) << "Failed to poll for chunk replies, " << e.what();
+            continue;
+        }
+
+        // drain the wake-up notifications
+        if (items[0].revents & ZMQ_POLLIN) {
+            while (read(self->_wakeupPipe[0], buf, sizeof(buf)) > 0);
+        }
+
+        // process the replies, and send the queued requests
+        for (size_t i = 1; i < items.size(); i++) {
+            if (items[i].revents & ZMQ_POLLOUT)
+                self->drainPendingSends(sockets.at(i - 1));
+            if (!(items[i].revents & ZMQ_POLLIN))
+                continue;
+            // process all replies available on the socket
+            while (sockets.at(i - 1)->getsockopt<int>(ZMQ_EVENTS) & ZMQ_POLLIN)
+                self->receiveAsyncChunkReply(sockets.at(i - 1));
+        }
+
+        // fail requests which could not be sent or did not get replies in time
+        now = std::chrono::steady_clock::now();
+        for (auto sit = self->_pendingSends.begin(); sit != self->_pendingSends.end();) {
+            std::deque<InFlightRequest> &queue = sit->second;
+            for (auto it = queue.begin(); it != queue.end();) {
+                if (it->deadline > now) {
+                    it++;
+                    continue;
+                }
+                RequestMeta *meta = it->meta;
+                LOG(ERROR) << "Failed to send a chunk event request in time for container id = " << meta->containerId;
+                if (meta->network != NULL) {
+                    meta->network->markEnd();
+                }
+                completeChunkRequest(meta, (void *) -2);
+                it = queue.erase(it);
+            }
+            sit = queue.empty() ? self->_pendingSends.erase(sit) : std::next(sit);
+        }
+        for (auto it = self->_inFlightRequests.begin(); it != self->_inFlightRequests.end();) {
+            if (it->second.deadline > now) {
+                it++;
+                continue;
+            }
+            RequestMeta *meta = it->second.meta;
+            LOG(ERROR) << "Failed to get a chunk event reply in time for container id = " << meta->containerId;
+            if (meta->network != NULL) {
+                meta->network->markEnd();
+            }
+            completeChunkRequest(meta, (void *) -2);
+            it = self->_inFlightRequests.erase(it);
+        }
+    }
+
+    return 0;
+}
+
+bool ProxyIO::sendAsyncChunkRequest(RequestMeta *meta) {
+    std::string address;
+    try {
+        address = _containerToAgentMap->at(meta->containerId);
+    } catch (std::exception &e) {
+        LOG(ERROR) << "Failed to find agent addresss, container id = " << meta->containerId;
+        return false;
+    }
+
+    int timeout = Config::getInstance().getFailureTimeout();
+
+    // TAGPT (start): network
+    if (meta->network != NULL) {
+        meta->network->markStart();
+    }
+
+    InFlightRequest req;
+    req.meta = meta;
+    req.eventId = meta->request->id;
+    req.socket = 0;
+    req.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+
+    try {
+        auto sit = _agentToAsyncSocketMap.find(address);
+        if (sit != _agentToAsyncSocketMap.end()) {
+            req.socket = sit->second;
+        } else {
+            req.socket = new zmq::socket_t(_cxt, ZMQ_DEALER);
+            Util::setSocketOptions(req.socket);
+            // never block the event loop on sending, the frames after the first one of a request are always taken
+            req.socket->setsockopt(ZMQ_SNDTIMEO, 0);
+            req.socket->setsockopt(ZMQ_LINGER, timeout);
+            req.socket->connect(address);
+            _agentToAsyncSocketMap.insert(std::make_pair(address, req.socket));
+        }
+    } catch (zmq::error_t &e) {
+        LOG(ERROR) << "Failed to connect agent to send the chunk request opcode = " << meta->request->opcode << ", " << e.what();
+        if (meta->network != NULL) {
+            meta->network->markEnd();
+        }
+        return false;
+    }
+
+    // keep the submission order behind the requests already queued on the socket
+    auto pit = _pendingSends.find(req.socket);
+    if (pit != _pendingSends.end()) {
+        pit->second.push_back(req);
+        return true;
+    }
+
+    int sent = trySendAsyncChunkRequest(req);
+    if (sent == 0)
+        _pendingSends[req.socket].push_back(req);
+    return sent >= 0;
+}
+
+int ProxyIO::trySendAsyncChunkRequest(InFlightRequest &req) {
+    RequestMeta *meta = req.meta;
+
+    // tag the request with a transport-wide unique id for matching the reply
+    unsigned int asyncEventId = _nextAsyncEventId;
+    meta->request->id = asyncEventId;
+
+    try {
+        // empty delimiter as expected by the REP workers behind the agent ROUTER front end, then the chunk event
+        zmq::message_t delimiter;
+        if (!req.socket->send(delimiter, ZMQ_SNDMORE | ZMQ_DONTWAIT)) {
+            // the socket cannot take more messages for now
+            meta->request->id = req.eventId;
+            return 0;
+        }
+        unsigned long sent = IO::sendChunkEventMessage(*req.socket, *meta->request);
+        meta->request->id = req.eventId;
+        if (sent == 0) {
+            LOG(ERROR) << "Failed to send chunk event for container id = " << meta->containerId;
+            if (meta->network != NULL) {
+                meta->network->markEnd();
+            }
+            return -1;
+        }
+    } catch (zmq::error_t &e) {
+        meta->request->id = req.eventId;
+        LOG(ERROR) << "Failed to send the chunk request opcode = " << meta->request->opcode << ", " << e.what();
+        if (meta->network != NULL) {
+            meta->network->markEnd();
+        }
+        return -1;
+    }
+
+    // skip id 0 on wrap-around
+    if (++_nextAsyncEventId == 0)
+        _nextAsyncEventId = 1;
+    _inFlightRequests[asyncEventId] = req;
+
+    return 1;
+}
+
+void ProxyIO::drainPendingSends(zmq::socket_t *socket) {
+    auto pit = _pendingSends.find(socket);
+    if (pit == _pendingSends.end())
+        return;
+
+    std::deque<InFlightRequest> &queue = pit->second;
+    while (!queue.empty()) {
+        int sent = trySendAsyncChunkRequest(queue.front());
+        if (sent == 0)
+            break;
+        if (sent < 0)
+            completeChunkRequest(queue.front().meta, (void *) -1);
+        queue.pop_front();
+    }
+    if (queue.empty())
+        _pendingSends.erase(pit);
+}
+
+void ProxyIO::receiveAsyncChunkReply(zmq::socket_t *socket) {
+    ChunkEvent reply;
+    unsigned long received = 0;
+
+    try {
+        // empty delimiter, followed by the chunk event
+        zmq::message_t delimiter;
+        socket->recv(&delimiter);
+        if (delimiter.size() == 0 && delimiter.more())
+            received = IO::getChunkEventMessage(*socket, reply);
+        // skip the rest of a malformed message
+        while (socket->getsockopt<int>(ZMQ_RCVMORE)) {
+            zmq::message_t part;
+            socket->recv(&part);
+        }
+    } catch (zmq::error_t &e) {
+        LOG(ERROR) << "Failed to get a chunk event reply, " << e.what();
+        return;
+    }
+
+    // drop a reply which cannot be parsed, as its id is not reliable; the request fails once it times out
+    if (received == 0) {
+        LOG(ERROR) << "Failed to parse a chunk event reply, drop it";
+        return;
+    }
+
+    // match the reply with the in-flight request
+    auto it = _inFlightRequests.find(reply.id);
+    if (it == _inFlightRequests.end() || it->second.socket != socket) {
+        LOG(WARNING) << "Drop chunk event reply with unknown id = " << reply.id << " (opcode = " << reply.opcode << "), which may have timed out";
+        return;
+    }
+
+    // hand over the reply (and its buffers) to the caller
+    RequestMeta *meta = it->second.meta;
+    reply.id = it->second.eventId;
+    *meta->reply = reply;
+    reply.reset();
+    reply.codingMeta.reset();
+
+    // TAGPT (end): network
+    if (meta->network != NULL) {
+        meta->network->markEnd();
+    }
+
+    completeChunkRequest(meta, NULL);
+    _inFlightRequests.erase(it);
 }
 
@@ -3,6 +3,9 @@
 #ifndef __PROXY_IO_HH__
 #define __PROXY_IO_HH__
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <string>
 #include <map>
 #include <mutex>
@@ -24,11 +27,22 @@ public:
         ChunkEvent *reply;
         TagPt *network;
 
+        void *ret;                              /**< return value of the request after completion */
+        bool pending;                           /**< whether the request is submitted but not yet completed */
+        std::mutex completionLock;              /**< lock for completion status */
+        std::condition_variable completed;      /**< signaled upon request completion */
+
         RequestMeta() {
+            pending = false;
+            ret = 0;
             reset();
         }
 
         ~RequestMeta() {
+            // never release a request which is still being processed by the I/O workers
+            std::unique_lock<std::mutex> lk (completionLock);
+            completed.wait(lk, [this] { return !pending; });
+            lk.unlock();
             reset();
         }
 
@@ -45,17 +59,110 @@ public:
      * Send a chunk event request to agent (and get the reply)
      *
      * @param arg    pointer to a ProxyIO::RequestMeta structure
-     * @return whether the operation is successful, NULL if sucessful, non-NULL otherwise
+     * @return whether the operation is successful, NULL if successful, non-NULL otherwise
      **/
     static void *sendChunkRequestToAgent(void *arg);
 
+    /**
+     * Submit a chunk event request to the I/O workers (or the asynchronous transport if enabled) without waiting for its reply
+     *
+     * @param[in] meta   request metadata, which must remain valid until the request completes
+     * @return whether the request is submitted
+     **/
+    bool submitChunkRequest(RequestMeta *meta);
+
+    /**
+     * Wait for a submitted chunk event request to complete
+     *
+     * @param[in] meta   request metadata used for submission
+     * @return whether the operation is successful, NULL if successful, non-NULL otherwise
+     **/
+    static void *waitForChunkRequest(RequestMeta *meta);
+
+    /**
+     * Main process of each I/O worker
+     *
+     * @param[in] arg    an instance of proxy IO
+     * @return always 0
+     **/
+    static void *runIOWorker(void *arg);
+
+    /**
+     * Main process of the event loop of the asynchronous transport,
+     * which keeps multiple requests in flight on one DEALER socket per agent, and completes requests as replies arrive (matched by event id)
+     *
+     * @param[in] arg    an instance of proxy IO
+     * @return always 0
+     **/
+    static void *runAsyncEventLoop(void *arg);
+
 private:
+    struct InFlightRequest {
+        RequestMeta *meta;                                      /**< request metadata */
+        unsigned int eventId;                                   /**< original event id of the request */
+        zmq::socket_t *socket;                                  /**< socket the request is sent over */
+        std::chrono::steady_clock::time_point deadline;         /**< time to give up waiting for the reply */
+    };
+
+    /**
+     * Send a chunk event request over the asynchronous transport, or queue it until the socket can take more messages (only called by the event loop)
+     *
+     * @param[in] meta   request metadata
+     * @return whether the request is sent or queued
+     **/
+    bool sendAsyncChunkRequest(RequestMeta *meta);
+
+    /**
+     * Try to send a chunk event request over a DEALER socket without blocking (only called by the event loop)
+     *
+     * @param[in] req    request to send, with its socket and deadline set
+     * @return 1 if the request is sent and in flight, 0 if the socket cannot take more messages for now, -1 on failure
+     **/
+    int trySendAsyncChunkRequest(InFlightRequest &req);
+
+    /**
+     * Send the requests queued on a socket until the socket cannot take more messages (only called by the event loop)
+     *
+     * @param[in] socket socket ready for sending
+     **/
+    void drainPendingSends(zmq::socket_t *socket);
+
+    /**
+     * Receive a chunk event reply from the asynchronous transport and complete the matching request (only called by the event loop)
+     *
+     * @param[in] socket socket with an incoming reply
+     **/
+    void receiveAsyncChunkReply(zmq::socket_t *socket);
+
+    /**
+     * Mark a request as completed and notify the waiting caller
+     *
+     * @param[in] meta   request metadata
+     * @param[in] ret    return value of the request, NULL if successful, non-NULL otherwise
+     **/
+    static void completeChunkRequest(RequestMeta *meta, void *ret);
+
     std::map<int, std::string> *_containerToAgentMap;           /**< container id to agent address mapping */
     std::map<int, zmq::socket_t*> _containerToSocketMap;        /**< container id to socket mapping */
     std::mutex _lock;
 
     zmq::context_t _cxt;                                        /**< zeromq context */
 
+    int _numWorkers;                                            /**< number of I/O workers */
+    pthread_t *_workers;                                        /**< I/O workers issuing chunk requests */
+    bool _running;                                              /**< whether the I/O workers should keep running */
+    std::deque<RequestMeta*> _requests;                         /**< pending chunk requests */
+    std::mutex _requestsLock;                                   /**< lock for pending chunk requests */
+    std::condition_variable _newRequest;                        /**< new request arrived */
+
+    bool _asyncTransport;                                       /**< whether to use the asynchronous transport */
+    pthread_t _eventLoop;                                       /**< event loop of the asynchronous transport */
+    int _wakeupPipe[2];                                         /**< pipe to wake up the event loop on new requests */
+    unsigned int _nextAsyncEventId;                             /**< id of the next request sent over the asynchronous transport, never 0 */
+    std::map<std::string, zmq::socket_t*> _agentToAsyncSocketMap; /**< agent address to DEALER socket mapping (event loop only) */
+    std::map<unsigned int, InFlightRequest> _inFlightRequests;  /**< requests waiting for replies (event loop only) */
+    std::map<zmq::socket_t*, std::deque<InFlightRequest>> _pendingSends; /**< requests waiting for their sockets to take more messages, in submission order (event loop only) */
+
 };
 
 #endif // define __PROXY_IO_HH__
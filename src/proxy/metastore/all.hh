@@ -4,6 +4,8 @@
 #define __PROXY_METASTORE_ALL_HH__
 
 #include "metastore.hh"
+#include "instrumented_metastore.hh"
+#include "local_metastore.hh"
 #include "redis_metastore.hh"
 
 #endif //__PROXY_METASTORE_ALL_HH__
@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <stdio.h>
+
+#include <functional>
+
+#include <openssl/sha.h>
+
+#include "file_meta_cache.hh"
+
+// approx. memory used by a node of the block maps, including the node pointers and the fingerprint buffer
+#define BLOCK_NODE_OVERHEAD (sizeof(void *) * 4 + SHA256_DIGEST_LENGTH)
+
+double FileMetaCacheStats::getHitRate() const {
+    unsigned long int numLookups = numHits + numMisses;
+    return numLookups == 0 ? 0 : numHits * 1.0 / numLookups;
+}
+
+std::string FileMetaCacheStats::toString() const {
+    char hitRate[16];
+    snprintf(hitRate, sizeof(hitRate), "%.2lf%%", getHitRate() * 100);
+    return std::string("hits = ").append(std::to_string(numHits))
+        .append(", misses = ").append(std::to_string(numMisses))
+        .append(", hit rate = ").append(hitRate)
+        .append(", entries = ").append(std::to_string(numEntries))
+        .append(", usage = ").append(std::to_string(usage))
+        .append(" / ").append(std::to_string(capacity)).append(" bytes");
+}
+
+FileMetaCache::FileMetaCache(unsigned long int capacity) {
+    _shardCapacity = capacity / FILE_META_CACHE_NUM_SHARDS;
+    for (int i = 0; i < FILE_META_CACHE_NUM_SHARDS; i++) {
+        _shards[i].usage = 0;
+        _shards[i].epoch = 0;
+    }
+    _numHits = 0;
+    _numMisses = 0;
+}
+
+FileMetaCache::~FileMetaCache() {
+}
+
+std::string FileMetaCache::genKey(unsigned char namespaceId, const char *name, int nameLength) {
+    return std::to_string(namespaceId).append("_").append(name, nameLength);
+}
+
+bool FileMetaCache::get(const std::string &key, File &f, int getBlocks, int version) {
+    Shard &shard = getShard(key);
+    shard.lock.lock();
+    auto it = shard.index.find(key);
+    if (
+        it == shard.index.end()
+        || (version != -1 && it->second->file->version != version)
+        || (it->second->blocks & getBlocks) != getBlocks
+    ) {
+        shard.lock.unlock();
+        _numMisses++;
+        return false;
+    }
+
+    // mark as the most recently used
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    copyMeta(*it->second->file, f, getBlocks);
+    shard.lock.unlock();
+    _numHits++;
+
+    return true;
+}
+
+unsigned long int FileMetaCache::getEpoch(const std::string &key) {
+    Shard &shard = getShard(key);
+    std::lock_guard<std::mutex> lk(shard.lock);
+    return shard.epoch;
+}
+
+void FileMetaCache::put(const std::string &key, const File &f, int getBlocks, unsigned long int epoch) {
+    // copy the metadata before taking the lock
+    Entry entry;
+    entry.key = key;
+    entry.file.reset(new File());
+    entry.blocks = getBlocks;
+    copyMeta(f, *entry.file, getBlocks);
+    entry.size = estimateSize(*entry.file) + key.size() * 2;
+
+    // skip files too large for the cache
+    if (entry.size > _shardCapacity)
+        return;
+
+    Shard &shard = getShard(key);
+    std::lock_guard<std::mutex> lk(shard.lock);
+
+    // skip metadata read before the latest invalidation
+    if (shard.epoch != epoch)
+        return;
+
+    // replace the existing metadata
+    auto it = shard.index.find(key);
+    if (it != shard.index.end())
+        removeEntry(shard, it->second);
+
+    // evict the least recently used files
+    while (!shard.entries.empty() && shard.usage + entry.size > _shardCapacity)
+        removeEntry(shard, std::prev(shard.entries.end()));
+
+    shard.usage += entry.size;
+    shard.entries.push_front(std::move(entry));
+    shard.index[key] = shard.entries.begin();
+}
+
+void FileMetaCache::updateTimestamps(const std::string &key, const File &f) {
+    Shard &shard = getShard(key);
+    std::lock_guard<std::mutex> lk(shard.lock);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end())
+        it->second->file->copyTimeStamps(f);
+}
+
+void FileMetaCache::invalidate(const std::string &key) {
+    Shard &shard = getShard(key);
+    std::lock_guard<std::mutex> lk(shard.lock);
+    shard.epoch++;
+    auto it = shard.index.find(key);
+    if (it != shard.index.end())
+        removeEntry(shard, it->second);
+}
+
+void FileMetaCache::clear() {
+    for (int i = 0; i < FILE_META_CACHE_NUM_SHARDS; i++) {
+        Shard &shard = _shards[i];
+        std::lock_guard<std::mutex> lk(shard.lock);
+        shard.epoch++;
+        shard.index.clear();
+        shard.entries.clear();
+        shard.usage = 0;
+    }
+}
+
+FileMetaCacheStats FileMetaCache::getStats() {
+    FileMetaCacheStats stats;
+    stats.numHits = _numHits;
+    stats.numMisses = _numMisses;
+    stats.numEntries = 0;
+    stats.usage = 0;
+    stats.capacity = _shardCapacity * FILE_META_CACHE_NUM_SHARDS;
+    for (int i = 0; i < FILE_META_CACHE_NUM_SHARDS; i++) {
+        Shard &shard = _shards[i];
+        std::lock_guard<std::mutex> lk(shard.lock);
+        stats.numEntries += shard.entries.size();
+        stats.usage += shard.usage;
+    }
+    return stats;
+}
+
+FileMetaCache::Shard &FileMetaCache::getShard(const std::string &key) {
+    return _shards[std::hash<std::string>{}(key) % FILE_META_CACHE_NUM_SHARDS];
+}
+
+void FileMetaCache::removeEntry(Shard &shard, EntryList::iterator it) {
+    shard.usage -= it->size;
+    shard.index.erase(it->key);
+    shard.entries.erase(it);
+}
+
+void FileMetaCache::copyMeta(const File &src, File &dst, int getBlocks) {
+    dst.uuid = src.uuid;
+    dst.size = src.size;
+    dst.numStripes = src.numStripes;
+    dst.copyFileChecksum(src);
+    dst.copyTimeStamps(src);
+    dst.copyVersionControlInfo(src);
+    dst.isDeleted = src.isDeleted;
+    // storage policy, including the coding state
+    dst.storageClass = src.storageClass;
+    dst.codingMeta.copyMeta(src.codingMeta);
+    // staging (coding parameters only, as in the metadata store)
+    dst.staged.size = src.staged.size;
+    dst.staged.storageClass = src.staged.storageClass;
+    dst.staged.codingMeta.copyMeta(src.staged.codingMeta, /* parameters only */ true);
+    dst.staged.mtime = src.staged.mtime;
+    // chunks
+    dst.copyChunkInfo(src);
+    // blocks
+    if (getBlocks & 1)
+        dst.uniqueBlocks.insert(src.uniqueBlocks.begin(), src.uniqueBlocks.end());
+    if (getBlocks & 2)
+        dst.duplicateBlocks.insert(src.duplicateBlocks.begin(), src.duplicateBlocks.end());
+}
+
+size_t FileMetaCache::estimateSize(const File &f) {
+    return sizeof(Entry) + sizeof(File)
+        + f.storageClass.size() + f.staged.storageClass.size()
+        + f.codingMeta.codingStateSize
+        + f.numChunks * (sizeof(Chunk) + sizeof(int) + sizeof(bool))
+        + f.uniqueBlocks.size() * (sizeof(decltype(f.uniqueBlocks)::value_type) + BLOCK_NODE_OVERHEAD)
+        + f.duplicateBlocks.size() * (sizeof(decltype(f.duplicateBlocks)::value_type) + BLOCK_NODE_OVERHEAD);
+}
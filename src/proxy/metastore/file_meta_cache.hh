@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __FILE_META_CACHE_HH__
+#define __FILE_META_CACHE_HH__
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "../../ds/file.hh"
+
+#define FILE_META_CACHE_NUM_SHARDS (16)
+
+/**
+ * Statistics of the file metadata cache
+ **/
+struct FileMetaCacheStats {
+    unsigned long int numHits;                /**< number of lookups served by the cache */
+    unsigned long int numMisses;              /**< number of lookups not served by the cache */
+    unsigned long int numEntries;             /**< number of files cached */
+    unsigned long int usage;                  /**< (estimated) memory used by the cached metadata in bytes */
+    unsigned long int capacity;               /**< max. memory for the cached metadata in bytes */
+
+    double getHitRate() const;
+    std::string toString() const;
+};
+
+/**
+ * Bounded LRU cache of the metadata of the current versions of files, in front of a metadata store
+ *
+ * Files are identified by keys built with genKey(), and spread over shards with
+ * their own locks and LRU lists. The metadata store should invalidate a file
+ * after changing its metadata. To avoid caching metadata read before an
+ * invalidation, take the epoch of the file with getEpoch() before reading from
+ * the metadata store, and pass it to put().
+ **/
+class FileMetaCache {
+public:
+    /**
+     * Constructor
+     *
+     * @param[in] capacity  max. memory for the cached metadata in bytes
+     **/
+    FileMetaCache(unsigned long int capacity);
+    ~FileMetaCache();
+
+    /**
+     * Generate the key of a file
+     *
+     * @param[in] namespaceId   namespace id of the file
+     * @param[in] name          name of the file
+     * @param[in] nameLength    length of the file name
+     *
+     * @return key of the file
+     **/
+    static std::string genKey(unsigned char namespaceId, const char *name, int nameLength);
+
+    /**
+     * Look up the metadata of a file
+     *
+     * @param[in] key       key of the file
+     * @param[in,out] f     file structure to fill the metadata into (see MetaStore::getMeta())
+     * @param[in] getBlocks type of blocks to get (see MetaStore::getMeta())
+     * @param[in] version   version of the file expected, -1 for any
+     *
+     * @return whether the metadata with the expected version and blocks is found
+     **/
+    bool get(const std::string &key, File &f, int getBlocks, int version = -1);
+
+    /**
+     * Get the invalidation epoch of a file
+     *
+     * @param[in] key       key of the file
+     *
+     * @return the invalidation epoch
+     **/
+    unsigned long int getEpoch(const std::string &key);
+
+    /**
+     * Add (or replace) the metadata of a file, and evict the least recently used files if the cache is full
+     *
+     * @param[in] key       key of the file
+     * @param[in] f         file with the metadata of its current version
+     * @param[in] getBlocks type of blocks in the metadata (see MetaStore::getMeta())
+     * @param[in] epoch     invalidation epoch of the file taken before reading its metadata, the metadata is not added if the file is invalidated since then
+     **/
+    void put(const std::string &key, const File &f, int getBlocks, unsigned long int epoch);
+
+    /**
+     * Update the timestamps of a cached file, e.g., after a read
+     *
+     * @param[in] key       key of the file
+     * @param[in] f         file with the new timestamps
+     **/
+    void updateTimestamps(const std::string &key, const File &f);
+
+    /**
+     * Remove the metadata of a file
+     *
+     * @param[in] key       key of the file
+     **/
+    void invalidate(const std::string &key);
+
+    /**
+     * Remove the metadata of all files
+     **/
+    void clear();
+
+    /**
+     * Get the current statistics of the cache
+     *
+     * @return statistics of the cache
+     **/
+    FileMetaCacheStats getStats();
+
+private:
+    struct Entry {
+        std::string key;                        /**< key of the file */
+        std::unique_ptr<File> file;             /**< cached metadata */
+        int blocks;                             /**< type of blocks cached */
+        size_t size;                            /**< estimated memory used by the entry */
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    struct Shard {
+        std::mutex lock;                                            /**< lock on the shard */
+        EntryList entries;                                          /**< cached files, in the order of most recently used first */
+        std::unordered_map<std::string, EntryList::iterator> index; /**< key to cached file mapping */
+        size_t usage;                                               /**< estimated memory used by the cached files */
+        unsigned long int epoch;                                    /**< number of invalidations on the shard */
+    };
+
+    Shard &getShard(const std::string &key);
+    void removeEntry(Shard &shard, EntryList::iterator it);
+
+    /**
+     * Copy the metadata of a file (excluding its name and the operation data range)
+     *
+     * @param[in] src       source file
+     * @param[out] dst      destination file
+     * @param[in] getBlocks type of blocks to copy (see MetaStore::getMeta())
+     **/
+    static void copyMeta(const File &src, File &dst, int getBlocks);
+    static size_t estimateSize(const File &f);
+
+    Shard _shards[FILE_META_CACHE_NUM_SHARDS];  /**< shards of the cache */
+    size_t _shardCapacity;                      /**< max. memory used by each shard */
+
+    std::atomic<unsigned long int> _numHits;    /**< number of lookups served by the cache */
+    std::atomic<unsigned long int> _numMisses;  /**< number of lookups not served by the cache */
+};
+
+#endif // define __FILE_META_CACHE_HH__
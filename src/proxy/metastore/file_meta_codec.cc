@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <string.h>
+
+#include <glog/logging.h>
+#include <openssl/sha.h>
+
+#include "file_meta_codec.hh"
+
+void FileMetaCodec::encodeHeader(uint32_t numEntries, std::string &out) {
+    uint32_t format = CURRENT_FORMAT;
+    out.append((const char *) &format, sizeof(uint32_t));
+    out.append((const char *) &numEntries, sizeof(uint32_t));
+}
+
+bool FileMetaCodec::decodeHeader(const char *data, size_t length, uint32_t &numEntries) {
+    uint32_t format = 0;
+    if (data == NULL || length < HEADER_SIZE)
+        return false;
+    memcpy(&format, data, sizeof(uint32_t));
+    memcpy(&numEntries, data + sizeof(uint32_t), sizeof(uint32_t));
+    if (format != FORMAT_V1) {
+        LOG(ERROR) << "Unknown file metadata format " << format;
+        return false;
+    }
+    return true;
+}
+
+void FileMetaCodec::encodeChunks(const File &f, std::string &out) {
+    uint32_t n = f.numChunks > 0 ? f.numChunks : 0;
+    size_t idsOfs = HEADER_SIZE;
+    size_t sizesOfs = idsOfs + n * sizeof(int32_t);
+    size_t md5Ofs = sizesOfs + n * sizeof(int32_t);
+    size_t badOfs = md5Ofs + n * MD5_DIGEST_LENGTH;
+
+    out.clear();
+    encodeHeader(n, out);
+    out.resize(badOfs + (n + 7) / 8, 0);
+
+    char *buf = &out[0];
+    for (uint32_t i = 0; i < n; i++) {
+        // place the chunk by its id
+        int pos = f.chunks[i].getChunkId();
+        if (pos < 0 || (uint32_t) pos >= n)
+            pos = i;
+        int32_t containerId = f.containerIds[i];
+        int32_t size = f.chunks[i].size;
+        memcpy(buf + idsOfs + pos * sizeof(int32_t), &containerId, sizeof(int32_t));
+        memcpy(buf + sizesOfs + pos * sizeof(int32_t), &size, sizeof(int32_t));
+        memcpy(buf + md5Ofs + pos * MD5_DIGEST_LENGTH, f.chunks[i].md5, MD5_DIGEST_LENGTH);
+        if (f.chunksCorrupted && f.chunksCorrupted[i])
+            buf[badOfs + pos / 8] |= 1 << (pos % 8);
+    }
+}
+
+bool FileMetaCodec::decodeChunks(const char *data, size_t length, File &f) {
+    uint32_t n = 0;
+    if (!decodeHeader(data, length, n))
+        return false;
+
+    size_t idsOfs = HEADER_SIZE;
+    size_t sizesOfs = idsOfs + n * sizeof(int32_t);
+    size_t md5Ofs = sizesOfs + n * sizeof(int32_t);
+    size_t badOfs = md5Ofs + n * MD5_DIGEST_LENGTH;
+
+    if (length < badOfs + (n + 7) / 8 || (int) n != f.numChunks) {
+        LOG(ERROR) << "Invalid chunk metadata of file " << (f.name ? f.name : "") << " (" << n << " chunks in " << length << " bytes, expected " << f.numChunks << " chunks)";
+        return false;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        int32_t containerId = 0, size = 0;
+        memcpy(&containerId, data + idsOfs + i * sizeof(int32_t), sizeof(int32_t));
+        memcpy(&size, data + sizesOfs + i * sizeof(int32_t), sizeof(int32_t));
+        f.containerIds[i] = containerId;
+        f.chunks[i].size = size;
+        memcpy(f.chunks[i].md5, data + md5Ofs + i * MD5_DIGEST_LENGTH, MD5_DIGEST_LENGTH);
+        f.chunksCorrupted[i] = data[badOfs + i / 8] & (1 << (i % 8));
+    }
+
+    return true;
+}
+
+void FileMetaCodec::encodeBlocks(const File &f, bool unique, std::string &out) {
+    uint32_t m = unique ? f.uniqueBlocks.size() : f.duplicateBlocks.size();
+
+    out.clear();
+    encodeHeader(m, out);
+
+    std::string lengths, physicalOffsets, fingerprintLengths, fingerprints;
+    lengths.reserve(m * sizeof(uint32_t));
+    out.reserve(HEADER_SIZE + m * (sizeof(uint64_t) + sizeof(uint32_t) + sizeof(int32_t) + 1 + SHA256_DIGEST_LENGTH));
+
+    auto addBlock = [&](const BlockLocation::InObjectLocation &loc, const Fingerprint &fp) {
+        uint64_t offset = loc._offset;
+        uint32_t length = loc._length;
+        std::string fpBytes = fp.get();
+        uint8_t fpLength = fpBytes.size() > UINT8_MAX ? UINT8_MAX : fpBytes.size();
+        out.append((const char *) &offset, sizeof(uint64_t));
+        lengths.append((const char *) &length, sizeof(uint32_t));
+        fingerprintLengths.append((const char *) &fpLength, sizeof(uint8_t));
+        fingerprints.append(fpBytes.data(), fpLength);
+    };
+
+    if (unique) {
+        physicalOffsets.reserve(m * sizeof(int32_t));
+        for (auto it = f.uniqueBlocks.begin(); it != f.uniqueBlocks.end(); it++) {
+            int32_t physicalOffset = it->second.second;
+            addBlock(it->first, it->second.first);
+            physicalOffsets.append((const char *) &physicalOffset, sizeof(int32_t));
+        }
+    } else {
+        for (auto it = f.duplicateBlocks.begin(); it != f.duplicateBlocks.end(); it++) {
+            addBlock(it->first, it->second);
+        }
+    }
+
+    out.append(lengths).append(physicalOffsets).append(fingerprintLengths).append(fingerprints);
+}
+
+bool FileMetaCodec::decodeBlocks(const char *data, size_t length, bool unique, File &f) {
+    uint32_t m = 0;
+    if (!decodeHeader(data, length, m))
+        return false;
+
+    size_t offsetsOfs = HEADER_SIZE;
+    size_t lengthsOfs = offsetsOfs + m * sizeof(uint64_t);
+    size_t physicalOffsetsOfs = lengthsOfs + m * sizeof(uint32_t);
+    size_t fpLengthsOfs = physicalOffsetsOfs + (unique ? m * sizeof(int32_t) : 0);
+    size_t fpOfs = fpLengthsOfs + m;
+
+    if (length < fpOfs) {
+        LOG(ERROR) << "Invalid block metadata of file " << (f.name ? f.name : "") << " (" << m << " blocks in " << length << " bytes)";
+        return false;
+    }
+
+    BlockLocation::InObjectLocation loc;
+    Fingerprint fp;
+    for (uint32_t i = 0; i < m; i++) {
+        uint64_t offset = 0;
+        uint32_t blockLength = 0;
+        uint8_t fpLength = data[fpLengthsOfs + i];
+        memcpy(&offset, data + offsetsOfs + i * sizeof(uint64_t), sizeof(uint64_t));
+        memcpy(&blockLength, data + lengthsOfs + i * sizeof(uint32_t), sizeof(uint32_t));
+        if (fpOfs + fpLength > length) {
+            LOG(ERROR) << "Invalid block metadata of file " << (f.name ? f.name : "") << " (fingerprint of block " << i << " out of bound)";
+            return false;
+        }
+        loc.set(offset, blockLength);
+        fp.set(data + fpOfs, fpLength);
+        fpOfs += fpLength;
+        // hint is the item after the element to insert, as blocks are encoded in order
+        if (unique) {
+            int32_t physicalOffset = 0;
+            memcpy(&physicalOffset, data + physicalOffsetsOfs + i * sizeof(int32_t), sizeof(int32_t));
+            f.uniqueBlocks.emplace_hint(f.uniqueBlocks.end(), std::make_pair(loc, std::make_pair(fp, (int) physicalOffset)));
+        } else {
+            f.duplicateBlocks.emplace_hint(f.duplicateBlocks.end(), std::make_pair(loc, fp));
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __FILE_META_CODEC_HH__
+#define __FILE_META_CODEC_HH__
+
+#include <stdint.h>
+#include <string>
+
+#include "../../ds/file.hh"
+
+/**
+ * Packed binary encoding of the per-chunk and per-block metadata of a file
+ *
+ * Each encoding is a versioned struct-of-arrays blob in host byte order,
+ * which begins with the format version and the number of entries (both
+ * uint32_t).
+ *
+ * Chunks (entry i is the chunk with id i)
+ *   int32_t container ids [n], int32_t sizes [n], md5 [n][MD5_DIGEST_LENGTH], corrupted bits [(n + 7) / 8]
+ *
+ * Unique (duplicate) blocks
+ *   uint64_t logical offsets [m], uint32_t lengths [m], (int32_t physical offsets [m],) uint8_t fingerprint lengths [m],
+ *   fingerprints (concatenated)
+ **/
+class FileMetaCodec {
+public:
+    static const uint32_t FORMAT_V1 = 1;
+    static const uint32_t CURRENT_FORMAT = FORMAT_V1;
+
+    /**
+     * Encode the attributes of all chunks of a file
+     *
+     * @param[in] f         file with the container ids and chunks to encode
+     * @param[out] out      encoded chunk attributes
+     **/
+    static void encodeChunks(const File &f, std::string &out);
+
+    /**
+     * Decode the attributes of all chunks of a file
+     *
+     * @param[in] data      encoded chunk attributes
+     * @param[in] length    length of the encoded chunk attributes
+     * @param[in,out] f     file with the container ids and chunks allocated for f.numChunks chunks, to fill in the container ids, chunk sizes, checksums, and corruption marks
+     *
+     * @return whether the encoding is valid and matches the number of chunks of the file
+     **/
+    static bool decodeChunks(const char *data, size_t length, File &f);
+
+    /**
+     * Encode the unique or duplicate blocks of a file
+     *
+     * @param[in] f         file with the blocks to encode
+     * @param[in] unique    whether to encode the unique blocks, or the duplicate blocks
+     * @param[out] out      encoded blocks
+     **/
+    static void encodeBlocks(const File &f, bool unique, std::string &out);
+
+    /**
+     * Decode the unique or duplicate blocks of a file
+     *
+     * @param[in] data      encoded blocks
+     * @param[in] length    length of the encoded blocks
+     * @param[in] unique    whether the blocks are unique blocks, or duplicate blocks
+     * @param[in,out] f     file to add the blocks to
+     *
+     * @return whether the encoding is valid
+     **/
+    static bool decodeBlocks(const char *data, size_t length, bool unique, File &f);
+
+private:
+    static const size_t HEADER_SIZE = sizeof(uint32_t) * 2;
+
+    static void encodeHeader(uint32_t numEntries, std::string &out);
+    static bool decodeHeader(const char *data, size_t length, uint32_t &numEntries);
+};
+
+#endif // define __FILE_META_CODEC_HH__
@@ -0,0 +1,370 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <stdio.h>
+
+#include <glog/logging.h>
+
+#include "instrumented_metastore.hh"
+
+#define PROMETHEUS_METRIC_NAME "nexoedge_metastore_op_latency_microseconds"
+
+static const char *opNames[] = {
+    "putMeta",
+    "getMeta",
+    "getMetaBatch",
+    "deleteMeta",
+    "renameMeta",
+    "updateTimestamps",
+    "updateChunks",
+    "getFileName",
+    "getFileList",
+    "getFileListPage",
+    "getFolderList",
+    "getMaxNumKeysSupported",
+    "getNumFiles",
+    "getNumFilesToRepair",
+    "getFilesToRepair",
+    "markFileAsNeedsRepair",
+    "markFilesAsNeedsRepair",
+    "markFileAsRepaired",
+    "markFilesAsRepaired",
+    "markFileAsPendingWriteToCloud",
+    "markFileAsWrittenToCloud",
+    "markFilesAsWrittenToCloud",
+    "getFilesPendingWriteToCloud",
+    "updateFileStatus",
+    "getNextFileForTaskCheck",
+    "lockFile",
+    "unlockFile",
+    "addChunkToJournal",
+    "updateChunkInJournal",
+    "getFileJournal",
+    "getFilesWithJournal",
+    "fileHasJournal",
+    "getFileMetaCacheStats"
+};
+static_assert(sizeof(opNames) / sizeof(opNames[0]) == InstrumentedMetaStore::NUM_OPS, "Missing names of metadata store operations");
+
+std::atomic<LatencyHistogram *> InstrumentedMetaStore::_latencies[1 << 8];
+thread_local unsigned long int InstrumentedMetaStore::_threadOpTimes[InstrumentedMetaStore::NUM_OPS];
+
+InstrumentedMetaStore::InstrumentedMetaStore(MetaStore *store) {
+    _store = store;
+}
+
+InstrumentedMetaStore::~InstrumentedMetaStore() {
+    delete _store;
+}
+
+unsigned char InstrumentedMetaStore::getBatchNamespaceId(int numFiles, const File files[]) {
+    if (numFiles <= 0)
+        return INVALID_NAMESPACE_ID;
+    for (int i = 1; i < numFiles; i++)
+        if (files[i].namespaceId != files[0].namespaceId)
+            return INVALID_NAMESPACE_ID;
+    return files[0].namespaceId;
+}
+
+InstrumentedMetaStore::OpTimer::OpTimer(Op op, unsigned char namespaceId) : _op(op), _namespaceId(namespaceId) {
+    _start = std::chrono::steady_clock::now();
+}
+
+InstrumentedMetaStore::OpTimer::~OpTimer() {
+    unsigned long int us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start).count();
+    getNamespaceLatencies(_namespaceId)[_op].record(us);
+    _threadOpTimes[_op] += us;
+}
+
+bool InstrumentedMetaStore::putMeta(const File &f) {
+    OpTimer t(PUT_META, f.namespaceId);
+    return _store->putMeta(f);
+}
+
+bool InstrumentedMetaStore::getMeta(File &f, int getBlocks) {
+    OpTimer t(GET_META, f.namespaceId);
+    return _store->getMeta(f, getBlocks);
+}
+
+int InstrumentedMetaStore::getMetaBatch(int numFiles, File files[], bool found[], int getBlocks) {
+    OpTimer t(GET_META_BATCH, getBatchNamespaceId(numFiles, files));
+    return _store->getMetaBatch(numFiles, files, found, getBlocks);
+}
+
+bool InstrumentedMetaStore::deleteMeta(File &f) {
+    OpTimer t(DELETE_META, f.namespaceId);
+    return _store->deleteMeta(f);
+}
+
+bool InstrumentedMetaStore::renameMeta(File &sf, File &df) {
+    OpTimer t(RENAME_META, sf.namespaceId);
+    return _store->renameMeta(sf, df);
+}
+
+bool InstrumentedMetaStore::updateTimestamps(const File &f) {
+    OpTimer t(UPDATE_TIMESTAMPS, f.namespaceId);
+    return _store->updateTimestamps(f);
+}
+
+int InstrumentedMetaStore::updateChunks(const File &f, int version) {
+    OpTimer t(UPDATE_CHUNKS, f.namespaceId);
+    return _store->updateChunks(f, version);
+}
+
+bool InstrumentedMetaStore::getFileName(boost::uuids::uuid fuuid, File &f) {
+    OpTimer t(GET_FILE_NAME, INVALID_NAMESPACE_ID);
+    return _store->getFileName(fuuid, f);
+}
+
+unsigned int InstrumentedMetaStore::getFileList(FileInfo **list, unsigned char namespaceId, bool withSize, bool withTime, bool withVersions, std::string prefix) {
+    OpTimer t(GET_FILE_LIST, namespaceId);
+    return _store->getFileList(list, namespaceId, withSize, withTime, withVersions, prefix);
+}
+
+unsigned int InstrumentedMetaStore::getFileListPage(FileInfo **list, std::string &cursor, unsigned int pageSize, unsigned char namespaceId, bool withSize, bool withTime, bool withVersions, std::string prefix) {
+    OpTimer t(GET_FILE_LIST_PAGE, namespaceId);
+    return _store->getFileListPage(list, cursor, pageSize, namespaceId, withSize, withTime, withVersions, prefix);
+}
+
+unsigned int InstrumentedMetaStore::getFolderList(std::vector<std::string> &list, unsigned char namespaceId, std::string prefix, bool skipSubfolders) {
+    OpTimer t(GET_FOLDER_LIST, namespaceId);
+    return _store->getFolderList(list, namespaceId, prefix, skipSubfolders);
+}
+
+unsigned long int InstrumentedMetaStore::getMaxNumKeysSupported() {
+    OpTimer t(GET_MAX_NUM_KEYS_SUPPORTED, INVALID_NAMESPACE_ID);
+    return _store->getMaxNumKeysSupported();
+}
+
+unsigned long int InstrumentedMetaStore::getNumFiles() {
+    OpTimer t(GET_NUM_FILES, INVALID_NAMESPACE_ID);
+    return _store->getNumFiles();
+}
+
+unsigned long int InstrumentedMetaStore::getNumFilesToRepair() {
+    OpTimer t(GET_NUM_FILES_TO_REPAIR, INVALID_NAMESPACE_ID);
+    return _store->getNumFilesToRepair();
+}
+
+int InstrumentedMetaStore::getFilesToRepair(int numFiles, File files[]) {
+    OpTimer t(GET_FILES_TO_REPAIR, INVALID_NAMESPACE_ID);
+    return _store->getFilesToRepair(numFiles, files);
+}
+
+bool InstrumentedMetaStore::markFileAsNeedsRepair(const File &file) {
+    OpTimer t(MARK_FILE_AS_NEEDS_REPAIR, file.namespaceId);
+    return _store->markFileAsNeedsRepair(file);
+}
+
+bool InstrumentedMetaStore::markFilesAsNeedsRepair(int numFiles, const File files[]) {
+    OpTimer t(MARK_FILES_AS_NEEDS_REPAIR, getBatchNamespaceId(numFiles, files));
+    return _store->markFilesAsNeedsRepair(numFiles, files);
+}
+
+bool InstrumentedMetaStore::markFileAsRepaired(const File &file) {
+    OpTimer t(MARK_FILE_AS_REPAIRED, file.namespaceId);
+    return _store->markFileAsRepaired(file);
+}
+
+bool InstrumentedMetaStore::markFilesAsRepaired(int numFiles, const File files[]) {
+    OpTimer t(MARK_FILES_AS_REPAIRED, getBatchNamespaceId(numFiles, files));
+    return _store->markFilesAsRepaired(numFiles, files);
+}
+
+bool InstrumentedMetaStore::markFileAsPendingWriteToCloud(const File &file) {
+    OpTimer t(MARK_FILE_AS_PENDING_WRITE_TO_CLOUD, file.namespaceId);
+    return _store->markFileAsPendingWriteToCloud(file);
+}
+
+bool InstrumentedMetaStore::markFileAsWrittenToCloud(const File &file, bool removePending) {
+    OpTimer t(MARK_FILE_AS_WRITTEN_TO_CLOUD, file.namespaceId);
+    return _store->markFileAsWrittenToCloud(file, removePending);
+}
+
+bool InstrumentedMetaStore::markFilesAsWrittenToCloud(int numFiles, const File files[], bool removePending) {
+    OpTimer t(MARK_FILES_AS_WRITTEN_TO_CLOUD, getBatchNamespaceId(numFiles, files));
+    return _store->markFilesAsWrittenToCloud(numFiles, files, removePending);
+}
+
+int InstrumentedMetaStore::getFilesPendingWriteToCloud(int numFiles, File files[]) {
+    OpTimer t(GET_FILES_PENDING_WRITE_TO_CLOUD, INVALID_NAMESPACE_ID);
+    return _store->getFilesPendingWriteToCloud(numFiles, files);
+}
+
+bool InstrumentedMetaStore::updateFileStatus(const File &file) {
+    OpTimer t(UPDATE_FILE_STATUS, file.namespaceId);
+    return _store->updateFileStatus(file);
+}
+
+bool InstrumentedMetaStore::getNextFileForTaskCheck(File &file) {
+    OpTimer t(GET_NEXT_FILE_FOR_TASK_CHECK, INVALID_NAMESPACE_ID);
+    return _store->getNextFileForTaskCheck(file);
+}
+
+bool InstrumentedMetaStore::lockFile(const File &file) {
+    OpTimer t(LOCK_FILE, file.namespaceId);
+    return _store->lockFile(file);
+}
+
+bool InstrumentedMetaStore::lockFile(const File &file, unsigned long int maxWaitUs) {
+    OpTimer t(LOCK_FILE, file.namespaceId);
+    return _store->lockFile(file, maxWaitUs);
+}
+
+bool InstrumentedMetaStore::unlockFile(const File &file) {
+    OpTimer t(UNLOCK_FILE, file.namespaceId);
+    return _store->unlockFile(file);
+}
+
+bool InstrumentedMetaStore::addChunkToJournal(const File &file, const Chunk &chunk, int containerId, bool isWrite) {
+    OpTimer t(ADD_CHUNK_TO_JOURNAL, file.namespaceId);
+    return _store->addChunkToJournal(file, chunk, containerId, isWrite);
+}
+
+bool InstrumentedMetaStore::updateChunkInJournal(const File &file, const Chunk &chunk, bool isWrite, bool deleteRecord, int containerId) {
+    OpTimer t(UPDATE_CHUNK_IN_JOURNAL, file.namespaceId);
+    return _store->updateChunkInJournal(file, chunk, isWrite, deleteRecord, containerId);
+}
+
+void InstrumentedMetaStore::getFileJournal(const FileInfo &file, std::vector<std::tuple<Chunk, int, bool, bool>> &records) {
+    OpTimer t(GET_FILE_JOURNAL, file.namespaceId);
+    _store->getFileJournal(file, records);
+}
+
+int InstrumentedMetaStore::getFilesWithJounal(FileInfo **list) {
+    OpTimer t(GET_FILES_WITH_JOURNAL, INVALID_NAMESPACE_ID);
+    return _store->getFilesWithJounal(list);
+}
+
+bool InstrumentedMetaStore::fileHasJournal(const File &file) {
+    OpTimer t(FILE_HAS_JOURNAL, file.namespaceId);
+    return _store->fileHasJournal(file);
+}
+
+bool InstrumentedMetaStore::getFileMetaCacheStats(FileMetaCacheStats &stats) {
+    OpTimer t(GET_FILE_META_CACHE_STATS, INVALID_NAMESPACE_ID);
+    return _store->getFileMetaCacheStats(stats);
+}
+
+const char *InstrumentedMetaStore::getOpName(int op) {
+    if (op < 0 || op >= NUM_OPS)
+        return "unknown";
+    return opNames[op];
+}
+
+const LatencyHistogram *InstrumentedMetaStore::getLatencies(unsigned char namespaceId, int op) {
+    if (op < 0 || op >= NUM_OPS)
+        return NULL;
+    LatencyHistogram *latencies = _latencies[namespaceId].load(std::memory_order_acquire);
+    if (latencies == NULL || latencies[op].getCount() == 0)
+        return NULL;
+    return &latencies[op];
+}
+
+void InstrumentedMetaStore::getThreadOpTimes(std::map<std::string, double> &stats, bool reset) {
+    for (int i = 0; i < NUM_OPS; i++) {
+        if (_threadOpTimes[i] == 0)
+            continue;
+        stats[std::string("meta ").append(opNames[i]).append(" (ms)")] = _threadOpTimes[i] / 1e3;
+        if (reset)
+            _threadOpTimes[i] = 0;
+    }
+}
+
+void InstrumentedMetaStore::resetThreadOpTimes() {
+    for (int i = 0; i < NUM_OPS; i++)
+        _threadOpTimes[i] = 0;
+}
+
+void InstrumentedMetaStore::getLatencyStats(std::map<std::string, double> &stats) {
+    for (int ns = 0; ns < (1 << 8); ns++) {
+        for (int i = 0; i < NUM_OPS; i++) {
+            const LatencyHistogram *latencies = getLatencies(ns, i);
+            if (latencies == NULL)
+                continue;
+            std::string name = std::string(opNames[i]).append(" ns").append(ns == INVALID_NAMESPACE_ID ? "-" : std::to_string(ns));
+            stats[std::string(name).append(" count")] = latencies->getCount();
+            stats[std::string(name).append(" p50 (us)")] = latencies->getPercentile(50);
+            stats[std::string(name).append(" p99 (us)")] = latencies->getPercentile(99);
+            stats[std::string(name).append(" p999 (us)")] = latencies->getPercentile(99.9);
+        }
+    }
+}
+
+std::string InstrumentedMetaStore::toString() {
+    std::string summary;
+    for (int ns = 0; ns < (1 << 8); ns++) {
+        for (int i = 0; i < NUM_OPS; i++) {
+            const LatencyHistogram *latencies = getLatencies(ns, i);
+            if (latencies == NULL)
+                continue;
+            summary.append("\n  ").append(opNames[i])
+                .append(" (namespace ").append(ns == INVALID_NAMESPACE_ID ? "-" : std::to_string(ns)).append("): ")
+                .append(latencies->toString());
+        }
+    }
+    return summary;
+}
+
+std::string InstrumentedMetaStore::toPrometheusText() {
+    std::string text;
+    text.append("# HELP " PROMETHEUS_METRIC_NAME " Latency of metadata store operations at Proxy.\n");
+    text.append("# TYPE " PROMETHEUS_METRIC_NAME " histogram\n");
+
+    char line[256];
+    for (int ns = 0; ns < (1 << 8); ns++) {
+        for (int i = 0; i < NUM_OPS; i++) {
+            const LatencyHistogram *latencies = getLatencies(ns, i);
+            if (latencies == NULL)
+                continue;
+            std::string labels = std::string("op=\"").append(opNames[i]).append("\",namespace=\"")
+                .append(ns == INVALID_NAMESPACE_ID ? "none" : std::to_string(ns)).append("\"");
+            // cumulative counts of the buckets, where a latency in bucket i is at most (2^i - 1) us
+            unsigned long int count = 0;
+            for (int b = 0; b < LATENCY_HISTOGRAM_NUM_BUCKETS; b++) {
+                count += latencies->getBucketCount(b);
+                if (b == LATENCY_HISTOGRAM_NUM_BUCKETS - 1)
+                    snprintf(line, sizeof(line), PROMETHEUS_METRIC_NAME "_bucket{%s,le=\"+Inf\"} %lu\n", labels.c_str(), count);
+                else
+                    snprintf(line, sizeof(line), PROMETHEUS_METRIC_NAME "_bucket{%s,le=\"%lu\"} %lu\n", labels.c_str(), LatencyHistogram::getBucketUpperBound(b) - 1, count);
+                text.append(line);
+            }
+            snprintf(line, sizeof(line), PROMETHEUS_METRIC_NAME "_sum{%s} %lu\n", labels.c_str(), latencies->getSum());
+            text.append(line);
+            snprintf(line, sizeof(line), PROMETHEUS_METRIC_NAME "_count{%s} %lu\n", labels.c_str(), count);
+            text.append(line);
+        }
+    }
+    return text;
+}
+
+bool InstrumentedMetaStore::dumpPrometheusText(const std::string &path) {
+    std::string text = toPrometheusText();
+    std::string tmpPath = std::string(path).append(".tmp");
+
+    FILE *f = fopen(tmpPath.c_str(), "w");
+    if (f == NULL) {
+        LOG(ERROR) << "Failed to open " << tmpPath << " for dumping the metadata store latencies";
+        return false;
+    }
+    bool okay = fwrite(text.data(), 1, text.size(), f) == text.size();
+    okay = fclose(f) == 0 && okay;
+    if (!okay || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        LOG(ERROR) << "Failed to dump the metadata store latencies to " << path;
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+LatencyHistogram *InstrumentedMetaStore::getNamespaceLatencies(unsigned char namespaceId) {
+    LatencyHistogram *latencies = _latencies[namespaceId].load(std::memory_order_acquire);
+    if (latencies != NULL)
+        return latencies;
+
+    // install the histograms of the namespace, unless another thread has done so
+    LatencyHistogram *newLatencies = new LatencyHistogram[NUM_OPS];
+    if (_latencies[namespaceId].compare_exchange_strong(latencies, newLatencies, std::memory_order_acq_rel))
+        return newLatencies;
+    delete [] newLatencies;
+    return latencies;
+}
@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __INSTRUMENTED_METASTORE_HH__
+#define __INSTRUMENTED_METASTORE_HH__
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "metastore.hh"
+#include "../../common/latency_histogram.hh"
+
+/**
+ * Metadata store that measures the latency of each call to another metadata store
+ *
+ * Latencies are recorded into lock-free histograms by operation and
+ * namespace, which are shared by all instances in the process (e.g., one per
+ * Proxy instance of each request handler). The following operations are
+ * recorded under INVALID_NAMESPACE_ID instead of a namespace:
+ *   - operations without a file or namespace (e.g., getNumFiles())
+ *   - operations on a batch of files in different namespaces (e.g.,
+ *     getMetaBatch()), which are recorded under the namespace of the files
+ *     only if all files share one
+ *   - getFileName(), as the file is not known before the uuid is looked up
+ * Each thread also sums up the time it spends on each operation, for the
+ * per-request statistics.
+ **/
+class InstrumentedMetaStore : public MetaStore {
+public:
+    enum Op {
+        PUT_META,
+        GET_META,
+        GET_META_BATCH,
+        DELETE_META,
+        RENAME_META,
+        UPDATE_TIMESTAMPS,
+        UPDATE_CHUNKS,
+        GET_FILE_NAME,
+        GET_FILE_LIST,
+        GET_FILE_LIST_PAGE,
+        GET_FOLDER_LIST,
+        GET_MAX_NUM_KEYS_SUPPORTED,
+        GET_NUM_FILES,
+        GET_NUM_FILES_TO_REPAIR,
+        GET_FILES_TO_REPAIR,
+        MARK_FILE_AS_NEEDS_REPAIR,
+        MARK_FILES_AS_NEEDS_REPAIR,
+        MARK_FILE_AS_REPAIRED,
+        MARK_FILES_AS_REPAIRED,
+        MARK_FILE_AS_PENDING_WRITE_TO_CLOUD,
+        MARK_FILE_AS_WRITTEN_TO_CLOUD,
+        MARK_FILES_AS_WRITTEN_TO_CLOUD,
+        GET_FILES_PENDING_WRITE_TO_CLOUD,
+        UPDATE_FILE_STATUS,
+        GET_NEXT_FILE_FOR_TASK_CHECK,
+        LOCK_FILE,
+        UNLOCK_FILE,
+        ADD_CHUNK_TO_JOURNAL,
+        UPDATE_CHUNK_IN_JOURNAL,
+        GET_FILE_JOURNAL,
+        GET_FILES_WITH_JOURNAL,
+        FILE_HAS_JOURNAL,
+        GET_FILE_META_CACHE_STATS,
+
+        NUM_OPS
+    };
+
+    /**
+     * Constructor
+     *
+     * @param[in] store     metadata store to measure, which is released together with this instance
+     **/
+    InstrumentedMetaStore(MetaStore *store);
+    ~InstrumentedMetaStore();
+
+    bool putMeta(const File &f);
+    bool getMeta(File &f, int getBlocks = 3);
+    int getMetaBatch(int numFiles, File files[], bool found[], int getBlocks = 3);
+    bool deleteMeta(File &f);
+    bool renameMeta(File &sf, File &df);
+    bool updateTimestamps(const File &f);
+    int updateChunks(const File &f, int version);
+    bool getFileName(boost::uuids::uuid fuuid, File &f);
+    unsigned int getFileList(FileInfo **list, unsigned char namespaceId = INVALID_NAMESPACE_ID, bool withSize = true, bool withTime = true, bool withVersions = false, std::string prefix = "");
+    unsigned int getFileListPage(FileInfo **list, std::string &cursor, unsigned int pageSize = DEFAULT_FILE_LIST_PAGE_SIZE, unsigned char namespaceId = INVALID_NAMESPACE_ID, bool withSize = true, bool withTime = true, bool withVersions = false, std::string prefix = "");
+    unsigned int getFolderList(std::vector<std::string> &list, unsigned char namespaceId = INVALID_NAMESPACE_ID, std::string prefix = "", bool skipSubfolders = true);
+    unsigned long int getMaxNumKeysSupported();
+    unsigned long int getNumFiles();
+    unsigned long int getNumFilesToRepair();
+    int getFilesToRepair(int numFiles, File files[]);
+    bool markFileAsNeedsRepair(const File &file);
+    bool markFilesAsNeedsRepair(int numFiles, const File files[]);
+    bool markFileAsRepaired(const File &file);
+    bool markFilesAsRepaired(int numFiles, const File files[]);
+    bool markFileAsPendingWriteToCloud(const File &file);
+    bool markFileAsWrittenToCloud(const File &file, bool removePending = false);
+    bool markFilesAsWrittenToCloud(int numFiles, const File files[], bool removePending = false);
+    int getFilesPendingWriteToCloud(int numFiles, File files[]);
+    bool updateFileStatus(const File &file);
+    bool getNextFileForTaskCheck(File &file);
+    bool lockFile(const File &file);
+    bool lockFile(const File &file, unsigned long int maxWaitUs);
+    bool unlockFile(const File &file);
+    bool addChunkToJournal(const File &file, const Chunk &chunk, int containerId, bool isWrite);
+    bool updateChunkInJournal(const File &file, const Chunk &chunk, bool isWrite, bool deleteRecord, int containerId);
+    void getFileJournal(const FileInfo &file, std::vector<std::tuple<Chunk, int /* container id*/, bool /* isWrite */, bool /* isPre */>> &records);
+    int getFilesWithJounal(FileInfo **list);
+    bool fileHasJournal(const File &file);
+    bool getFileMetaCacheStats(FileMetaCacheStats &stats);
+
+    /**
+     * Get the name of an operation
+     *
+     * @param[in] op        operation
+     *
+     * @return name of the metadata store method of the operation
+     **/
+    static const char *getOpName(int op);
+
+    /**
+     * Get the latencies of an operation in a namespace
+     *
+     * @param[in] namespaceId   namespace id, INVALID_NAMESPACE_ID for operations without a namespace
+     * @param[in] op            operation
+     *
+     * @return latencies of the operation, NULL if the operation is never called in the namespace
+     **/
+    static const LatencyHistogram *getLatencies(unsigned char namespaceId, int op);
+
+    /**
+     * Add the time the calling thread spent on each operation since the last reset to a set of statistics, as "meta <op> (ms)"
+     *
+     * @param[in,out] stats     statistics to add to
+     * @param[in] reset         whether to reset the time after adding
+     **/
+    static void getThreadOpTimes(std::map<std::string, double> &stats, bool reset = true);
+
+    /**
+     * Reset the time the calling thread spent on each operation, e.g., before handling a request
+     **/
+    static void resetThreadOpTimes();
+
+    /**
+     * Add the count and percentiles (p50, p99, p999) of latencies of the operations called to a set of statistics, as "<op> ns<namespace id> <stat>"
+     *
+     * @param[in,out] stats     statistics to add to
+     **/
+    static void getLatencyStats(std::map<std::string, double> &stats);
+
+    /**
+     * Summarize the latencies of the operations called, e.g., for logging
+     *
+     * @return one line per operation and namespace, in the format of LatencyHistogram::toString()
+     **/
+    static std::string toString();
+
+    /**
+     * Dump the latencies of the operations called in Prometheus text format, as a histogram metric with the operation and namespace as labels
+     *
+     * @return the metrics
+     **/
+    static std::string toPrometheusText();
+
+    /**
+     * Write the latencies in Prometheus text format to a file, replacing the file atomically
+     *
+     * @param[in] path      path of the file
+     *
+     * @return whether the file is written
+     **/
+    static bool dumpPrometheusText(const std::string &path);
+
+private:
+    /**
+     * Measurement of an operation call, recorded when it goes out of scope
+     **/
+    class OpTimer {
+    public:
+        OpTimer(Op op, unsigned char namespaceId);
+        ~OpTimer();
+
+    private:
+        Op _op;
+        unsigned char _namespaceId;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+    /**
+     * Get the namespace to record an operation on a batch of files under
+     *
+     * @return the namespace of the files if all files share one, INVALID_NAMESPACE_ID otherwise
+     **/
+    static unsigned char getBatchNamespaceId(int numFiles, const File files[]);
+
+    /**
+     * Get the latencies of all operations in a namespace, allocated on first use
+     **/
+    static LatencyHistogram *getNamespaceLatencies(unsigned char namespaceId);
+
+    MetaStore *_store;                                              /**< metadata store measured */
+
+    static std::atomic<LatencyHistogram *> _latencies[1 << 8];      /**< latencies of all operations, indexed by namespace id */
+    static thread_local unsigned long int _threadOpTimes[NUM_OPS];  /**< time (in microseconds) spent by the thread on each operation */
+};
+
+#endif // define __INSTRUMENTED_METASTORE_HH__
@@ -0,0 +1,502 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h> // flock()
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glog/logging.h>
+
+#include "local_kv_store.hh"
+
+#define SNAPSHOT_FILE_NAME "snapshot"
+#define LOG_FILE_NAME "log"
+#define OLD_LOG_FILE_NAME "log.old"
+#define RECORD_HEADER_SIZE (sizeof(uint32_t) * 2)
+#define MAX_SNAPSHOT_RECORD_SIZE (1 << 20)  // max. payload size of a snapshot record (in bytes), unless a pair is larger
+
+enum LocalKVOpType {
+    KV_OP_PUT,
+    KV_OP_DELETE
+};
+
+void LocalKVStore::WriteBatch::put(const std::string &key, const std::string &value) {
+    _ops.push_back({false, key, value});
+}
+
+void LocalKVStore::WriteBatch::remove(const std::string &key) {
+    _ops.push_back({true, key, ""});
+}
+
+bool LocalKVStore::WriteBatch::empty() const {
+    return _ops.empty();
+}
+
+LocalKVStore::LocalKVStore() {
+    _syncWrites = true;
+    _dirFd = -1;
+    _logFd = -1;
+    _logSize = 0;
+    _snapshotSize = 0;
+    _hasOldLog = false;
+    _compactionPending = false;
+    _running = false;
+}
+
+LocalKVStore::~LocalKVStore() {
+    close();
+}
+
+bool LocalKVStore::open(const std::string &dir, bool syncWrites) {
+    std::lock_guard<std::mutex> lk(_logLock);
+
+    if (_logFd != -1) {
+        LOG(ERROR) << "Local key-value store at " << _dir << " is already opened";
+        return false;
+    }
+
+    _dir = dir;
+    _syncWrites = syncWrites;
+
+    if (mkdir(_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        LOG(ERROR) << "Failed to create the data directory " << _dir << " of the local key-value store, " << strerror(errno);
+        return false;
+    }
+
+    // lock the directory against other stores, in this process or not
+    _dirFd = ::open(_dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (_dirFd == -1 || flock(_dirFd, LOCK_EX | LOCK_NB) != 0) {
+        LOG(ERROR) << "Failed to lock the data directory " << _dir << " of the local key-value store, " << (errno == EWOULDBLOCK? "it is opened by another store" : strerror(errno));
+        unlockDir();
+        return false;
+    }
+
+    std::unique_lock<std::shared_mutex> plk(_pairsLock);
+    _pairs.clear();
+
+    // load the snapshot, which must be complete as it is only renamed into place after it is fully written
+    std::string snapshotPath = _dir + "/" SNAPSHOT_FILE_NAME;
+    _snapshotSize = 0;
+    if (access(snapshotPath.c_str(), F_OK) == 0 && !replay(snapshotPath, _pairs, _snapshotSize)) {
+        LOG(ERROR) << "Snapshot " << snapshotPath << " of the local key-value store is corrupted";
+        _pairs.clear();
+        unlockDir();
+        return false;
+    }
+
+    // apply the batches in the log set aside for a compaction not completed in the last run (or completed without removing the log, in which case replaying it over the new snapshot is harmless)
+    std::string oldLogPath = _dir + "/" OLD_LOG_FILE_NAME;
+    size_t oldLogSize = 0;
+    _hasOldLog = access(oldLogPath.c_str(), F_OK) == 0;
+    if (_hasOldLog && !replay(oldLogPath, _pairs, oldLogSize)) {
+        LOG(WARNING) << "Drop the incomplete batch at the end of the log " << oldLogPath << " (valid length = " << oldLogSize << ")";
+    }
+
+    // apply the batches in the log, and drop any incomplete batch at its end (written when the last run is interrupted)
+    std::string logPath = _dir + "/" LOG_FILE_NAME;
+    _logSize = 0;
+    if (access(logPath.c_str(), F_OK) == 0 && !replay(logPath, _pairs, _logSize)) {
+        LOG(WARNING) << "Drop the incomplete batch at the end of the log " << logPath << " (valid length = " << _logSize << ")";
+    }
+
+    _logFd = ::open(logPath.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (_logFd == -1 || ftruncate(_logFd, _logSize) != 0 || lseek(_logFd, _logSize, SEEK_SET) == (off_t) -1) {
+        LOG(ERROR) << "Failed to open the log " << logPath << " of the local key-value store, " << strerror(errno);
+        if (_logFd != -1)
+            ::close(_logFd);
+        _logFd = -1;
+        _pairs.clear();
+        unlockDir();
+        return false;
+    }
+
+    // compact in background, starting with the log set aside in the last run (if any)
+    _running = true;
+    _compactionPending = _hasOldLog;
+    if (pthread_create(&_compactor, NULL, runCompaction, this) != 0) {
+        LOG(ERROR) << "Failed to start the compaction thread of the local key-value store";
+        _running = false;
+        ::close(_logFd);
+        _logFd = -1;
+        _pairs.clear();
+        unlockDir();
+        return false;
+    }
+
+    LOG(INFO) << "Local key-value store at " << _dir << " opened with " << _pairs.size() << " pairs (snapshot = " << _snapshotSize << " bytes, log = " << (_logSize + oldLogSize) << " bytes)";
+
+    return true;
+}
+
+void LocalKVStore::close() {
+    // stop the background compaction, after any compaction in progress completes
+    _compactorLock.lock();
+    bool running = _running;
+    _running = false;
+    _compactorLock.unlock();
+    if (running) {
+        _compactionRequested.notify_all();
+        pthread_join(_compactor, NULL);
+    }
+
+    std::lock_guard<std::mutex> lk(_logLock);
+    if (_logFd == -1)
+        return;
+    fdatasync(_logFd);
+    ::close(_logFd);
+    _logFd = -1;
+    unlockDir();
+}
+
+void LocalKVStore::unlockDir() {
+    // closing the directory releases the lock
+    if (_dirFd != -1)
+        ::close(_dirFd);
+    _dirFd = -1;
+}
+
+bool LocalKVStore::get(const std::string &key, std::string &value) const {
+    std::shared_lock<std::shared_mutex> lk(_pairsLock);
+    auto it = _pairs.find(key);
+    if (it == _pairs.end())
+        return false;
+    value = it->second;
+    return true;
+}
+
+bool LocalKVStore::exists(const std::string &key) const {
+    std::shared_lock<std::shared_mutex> lk(_pairsLock);
+    return _pairs.count(key) > 0;
+}
+
+size_t LocalKVStore::scan(const std::string &prefix, const std::string &startAfter, size_t limit, std::vector<std::pair<std::string, std::string> > &pairs, bool keysOnly) const {
+    std::shared_lock<std::shared_mutex> lk(_pairsLock);
+    auto it = startAfter < prefix ? _pairs.lower_bound(prefix) : _pairs.upper_bound(startAfter);
+    size_t num = 0;
+    for (; it != _pairs.end() && (limit == 0 || num < limit); it++, num++) {
+        if (it->first.compare(0, prefix.size(), prefix) != 0)
+            break;
+        pairs.emplace_back(it->first, keysOnly ? std::string() : it->second);
+    }
+    return num;
+}
+
+size_t LocalKVStore::count(const std::string &prefix) const {
+    std::shared_lock<std::shared_mutex> lk(_pairsLock);
+    size_t num = 0;
+    for (auto it = _pairs.lower_bound(prefix); it != _pairs.end() && it->first.compare(0, prefix.size(), prefix) == 0; it++)
+        num++;
+    return num;
+}
+
+bool LocalKVStore::write(const WriteBatch &batch) {
+    if (batch.empty())
+        return true;
+
+    std::string payload;
+    for (const WriteBatch::Op &op : batch._ops)
+        encodeOp(op.isDelete, op.key, op.value, payload);
+
+    std::lock_guard<std::mutex> lk(_logLock);
+
+    if (_logFd == -1) {
+        LOG(ERROR) << "Local key-value store is not opened";
+        return false;
+    }
+
+    // log the batch before applying it
+    if (!writeRecord(_logFd, payload) || (_syncWrites && fdatasync(_logFd) != 0)) {
+        LOG(ERROR) << "Failed to append a batch of " << batch._ops.size() << " changes to the log of the local key-value store, " << strerror(errno);
+        // drop the partially written record, so that later batches are not logged after it
+        if (ftruncate(_logFd, _logSize) != 0 || lseek(_logFd, _logSize, SEEK_SET) == (off_t) -1) {
+            LOG(ERROR) << "Failed to roll back the log of the local key-value store, " << strerror(errno);
+        }
+        return false;
+    }
+    _logSize += RECORD_HEADER_SIZE + payload.size();
+
+    {
+        std::unique_lock<std::shared_mutex> plk(_pairsLock);
+        for (const WriteBatch::Op &op : batch._ops) {
+            if (op.isDelete)
+                _pairs.erase(op.key);
+            else
+                _pairs[op.key] = op.value;
+        }
+    }
+
+    // set the log aside for compaction in background, instead of compacting on the write path
+    if (!_hasOldLog && _logSize > LOCAL_KV_STORE_MIN_COMPACTION_SIZE && _logSize > _snapshotSize && swapLog()) {
+        _compactorLock.lock();
+        _compactionPending = true;
+        _compactorLock.unlock();
+        _compactionRequested.notify_one();
+    }
+
+    return true;
+}
+
+bool LocalKVStore::compact() {
+    std::lock_guard<std::mutex> clk(_compactionLock);
+
+    // complete the compaction of the log set aside before (if any), and then compact the current log
+    if (!compactOldLog())
+        return false;
+    {
+        std::lock_guard<std::mutex> lk(_logLock);
+        if (_logFd == -1 || !swapLog())
+            return false;
+    }
+    return compactOldLog();
+}
+
+bool LocalKVStore::swapLog() {
+    if (_hasOldLog)
+        return true;
+
+    std::string logPath = _dir + "/" LOG_FILE_NAME;
+    std::string oldLogPath = _dir + "/" OLD_LOG_FILE_NAME;
+
+    // flush the batches before setting the log aside, as the new snapshot is built from the files
+    if (fdatasync(_logFd) != 0 || rename(logPath.c_str(), oldLogPath.c_str()) != 0) {
+        LOG(ERROR) << "Failed to set the log of the local key-value store aside for compaction, " << strerror(errno);
+        return false;
+    }
+    int fd = ::open(logPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        LOG(ERROR) << "Failed to create a new log " << logPath << " of the local key-value store, " << strerror(errno);
+        // continue with the current log
+        if (rename(oldLogPath.c_str(), logPath.c_str()) != 0)
+            LOG(ERROR) << "Failed to restore the log " << logPath << " of the local key-value store, " << strerror(errno);
+        return false;
+    }
+    syncDir(_dir);
+
+    ::close(_logFd);
+    _logFd = fd;
+    _logSize = 0;
+    _hasOldLog = true;
+
+    return true;
+}
+
+bool LocalKVStore::compactOldLog() {
+    {
+        std::lock_guard<std::mutex> lk(_logLock);
+        if (!_hasOldLog)
+            return true;
+    }
+
+    std::string snapshotPath = _dir + "/" SNAPSHOT_FILE_NAME;
+    std::string oldLogPath = _dir + "/" OLD_LOG_FILE_NAME;
+    std::string tmpPath = snapshotPath + ".tmp";
+
+    // rebuild the pairs as of the log set aside from the files, without blocking reads and writes on the pairs in memory
+    std::map<std::string, std::string> pairs;
+    size_t length = 0;
+    if (access(snapshotPath.c_str(), F_OK) == 0 && !replay(snapshotPath, pairs, length)) {
+        LOG(ERROR) << "Snapshot " << snapshotPath << " of the local key-value store is corrupted, skip compaction";
+        return false;
+    }
+    if (!replay(oldLogPath, pairs, length)) {
+        LOG(WARNING) << "Drop the incomplete batch at the end of the log " << oldLogPath << " (valid length = " << length << ") in compaction";
+    }
+    size_t oldLogSize = length;
+
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        LOG(ERROR) << "Failed to create a new snapshot " << tmpPath << " of the local key-value store, " << strerror(errno);
+        return false;
+    }
+
+    // write all pairs in records of bounded size
+    bool okay = true;
+    size_t size = 0;
+    std::string payload;
+    for (auto it = pairs.begin(); okay && it != pairs.end(); it++) {
+        encodeOp(false, it->first, it->second, payload);
+        if (payload.size() >= MAX_SNAPSHOT_RECORD_SIZE) {
+            okay = writeRecord(fd, payload);
+            size += RECORD_HEADER_SIZE + payload.size();
+            payload.clear();
+        }
+    }
+    if (okay && !payload.empty()) {
+        okay = writeRecord(fd, payload);
+        size += RECORD_HEADER_SIZE + payload.size();
+    }
+    okay = okay && fsync(fd) == 0;
+    ::close(fd);
+
+    // replace the snapshot, and then remove the log set aside; replaying the log over the new snapshot (upon failure in between) is harmless
+    okay = okay && rename(tmpPath.c_str(), snapshotPath.c_str()) == 0;
+    if (!okay) {
+        LOG(ERROR) << "Failed to write a new snapshot of the local key-value store, " << strerror(errno);
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    syncDir(_dir);
+
+    {
+        std::lock_guard<std::mutex> lk(_logLock);
+        if (unlink(oldLogPath.c_str()) != 0) {
+            LOG(ERROR) << "Failed to remove the log " << oldLogPath << " of the local key-value store after compaction, " << strerror(errno);
+            return false;
+        }
+        _hasOldLog = false;
+        _snapshotSize = size;
+    }
+
+    LOG(INFO) << "Compacted the log of the local key-value store (" << oldLogSize << " bytes) into a snapshot of " << size << " bytes";
+
+    return true;
+}
+
+void *LocalKVStore::runCompaction(void *arg) {
+    LocalKVStore *self = (LocalKVStore *) arg;
+
+    std::unique_lock<std::mutex> lk(self->_compactorLock);
+    while (true) {
+        self->_compactionRequested.wait(lk, [self] { return !self->_running || self->_compactionPending; });
+        if (!self->_running)
+            break;
+        self->_compactionPending = false;
+        lk.unlock();
+        {
+            std::lock_guard<std::mutex> clk(self->_compactionLock);
+            self->compactOldLog();
+        }
+        lk.lock();
+    }
+
+    return NULL;
+}
+
+void LocalKVStore::syncDir(const std::string &dir) {
+    int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dfd != -1) {
+        fsync(dfd);
+        ::close(dfd);
+    }
+}
+
+bool LocalKVStore::replay(const std::string &path, std::map<std::string, std::string> &pairs, size_t &validLength) {
+    validLength = 0;
+
+    FILE *f = fopen(path.c_str(), "rb");
+    if (f == NULL) {
+        LOG(ERROR) << "Failed to open " << path << ", " << strerror(errno);
+        return false;
+    }
+    struct stat sbuf;
+    if (fstat(fileno(f), &sbuf) != 0) {
+        LOG(ERROR) << "Failed to get the size of " << path << ", " << strerror(errno);
+        fclose(f);
+        return false;
+    }
+    size_t fileSize = sbuf.st_size;
+
+    bool okay = true;
+    std::string payload;
+    while (true) {
+        uint32_t header[2];
+        size_t numRead = fread(header, 1, RECORD_HEADER_SIZE, f);
+        if (numRead == 0 && feof(f))
+            break;
+        if (numRead != RECORD_HEADER_SIZE) {
+            okay = false;
+            break;
+        }
+        // stop at a (corrupted) length beyond the end of file, before allocating for it
+        if (header[0] > fileSize - validLength - RECORD_HEADER_SIZE) {
+            okay = false;
+            break;
+        }
+        payload.resize(header[0]);
+        if (fread(&payload[0], 1, header[0], f) != header[0] || checksum(payload.data(), payload.size()) != header[1] || !applyPayload(payload.data(), payload.size(), pairs)) {
+            okay = false;
+            break;
+        }
+        validLength += RECORD_HEADER_SIZE + header[0];
+    }
+
+    fclose(f);
+    return okay;
+}
+
+void LocalKVStore::encodeOp(bool isDelete, const std::string &key, const std::string &value, std::string &payload) {
+    uint8_t type = isDelete ? KV_OP_DELETE : KV_OP_PUT;
+    uint32_t length = key.size();
+    payload.append((const char *) &type, sizeof(type));
+    payload.append((const char *) &length, sizeof(length)).append(key);
+    if (isDelete)
+        return;
+    length = value.size();
+    payload.append((const char *) &length, sizeof(length)).append(value);
+}
+
+bool LocalKVStore::applyPayload(const char *payload, size_t length, std::map<std::string, std::string> &pairs) {
+    // parse the whole payload before applying any change
+    std::vector<WriteBatch::Op> ops;
+    size_t ofs = 0;
+    while (ofs < length) {
+        uint8_t type;
+        uint32_t keyLength, valueLength = 0;
+        if (ofs + sizeof(type) + sizeof(keyLength) > length)
+            return false;
+        memcpy(&type, payload + ofs, sizeof(type));
+        memcpy(&keyLength, payload + ofs + sizeof(type), sizeof(keyLength));
+        ofs += sizeof(type) + sizeof(keyLength);
+        if (type > KV_OP_DELETE || ofs + keyLength > length)
+            return false;
+        size_t keyOfs = ofs;
+        ofs += keyLength;
+        if (type == KV_OP_PUT) {
+            if (ofs + sizeof(valueLength) > length)
+                return false;
+            memcpy(&valueLength, payload + ofs, sizeof(valueLength));
+            ofs += sizeof(valueLength);
+            if (ofs + valueLength > length)
+                return false;
+        }
+        ops.push_back({type == KV_OP_DELETE, std::string(payload + keyOfs, keyLength), std::string(payload + ofs, valueLength)});
+        ofs += valueLength;
+    }
+
+    for (WriteBatch::Op &op : ops) {
+        if (op.isDelete)
+            pairs.erase(op.key);
+        else
+            pairs[op.key] = std::move(op.value);
+    }
+    return true;
+}
+
+uint32_t LocalKVStore::checksum(const char *data, size_t length) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t) data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool LocalKVStore::writeRecord(int fd, const std::string &payload) {
+    uint32_t header[2] = { (uint32_t) payload.size(), checksum(payload.data(), payload.size()) };
+    std::string record((const char *) header, RECORD_HEADER_SIZE);
+    record.append(payload);
+    size_t ofs = 0;
+    while (ofs < record.size()) {
+        ssize_t ret = ::write(fd, record.data() + ofs, record.size() - ofs);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0)
+            return false;
+        ofs += ret;
+    }
+    return true;
+}
@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __LOCAL_KV_STORE_HH__
+#define __LOCAL_KV_STORE_HH__
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <pthread.h>
+
+#define LOCAL_KV_STORE_MIN_COMPACTION_SIZE (64 << 20)  // min. size of the log (in bytes) before it is compacted into the snapshot
+
+/**
+ * Embedded, persistent, and ordered key-value store
+ *
+ * NOTE: all pairs are kept in memory (a std::map in key order), and the files
+ * are only used for recovery, so the store is limited by the memory of the
+ * machine rather than its disk. Compaction reads the snapshot and the log
+ * into a second copy of the pairs, so reserve twice the memory of the pairs.
+ *
+ * Changes are grouped into batches, and each batch is appended to a
+ * write-ahead log as one checksummed record before it is applied, so a batch
+ * is either applied as a whole or not at all after a crash. Once the log grows
+ * larger than both the snapshot and LOCAL_KV_STORE_MIN_COMPACTION_SIZE, it is
+ * set aside for a background thread to merge into a new snapshot, and writes
+ * continue on a new log.
+ *
+ * The data directory is locked (flock) while the store is open, so it is
+ * never opened by two stores at the same time, which would overwrite the
+ * records of each other in the log.
+ *
+ * Files under the data directory
+ *   snapshot   all pairs at the last compaction
+ *   log.old    batches applied after the last compaction, which are being compacted (if exists)
+ *   log        batches applied after the last compaction, and after those in log.old
+ *
+ * Both files are sequences of records in host byte order,
+ *   uint32_t payload length, uint32_t payload checksum, payload
+ * where a payload is a sequence of operations,
+ *   uint8_t type (put or delete), uint32_t key length, key, (uint32_t value length, value)
+ **/
+class LocalKVStore {
+public:
+    /**
+     * Changes to apply atomically, in the order they are added
+     **/
+    class WriteBatch {
+    public:
+        void put(const std::string &key, const std::string &value);
+        void remove(const std::string &key);
+        bool empty() const;
+
+    private:
+        friend class LocalKVStore;
+
+        struct Op {
+            bool isDelete;
+            std::string key;
+            std::string value;
+        };
+
+        std::vector<Op> _ops;  /**< changes in the batch */
+    };
+
+    LocalKVStore();
+    ~LocalKVStore();
+
+    /**
+     * Open the store, and load the pairs from its data directory
+     *
+     * @param[in] dir           data directory, created if not exists
+     * @param[in] syncWrites    whether to flush each batch to disk before it is applied
+     *
+     * @return whether the store is opened, false if the directory is already opened by another store
+     **/
+    bool open(const std::string &dir, bool syncWrites);
+
+    /**
+     * Close the store
+     **/
+    void close();
+
+    /**
+     * Get the value of a key
+     *
+     * @param[in] key       key to get
+     * @param[out] value    value of the key
+     *
+     * @return whether the key exists
+     **/
+    bool get(const std::string &key, std::string &value) const;
+
+    /**
+     * Check if a key exists
+     *
+     * @param[in] key       key to check
+     *
+     * @return whether the key exists
+     **/
+    bool exists(const std::string &key) const;
+
+    /**
+     * Get the pairs with keys beginning with a prefix, in key order
+     *
+     * @param[in] prefix        prefix of the keys
+     * @param[in] startAfter    key to start after (exclusive), empty to start from the first key with the prefix
+     * @param[in] limit         max. number of pairs to get, 0 for no limit
+     * @param[out] pairs        pairs found, appended in key order
+     * @param[in] keysOnly      whether to skip copying the values
+     *
+     * @return number of pairs found
+     **/
+    size_t scan(const std::string &prefix, const std::string &startAfter, size_t limit, std::vector<std::pair<std::string, std::string> > &pairs, bool keysOnly = false) const;
+
+    /**
+     * Count the keys beginning with a prefix
+     *
+     * @param[in] prefix        prefix of the keys
+     *
+     * @return number of keys
+     **/
+    size_t count(const std::string &prefix) const;
+
+    /**
+     * Apply a batch of changes
+     *
+     * @param[in] batch     changes to apply
+     *
+     * @return whether the changes are logged and applied
+     **/
+    bool write(const WriteBatch &batch);
+
+    /**
+     * Compact the log into a new snapshot, and wait for the compaction to complete
+     *
+     * @return whether the compaction succeeded
+     **/
+    bool compact();
+
+private:
+    /**
+     * Apply the records in a file to a set of pairs
+     *
+     * @param[in] path      path of the file
+     * @param[in,out] pairs pairs to apply the records to
+     * @param[out] validLength length of the valid records at the beginning of the file
+     *
+     * @return whether all records in the file are valid
+     **/
+    static bool replay(const std::string &path, std::map<std::string, std::string> &pairs, size_t &validLength);
+
+    /**
+     * Set the log aside for compaction, and start a new log
+     *
+     * @return whether the log is set aside, or there is already one set aside
+     *
+     * @remark _logLock must be held
+     **/
+    bool swapLog();
+
+    /**
+     * Merge the snapshot and the log set aside into a new snapshot
+     *
+     * @return whether the compaction succeeded, or there is no log set aside
+     *
+     * @remark _compactionLock must be held
+     **/
+    bool compactOldLog();
+
+    /**
+     * Release the lock on the data directory
+     *
+     * @remark _logLock must be held
+     **/
+    void unlockDir();
+
+    static void *runCompaction(void *arg);
+    static void syncDir(const std::string &dir);
+
+    static void encodeOp(bool isDelete, const std::string &key, const std::string &value, std::string &payload);
+    static bool applyPayload(const char *payload, size_t length, std::map<std::string, std::string> &pairs);
+    static uint32_t checksum(const char *data, size_t length);
+    static bool writeRecord(int fd, const std::string &payload);
+
+    std::string _dir;                                   /**< data directory */
+    int _dirFd;                                         /**< file descriptor of the data directory, locked while the store is open, -1 if not opened */
+    bool _syncWrites;                                   /**< whether to flush each batch to disk before it is applied */
+
+    std::map<std::string, std::string> _pairs;          /**< all pairs */
+    mutable std::shared_mutex _pairsLock;               /**< lock on the pairs */
+
+    std::mutex _logLock;                                /**< lock on the log, held by writers throughout a write */
+    int _logFd;                                         /**< file descriptor of the log, -1 if not opened */
+    size_t _logSize;                                    /**< size of the log */
+    size_t _snapshotSize;                               /**< size of the snapshot */
+    bool _hasOldLog;                                    /**< whether a log is set aside for compaction */
+
+    std::mutex _compactionLock;                         /**< lock held throughout a compaction, always taken before _logLock */
+    std::mutex _compactorLock;                          /**< lock on the states of the background compaction thread below */
+    std::condition_variable _compactionRequested;       /**< signal on a log set aside, or on close */
+    bool _compactionPending;                            /**< whether a background compaction is requested */
+    bool _running;                                      /**< whether the background compaction thread is running */
+    pthread_t _compactor;                               /**< background compaction thread */
+};
+
+#endif // define __LOCAL_KV_STORE_HH__
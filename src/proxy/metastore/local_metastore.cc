@@ -0,0 +1,1199 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include <boost/uuid/uuid_io.hpp>
+#include <glog/logging.h>
+
+#include "../../common/config.hh"
+#include "../../common/define.hh"
+#include "file_meta_codec.hh"
+#include "local_metastore.hh"
+
+// key tags (see LocalMetaStore)
+#define FILE_TAG "f"
+#define VERSION_TAG "v"
+#define UUID_TAG "u"
+#define DIR_TAG "d"
+#define REPAIR_TAG "r"
+#define PENDING_WRITE_TAG "p"
+#define PENDING_WRITE_COMP_TAG "q"
+#define BG_TASK_TAG "t"
+#define JOURNAL_TAG "j"
+#define JOURNAL_FILE_TAG "J"
+
+#define VERSION_SUFFIX_SIZE (1 + sizeof(uint32_t))  // '\0' and the version at the end of a versioned file key
+#define JOURNAL_SUFFIX_SIZE (sizeof(uint32_t) * 2)  // chunk id and container id at the end of a journal record key
+
+#define LOCAL_META_FORMAT_V1 (1)
+
+// offsets of the timestamps in a record (see encodeFile())
+#define RECORD_ATIME_OFFSET (sizeof(uint32_t) + sizeof(unsigned long int) + sizeof(time_t))
+#define RECORD_MTIME_OFFSET (RECORD_ATIME_OFFSET + sizeof(time_t))
+#define RECORD_TCTIME_OFFSET (RECORD_MTIME_OFFSET + sizeof(time_t))
+
+static void appendBigEndian(std::string &out, uint32_t value) {
+    for (int i = 3; i >= 0; i--)
+        out.push_back((char) ((value >> (i * 8)) & 0xff));
+}
+
+static uint32_t readBigEndian(const char *in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+        value = (value << 8) | (uint8_t) in[i];
+    return value;
+}
+
+template <typename T>
+static void appendField(std::string &out, const T &value) {
+    out.append((const char *) &value, sizeof(T));
+}
+
+static void appendBlob(std::string &out, const char *data, size_t length) {
+    appendField(out, (uint32_t) length);
+    out.append(data, length);
+}
+
+static bool setRecordField(std::string &record, size_t ofs, const void *value, size_t length) {
+    if (record.size() < ofs + length)
+        return false;
+    memcpy(&record[ofs], value, length);
+    return true;
+}
+
+/**
+ * Sequential reader of the fields in a record
+ **/
+class RecordReader {
+public:
+    RecordReader(const std::string &record) : _record(record), _ofs(0) {}
+
+    template <typename T>
+    bool read(T &value) {
+        return read(&value, sizeof(T));
+    }
+
+    bool read(void *value, size_t length) {
+        if (_ofs + length > _record.size())
+            return false;
+        memcpy(value, _record.data() + _ofs, length);
+        _ofs += length;
+        return true;
+    }
+
+    bool readBlob(const char *&data, uint32_t &length) {
+        if (!read(length) || _ofs + length > _record.size())
+            return false;
+        data = _record.data() + _ofs;
+        _ofs += length;
+        return true;
+    }
+
+    bool readString(std::string &value) {
+        const char *data = 0;
+        uint32_t length = 0;
+        if (!readBlob(data, length))
+            return false;
+        value.assign(data, length);
+        return true;
+    }
+
+private:
+    const std::string &_record;
+    size_t _ofs;
+};
+
+/**
+ * Journal record of a chunk
+ **/
+struct JournalRecord {
+    int size;
+    unsigned char md5[MD5_DIGEST_LENGTH];
+    uint8_t isWrite;
+    uint8_t isPre;
+};
+
+std::mutex LocalMetaStore::_sharedStatesLock;
+std::map<std::string, LocalMetaStore::SharedState*> LocalMetaStore::_sharedStates;
+
+LocalMetaStore::LocalMetaStore() :
+        _path(Config::getInstance().getProxyMetaStorePath()),
+        _shared(acquireSharedState(_path)),
+        _store(_shared->store),
+        _lock(_shared->lock),
+        _fileLocksLock(_shared->fileLocksLock),
+        _fileLockReleased(_shared->fileLockReleased),
+        _lockedFiles(_shared->lockedFiles),
+        _scanLock(_shared->scanLock),
+        _taskScanIt(_shared->taskScanIt),
+        _pendingWriteScan(_shared->pendingWriteScan),
+        _endOfPendingWriteSet(_shared->endOfPendingWriteSet) {
+}
+
+LocalMetaStore::~LocalMetaStore() {
+    releaseSharedState(_path);
+}
+
+LocalMetaStore::SharedState *LocalMetaStore::acquireSharedState(const std::string &path) {
+    std::lock_guard<std::mutex> lk(_sharedStatesLock);
+    SharedState *&shared = _sharedStates[path];
+    if (shared == NULL) {
+        Config &config = Config::getInstance();
+        shared = new SharedState();
+        if (!shared->store.open(path, config.syncMetaStoreWrites())) {
+            LOG(ERROR) << "Failed to open the local metastore at " << path;
+            exit(1);
+        }
+        LOG(INFO) << "Local metastore init at " << path << " (sync writes = " << config.syncMetaStoreWrites() << ")";
+    }
+    shared->numRefs++;
+    return shared;
+}
+
+void LocalMetaStore::releaseSharedState(const std::string &path) {
+    std::lock_guard<std::mutex> lk(_sharedStatesLock);
+    auto it = _sharedStates.find(path);
+    if (it == _sharedStates.end() || --it->second->numRefs > 0)
+        return;
+    // close the store before another instance may open it again
+    it->second->store.close();
+    delete it->second;
+    _sharedStates.erase(it);
+}
+
+bool LocalMetaStore::putMeta(const File &f) {
+    std::lock_guard<std::mutex> lk(_lock);
+    LocalKVStore::WriteBatch batch;
+    return putMeta(f, batch) && _store.write(batch);
+}
+
+bool LocalMetaStore::putMeta(const File &f, LocalKVStore::WriteBatch &batch) {
+    std::string fkey = genFileKey(f.namespaceId, f.name, f.nameLength);
+
+    // find the current version
+    std::string current;
+    FileInfo info;
+    bool exists = _store.get(FILE_TAG + fkey, current) && decodeFileInfo(current, info);
+    int curVersion = exists ? info.version : -1;
+
+    std::string record;
+    encodeFile(f, record);
+
+    bool keepVersion = !Config::getInstance().overwriteFiles();
+    if (keepVersion && exists && f.version > curVersion) {
+        // backup the metadata of the current version as the previous version
+        batch.put(VERSION_TAG + genVersionedFileKey(f.namespaceId, f.name, f.nameLength, f.version - 1), current);
+        batch.put(FILE_TAG + fkey, record);
+    } else if (keepVersion && exists && f.version < curVersion) {
+        // operate on previous versions, only if the version exists
+        std::string vkey = VERSION_TAG + genVersionedFileKey(f.namespaceId, f.name, f.nameLength, f.version);
+        if (!_store.exists(vkey)) {
+            LOG(ERROR) << "Failed to find the previous version " << f.version << " record for file " << f.name;
+            return false;
+        }
+        batch.put(vkey, record);
+    } else {
+        batch.put(FILE_TAG + fkey, record);
+    }
+
+    // add uuid-to-file-name mapping
+    batch.put(UUID_TAG + genFileUuidKey(f.namespaceId, f.uuid), std::string(f.name, f.nameLength));
+    // add the file to its directory
+    if (!exists)
+        addToDirectory(fkey, 1, batch);
+
+    return true;
+}
+
+bool LocalMetaStore::getMeta(File &f, int getBlocks) {
+    std::string record;
+    bool found = _store.get(FILE_TAG + genFileKey(f.namespaceId, f.name, f.nameLength), record);
+
+    // find the metadata using the versioned key if the version is not the current one
+    if (f.version != -1) {
+        FileInfo info;
+        if (!found || !decodeFileInfo(record, info) || info.version != f.version)
+            found = _store.get(VERSION_TAG + genVersionedFileKey(f.namespaceId, f.name, f.nameLength, f.version), record);
+    }
+
+    if (!found) {
+        LOG(INFO) << "Metadata not found (file not exist?), file [" << f.name << "] version " << f.version;
+        return false;
+    }
+
+    if (!decodeFile(record, f, getBlocks)) {
+        LOG(ERROR) << "Failed to parse the metadata of file " << f.name;
+        return false;
+    }
+
+    return true;
+}
+
+int LocalMetaStore::getMetaBatch(int numFiles, File files[], bool found[], int getBlocks) {
+    // the metadata is read from memory, so there is no round trip to save
+    int numFound = 0;
+    for (int i = 0; i < numFiles; i++) {
+        found[i] = getMeta(files[i], getBlocks);
+        if (found[i])
+            numFound++;
+    }
+    return numFound;
+}
+
+bool LocalMetaStore::deleteMeta(File &f) {
+    std::lock_guard<std::mutex> lk(_lock);
+
+    int versionToDelete = f.version;
+    bool isVersioned = !Config::getInstance().overwriteFiles();
+
+    DLOG(INFO) << "Delete file " << f.name << " version " << f.version;
+
+    if (!getMeta(f)) {
+        LOG(WARNING) << "Deleting a non-existing file " << f.name;
+        return false;
+    }
+
+    LocalKVStore::WriteBatch batch;
+
+    // versioning enabled and version not specified, add a delete marker
+    if (isVersioned && versionToDelete == -1) {
+        f.isDeleted = true;
+        f.size = 0;
+        f.version += 1;
+        f.numChunks = 0;
+        f.numStripes = 0;
+        f.mtime = time(NULL);
+        memset(f.md5, 0, MD5_DIGEST_LENGTH);
+        bool ret = putMeta(f, batch) && _store.write(batch);
+        // tell the caller not to remove the data
+        f.version = -1;
+        return ret;
+    }
+
+    std::string fkey = genFileKey(f.namespaceId, f.name, f.nameLength);
+
+    // delete a specific version
+    if (isVersioned && versionToDelete != -1) {
+        std::string current;
+        FileInfo info;
+        if (!_store.get(FILE_TAG + fkey, current) || !decodeFileInfo(current, info)) {
+            LOG(ERROR) << "Failed to find current version number of file " << f.name << " with previous version " << f.version;
+            return false;
+        }
+        std::vector<std::pair<std::string, std::string> > versions;
+        _store.scan(std::string(VERSION_TAG).append(fkey).append(1, '\0'), "", 0, versions);
+        if (info.version == f.version) {
+            // replace the current version with the latest previous version, if any
+            if (!versions.empty()) {
+                batch.put(FILE_TAG + fkey, versions.back().second);
+                batch.remove(versions.back().first);
+                DLOG(INFO) << "Update the current version of file " << f.name << " to " << readBigEndian(versions.back().first.data() + versions.back().first.size() - sizeof(uint32_t));
+                return _store.write(batch);
+            }
+        } else if (versions.empty()) {
+            // no previous versions to operate on
+            return false;
+        } else {
+            // let the caller handle the data (deletion)
+            batch.remove(VERSION_TAG + genVersionedFileKey(f.namespaceId, f.name, f.nameLength, f.version));
+            return _store.write(batch);
+        }
+    }
+
+    // remove the reverse mapping of the uuid stored with the current version, which follows the file name on rename
+    std::string current;
+    File cf;
+    cf.namespaceId = f.namespaceId;
+    if (!_store.get(FILE_TAG + fkey, current) || !decodeFile(current, cf, /* no blocks */ 0)) {
+        LOG(ERROR) << "Failed to delete file metadata of file " << f.name;
+        return false;
+    }
+    batch.remove(FILE_TAG + fkey);
+    batch.remove(UUID_TAG + genFileUuidKey(cf.namespaceId, cf.uuid));
+
+    // remove the file from its directory
+    addToDirectory(fkey, -1, batch);
+
+    return _store.write(batch);
+}
+
+bool LocalMetaStore::renameMeta(File &sf, File &df) {
+    std::string sfkey = genFileKey(sf.namespaceId, sf.name, sf.nameLength);
+    std::string dfkey = genFileKey(df.namespaceId, df.name, df.nameLength);
+    sf.genUUID();
+    df.genUUID();
+
+    std::lock_guard<std::mutex> lk(_lock);
+
+    std::string record;
+    bool exists = _store.get(FILE_TAG + sfkey, record);
+    if (!exists || _store.exists(FILE_TAG + dfkey)) {
+        LOG(ERROR) << "Failed to rename file from " << sf.name << " (" << (int) sf.namespaceId << ") to " << df.name << " (" << (int) df.namespaceId << "), " << (!exists ? "source file not found" : "target name already exists");
+        return false;
+    }
+
+    // the uuid of the file follows its new name
+    File f;
+    f.namespaceId = sf.namespaceId;
+    if (!decodeFile(record, f, /* all blocks */ 3)) {
+        LOG(ERROR) << "Failed to parse the metadata of file " << sf.name << " for rename";
+        return false;
+    }
+    f.uuid = df.uuid;
+    record.clear();
+    encodeFile(f, record);
+
+    // only the current version is renamed, as in the Redis metadata store
+    LocalKVStore::WriteBatch batch;
+    batch.remove(FILE_TAG + sfkey);
+    batch.put(FILE_TAG + dfkey, record);
+    batch.remove(UUID_TAG + genFileUuidKey(sf.namespaceId, sf.uuid));
+    batch.put(UUID_TAG + genFileUuidKey(df.namespaceId, df.uuid), std::string(df.name, df.nameLength));
+    if (getFilePrefix(sfkey) != getFilePrefix(dfkey)) {
+        addToDirectory(sfkey, -1, batch);
+        addToDirectory(dfkey, 1, batch);
+    }
+
+    // move the number of pending background tasks along with the file
+    std::string numTasks;
+    if (_store.get(BG_TASK_TAG + sfkey, numTasks)) {
+        batch.remove(BG_TASK_TAG + sfkey);
+        batch.put(BG_TASK_TAG + dfkey, numTasks);
+    }
+
+    return _store.write(batch);
+}
+
+bool LocalMetaStore::updateTimestamps(const File &f) {
+    std::lock_guard<std::mutex> lk(_lock);
+
+    std::string fkey = FILE_TAG + genFileKey(f.namespaceId, f.name, f.nameLength);
+    std::string record;
+    // update the timestamps in place, without parsing the rest of the metadata
+    if (
+        !_store.get(fkey, record)
+        || !setRecordField(record, RECORD_ATIME_OFFSET, &f.atime, sizeof(time_t))
+        || !setRecordField(record, RECORD_MTIME_OFFSET, &f.mtime, sizeof(time_t))
+        || !setRecordField(record, RECORD_TCTIME_OFFSET, &f.tctime, sizeof(time_t))
+    ) {
+        LOG(ERROR) << "Failed to update timestamps of file " << f.name << " (" << (int) f.namespaceId << "), file not found";
+        return false;
+    }
+
+    LocalKVStore::WriteBatch batch;
+    batch.put(fkey, record);
+    return _store.write(batch);
+}
+
+int LocalMetaStore::updateChunks(const File &f, int version) {
+    if (f.numChunks <= 0)
+        return 0;
+
+    std::lock_guard<std::mutex> lk(_lock);
+
+    std::string fkey = FILE_TAG + genFileKey(f.namespaceId, f.name, f.nameLength);
+    std::string record;
+    File cur;
+    cur.namespaceId = f.namespaceId;
+    if (!_store.get(fkey, record) || !decodeFile(record, cur, /* all blocks */ 3)) {
+        LOG(ERROR) << "Failed to operate on metadata of file " << f.name << " in background, file not found";
+        return 2;
+    }
+    if (cur.version != f.version) {
+        LOG(ERROR) << "Failed to operate on metadata of file " << f.name << " in background, version " << f.version << " is outdated (current = " << cur.version << ")";
+        return 1;
+    }
+
+    for (int i = 0; i < f.numChunks; i++) {
+        int chunkId = f.chunks[i].getChunkId();
+        if (chunkId < 0 || chunkId >= cur.numChunks)
+            continue;
+        cur.containerIds[chunkId] = f.containerIds[i];
+        cur.chunks[chunkId].size = f.chunks[i].size;
+    }
+    DLOG(INFO) << "Update " << f.numChunks << " chunks of file " << f.name;
+
+    record.clear();
+    encodeFile(cur, record);
+    LocalKVStore::WriteBatch batch;
+    batch.put(fkey, record);
+    return _store.write(batch) ? 0 : 2;
+}
+
+bool LocalMetaStore::getFileName(boost::uuids::uuid fuuid, File &f) {
+    std::string name;
+    if (!_store.get(UUID_TAG + genFileUuidKey(f.namespaceId, fuuid), name)) {
+        LOG(ERROR) << "Failed to get file name of " << boost::uuids::to_string(fuuid);
+        return false;
+    }
+    f.nameLength = name.size();
+    f.name = (char *) malloc(name.size() + 1);
+    memcpy(f.name, name.data(), name.size());
+    f.name[name.size()] = 0;
+    return true;
+}
+
+unsigned int LocalMetaStore::getFileList(FileInfo **list, unsigned char namespaceId, bool withSize, bool withTime, bool withVersions, std::string prefix) {
+    if (namespaceId == INVALID_NAMESPACE_ID)
+        namespaceId = Config::getInstance().getProxyNamespaceId();
+
+    std::string dir;
+    std::string scanPrefix = getFileListScanPrefix(namespaceId, prefix, dir);
+    std::vector<std::pair<std::string, std::string> > records;
+    if (_store.scan(scanPrefix, "", 0, records) == 0)
+        return 0;
+
+    *list = new FileInfo[records.size()];
+    return getFileInfo(records, dir, *list, withVersions);
+}
+
+unsigned int LocalMetaStore::getFileListPage(FileInfo **list, std::string &cursor, unsigned int pageSize, unsigned char namespaceId, bool withSize, bool withTime, bool withVersions, std::string prefix) {
+    if (namespaceId == INVALID_NAMESPACE_ID)
+        namespaceId = Config::getInstance().getProxyNamespaceId();
+    if (pageSize == 0)
+        pageSize = DEFAULT_FILE_LIST_PAGE_SIZE;
+    pageSize = std::min(pageSize, MAX_FILE_LIST_PAGE_SIZE);
+
+    std::string dir;
+    std::string scanPrefix = getFileListScanPrefix(namespaceId, prefix, dir);
+
+    // the continuation token is the key of the last file scanned, which is empty at both the start and the end of a scan
+    std::string startAfter;
+    if (!cursor.empty()) {
+        startAfter = FILE_TAG + cursor;
+        if (startAfter.compare(0, scanPrefix.size(), scanPrefix) != 0) {
+            LOG(WARNING) << "Invalid cursor " << cursor << " for listing files";
+            cursor.clear();
+            return 0;
+        }
+    }
+
+    std::vector<std::pair<std::string, std::string> > records;
+    size_t numScanned = _store.scan(scanPrefix, startAfter, pageSize, records);
+    cursor = numScanned < pageSize ? "" : records.back().first.substr(strlen(FILE_TAG));
+
+    if (records.empty())
+        return 0;
+
+    *list = new FileInfo[records.size()];
+    return getFileInfo(records, dir, *list, withVersions);
+}
+
+unsigned int LocalMetaStore::getFolderList(std::vector<std::string> &list, unsigned char namespaceId, std::string prefix, bool skipSubfolders) {
+    if (namespaceId == INVALID_NAMESPACE_ID)
+        namespaceId = Config::getInstance().getProxyNamespaceId();
+
+    // generate the prefix for directory searching
+    prefix.append("a");
+    std::string pattern = getFilePrefix(genFileKey(namespaceId, prefix.c_str(), prefix.size()), /* no ending slash */ true);
+
+    std::vector<std::pair<std::string, std::string> > dirs;
+    _store.scan(DIR_TAG + pattern, "", 0, dirs, /* keys only */ true);
+
+    unsigned int count = 0;
+    size_t ofs = strlen(DIR_TAG) + pattern.size();
+    for (size_t i = 0; i < dirs.size(); i++) {
+        // skip subfolders
+        if (skipSubfolders && dirs.at(i).first.find('/', ofs) != std::string::npos)
+            continue;
+        list.push_back(dirs.at(i).first.substr(ofs));
+        count++;
+    }
+
+    return count;
+}
+
+unsigned long int LocalMetaStore::getMaxNumKeysSupported() {
+    // bounded by the memory available in practice
+    return (unsigned long int) 1 << 32;
+}
+
+unsigned long int LocalMetaStore::getNumFiles() {
+    return _store.count(FILE_TAG);
+}
+
+unsigned long int LocalMetaStore::getNumFilesToRepair() {
+    return _store.count(REPAIR_TAG);
+}
+
+int LocalMetaStore::getFilesToRepair(int numFiles, File files[]) {
+    if (numFiles <= 0)
+        return 0;
+
+    std::lock_guard<std::mutex> lk(_lock);
+
+    // pop files to repair
+    std::vector<std::pair<std::string, std::string> > keys;
+    _store.scan(REPAIR_TAG, "", numFiles, keys, /* keys only */ true);
+
+    int numFilesToRepair = 0;
+    LocalKVStore::WriteBatch batch;
+    for (size_t i = 0; i < keys.size(); i++) {
+        File &f = files[numFilesToRepair];
+        free(f.name);
+        f.name = 0;
+        if (!getNameFromFileKey(keys.at(i).first, strlen(REPAIR_TAG), /* versioned */ true, &f.name, f.nameLength, f.namespaceId, &f.version))
+            break;
+        batch.remove(keys.at(i).first);
+        numFilesToRepair++;
+    }
+
+    if (!_store.write(batch)) {
+        LOG(ERROR) << "Failed to get files to repair";
+        return 0;
+    }
+
+    return numFilesToRepair;
+}
+
+bool LocalMetaStore::markFileAsNeedsRepair(const File &file) {
+    return markFileStatus(file, REPAIR_TAG, true);
+}
+
+bool LocalMetaStore::markFilesAsNeedsRepair(int numFiles, const File files[]) {
+    return markFilesStatus(numFiles, files, REPAIR_TAG, true);
+}
+
+bool LocalMetaStore::markFileAsRepaired(const File &file) {
+    return markFileStatus(file, REPAIR_TAG, false);
+}
+
+bool LocalMetaStore::markFilesAsRepaired(int numFiles, const File files[]) {
+    return markFilesStatus(numFiles, files, REPAIR_TAG, false);
+}
+
+bool LocalMetaStore::markFileAsPendingWriteToCloud(const File &file) {
+    return markFileStatus(file, PENDING_WRITE_TAG, true);
+}
+
+bool LocalMetaStore::markFileAsWrittenToCloud(const File &file, bool removePending) {
+    std::string vkey = genVersionedFileKey(file.namespaceId, file.name, file.nameLength, file.version);
+    LocalKVStore::WriteBatch batch;
+    batch.remove(PENDING_WRITE_COMP_TAG + vkey);
+    if (removePending)
+        batch.remove(PENDING_WRITE_TAG + vkey);
+    return _store.write(batch);
+}
+
+bool LocalMetaStore::markFilesAsWrittenToCloud(int numFiles, const File files[], bool removePending) {
+    LocalKVStore::WriteBatch batch;
+    for (int i = 0; i < numFiles; i++) {
+        std::string vkey = genVersionedFileKey(files[i].namespaceId, files[i].name, files[i].nameLength, files[i].version);
+        batch.remove(PENDING_WRITE_COMP_TAG + vkey);
+        if (removePending)
+            batch.remove(PENDING_WRITE_TAG + vkey);
+    }
+    return batch.empty() || _store.write(batch);
+}
+
+bool LocalMetaStore::markFileStatus(const File &file, const char *tag, bool set) {
+    return markFilesStatus(1, &file, tag, set);
+}
+
+bool LocalMetaStore::markFilesStatus(int numFiles, const File files[], const char *tag, bool set) {
+    LocalKVStore::WriteBatch batch;
+    for (int i = 0; i < numFiles; i++) {
+        std::string key = tag + genVersionedFileKey(files[i].namespaceId, files[i].name, files[i].nameLength, files[i].version);
+        if (set)
+            batch.put(key, "");
+        else
+            batch.remove(key);
+    }
+    if (!batch.empty() && !_store.write(batch)) {
+        LOG(ERROR) << "Failed to " << (set ? "add" : "remove") << " " << numFiles << " files " << (set ? "to" : "from") << " the list of tag " << tag;
+        return false;
+    }
+    return true;
+}
+
+int LocalMetaStore::getFilesPendingWriteToCloud(int numFiles, File files[]) {
+    std::lock_guard<std::mutex> lk(_scanLock);
+
+    int num = 0;
+
+    if (_pendingWriteScan.empty()) {
+        // mark end of set iteration
+        if (!_endOfPendingWriteSet) {
+            _endOfPendingWriteSet = true;
+            return num;
+        }
+        // start a new scan over the files pending write
+        std::vector<std::pair<std::string, std::string> > keys;
+        _store.scan(PENDING_WRITE_TAG, "", 0, keys, /* keys only */ true);
+        for (size_t i = 0; i < keys.size(); i++)
+            _pendingWriteScan.push_back(keys.at(i).first.substr(strlen(PENDING_WRITE_TAG)));
+        if (_pendingWriteScan.empty())
+            return num;
+    }
+
+    // mark the set scanning is in-progress
+    _endOfPendingWriteSet = false;
+
+    std::lock_guard<std::mutex> mlk(_lock);
+    while (num < numFiles && !_pendingWriteScan.empty()) {
+        std::string vkey = _pendingWriteScan.front();
+        _pendingWriteScan.pop_front();
+        // mark the file as pending to complete for write, if it is still pending
+        if (!_store.exists(PENDING_WRITE_TAG + vkey))
+            continue;
+        LocalKVStore::WriteBatch batch;
+        batch.remove(PENDING_WRITE_TAG + vkey);
+        batch.put(PENDING_WRITE_COMP_TAG + vkey, "");
+        File &f = files[num];
+        if (!getNameFromFileKey(vkey, 0, /* versioned */ true, &f.name, f.nameLength, f.namespaceId, &f.version))
+            continue;
+        if (!_store.write(batch)) {
+            free(f.name);
+            f.name = 0;
+            break;
+        }
+        num++;
+    }
+
+    return num;
+}
+
+bool LocalMetaStore::updateFileStatus(const File &file) {
+    std::lock_guard<std::mutex> lk(_lock);
+
+    std::string fkey = genFileKey(file.namespaceId, file.name, file.nameLength);
+    std::string tkey = BG_TASK_TAG + fkey;
+
+    std::string value;
+    int numTasks = 0;
+    bool exists = _store.get(tkey, value) && value.size() == sizeof(int);
+    if (exists)
+        memcpy(&numTasks, value.data(), sizeof(int));
+
+    bool ret = false;
+    LocalKVStore::WriteBatch batch;
+    if (file.status == FileStatus::PART_BG_TASK_COMPLETED) {
+        // decrement number of task by 1, and remove the file if the number of pending task drops to 0
+        ret = exists;
+        if (exists && --numTasks <= 0)
+            batch.remove(tkey);
+        else if (exists)
+            batch.put(tkey, std::string((const char *) &numTasks, sizeof(int)));
+    } else if (file.status == FileStatus::BG_TASK_PENDING) {
+        // increment number of task by 1
+        ret = true;
+        numTasks++;
+        batch.put(tkey, std::string((const char *) &numTasks, sizeof(int)));
+    } else if (file.status == FileStatus::ALL_BG_TASKS_COMPLETED) {
+        ret = exists;
+        batch.remove(tkey);
+    }
+
+    // update the last task check time
+    time_t tctime = time(NULL);
+    std::string record;
+    if (_store.get(FILE_TAG + fkey, record) && setRecordField(record, RECORD_TCTIME_OFFSET, &tctime, sizeof(time_t)))
+        batch.put(FILE_TAG + fkey, record);
+
+    ret = _store.write(batch) && ret;
+
+    // report failure
+    if (ret == false) {
+        LOG(ERROR) << "Failed to update status of file " << file.name << " to " << (int) file.status;
+    }
+
+    return ret;
+}
+
+bool LocalMetaStore::getNextFileForTaskCheck(File &file) {
+    std::lock_guard<std::mutex> lk(_scanLock);
+
+    std::vector<std::pair<std::string, std::string> > keys;
+    if (_store.scan(BG_TASK_TAG, _taskScanIt, 1, keys, /* keys only */ true) == 0) {
+        // restart from the beginning in the next call
+        _taskScanIt.clear();
+        return false;
+    }
+
+    _taskScanIt = keys.at(0).first;
+    if (!getNameFromFileKey(_taskScanIt, strlen(BG_TASK_TAG), /* versioned */ false, &file.name, file.nameLength, file.namespaceId))
+        return false;
+
+    DLOG(INFO) << "Next file to check: " << file.name << ", " << (int) file.namespaceId;
+    return true;
+}
+
+bool LocalMetaStore::lockFile(const File &file) {
+    std::lock_guard<std::mutex> lk(_fileLocksLock);
+    bool locked = _lockedFiles.insert(genFileKey(file.namespaceId, file.name, file.nameLength)).second;
+    DLOG_IF(INFO, !locked) << "File " << file.name << " is already locked";
+    return locked;
+}
+
+bool LocalMetaStore::lockFile(const File &file, unsigned long int maxWaitUs) {
+    std::string key = genFileKey(file.namespaceId, file.name, file.nameLength);
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(maxWaitUs);
+
+    std::unique_lock<std::mutex> lk(_fileLocksLock);
+    bool released = _fileLockReleased.wait_until(lk, deadline, [&] { return _lockedFiles.count(key) == 0; });
+    if (!released) {
+        LOG(ERROR) << "Failed to lock file " << file.name << " after waiting for " << maxWaitUs << " us";
+        return false;
+    }
+    _lockedFiles.insert(key);
+    return true;
+}
+
+bool LocalMetaStore::unlockFile(const File &file) {
+    std::lock_guard<std::mutex> lk(_fileLocksLock);
+    if (_lockedFiles.erase(genFileKey(file.namespaceId, file.name, file.nameLength)) == 0) {
+        LOG(ERROR) << "Failed to unlock file " << file.name << ", which is not locked";
+        return false;
+    }
+    _fileLockReleased.notify_all();
+    return true;
+}
+
+bool LocalMetaStore::addChunkToJournal(const File &file, const Chunk &chunk, int containerId, bool isWrite) {
+    std::lock_guard<std::mutex> lk(_lock);
+
+    std::string vkey = genVersionedFileKey(file.namespaceId, file.name, file.nameLength, file.version);
+    std::string chunkPrefix = JOURNAL_TAG + vkey;
+    appendBigEndian(chunkPrefix, chunk.getChunkId());
+
+    // first, set all previous writes of the chunk to deletes
+    std::vector<std::pair<std::string, std::string> > records;
+    _store.scan(chunkPrefix, "", 0, records);
+
+    LocalKVStore::WriteBatch batch;
+    bool skipAdding = false;
+    for (size_t i = 0; i < records.size(); i++) {
+        std::string &value = records.at(i).second;
+        JournalRecord record;
+        if (value.size() != sizeof(JournalRecord))
+            continue;
+        memcpy(&record, value.data(), sizeof(JournalRecord));
+        if (!record.isWrite)
+            continue;
+        record.isWrite = false;
+        batch.put(records.at(i).first, std::string((const char *) &record, sizeof(JournalRecord)));
+        // skip adding a deletion if a previous write to the same container is superseded by it
+        const std::string &key = records.at(i).first;
+        if (!isWrite && (int) readBigEndian(key.data() + key.size() - sizeof(uint32_t)) == containerId)
+            skipAdding = true;
+    }
+
+    // second, set the latest record
+    if (!skipAdding) {
+        JournalRecord record;
+        record.size = chunk.size;
+        memcpy(record.md5, chunk.md5, MD5_DIGEST_LENGTH);
+        record.isWrite = isWrite;
+        record.isPre = true;
+        batch.put(genJournalKey(vkey, chunk.getChunkId(), containerId), std::string((const char *) &record, sizeof(JournalRecord)));
+        batch.put(JOURNAL_FILE_TAG + vkey, "");
+    }
+
+    if (!_store.write(batch)) {
+        LOG(ERROR) << "Failed to add the journal record of chunk " << chunk.getChunkId() << " of file " << file.name << " with namespace " << (int) file.namespaceId;
+        return false;
+    }
+    return true;
+}
+
+bool LocalMetaStore::updateChunkInJournal(const File &file, const Chunk &chunk, bool isWrite, bool deleteRecord, int containerId) {
+    std::lock_guard<std::mutex> lk(_lock);
+
+    std::string vkey = genVersionedFileKey(file.namespaceId, file.name, file.nameLength, file.version);
+    std::string key = genJournalKey(vkey, chunk.getChunkId(), containerId);
+
+    LocalKVStore::WriteBatch batch;
+    bool success = false;
+    if (deleteRecord) {
+        // delete the record; if no record is left, remove the file from the set of files with journal
+        batch.remove(key);
+        std::vector<std::pair<std::string, std::string> > records;
+        _store.scan(JOURNAL_TAG + vkey, "", 2, records, /* keys only */ true);
+        bool othersLeft = false;
+        for (size_t i = 0; i < records.size(); i++)
+            othersLeft = othersLeft || records.at(i).first != key;
+        if (!othersLeft)
+            batch.remove(JOURNAL_FILE_TAG + vkey);
+        success = true;
+    } else {
+        // update the record if it already exists
+        std::string value;
+        JournalRecord record;
+        if (_store.get(key, value) && value.size() == sizeof(JournalRecord)) {
+            memcpy(&record, value.data(), sizeof(JournalRecord));
+            record.isWrite = isWrite;
+            record.isPre = false;
+            batch.put(key, std::string((const char *) &record, sizeof(JournalRecord)));
+            success = true;
+        }
+    }
+
+    if (!success || !_store.write(batch)) {
+        LOG(ERROR) << "Failed to " << (deleteRecord ? "delete" : "update") << " the journal record of chunk " << chunk.getChunkId() << " of file " << file.name << " with namespace " << (int) file.namespaceId << " version " << file.version << " in container " << containerId;
+        return false;
+    }
+    return true;
+}
+
+void LocalMetaStore::getFileJournal(const FileInfo &file, std::vector<std::tuple<Chunk, int /* container id*/, bool /* isWrite */, bool /* isPre */>> &records) {
+    std::string vkey = genVersionedFileKey(file.namespaceId, file.name, file.nameLength, file.version);
+    std::string prefix = JOURNAL_TAG + vkey;
+
+    std::vector<std::pair<std::string, std::string> > pairs;
+    _store.scan(prefix, "", 0, pairs);
+
+    DLOG(INFO) << "File " << file.name << " version " << file.version << " in namespace " << (int) file.namespaceId << " number of chunk journal records = " << pairs.size() << ".";
+
+    for (size_t i = 0; i < pairs.size(); i++) {
+        const std::string &key = pairs.at(i).first;
+        const std::string &value = pairs.at(i).second;
+        if (key.size() != prefix.size() + JOURNAL_SUFFIX_SIZE || value.size() != sizeof(JournalRecord))
+            continue;
+        JournalRecord record;
+        memcpy(&record, value.data(), sizeof(JournalRecord));
+        records.resize(records.size() + 1);
+        auto &rec = records.back();
+        std::get<0>(rec).setChunkId((int) readBigEndian(key.data() + prefix.size()));
+        std::get<0>(rec).size = record.size;
+        memcpy(std::get<0>(rec).md5, record.md5, MD5_DIGEST_LENGTH);
+        std::get<1>(rec) = (int) readBigEndian(key.data() + prefix.size() + sizeof(uint32_t));
+        std::get<2>(rec) = record.isWrite;
+        std::get<3>(rec) = record.isPre;
+    }
+}
+
+int LocalMetaStore::getFilesWithJounal(FileInfo **list) {
+    std::vector<std::pair<std::string, std::string> > keys;
+    if (_store.scan(JOURNAL_FILE_TAG, "", 0, keys, /* keys only */ true) == 0)
+        return 0;
+
+    int numFiles = 0;
+    *list = new FileInfo[keys.size()];
+    for (size_t i = 0; i < keys.size(); i++) {
+        FileInfo *info = &(*list)[numFiles];
+        if (!getNameFromFileKey(keys.at(i).first, strlen(JOURNAL_FILE_TAG), /* versioned */ true, &info->name, info->nameLength, info->namespaceId, &info->version))
+            continue;
+        numFiles++;
+    }
+
+    return numFiles;
+}
+
+bool LocalMetaStore::fileHasJournal(const File &file) {
+    return _store.exists(JOURNAL_FILE_TAG + genVersionedFileKey(file.namespaceId, file.name, file.nameLength, file.version));
+}
+
+bool LocalMetaStore::getFileMetaCacheStats(FileMetaCacheStats &stats) {
+    return false;
+}
+
+std::string LocalMetaStore::genFileKey(unsigned char namespaceId, const char *name, int nameLength) {
+    return std::to_string(namespaceId).append("_").append(name, nameLength);
+}
+
+std::string LocalMetaStore::genVersionedFileKey(unsigned char namespaceId, const char *name, int nameLength, int version) {
+    std::string key = genFileKey(namespaceId, name, nameLength);
+    key.push_back('\0');
+    appendBigEndian(key, (uint32_t) version);
+    return key;
+}
+
+std::string LocalMetaStore::genFileUuidKey(unsigned char namespaceId, boost::uuids::uuid uuid) {
+    return std::to_string(namespaceId).append("-").append(boost::uuids::to_string(uuid));
+}
+
+std::string LocalMetaStore::genJournalKey(const std::string &vkey, int chunkId, int containerId) {
+    std::string key = JOURNAL_TAG + vkey;
+    appendBigEndian(key, (uint32_t) chunkId);
+    appendBigEndian(key, (uint32_t) containerId);
+    return key;
+}
+
+bool LocalMetaStore::getNameFromFileKey(const std::string &key, size_t ofs, bool versioned, char **name, int &nameLength, unsigned char &namespaceId, int *version) {
+    size_t end = key.size();
+    if (versioned) {
+        if (end < ofs + VERSION_SUFFIX_SIZE || key.at(end - VERSION_SUFFIX_SIZE) != '\0')
+            return false;
+        if (version)
+            *version = (int) readBigEndian(key.data() + end - sizeof(uint32_t));
+        end -= VERSION_SUFFIX_SIZE;
+    }
+
+    // file key in form of "namespaceId_filename"
+    size_t dpos = key.find('_', ofs);
+    if (dpos == std::string::npos || dpos >= end)
+        return false;
+
+    namespaceId = strtol(key.substr(ofs, dpos - ofs).c_str(), NULL, 10) % 256;
+    nameLength = end - dpos - 1;
+    *name = (char *) malloc(nameLength + 1);
+    memcpy(*name, key.data() + dpos + 1, nameLength);
+    (*name)[nameLength] = 0;
+
+    return true;
+}
+
+std::string LocalMetaStore::getFilePrefix(const std::string &fileKey, bool noEndingSlash) {
+    size_t slash = fileKey.rfind('/'), us = fileKey.find('_');
+    // file on root directory, or root directory (ends with one '/')
+    if (slash == std::string::npos || us + 1 == slash) {
+        std::string prefix = fileKey.substr(0, us + 1);
+        return noEndingSlash ? prefix : prefix.append("/");
+    }
+    // sub-directory
+    return fileKey.substr(0, slash);
+}
+
+std::string LocalMetaStore::getFileListScanPrefix(unsigned char namespaceId, const std::string &prefix, std::string &dir) {
+    std::string nsPrefix = std::to_string(namespaceId).append("_");
+    dir.clear();
+
+    // search all files with names beginning with the prefix
+    if (prefix.empty() || prefix.back() != '/')
+        return FILE_TAG + nsPrefix + prefix;
+
+    // search files directly under the directory, which are all under the root directory or the directory itself
+    dir = getFilePrefix(nsPrefix + prefix);
+    return FILE_TAG + (dir == getFilePrefix(nsPrefix) ? nsPrefix : dir);
+}
+
+void LocalMetaStore::addToDirectory(const std::string &fkey, int delta, LocalKVStore::WriteBatch &batch) {
+    std::string dkey = DIR_TAG + getFilePrefix(fkey);
+    std::string value;
+    long int numFiles = 0;
+    if (_store.get(dkey, value) && value.size() == sizeof(long int))
+        memcpy(&numFiles, value.data(), sizeof(long int));
+    numFiles += delta;
+    if (numFiles <= 0)
+        batch.remove(dkey);
+    else
+        batch.put(dkey, std::string((const char *) &numFiles, sizeof(long int)));
+}
+
+unsigned int LocalMetaStore::getFileInfo(const std::vector<std::pair<std::string, std::string> > &records, const std::string &dir, FileInfo *list, bool withVersions) {
+    unsigned int numFiles = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+        const std::string &key = records.at(i).first;
+        FileInfo &cur = list[numFiles];
+        // skip files not directly under the directory
+        if (!dir.empty() && getFilePrefix(key.substr(strlen(FILE_TAG))) != dir)
+            continue;
+        if (!decodeFileInfo(records.at(i).second, cur) || !getNameFromFileKey(key, strlen(FILE_TAG), /* versioned */ false, &cur.name, cur.nameLength, cur.namespaceId)) {
+            LOG(WARNING) << "Cannot get the file info of file " << key.substr(strlen(FILE_TAG));
+            free(cur.name);
+            cur.reset();
+            continue;
+        }
+        // do not add delete marker to the list unless for queries on versions
+        if (!withVersions && cur.isDeleted) {
+            free(cur.name);
+            cur.reset();
+            continue;
+        }
+        numFiles++;
+
+        if (!withVersions || cur.version <= 0)
+            continue;
+
+        // versions of the file
+        std::vector<std::pair<std::string, std::string> > versions;
+        _store.scan(std::string(VERSION_TAG).append(key, strlen(FILE_TAG), std::string::npos).append(1, '\0'), "", 0, versions);
+        if (versions.empty())
+            continue;
+        cur.numVersions = versions.size();
+        cur.versions = new VersionInfo[versions.size()];
+        for (size_t vi = 0; vi < versions.size(); vi++) {
+            const std::string &vkey = versions.at(vi).first;
+            cur.versions[vi].version = (int) readBigEndian(vkey.data() + vkey.size() - sizeof(uint32_t));
+            decodeVersionInfo(versions.at(vi).second, cur.versions[vi]);
+        }
+    }
+    return numFiles;
+}
+
+void LocalMetaStore::encodeFile(const File &f, std::string &record) {
+    bool isEmptyFile = f.size == 0;
+    uint8_t deleted = isEmptyFile && f.isDeleted;
+    uint32_t format = LOCAL_META_FORMAT_V1;
+
+    appendField(record, format);
+    // attributes for file listing
+    appendField(record, f.size);
+    appendField(record, f.ctime);
+    appendField(record, f.atime);
+    appendField(record, f.mtime);
+    appendField(record, f.tctime);
+    appendField(record, f.version);
+    appendField(record, deleted);
+    record.append((const char *) f.md5, MD5_DIGEST_LENGTH);
+    appendField(record, f.numChunks);
+    appendField(record, f.numStripes);
+    appendField(record, f.staged.size);
+    appendField(record, f.staged.mtime);
+    appendBlob(record, f.storageClass.data(), f.storageClass.size());
+    // uuid
+    record.append((const char *) f.uuid.data, f.uuid.size());
+    // storage policy
+    const CodingMeta &cmeta = f.codingMeta;
+    appendField(record, cmeta.coding);
+    appendField(record, cmeta.n);
+    appendField(record, cmeta.k);
+    appendField(record, cmeta.f);
+    appendField(record, cmeta.maxChunkSize);
+    bool hasCodingState = !isEmptyFile && cmeta.codingState != NULL;
+    appendBlob(record, (const char *) cmeta.codingState, hasCodingState ? cmeta.codingStateSize : 0);
+    // staging (coding parameters only)
+    const CodingMeta &smeta = f.staged.codingMeta;
+    appendBlob(record, f.staged.storageClass.data(), f.staged.storageClass.size());
+    appendField(record, smeta.coding);
+    appendField(record, smeta.n);
+    appendField(record, smeta.k);
+    appendField(record, smeta.f);
+    appendField(record, smeta.maxChunkSize);
+    // chunks and blocks
+    std::string packed;
+    FileMetaCodec::encodeChunks(f, packed);
+    appendBlob(record, packed.data(), packed.size());
+    FileMetaCodec::encodeBlocks(f, /* is unique */ true, packed);
+    appendBlob(record, packed.data(), packed.size());
+    FileMetaCodec::encodeBlocks(f, /* is unique */ false, packed);
+    appendBlob(record, packed.data(), packed.size());
+}
+
+bool LocalMetaStore::decodeFile(const std::string &record, File &f, int getBlocks) {
+    RecordReader reader(record);
+    uint32_t format = 0;
+    uint8_t deleted = 0;
+    const char *data = 0;
+    uint32_t length = 0;
+
+    if (!reader.read(format) || format != LOCAL_META_FORMAT_V1)
+        return false;
+
+    bool okay = true
+        && reader.read(f.size)
+        && reader.read(f.ctime)
+        && reader.read(f.atime)
+        && reader.read(f.mtime)
+        && reader.read(f.tctime)
+        && reader.read(f.version)
+        && reader.read(deleted)
+        && reader.read(f.md5, MD5_DIGEST_LENGTH)
+        && reader.read(f.numChunks)
+        && reader.read(f.numStripes)
+        && reader.read(f.staged.size)
+        && reader.read(f.staged.mtime)
+        && reader.readString(f.storageClass)
+        && reader.read(f.uuid.data, f.uuid.size())
+        && reader.read(f.codingMeta.coding)
+        && reader.read(f.codingMeta.n)
+        && reader.read(f.codingMeta.k)
+        && reader.read(f.codingMeta.f)
+        && reader.read(f.codingMeta.maxChunkSize)
+        && reader.readBlob(data, length)
+    ;
+    if (!okay)
+        return false;
+    f.isDeleted = deleted;
+
+    // coding state
+    delete [] f.codingMeta.codingState;
+    f.codingMeta.codingState = 0;
+    f.codingMeta.codingStateSize = length;
+    if (length > 0) {
+        f.codingMeta.codingState = new unsigned char[length];
+        memcpy(f.codingMeta.codingState, data, length);
+    }
+
+    okay = true
+        && reader.readString(f.staged.storageClass)
+        && reader.read(f.staged.codingMeta.coding)
+        && reader.read(f.staged.codingMeta.n)
+        && reader.read(f.staged.codingMeta.k)
+        && reader.read(f.staged.codingMeta.f)
+        && reader.read(f.staged.codingMeta.maxChunkSize)
+        && reader.readBlob(data, length)
+    ;
+    if (!okay)
+        return false;
+
+    // chunks
+    if (!f.initChunksAndContainerIds()) {
+        LOG(ERROR) << "Failed to allocate space for container ids";
+        return false;
+    }
+    if (f.numChunks > 0 && !FileMetaCodec::decodeChunks(data, length, f))
+        return false;
+    for (int i = 0; i < f.numChunks; i++) {
+        f.chunks[i].setId(f.namespaceId, f.uuid, i);
+        f.chunks[i].data = 0;
+        f.chunks[i].freeData = true;
+        f.chunks[i].fileVersion = f.version;
+    }
+
+    // blocks
+    if (!reader.readBlob(data, length))
+        return false;
+    if ((getBlocks & 1) && !FileMetaCodec::decodeBlocks(data, length, /* is unique */ true, f))
+        return false;
+    if (!reader.readBlob(data, length))
+        return false;
+    if ((getBlocks & 2) && !FileMetaCodec::decodeBlocks(data, length, /* is unique */ false, f))
+        return false;
+
+    return true;
+}
+
+bool LocalMetaStore::decodeFileInfo(const std::string &record, FileInfo &info) {
+    RecordReader reader(record);
+    uint32_t format = 0;
+    time_t tctime = 0, stagedMtime = 0;
+    uint8_t deleted = 0;
+    int numStripes = 0;
+    unsigned long int stagedSize = 0;
+
+    bool okay = true
+        && reader.read(format)
+        && format == LOCAL_META_FORMAT_V1
+        && reader.read(info.size)
+        && reader.read(info.ctime)
+        && reader.read(info.atime)
+        && reader.read(info.mtime)
+        && reader.read(tctime)
+        && reader.read(info.version)
+        && reader.read(deleted)
+        && reader.read(info.md5, MD5_DIGEST_LENGTH)
+        && reader.read(info.numChunks)
+        && reader.read(numStripes)
+        && reader.read(stagedSize)
+        && reader.read(stagedMtime)
+        && reader.readString(info.storageClass)
+    ;
+    if (!okay)
+        return false;
+    info.isDeleted = deleted;
+
+    // use staged file info if staged file is more updated
+    if (stagedMtime > info.mtime) {
+        info.mtime = stagedMtime;
+        info.atime = stagedMtime;
+        info.size = stagedSize;
+    }
+
+    return true;
+}
+
+bool LocalMetaStore::decodeVersionInfo(const std::string &record, VersionInfo &info) {
+    FileInfo finfo;
+    if (!decodeFileInfo(record, finfo))
+        return false;
+    info.size = finfo.size;
+    info.mtime = finfo.mtime;
+    memcpy(info.md5, finfo.md5, MD5_DIGEST_LENGTH);
+    info.isDeleted = finfo.isDeleted;
+    info.numChunks = finfo.numChunks;
+    return true;
+}
@@ -0,0 +1,326 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __LOCAL_METASTORE_HH__
+#define __LOCAL_METASTORE_HH__
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "local_kv_store.hh"
+#include "metastore.hh"
+
+#include <boost/uuid/uuid.hpp>
+
+/**
+ * Metadata store embedded in the Proxy, on an ordered key-value store on local disk
+ *
+ * It serves a single Proxy process without a separate metadata store service,
+ * and each metadata change (e.g., backing up the current version of a file on
+ * put, or moving a file on rename) is applied atomically in one batch. The
+ * instances created in one process on the same path (e.g., one per Proxy with
+ * misc.reuse_data_connection) share the same store, locks, and scan states.
+ *
+ * NOTE: the key-value store keeps all pairs in memory (see LocalKVStore), so
+ * the metadata of all files must fit in the memory of the Proxy.
+ *
+ * Keys (a file key is "<namespace id>_<file name>", and a versioned file key
+ * is the file key followed by '\0' and the version in big-endian uint32_t)
+ *   f<file key>            metadata of the current version of a file
+ *   v<versioned file key>  metadata of a previous version of a file
+ *   u<namespace id>-<uuid> name of the file with the uuid
+ *   d<directory prefix>    number of files in a directory (see getFilePrefix())
+ *   r<versioned file key>  file to repair
+ *   p<versioned file key>  file pending write to cloud
+ *   q<versioned file key>  file pending completion of write to cloud
+ *   t<file key>            number of pending background tasks of a file
+ *   j<versioned file key><chunk id><container id> journal record of a chunk (ids in big-endian uint32_t)
+ *   J<versioned file key>  file with journal records
+ **/
+class LocalMetaStore : public MetaStore {
+public:
+    LocalMetaStore();
+    ~LocalMetaStore();
+
+    /**
+     * See MetaStore::putMeta()
+     **/
+    bool putMeta(const File &f);
+
+    /**
+     * See MetaStore::getMeta()
+     **/
+    bool getMeta(File &f, int getBlocks = 3);
+
+    /**
+     * See MetaStore::getMetaBatch()
+     **/
+    int getMetaBatch(int numFiles, File files[], bool found[], int getBlocks = 3);
+
+    /**
+     * See MetaStore::deleteMeta()
+     **/
+    bool deleteMeta(File &f);
+
+    /**
+     * See MetaStore::renameMeta()
+     **/
+    bool renameMeta(File &sf, File &df);
+
+    /**
+     * See MetaStore::updateTimestamps()
+     **/
+    bool updateTimestamps(const File &f);
+
+    /**
+     * See MetaStore::updateChunks()
+     **/
+    int updateChunks(const File &f, int version);
+
+    /**
+     * See MetaStore::getFileName(boost::uuids::uuid, File)
+     **/
+    bool getFileName(boost::uuids::uuid fuuid, File &f);
+
+    /**
+     * See MetaStore::getFileList()
+     **/
+    unsigned int getFileList(FileInfo **list, unsigned char namespaceId = INVALID_NAMESPACE_ID, bool withSize = true, bool withTime = true, bool withVersions = false, std::string prefix = "");
+
+    /**
+     * See MetaStore::getFileListPage()
+     **/
+    unsigned int getFileListPage(FileInfo **list, std::string &cursor, unsigned int pageSize = DEFAULT_FILE_LIST_PAGE_SIZE, unsigned char namespaceId = INVALID_NAMESPACE_ID, bool withSize = true, bool withTime = true, bool withVersions = false, std::string prefix = "");
+
+    /**
+     * See MetaStore::getFolderList()
+     **/
+    unsigned int getFolderList(std::vector<std::string> &list, unsigned char namespaceId = INVALID_NAMESPACE_ID, std::string prefix = "", bool skipSubfolders = true);
+
+    /**
+     * See MetaStore::getMaxNumKeysSupported()
+     **/
+    unsigned long int getMaxNumKeysSupported();
+
+    /**
+     * See MetaStore::getNumFiles()
+     **/
+    unsigned long int getNumFiles();
+
+    /**
+     * See MetaStore::getNumFilesToRepair()
+     **/
+    unsigned long int getNumFilesToRepair();
+
+    /**
+     * See MetaStore::getFilesToRepair()
+     **/
+    int getFilesToRepair(int numFiles, File files[]);
+
+    /**
+     * See MetaStore::markFileAsNeedsRepair()
+     **/
+    bool markFileAsNeedsRepair(const File &file);
+
+    /**
+     * See MetaStore::markFilesAsNeedsRepair()
+     **/
+    bool markFilesAsNeedsRepair(int numFiles, const File files[]);
+
+    /**
+     * See MetaStore::markFileAsRepaired()
+     **/
+    bool markFileAsRepaired(const File &file);
+
+    /**
+     * See MetaStore::markFilesAsRepaired()
+     **/
+    bool markFilesAsRepaired(int numFiles, const File files[]);
+
+    /**
+     * See MetaStore::markFileAsPendingWriteToCloud()
+     **/
+    bool markFileAsPendingWriteToCloud(const File &file);
+
+    /**
+     * See MetaStore::markFileAsWrittenToCloud()
+     **/
+    bool markFileAsWrittenToCloud(const File &file, bool removePending = false);
+
+    /**
+     * See MetaStore::markFilesAsWrittenToCloud()
+     **/
+    bool markFilesAsWrittenToCloud(int numFiles, const File files[], bool removePending = false);
+
+    /**
+     * See MetaStore::getFilesPendingWriteToCloud()
+     **/
+    int getFilesPendingWriteToCloud(int numFiles, File files[]);
+
+    /**
+     * See MetaStore::updateFileStatus()
+     **/
+    bool updateFileStatus(const File &file);
+
+    /**
+     * See MetaStore::getNextFileForTaskCheck()
+     **/
+    bool getNextFileForTaskCheck(File &file);
+
+    /**
+     * See MetaStore::lockFile()
+     **/
+    bool lockFile(const File &file);
+
+    /**
+     * See MetaStore::lockFile(const File &, unsigned long int)
+     **/
+    bool lockFile(const File &file, unsigned long int maxWaitUs);
+
+    /**
+     * See MetaStore::unlockFile()
+     **/
+    bool unlockFile(const File &file);
+
+    /**
+     * See MetaStore::addChunkToJournal()
+     **/
+    bool addChunkToJournal(const File &file, const Chunk &chunk, int containerId, bool isWrite);
+
+    /**
+     * See MetaStore::updateChunkInJournal()
+     **/
+    bool updateChunkInJournal(const File &file, const Chunk &chunk, bool isWrite, bool deleteRecord, int containerId);
+
+    /**
+     * See MetaStore::getFileJournal()
+     **/
+    void getFileJournal(const FileInfo &file, std::vector<std::tuple<Chunk, int /* container id*/, bool /* isWrite */, bool /* isPre */>> &records);
+
+    /**
+     * See MetaStore::getFilesWithJournal()
+     **/
+    int getFilesWithJounal(FileInfo **list);
+
+    /**
+     * See MetaStore::fileHasJournal()
+     **/
+    bool fileHasJournal(const File &file);
+
+    /**
+     * See MetaStore::getFileMetaCacheStats()
+     *
+     * @remark no cache is needed as the metadata is read from memory
+     **/
+    bool getFileMetaCacheStats(FileMetaCacheStats &stats);
+
+private:
+    static std::string genFileKey(unsigned char namespaceId, const char *name, int nameLength);
+    static std::string genVersionedFileKey(unsigned char namespaceId, const char *name, int nameLength, int version);
+    static std::string genFileUuidKey(unsigned char namespaceId, boost::uuids::uuid uuid);
+    static std::string genJournalKey(const std::string &vkey, int chunkId, int containerId);
+    static bool getNameFromFileKey(const std::string &key, size_t ofs, bool versioned, char **name, int &nameLength, unsigned char &namespaceId, int *version = 0);
+
+    /**
+     * Get the directory prefix of a file, in the same form as the Redis metadata store without its "//pf_" prefix
+     *
+     * @param[in] fileKey       file key
+     * @param[in] noEndingSlash whether to omit the ending slash for the root directory
+     *
+     * @return the directory prefix
+     **/
+    static std::string getFilePrefix(const std::string &fileKey, bool noEndingSlash = false);
+
+    /**
+     * Encode the metadata of a file into a record
+     *
+     * Layout (in host byte order): uint32_t format, listing attributes (size, timestamps, version, delete mark, md5,
+     * number of chunks, number of stripes, staged size and time, storage class), uuid, coding metadata, staged storage
+     * class and coding parameters, then the packed chunks and blocks (see FileMetaCodec), where strings and blobs are
+     * each prefixed with a uint32_t length
+     **/
+    static void encodeFile(const File &f, std::string &record);
+    static bool decodeFile(const std::string &record, File &f, int getBlocks);
+    static bool decodeFileInfo(const std::string &record, FileInfo &info);
+    static bool decodeVersionInfo(const std::string &record, VersionInfo &info);
+
+    /**
+     * Get the prefix of the keys to scan for a file listing
+     *
+     * @param[in] namespaceId   namespace id of the files
+     * @param[in] prefix        prefix of the file names, or a directory if ends with '/'
+     * @param[out] dir          directory prefix the files must be directly under, empty if no such restriction
+     *
+     * @return prefix of the keys to scan
+     **/
+    static std::string getFileListScanPrefix(unsigned char namespaceId, const std::string &prefix, std::string &dir);
+
+    bool putMeta(const File &f, LocalKVStore::WriteBatch &batch);
+    void addToDirectory(const std::string &fkey, int delta, LocalKVStore::WriteBatch &batch);
+    bool markFileStatus(const File &file, const char *tag, bool set);
+    bool markFilesStatus(int numFiles, const File files[], const char *tag, bool set);
+
+    /**
+     * Get the file info of a list of current files, skipping delete markers unless asked for versions
+     *
+     * @param[in] records       current file records scanned
+     * @param[in] dir           directory prefix the files must be directly under, empty if no such restriction
+     * @param[out] list         file info
+     * @param[in] withVersions  whether to include delete markers and the previous versions
+     *
+     * @return number of files added to the list
+     **/
+    unsigned int getFileInfo(const std::vector<std::pair<std::string, std::string> > &records, const std::string &dir, FileInfo *list, bool withVersions);
+
+    /**
+     * States shared by the instances on the same path in a process
+     **/
+    struct SharedState {
+        LocalKVStore store;
+        std::mutex lock;
+        std::mutex fileLocksLock;
+        std::condition_variable fileLockReleased;
+        std::set<std::string> lockedFiles;
+        std::mutex scanLock;
+        std::string taskScanIt;
+        std::deque<std::string> pendingWriteScan;
+        bool endOfPendingWriteSet = true;
+        int numRefs = 0;                                /**< number of instances sharing the states */
+    };
+
+    /**
+     * Get the shared states on a path, and open the store if it is not opened in the process yet
+     *
+     * @return the shared states, NULL if the store cannot be opened
+     **/
+    static SharedState *acquireSharedState(const std::string &path);
+
+    /**
+     * Release the shared states on a path, and close the store once no instance shares it
+     **/
+    static void releaseSharedState(const std::string &path);
+
+    static std::mutex _sharedStatesLock;                /**< lock on the shared states of all paths */
+    static std::map<std::string, SharedState*> _sharedStates; /**< path to the shared states */
+
+    std::string _path;                                  /**< path of the store */
+    SharedState *_shared;                               /**< states shared with the other instances on the same path */
+
+    LocalKVStore &_store;                               /**< key-value store of the metadata */
+    std::mutex &_lock;                                  /**< lock on changes that read the metadata before updating it */
+
+    std::mutex &_fileLocksLock;                         /**< lock on the file locks */
+    std::condition_variable &_fileLockReleased;         /**< signal on a file lock released */
+    std::set<std::string> &_lockedFiles;                /**< keys of the files locked */
+
+    std::mutex &_scanLock;                              /**< lock on the scan states below */
+    std::string &_taskScanIt;                           /**< key of the last file returned for task check */
+    std::deque<std::string> &_pendingWriteScan;         /**< files left in the current scan over the files pending write to cloud */
+    bool &_endOfPendingWriteSet;                        /**< whether the last scan over the files pending write to cloud has completed */
+};
+
+#endif // define __LOCAL_METASTORE_HH__
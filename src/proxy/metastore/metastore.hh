@@ -9,6 +9,7 @@
 
 #include "../../ds/file.hh"
 #include "../../ds/chunk.hh"
+#include "file_meta_cache.hh"
 
 class MetaStore {
 public:
@@ -34,6 +35,18 @@ public:
      **/
     virtual bool getMeta(File &f, int getBlocks = 3) = 0;
 
+    /**
+     * Get the metadata of a batch of files from the metadata store, in as few round trips as possible
+     *
+     * @param[in] numFiles  number of files
+     * @param[in,out] files the file structures containing the name, namespace id and version of files to get, and other fields would be filled with info from the metadata store
+     * @param[out] found    whether the metadata of each file is found, in size numFiles
+     * @param[in] getBlocks type of blocks fingerprints to get, see getMeta()
+     *
+     * @return the number of files with metadata found
+     **/
+    virtual int getMetaBatch(int numFiles, File files[], bool found[], int getBlocks = 3) = 0;
+
     /**
      * Delete the file metadata from the metadata store
      *
@@ -96,6 +109,24 @@ public:
      **/
     virtual unsigned int getFileList(FileInfo **list, unsigned char namespaceId = INVALID_NAMESPACE_ID, bool withSize = true, bool withTime = true, bool withVersions = false, std::string prefix = "") = 0;
 
+    /**
+     * Get a page of the file names
+     *
+     * @param[out] list        address of the pointer, which will hold the allocated list of file info (name and size)
+     * @param[in,out] cursor   continuation token, empty to start from the first page; set to the token of the next page, or empty if this is the last page
+     * @param[in]  pageSize    the approx. number of files in a page
+     * @param[in]  namespaceId the namespace id of the files to list
+     * @param[in]  withSize    whether to include file size in the list
+     * @param[in]  withTime    whether to include file timestamps in the list
+     * @param[in]  withVersions  whether to include versions in the file info record
+     * @param[in]  prefix      the prefix of files to list
+     *
+     * @return the number of files in the page
+     *
+     * @remark a page may be empty before the last page, and a file may appear in more than one page if files are added or removed during the listing
+     **/
+    virtual unsigned int getFileListPage(FileInfo **list, std::string &cursor, unsigned int pageSize = DEFAULT_FILE_LIST_PAGE_SIZE, unsigned char namespaceId = INVALID_NAMESPACE_ID, bool withSize = true, bool withTime = true, bool withVersions = false, std::string prefix = "") = 0;
+
     /**
      * Get a list of all folder names
      *
@@ -148,6 +179,16 @@ public:
      **/
     virtual bool markFileAsNeedsRepair(const File &file) = 0;
 
+    /**
+     * Mark a batch of files as needs repair
+     *
+     * @param[in] numFiles      number of files to mark
+     * @param[in] files         file structures containing the name and namespace id of files to repair
+     *
+     * @return whether all files are marked as need repair
+     **/
+    virtual bool markFilesAsNeedsRepair(int numFiles, const File files[]) = 0;
+
     /**
      * Mark file as repaired
      *
@@ -157,6 +198,16 @@ public:
      **/
     virtual bool markFileAsRepaired(const File &file) = 0;
 
+    /**
+     * Mark a batch of files as repaired
+     *
+     * @param[in] numFiles      number of files to mark
+     * @param[in] files         file structures containing the name and namespace id of files to mark as repaired
+     *
+     * @return whether all files are marked as repaired
+     **/
+    virtual bool markFilesAsRepaired(int numFiles, const File files[]) = 0;
+
     /**
      * Mark file as pending write to cloud
      *
@@ -175,6 +226,17 @@ public:
      **/
     virtual bool markFileAsWrittenToCloud(const File &file, bool removePending = false) = 0;
 
+    /**
+     * Mark a batch of files as written to cloud
+     *
+     * @param[in] numFiles      number of files to mark
+     * @param[in] files         file structures containing the name and namespace id of files to mark as written to cloud
+     * @param[in] removePending whether to also remove the files from the list of files pending write to cloud
+     *
+     * @return whether all files are marked
+     **/
+    virtual bool markFilesAsWrittenToCloud(int numFiles, const File files[], bool removePending = false) = 0;
+
     /**
      * Pop a number of file names for pending write to cloud
      *
@@ -212,6 +274,16 @@ public:
      **/
     virtual bool lockFile(const File &file) = 0;
 
+    /**
+     * Lock file, and wait for the file to be unlocked if it is locked
+     *
+     * @param[in] file          file structure containing the name and namespace id of file to lock
+     * @param[in] maxWaitUs     max. time to wait for the file to be unlocked (in microseconds)
+     *
+     * @return whether the file is locked
+     **/
+    virtual bool lockFile(const File &file, unsigned long int maxWaitUs) = 0;
+
     /**
      * Unlock file
      *
@@ -271,6 +343,15 @@ public:
      **/
     virtual bool fileHasJournal(const File &file) = 0;
 
+    /**
+     * Get the statistics of the cache of file metadata in front of the metadata store
+     *
+     * @param[out] stats        statistics of the cache
+     *
+     * @return whether the cache is enabled
+     **/
+    virtual bool getFileMetaCacheStats(FileMetaCacheStats &stats) = 0;
+
 private:
 
 };
@@ -2,12 +2,20 @@
 
 #include <stdio.h>   // sprintf()
 #include <stdlib.h>  // exit(), strtol()
+#include <string.h>  // strlen()
+#include <sys/socket.h>  // shutdown()
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <unordered_set>
+#include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
 
 #include <glog/logging.h>
 
 #include "../../common/config.hh"
 #include "../../common/define.hh"
+#include "file_meta_codec.hh"
 #include "redis_metastore.hh"
 
 #include <openssl/md5.h>
@@ -15,41 +23,240 @@
 
 #define NUM_RESERVED_SYSTEM_KEYS (8)
 #define FILE_LOCK_KEY "//snccFLock"
+#define FILE_LOCK_RELEASE_CHANNEL "//snccFLockRelease"
 #define FILE_PIN_STAGED_KEY "//snccFPinStaged"
 #define FILE_REPAIR_KEY "//snccFRepair"
 #define FILE_PENDING_WRITE_KEY "//snccFPendingWrite"
 #define FILE_PENDING_WRITE_COMP_KEY "//snccFPendingWriteComp"
 #define BG_TASK_PENDING_KEY "//snccFBgTask"
 #define DIR_LIST_KEY "//snccDirList"
+#define DIR_INDEX_KEY "//snccDirIndex"
+#define DIR_INDEX_VERSION_KEY "//snccDirIndexVer"
 #define JL_LIST_KEY "//snccJournalFSet"
 
+#define FILE_META_FORMAT_FIELD "mfmt"
+#define FILE_PACKED_CHUNKS_FIELD "pc"
+#define FILE_PACKED_UNIQUE_BLOCKS_FIELD "pub"
+#define FILE_PACKED_DUPLICATE_BLOCKS_FIELD "pdb"
+
 #define MAX_KEY_SIZE (64)
 #define NUM_REQ_FIELDS (10)
+#define MAX_FILE_LIST_SCANS_PER_CALL (64)
+#define DIR_INDEX_PAGE_SIZE (1024) // max. number of directories to get from the directory index per command
+#define DIR_INDEX_VERSION "1"     // version of the directory index, bump to rebuild the index from the directory list on start
+#define FILE_LOCK_POLL_INTERVAL (100) // max. time (in milliseconds) to wait for a lock release message before retrying a lock
 
 static std::tuple<int, std::string, int> extractJournalFieldKeyParts(const char *field, size_t fieldLength);
 
+/**
+ * Get the exclusive upper bound of the strings beginning with a prefix, for a lexicographical range search (e.g., ZRANGEBYLEX)
+ **/
+static std::string getLexUpperBound(std::string prefix) {
+  while (!prefix.empty() && (unsigned char)prefix.back() == 0xff) prefix.pop_back();
+  if (prefix.empty()) return "+";
+  prefix.back()++;
+  return std::string("(").append(prefix);
+}
+
+/**
+ * Arguments of a Redis command on a key with a variable number of fields (e.g., HMSET and HMGET)
+ **/
+class RedisCommandArgs {
+public:
+  RedisCommandArgs(const char *command, const char *key, size_t keyLength) {
+    add(command, strlen(command));
+    add(key, keyLength);
+  }
+
+  void add(const char *arg, size_t length) { _args.emplace_back(arg, length); }
+  void add(const std::string &arg) { _args.push_back(arg); }
+  void addField(const char *prefix, const char *suffix) { _args.emplace_back(std::string(prefix).append(suffix)); }
+
+  bool hasFields() const { return _args.size() > 2; }
+
+  /**
+   * Append the command to the output buffer of a connection (i.e., pipelined)
+   **/
+  int append(redisContext *cxt) const {
+    std::vector<const char *> argv;
+    std::vector<size_t> argvlen;
+    argv.reserve(_args.size());
+    argvlen.reserve(_args.size());
+    for (size_t i = 0; i < _args.size(); i++) {
+      argv.push_back(_args.at(i).data());
+      argvlen.push_back(_args.at(i).size());
+    }
+    return redisAppendCommandArgv(cxt, argv.size(), argv.data(), argvlen.data());
+  }
+
+private:
+  std::vector<std::string> _args; /**< command, key, and fields (and values) */
+};
+
+// file attributes to get in getMeta(), in the order of parsing
+static const char *fileAttributeFields[] = {
+    "size",   "numC",  "numS",    "uuid",  "sc",       "cs",       "n",     "k",     "f",       "maxCS",
+    "codingStateS",    "codingState",      "ver",      "ctime",    "atime", "mtime", "tctime",  "md5",
+    "sg_size", "sg_sc", "sg_cs",  "sg_n",  "sg_k",     "sg_f",     "sg_maxCS",      "sg_mtime", "dm",
+    "numUB",  "numDB"};
+static const size_t numFileAttributeFields = sizeof(fileAttributeFields) / sizeof(fileAttributeFields[0]);
+
+// file attributes to get in file listing, in the order of parsing
+static const char *fileListAttributeFields[] = {"size", "ctime", "atime", "mtime",    "ver", "dm",
+                                                "md5",  "numC",  "sg_size", "sg_mtime", "sc"};
+static const size_t numFileListAttributeFields = sizeof(fileListAttributeFields) / sizeof(fileListAttributeFields[0]);
+
+/**
+ * Append the command to get the file attributes, followed by the metadata format and the packed chunk attributes (and
+ * the packed blocks if asked)
+ **/
+static void appendGetFileAttributesCommand(redisContext *cxt, const char *key, size_t keyLength, bool uniqueBlocks,
+                                           bool duplicateBlocks) {
+  RedisCommandArgs args("HMGET", key, keyLength);
+  for (size_t i = 0; i < numFileAttributeFields; i++) args.add(fileAttributeFields[i], strlen(fileAttributeFields[i]));
+  args.add(std::string(FILE_META_FORMAT_FIELD));
+  args.add(std::string(FILE_PACKED_CHUNKS_FIELD));
+  if (uniqueBlocks) args.add(std::string(FILE_PACKED_UNIQUE_BLOCKS_FIELD));
+  if (duplicateBlocks) args.add(std::string(FILE_PACKED_DUPLICATE_BLOCKS_FIELD));
+  args.append(cxt);
+}
+
 RedisMetaStore::RedisMetaStore() {
   Config &config = Config::getInstance();
-  _cxt = NULL;
-  _cxt = redisConnect(config.getProxyMetaStoreIP().c_str(), config.getProxyMetaStorePort());
-  if (_cxt == NULL || _cxt->err) {
-    if (_cxt) {
-      LOG(ERROR) << "Redis connection error " << _cxt->errstr;
-      redisFree(_cxt);
-    } else {
-      LOG(ERROR) << "Failed to allocate Redis context";
-    }
+  _maxNumConnections = config.getProxyMetaStoreNumConnections();
+  _numConnections = 0;
+  // open the first connection to check if the metastore is reachable
+  redisContext *cxt = connect();
+  if (cxt == NULL) {
     exit(1);
   }
+  _numConnections = 1;
+  _idleConnections.push_back(cxt);
   _taskScanIt = "0";
   _endOfPendingWriteSet = true;
-  LOG(INFO) << "Redis metastore connection init";
+  _dirIndexReady = false;
+  // file locks
+  _lockOwner = boost::uuids::to_string(boost::uuids::random_generator()());
+  _lockLease = config.getProxyFileLockLease();
+  // file metadata cache, shared by the instances in this process (e.g., one per Proxy when data connections are reused)
+  // so changes through any of them invalidate the cached metadata
+  _metaCache = acquireMetaCache();
+  _running = true;
+  _subscriberFd = -1;
+  pthread_create(&_lockRenewer, NULL, RedisMetaStore::renewFileLocks, this);
+  pthread_create(&_subscriber, NULL, RedisMetaStore::subscribeNotifications, this);
+  LOG(INFO) << "Redis metastore connection init (max. " << _maxNumConnections << " connections, file metadata cache "
+            << (_metaCache ? config.getProxyFileMetaCacheSize() : 0) << "MiB)";
+}
+
+RedisMetaStore::~RedisMetaStore() {
+  // stop the lease renewal
+  _heldLocksLock.lock();
+  _running = false;
+  _heldLocksLock.unlock();
+  _lockRenewalStopped.notify_all();
+  pthread_join(_lockRenewer, NULL);
+  // wake up the subscriber blocked on reading its connection, whether it has subscribed or not
+  _subscriberLock.lock();
+  if (_subscriberFd != -1) shutdown(_subscriberFd, SHUT_RDWR);
+  _subscriberLock.unlock();
+  pthread_join(_subscriber, NULL);
+
+  for (size_t i = 0; i < _idleConnections.size(); i++) redisFree(_idleConnections.at(i));
+
+  releaseMetaCache();
+}
+
+std::mutex RedisMetaStore::_sharedMetaCacheLock;
+FileMetaCache *RedisMetaStore::_sharedMetaCache = NULL;
+int RedisMetaStore::_sharedMetaCacheRefs = 0;
+
+FileMetaCache *RedisMetaStore::acquireMetaCache() {
+  std::lock_guard<std::mutex> lk(_sharedMetaCacheLock);
+  if (_sharedMetaCacheRefs++ > 0) return _sharedMetaCache;
+  // the cache is disabled when multiple Proxies share the metadata store, as in-place changes (e.g., appends and
+  // overwrites) by other Proxies keep the file version, and validating each hit costs a round trip anyway
+  Config &config = Config::getInstance();
+  unsigned long int cacheSize = (unsigned long int)config.getProxyFileMetaCacheSize() << 20;
+  if (cacheSize > 0 && config.getNumProxy() > 1) {
+    LOG(WARNING) << "File metadata cache is disabled as the metadata store is shared by " << config.getNumProxy()
+                 << " Proxies";
+    cacheSize = 0;
+  }
+  _sharedMetaCache = cacheSize > 0 ? new FileMetaCache(cacheSize) : NULL;
+  return _sharedMetaCache;
 }
 
-RedisMetaStore::~RedisMetaStore() { redisFree(_cxt); }
+void RedisMetaStore::releaseMetaCache() {
+  std::lock_guard<std::mutex> lk(_sharedMetaCacheLock);
+  if (--_sharedMetaCacheRefs > 0) return;
+  delete _sharedMetaCache;
+  _sharedMetaCache = NULL;
+}
+
+RedisMetaStore::Connection::Connection(RedisMetaStore *store) : _store(store) { _cxt = _store->getConnection(); }
+
+RedisMetaStore::Connection::~Connection() { _store->releaseConnection(_cxt); }
+
+RedisMetaStore::CachedMetaInvalidation::CachedMetaInvalidation(RedisMetaStore *store, const File &f)
+    : _store(store), _key(FileMetaCache::genKey(f.namespaceId, f.name, f.nameLength)) {}
+
+RedisMetaStore::CachedMetaInvalidation::~CachedMetaInvalidation() {
+  if (_store->_metaCache) _store->_metaCache->invalidate(_key);
+}
+
+redisContext *RedisMetaStore::connect() {
+  Config &config = Config::getInstance();
+  redisContext *cxt = redisConnect(config.getProxyMetaStoreIP().c_str(), config.getProxyMetaStorePort());
+  if (cxt == NULL || cxt->err) {
+    if (cxt) {
+      LOG(ERROR) << "Redis connection error " << cxt->errstr;
+      redisFree(cxt);
+    } else {
+      LOG(ERROR) << "Failed to allocate Redis context";
+    }
+    return NULL;
+  }
+  return cxt;
+}
+
+redisContext *RedisMetaStore::getConnection() {
+  std::unique_lock<std::mutex> lk(_connectionsLock);
+  while (true) {
+    // reuse an idle connection
+    if (!_idleConnections.empty()) {
+      redisContext *cxt = _idleConnections.back();
+      _idleConnections.pop_back();
+      return cxt;
+    }
+    // open a new connection outside the lock
+    if (_numConnections < _maxNumConnections) {
+      _numConnections++;
+      lk.unlock();
+      redisContext *cxt = connect();
+      if (cxt != NULL) {
+        DLOG(INFO) << "Open a new Redis metastore connection";
+        return cxt;
+      }
+      // fall back to wait for an existing connection (the first connection is never closed)
+      lk.lock();
+      _numConnections--;
+    }
+    // wait for a connection to return
+    _connectionReleased.wait(lk, [this] { return !_idleConnections.empty(); });
+  }
+}
+
+void RedisMetaStore::releaseConnection(redisContext *cxt) {
+  _connectionsLock.lock();
+  _idleConnections.push_back(cxt);
+  _connectionsLock.unlock();
+  _connectionReleased.notify_one();
+}
 
 bool RedisMetaStore::putMeta(const File &f) {
-  std::lock_guard<std::mutex> lk(_lock);
+  CachedMetaInvalidation invalidation(this, f);
+  Connection cxt(this);
 
   char filename[PATH_MAX], vfilename[PATH_MAX], vlname[PATH_MAX];
   // filename format: namespaceId_name
@@ -58,15 +265,28 @@ bool RedisMetaStore::putMeta(const File &f) {
   std::string prefix = getFilePrefix(filename);
   int curVersion = -1;
 
-  // find the current version
-  redisReply *vr = (redisReply *)redisCommand(_cxt, "HGET %b ver", filename, (size_t)nameLength);
+  // find the current version, and the number of chunks and blocks stored in the legacy layout (if any)
+  int curNumChunks = 0;
+  size_t curNumUniqueBlocks = 0, curNumDuplicateBlocks = 0;
+  redisReply *vr = (redisReply *)redisCommand(cxt, "HMGET %b ver %s numC numUB numDB", filename, (size_t)nameLength,
+                                              FILE_META_FORMAT_FIELD);
 
-  if (vr != NULL && vr->type == REDIS_REPLY_STRING && vr->len == sizeof(int)) {
-    memcpy(&curVersion, vr->str, sizeof(int));
+  if (vr != NULL && vr->type == REDIS_REPLY_ARRAY && vr->elements == 5) {
+    if (vr->element[0]->type == REDIS_REPLY_STRING && vr->element[0]->len == sizeof(int)) {
+      memcpy(&curVersion, vr->element[0]->str, sizeof(int));
+    }
+    if (curVersion != -1 && vr->element[1]->type != REDIS_REPLY_STRING) {
+      if (vr->element[2]->type == REDIS_REPLY_STRING && vr->element[2]->len == sizeof(int))
+        memcpy(&curNumChunks, vr->element[2]->str, sizeof(int));
+      if (vr->element[3]->type == REDIS_REPLY_STRING && vr->element[3]->len == sizeof(size_t))
+        memcpy(&curNumUniqueBlocks, vr->element[3]->str, sizeof(size_t));
+      if (vr->element[4]->type == REDIS_REPLY_STRING && vr->element[4]->len == sizeof(size_t))
+        memcpy(&curNumDuplicateBlocks, vr->element[4]->str, sizeof(size_t));
+    }
   } else if (vr == NULL) {
     LOG(ERROR) << "Failed to get the current version of file " << f.name << " due to Redis connection error";
     freeReplyObject(vr);
-    redisReconnect(_cxt);
+    redisReconnect(cxt);
     return false;
   }
 
@@ -81,15 +301,15 @@ bool RedisMetaStore::putMeta(const File &f) {
     // TODO clone instead of put after rename
     // TODO these steps need to be an atomic transaction with HMSET, otherwise metadata can be inconsistent
     redisReply *r =
-        (redisReply *)redisCommand(_cxt, "RENAME %b %b", filename, (size_t)nameLength, vfilename, (size_t)vnameLength);
+        (redisReply *)redisCommand(cxt, "RENAME %b %b", filename, (size_t)nameLength, vfilename, (size_t)vnameLength);
     if (r == NULL || strncmp(r->str, "OK", 2) != 0) {
-      if (r == NULL) redisReconnect(_cxt);
+      if (r == NULL) redisReconnect(cxt);
       LOG(ERROR) << "Failed to backup the previous version " << f.version - 1 << " metadata for file " << f.name;
       freeReplyObject(r);
       return false;
     }
     freeReplyObject(r);
-    r = (redisReply *)redisCommand(_cxt, "HMGET %b size mtime md5 dm numC", vfilename, (size_t)vnameLength);
+    r = (redisReply *)redisCommand(cxt, "HMGET %b size mtime md5 dm numC", vfilename, (size_t)vnameLength);
     // create a set of versions (version_list [verison] -> "version size timestamp md5 dm") for this file name
     vlnameLength = genFileVersionListKey(f.namespaceId, f.name, f.nameLength, vlname);
     std::string fsummary;
@@ -106,26 +326,31 @@ bool RedisMetaStore::putMeta(const File &f) {
       }
     }
     freeReplyObject(r);
-    r = (redisReply *)redisCommand(_cxt, "ZADD %b %d %b", vlname, (size_t)vlnameLength, f.version - 1, fsummary.c_str(),
+    r = (redisReply *)redisCommand(cxt, "ZADD %b %d %b", vlname, (size_t)vlnameLength, f.version - 1, fsummary.c_str(),
                                    fsummary.size());
     LOG(INFO) << "File summary of " << vlname << " version " << f.version << " is >" << fsummary.c_str() << "<";
     freeReplyObject(r);
+    // the metadata is written to a new key
+    curNumChunks = 0;
+    curNumUniqueBlocks = curNumDuplicateBlocks = 0;
   }
 
   // operate on previous versions
   if (keepVersion && curVersion != -1 && f.version < curVersion) {
     // check and only allow such operations if the version exists
     vlnameLength = genFileVersionListKey(f.namespaceId, f.name, f.nameLength, vlname);
-    vr = (redisReply *)redisCommand(_cxt, "ZRANGEBYSCORE %b %d %d", vlname, (size_t)vlnameLength, f.version, f.version);
+    vr = (redisReply *)redisCommand(cxt, "ZRANGEBYSCORE %b %d %d", vlname, (size_t)vlnameLength, f.version, f.version);
     if (vr == NULL || vr->type != REDIS_REPLY_ARRAY || vr->elements < 1) {
       LOG(ERROR) << "Failed to find the previous version " << f.version << " record for file " << f.name << ", type "
                  << (int)vr->type << " elements " << vr->elements;
       freeReplyObject(vr);
-      if (vr == NULL) redisReconnect(_cxt);
+      if (vr == NULL) redisReconnect(cxt);
       return false;
     }
     // use the versioned file key
     nameLength = genVersionedFileKey(f.namespaceId, f.name, f.nameLength, f.version, filename);
+    curNumChunks = 0;
+    curNumUniqueBlocks = curNumDuplicateBlocks = 0;
   }
 
   bool isEmptyFile = f.size == 0;
@@ -134,7 +359,7 @@ bool RedisMetaStore::putMeta(const File &f) {
   int deleted = isEmptyFile ? f.isDeleted : 0;
   size_t numUniqueBlocks = f.uniqueBlocks.size();
   size_t numDuplicateBlocks = f.duplicateBlocks.size();
-  redisAppendCommand(_cxt,
+  redisAppendCommand(cxt,
                      "HMSET %b"
                      " name %b uuid %s size %b numC %b"
                      " sc %s cs %b n %b k %b f %b maxCS %b codingStateS %b codingState %b"
@@ -178,60 +403,115 @@ bool RedisMetaStore::putMeta(const File &f) {
                      ,
                      &numUniqueBlocks, (size_t)sizeof(size_t), &numDuplicateBlocks, (size_t)sizeof(size_t));
 
-  // container ids
+  // chunk attributes and deduplication fingerprints and block mapping, all in one command
+  RedisCommandArgs fieldArgs("HMSET", filename, nameLength);
+  RedisCommandArgs cleanUpArgs("HDEL", filename, nameLength);
   char cname[MAX_KEY_SIZE];
-  for (int i = 0; i < f.numChunks; i++) {
-    genChunkKeyPrefix(f.chunks[i].getChunkId(), cname);
-    redisAppendCommand(_cxt, "HMSET %b %s-cid %b %s-size %b %s-md5 %b %s-bad %d", filename, (size_t)nameLength, cname,
-                       &f.containerIds[i], (size_t)sizeof(int), cname, &f.chunks[i].size, (size_t)sizeof(int), cname,
-                       f.chunks[i].md5, MD5_DIGEST_LENGTH, cname, (f.chunksCorrupted ? f.chunksCorrupted[i] : 0));
+  char bname[MAX_KEY_SIZE];
+  if (config.usePackedFileMeta()) {
+    std::string packed;
+    uint32_t format = FileMetaCodec::CURRENT_FORMAT;
+    fieldArgs.add(std::string(FILE_META_FORMAT_FIELD));
+    fieldArgs.add((const char *)&format, sizeof(uint32_t));
+    FileMetaCodec::encodeChunks(f, packed);
+    fieldArgs.add(std::string(FILE_PACKED_CHUNKS_FIELD));
+    fieldArgs.add(packed);
+    FileMetaCodec::encodeBlocks(f, /* is unique */ true, packed);
+    fieldArgs.add(std::string(FILE_PACKED_UNIQUE_BLOCKS_FIELD));
+    fieldArgs.add(packed);
+    FileMetaCodec::encodeBlocks(f, /* is unique */ false, packed);
+    fieldArgs.add(std::string(FILE_PACKED_DUPLICATE_BLOCKS_FIELD));
+    fieldArgs.add(packed);
+    // remove the per-chunk and per-block fields of the existing metadata in the legacy layout
+    for (int i = 0; i < curNumChunks; i++) {
+      genChunkKeyPrefix(i, cname);
+      cleanUpArgs.addField(cname, "-cid");
+      cleanUpArgs.addField(cname, "-size");
+      cleanUpArgs.addField(cname, "-md5");
+      cleanUpArgs.addField(cname, "-bad");
+    }
+    for (size_t i = 0; i < curNumUniqueBlocks; i++) {
+      genBlockKey(i, bname, /* is unique */ true);
+      cleanUpArgs.add(bname, strlen(bname));
+    }
+    for (size_t i = 0; i < curNumDuplicateBlocks; i++) {
+      genBlockKey(i, bname, /* is unique */ false);
+      cleanUpArgs.add(bname, strlen(bname));
+    }
+  } else {
+    for (int i = 0; i < f.numChunks; i++) {
+      genChunkKeyPrefix(f.chunks[i].getChunkId(), cname);
+      fieldArgs.addField(cname, "-cid");
+      fieldArgs.add((const char *)&f.containerIds[i], sizeof(int));
+      fieldArgs.addField(cname, "-size");
+      fieldArgs.add((const char *)&f.chunks[i].size, sizeof(int));
+      fieldArgs.addField(cname, "-md5");
+      fieldArgs.add((const char *)f.chunks[i].md5, MD5_DIGEST_LENGTH);
+      fieldArgs.addField(cname, "-bad");
+      fieldArgs.add(std::to_string(f.chunksCorrupted ? f.chunksCorrupted[i] : 0));
+    }
+
+    size_t bid = 0;
+    for (auto it = f.uniqueBlocks.begin(); it != f.uniqueBlocks.end(); it++, bid++) {
+      genBlockKey(bid, bname, /* is unique */ true);
+      std::string fp = it->second.first.get();
+      // logical offset, length, fingerprint, physical offset
+      std::string value;
+      value.append((const char *)&it->first._offset, sizeof(unsigned long int))
+          .append((const char *)&it->first._length, sizeof(unsigned int))
+          .append(fp)
+          .append((const char *)&it->second.second, sizeof(int));
+      fieldArgs.add(bname, strlen(bname));
+      fieldArgs.add(value);
+    }
+    bid = 0;
+    for (auto it = f.duplicateBlocks.begin(); it != f.duplicateBlocks.end(); it++, bid++) {
+      genBlockKey(bid, bname, /* is unique */ false);
+      std::string fp = it->second.get();
+      // logical offset, length, fingerprint
+      std::string value;
+      value.append((const char *)&it->first._offset, sizeof(unsigned long int))
+          .append((const char *)&it->first._length, sizeof(unsigned int))
+          .append(fp);
+      fieldArgs.add(bname, strlen(bname));
+      fieldArgs.add(value);
+    }
+    // remove the packed fields, if any, so that the per-chunk and per-block fields are used
+    cleanUpArgs.add(std::string(FILE_META_FORMAT_FIELD));
+    cleanUpArgs.add(std::string(FILE_PACKED_CHUNKS_FIELD));
+    cleanUpArgs.add(std::string(FILE_PACKED_UNIQUE_BLOCKS_FIELD));
+    cleanUpArgs.add(std::string(FILE_PACKED_DUPLICATE_BLOCKS_FIELD));
   }
 
-  // deduplication fingerprints and block mapping
-  char bname[MAX_KEY_SIZE];
-  size_t bid = 0;
-  for (auto it = f.uniqueBlocks.begin(); it != f.uniqueBlocks.end(); it++, bid++) {
-    genBlockKey(bid, bname, /* is unique */ true);
-    std::string fp = it->second.first.get();
-    redisAppendCommand(_cxt, "HMSET %b %s %b%b%b%b"  // logical offset, length, fingerprint, physical offset
-                       ,
-                       filename, (size_t)nameLength, bname, &it->first._offset, (size_t)sizeof(unsigned long int),
-                       &it->first._length, (size_t)sizeof(unsigned int), fp.data(), fp.size(), &it->second.second,
-                       (size_t)sizeof(int));
-  }
-  bid = 0;
-  for (auto it = f.duplicateBlocks.begin(); it != f.duplicateBlocks.end(); it++, bid++) {
-    genBlockKey(bid, bname, /* is unique */ false);
-    std::string fp = it->second.get();
-    redisAppendCommand(_cxt, "HMSET %b %s %b%b%b"  // logical offset, length, fingerprint
-                       ,
-                       filename, (size_t)nameLength, bname, &it->first._offset, (size_t)sizeof(unsigned long int),
-                       &it->first._length, (size_t)sizeof(unsigned int), fp.data(), fp.size());
+  int setKey = 0;
+  if (fieldArgs.hasFields()) {
+    fieldArgs.append(cxt);
+    setKey += 1;
+  }
+  if (cleanUpArgs.hasFields()) {
+    cleanUpArgs.append(cxt);
+    setKey += 1;
   }
 
   char fidKey[MAX_KEY_SIZE + 64];
-  int setKey = 0;
 
   // add uuid-to-file-name maping
   if (genFileUuidKey(f.namespaceId, f.uuid, fidKey) == false) {
     LOG(WARNING) << "File uuid " << boost::uuids::to_string(f.uuid) << " is too long to generate a reverse key mapping";
   } else {
-    redisAppendCommand(_cxt, "SET %s %b", fidKey, f.name, (size_t)f.nameLength);
+    redisAppendCommand(cxt, "SET %s %b", fidKey, f.name, (size_t)f.nameLength);
     setKey += 1;
   }
-  // update the corresponding directory prefix set of this file
-  redisAppendCommand(_cxt, "SADD %s %b", prefix.c_str(), filename, (size_t)nameLength);
-  // update global directory list
-  redisAppendCommand(_cxt, "SADD %s %s", DIR_LIST_KEY, prefix.c_str());
-  setKey += 2;
+  // update the corresponding directory prefix set of this file, and the global directory list and index
+  setKey += appendAddToDirectoryCommands(cxt, prefix, filename, nameLength);
 
   // issue all commands and check their replies
   redisReply *r = 0;
-  for (size_t i = 0; i < f.numChunks + numUniqueBlocks + numDuplicateBlocks + 1 + setKey; i++) {
-    if (redisGetReply(_cxt, (void **)&r) != REDIS_OK) {
+  for (int i = 0; i < 1 + setKey; i++) {
+    if (redisGetReply(cxt, (void **)&r) != REDIS_OK) {
       LOG(ERROR) << "Redis reply with error, " << (r ? r->str : "NULL");
       if (r == NULL) {
-        redisReconnect(_cxt);
+        redisReconnect(cxt);
       }
       freeReplyObject(r);
       r = 0;
@@ -244,43 +524,136 @@ bool RedisMetaStore::putMeta(const File &f) {
 }
 
 bool RedisMetaStore::getMeta(File &f, int getBlocks) {
-  std::lock_guard<std::mutex> lk(_lock);
+  if (_metaCache == NULL) {
+    Connection cxt(this);
+    return getMeta(cxt, f, getBlocks);
+  }
 
-  char filename[PATH_MAX];
+  std::string key = FileMetaCache::genKey(f.namespaceId, f.name, f.nameLength);
+
+  // only the current version is cached, so a specific version is served from the cache only if it is the current one
+  if (_metaCache->get(key, f, getBlocks, f.version)) return true;
+
+  // take the invalidation epoch before reading, so metadata changed in between is not cached
+  bool isCurrent = f.version == -1;
+  unsigned long int epoch = isCurrent ? _metaCache->getEpoch(key) : 0;
+  Connection cxt(this);
+  if (!getMeta(cxt, f, getBlocks)) return false;
+  if (isCurrent) _metaCache->put(key, f, getBlocks, epoch);
+
+  return true;
+}
+
+int RedisMetaStore::getMetaBatch(int numFiles, File files[], bool found[], int getBlocks) {
+  if (numFiles <= 0) return 0;
+
+  // read from the metadata store directly, as the files in a batch are seldom read again soon
+  Connection cxt(this);
+  return getMetaBatch(cxt, numFiles, files, found, getBlocks);
+}
+
+bool RedisMetaStore::getMeta(redisContext *cxt, File &f, int getBlocks) {
+  int numReplies = appendGetMetaCommands(cxt, f, getBlocks);
+  std::vector<RedisReplyPtr> replies;
+  for (int i = 0; i < numReplies; i++) {
+    redisReply *reply = 0;
+    if (redisGetReply(cxt, (void **)&reply) != REDIS_OK) {
+      redisReconnect(cxt);
+      LOG(WARNING) << "Failed to get metadata for file " << f.name;
+      return false;
+    }
+    replies.emplace_back(reply, freeReplyObject);
+  }
+
+  return getMeta(cxt, f, getBlocks, replies);
+}
+
+int RedisMetaStore::getMetaBatch(redisContext *cxt, int numFiles, File files[], bool found[], int getBlocks) {
+  // first round trip for all files: the file attributes
+  std::vector<int> numReplies(numFiles, 0);
+  for (int i = 0; i < numFiles; i++) {
+    numReplies.at(i) = appendGetMetaCommands(cxt, files[i], getBlocks);
+    found[i] = false;
+  }
+
+  // read all replies before parsing any, as parsing may need more round trips (for files in the legacy layout)
+  std::vector<std::vector<RedisReplyPtr>> replies(numFiles);
+  for (int i = 0; i < numFiles; i++) {
+    for (int j = 0; j < numReplies.at(i); j++) {
+      redisReply *reply = 0;
+      if (redisGetReply(cxt, (void **)&reply) != REDIS_OK) {
+        redisReconnect(cxt);
+        LOG(WARNING) << "Failed to get metadata for a batch of " << numFiles << " files";
+        return 0;
+      }
+      replies.at(i).emplace_back(reply, freeReplyObject);
+    }
+  }
+
+  int numFound = 0;
+  for (int i = 0; i < numFiles; i++) {
+    found[i] = getMeta(cxt, files[i], getBlocks, replies.at(i));
+    if (found[i]) numFound++;
+  }
+  return numFound;
+}
+
+int RedisMetaStore::appendGetMetaCommands(redisContext *cxt, const File &f, int getBlocks) {
+  char filename[PATH_MAX], vfilename[PATH_MAX];
+  int nameLength = genFileKey(f.namespaceId, f.name, f.nameLength, filename);
+
+  // first round trip: the file attributes, which include the chunk attributes and blocks if they are packed
+  // if a version is specified, also get the current version, and the attributes under the versioned key in case the
+  // version is not the current one
+  bool checkVersion = f.version != -1;
+  if (checkVersion) {
+    redisAppendCommand(cxt, "HGET %b ver", filename, (size_t)nameLength);
+  }
+  bool getUniqueBlocks = getBlocks == 1 || getBlocks == 3;
+  bool getDuplicateBlocks = getBlocks == 2 || getBlocks == 3;
+  appendGetFileAttributesCommand(cxt, filename, nameLength, getUniqueBlocks, getDuplicateBlocks);
+  if (checkVersion) {
+    int vnameLength = genVersionedFileKey(f.namespaceId, f.name, f.nameLength, f.version, vfilename);
+    appendGetFileAttributesCommand(cxt, vfilename, vnameLength, getUniqueBlocks, getDuplicateBlocks);
+  }
+
+  return checkVersion ? 3 : 1;
+}
+
+bool RedisMetaStore::getMeta(redisContext *cxt, File &f, int getBlocks, std::vector<RedisReplyPtr> &replies) {
+  char filename[PATH_MAX], vfilename[PATH_MAX];
   int nameLength = genFileKey(f.namespaceId, f.name, f.nameLength, filename);
+  int vnameLength = 0;
 
   size_t numUniqueBlocks = 0, numDuplicateBlocks = 0;
 
-  // a version is specified
-  if (f.version != -1) {
-    redisReply *r = (redisReply *)redisCommand(_cxt, "HGET %b ver", filename, (size_t)nameLength);
+  bool checkVersion = f.version != -1;
+  if (checkVersion) {
+    vnameLength = genVersionedFileKey(f.namespaceId, f.name, f.nameLength, f.version, vfilename);
+  }
+  bool getUniqueBlocks = getBlocks == 1 || getBlocks == 3;
+  bool getDuplicateBlocks = getBlocks == 2 || getBlocks == 3;
+
+  redisReply *r = 0;
+  if (checkVersion) {
     // check if the version is the latest (current) one
     int version = -1;
-    if (r != NULL && r->type == REDIS_REPLY_STRING) {
-      memcpy(&version, r->str, sizeof(int));
+    redisReply *vr = replies.at(0).get();
+    if (vr->type == REDIS_REPLY_STRING && vr->len == sizeof(int)) {
+      memcpy(&version, vr->str, sizeof(int));
     }
     // if it is not the current one, find the metadata using versioned key instead
-    if (version != f.version)
-      nameLength = genVersionedFileKey(f.namespaceId, f.name, f.nameLength, f.version, filename);
-    freeReplyObject(r);
-  }
-
-  redisReply *r = (redisReply *)redisCommand(_cxt,
-                                             "HMGET %b"
-                                             " size numC numS uuid sc"
-                                             " cs n k f maxCS"
-                                             " codingStateS codingState ver ctime atime"
-                                             " mtime tctime md5 sg_size sg_sc"
-                                             " sg_cs sg_n sg_k sg_f sg_maxCS"
-                                             " sg_mtime dm numUB numDB",
-                                             filename, (size_t)nameLength);
-
-  // check if get is successful
-  if (r == NULL) {
-    redisReconnect(_cxt);
-    LOG(WARNING) << "Failed to get metadata for file " << f.name;
-    return false;
+    if (version != f.version) {
+      memcpy(filename, vfilename, vnameLength + 1);
+      nameLength = vnameLength;
+      r = replies.at(2).release();
+    } else {
+      r = replies.at(1).release();
+    }
+  } else {
+    r = replies.at(0).release();
   }
+  replies.clear();
 
   LOG_IF(ERROR, r->type != REDIS_REPLY_ARRAY || r->elements < NUM_REQ_FIELDS)
       << "Not enough field for file metadata (" << r->elements << ", " << r->type << ")";
@@ -347,7 +720,6 @@ bool RedisMetaStore::getMeta(File &f, int getBlocks) {
     }                                                                                          \
   } while (0)
 
-  std::cout << r->element[0]->type << " " << r->element[0]->len << std::endl;
   check_and_copy_field(&f.size, 0, sizeof(unsigned long int));
   check_and_copy_field(&f.numChunks, 1, sizeof(int));
   check_and_copy_field(&f.numStripes, 2, sizeof(int));
@@ -392,139 +764,184 @@ bool RedisMetaStore::getMeta(File &f, int getBlocks) {
   check_and_copy_or_set_field(&numUniqueBlocks, 27, sizeof(size_t), 0);
   check_and_copy_or_set_field(&numDuplicateBlocks, 28, sizeof(size_t), 0);
 
-  freeReplyObject(r);
-  r = 0;
-
   // get container ids and attributes
   if (!f.initChunksAndContainerIds()) {
     LOG(ERROR) << "Failed to allocate space for container ids";
+    freeReplyObject(r);
+    r = 0;
     return false;
   }
 
-  char cname[MAX_KEY_SIZE];
-  for (int i = 0; i < f.numChunks; i++) {
-    genChunkKeyPrefix(i, cname);
-    redisAppendCommand(_cxt, "HMGET %b %s-cid %s-size %s-md5 %s-bad", filename, (size_t)nameLength, cname, cname, cname,
-                       cname);
+  getUniqueBlocks = getUniqueBlocks && numUniqueBlocks > 0;
+  getDuplicateBlocks = getDuplicateBlocks && numDuplicateBlocks > 0;
+
+  // packed chunk attributes and blocks, no more round trip is needed
+  size_t packedIdx = numFileAttributeFields;
+  if (r->elements > packedIdx + 1 && r->element[packedIdx]->type == REDIS_REPLY_STRING) {
+    bool okay = true;
+    redisReply *pc = r->element[packedIdx + 1];
+    if (f.numChunks > 0) {
+      okay = pc->type == REDIS_REPLY_STRING && FileMetaCodec::decodeChunks(pc->str, pc->len, f);
+    }
+    size_t blockIdx = packedIdx + 2;
+    if (okay && getUniqueBlocks) {
+      redisReply *pb = r->elements > blockIdx ? r->element[blockIdx] : NULL;
+      okay = pb != NULL && pb->type == REDIS_REPLY_STRING &&
+             FileMetaCodec::decodeBlocks(pb->str, pb->len, /* is unique */ true, f);
+    }
+    if (getBlocks == 1 || getBlocks == 3) blockIdx++;
+    if (okay && getDuplicateBlocks) {
+      redisReply *pb = r->elements > blockIdx ? r->element[blockIdx] : NULL;
+      okay = pb != NULL && pb->type == REDIS_REPLY_STRING &&
+             FileMetaCodec::decodeBlocks(pb->str, pb->len, /* is unique */ false, f);
+    }
+    freeReplyObject(r);
+    r = 0;
+    if (!okay) {
+      LOG(ERROR) << "Failed to parse the packed chunk and block metadata of file " << f.name;
+      return false;
+    }
+    for (int i = 0; i < f.numChunks; i++) {
+      f.chunks[i].setId(f.namespaceId, f.uuid, i);
+      f.chunks[i].data = 0;
+      f.chunks[i].freeData = true;
+      f.chunks[i].fileVersion = f.version;
+    }
+    return true;
   }
 
+  freeReplyObject(r);
+  r = 0;
+
+  // (legacy layout) second round trip: the chunk attributes, and the block attributes for deduplication, each in one
+  // reply
+
+  char cname[MAX_KEY_SIZE], bname[MAX_KEY_SIZE];
+  RedisCommandArgs chunkArgs("HMGET", filename, nameLength);
   for (int i = 0; i < f.numChunks; i++) {
-    if (redisGetReply(_cxt, (void **)&r) != REDIS_OK) {
-      LOG(ERROR) << "Redis reply with error, " << (r ? r->str : "NULL");
-      if (r == NULL) {
-        redisReconnect(_cxt);
+    genChunkKeyPrefix(i, cname);
+    chunkArgs.addField(cname, "-cid");
+    chunkArgs.addField(cname, "-size");
+    chunkArgs.addField(cname, "-md5");
+    chunkArgs.addField(cname, "-bad");
+  }
+  RedisCommandArgs uniqueBlockArgs("HMGET", filename, nameLength);
+  for (size_t i = 0; getUniqueBlocks && i < numUniqueBlocks; i++) {
+    genBlockKey(i, bname, /* is unique */ true);
+    uniqueBlockArgs.add(bname, strlen(bname));
+  }
+  RedisCommandArgs duplicateBlockArgs("HMGET", filename, nameLength);
+  for (size_t i = 0; getDuplicateBlocks && i < numDuplicateBlocks; i++) {
+    genBlockKey(i, bname, /* is unique */ false);
+    duplicateBlockArgs.add(bname, strlen(bname));
+  }
+
+  // send all commands before reading any reply
+  RedisCommandArgs *commands[] = {&chunkArgs, &uniqueBlockArgs, &duplicateBlockArgs};
+  for (int i = 0; i < 3; i++) {
+    if (commands[i]->hasFields()) commands[i]->append(cxt);
+  }
+  // read all replies, so that none is left on the connection upon parsing errors
+  RedisReplyPtr chunkReply(0, freeReplyObject), uniqueBlockReply(0, freeReplyObject),
+      duplicateBlockReply(0, freeReplyObject);
+  RedisReplyPtr *commandReplies[] = {&chunkReply, &uniqueBlockReply, &duplicateBlockReply};
+  for (int i = 0; i < 3; i++) {
+    if (!commands[i]->hasFields()) continue;
+    redisReply *reply = 0;
+    if (redisGetReply(cxt, (void **)&reply) != REDIS_OK) {
+      LOG(ERROR) << "Redis reply with error, " << (reply ? reply->str : "NULL");
+      if (reply == NULL) {
+        redisReconnect(cxt);
       }
-      freeReplyObject(r);
-      r = 0;
+      freeReplyObject(reply);
       return false;
     }
+    commandReplies[i]->reset(reply);
+  }
 
-    if (r->type != REDIS_REPLY_ARRAY || r->elements < 2) {
+  if (f.numChunks > 0) {
+    r = chunkReply.release();
+    if (r->type != REDIS_REPLY_ARRAY || r->elements < (size_t)f.numChunks * 4) {
+      LOG(ERROR) << "Not enough field for chunk metadata (" << r->elements << ", " << r->type << ")";
       freeReplyObject(r);
       r = 0;
-      LOG(ERROR) << "Not enough field for chunk metadata (" << r->elements << ", " << r->type << ")";
       return false;
     }
+  }
 
-    check_and_copy_field(&f.containerIds[i], 0, sizeof(int));
-    check_and_copy_field(&f.chunks[i].size, 1, sizeof(int));
-    check_and_copy_or_set_field(f.chunks[i].md5, 2, MD5_DIGEST_LENGTH, 0);
-    f.chunksCorrupted[i] = r->elements <= 3 ? false : (bool)atoi(r->element[3]->str);
+  for (int i = 0; i < f.numChunks; i++) {
+    check_and_copy_field(&f.containerIds[i], i * 4, sizeof(int));
+    check_and_copy_field(&f.chunks[i].size, i * 4 + 1, sizeof(int));
+    check_and_copy_or_set_field(f.chunks[i].md5, (size_t)i * 4 + 2, MD5_DIGEST_LENGTH, 0);
+    f.chunksCorrupted[i] =
+        r->element[i * 4 + 3]->type != REDIS_REPLY_STRING ? false : (bool)atoi(r->element[i * 4 + 3]->str);
     f.chunks[i].setId(f.namespaceId, f.uuid, i);
     f.chunks[i].data = 0;
     f.chunks[i].freeData = true;
     f.chunks[i].fileVersion = f.version;
-    freeReplyObject(r);
-    r = 0;
   }
+  freeReplyObject(r);
+  r = 0;
 
   // get block attributes for deduplication
   BlockLocation::InObjectLocation loc;
   Fingerprint fp;
-  char bname[MAX_KEY_SIZE];
-  if (getBlocks == 1 || getBlocks == 3) {  // unique blocks
-
+  if (getUniqueBlocks) {  // unique blocks
     int pOffset = 0;
-    for (size_t i = 0; i < numUniqueBlocks; i++) {
-      genBlockKey(i, bname, /* is unique */ true);
-      redisAppendCommand(_cxt, "HMGET %b %s", filename, (size_t)nameLength, bname);
-    }
-
     int noFpOfs = sizeof(unsigned long int) + sizeof(unsigned int);
     int hasFpOfs = sizeof(unsigned long int) + sizeof(unsigned int) + SHA256_DIGEST_LENGTH;
     int lengthWithFp = sizeof(unsigned long int) + sizeof(unsigned int) + SHA256_DIGEST_LENGTH + sizeof(int);
+
+    r = uniqueBlockReply.release();
+    if (r->type != REDIS_REPLY_ARRAY || r->elements != numUniqueBlocks) {
+      LOG(ERROR) << "Failed to get metadata for unique blocks of file " << f.name << ", type = " << r->type
+                 << " num = " << r->elements;
+      freeReplyObject(r);
+      r = 0;
+      return false;
+    }
     for (size_t i = 0; i < numUniqueBlocks; i++) {
-      if (redisGetReply(_cxt, (void **)&r) != REDIS_OK) {
-        LOG(ERROR) << "Redis reply with error, " << (r ? r->str : "NULL");
-        if (r == NULL) {
-          redisReconnect(_cxt);
-        }
-        freeReplyObject(r);
-        r = 0;
-        return false;
-      }
-      if (r->type != REDIS_REPLY_ARRAY || r->elements != 1) {
-        LOG(ERROR) << "Failed to get metadata for block " << i << " of file " << f.name << ", type = " << r->type
-                   << " num = " << r->elements;
-        freeReplyObject(r);
-        r = 0;
-        return false;
-      }
-      check_and_copy_field_at_offset(&loc._offset, 0, 0, sizeof(unsigned long int));
-      check_and_copy_field_at_offset(&loc._length, 0, sizeof(unsigned long int), sizeof(unsigned int));
-      if (r->element[0]->len >= lengthWithFp) {
-        fp.set(r->element[0]->str + noFpOfs, SHA256_DIGEST_LENGTH);
-        check_and_copy_field_at_offset(&pOffset, 0, hasFpOfs, sizeof(int));
+      check_and_copy_field_at_offset(&loc._offset, i, 0, sizeof(unsigned long int));
+      check_and_copy_field_at_offset(&loc._length, i, sizeof(unsigned long int), sizeof(unsigned int));
+      if (r->element[i]->len >= lengthWithFp) {
+        fp.set(r->element[i]->str + noFpOfs, SHA256_DIGEST_LENGTH);
+        check_and_copy_field_at_offset(&pOffset, i, hasFpOfs, sizeof(int));
       } else {
-        check_and_copy_field_at_offset(&pOffset, 0, noFpOfs, sizeof(int));
+        check_and_copy_field_at_offset(&pOffset, i, noFpOfs, sizeof(int));
       }
       auto followIt =
           f.uniqueBlocks
               .end();  // hint is the item after the element to insert for c++11, and before the element for c++98
       f.uniqueBlocks.emplace_hint(followIt, std::make_pair(loc, std::make_pair(fp, pOffset)));
-
-      freeReplyObject(r);
-      r = 0;
     }
+    freeReplyObject(r);
+    r = 0;
   }
-  if (getBlocks == 2 || getBlocks == 3) {  // duplicate blocks
-    for (size_t i = 0; i < numDuplicateBlocks; i++) {
-      genBlockKey(i, bname, /* is unique */ false);
-      redisAppendCommand(_cxt, "HMGET %b %s", filename, (size_t)nameLength, bname);
-    }
-
+  if (getDuplicateBlocks) {  // duplicate blocks
     int noFpOfs = sizeof(unsigned long int) + sizeof(unsigned int);
     int lengthWithFp = sizeof(unsigned long int) + sizeof(unsigned int) + SHA256_DIGEST_LENGTH;
+
+    r = duplicateBlockReply.release();
+    if (r->type != REDIS_REPLY_ARRAY || r->elements != numDuplicateBlocks) {
+      LOG(ERROR) << "Failed to get metadata for duplicate blocks of file " << f.name << ", type = " << r->type
+                 << " num = " << r->elements;
+      freeReplyObject(r);
+      r = 0;
+      return false;
+    }
     for (size_t i = 0; i < numDuplicateBlocks; i++) {
-      if (redisGetReply(_cxt, (void **)&r) != REDIS_OK) {
-        LOG(ERROR) << "Redis reply with error, " << (r ? r->str : "NULL");
-        if (r == NULL) {
-          redisReconnect(_cxt);
-        }
-        freeReplyObject(r);
-        r = 0;
-        return false;
-      }
-      if (r->type != REDIS_REPLY_ARRAY || r->elements != 1) {
-        LOG(ERROR) << "Failed to get metadata for block " << i << " of file " << f.name << ", type = " << r->type
-                   << " num = " << r->elements;
-        freeReplyObject(r);
-        r = 0;
-        return false;
-      }
-      check_and_copy_field_at_offset(&loc._offset, 0, 0, sizeof(unsigned long int));
-      check_and_copy_field_at_offset(&loc._length, 0, sizeof(unsigned long int), sizeof(unsigned int));
-      if (r->element[0]->len >= lengthWithFp) {
-        fp.set(r->element[0]->str + noFpOfs, SHA256_DIGEST_LENGTH);
+      check_and_copy_field_at_offset(&loc._offset, i, 0, sizeof(unsigned long int));
+      check_and_copy_field_at_offset(&loc._length, i, sizeof(unsigned long int), sizeof(unsigned int));
+      if (r->element[i]->len >= lengthWithFp) {
+        fp.set(r->element[i]->str + noFpOfs, SHA256_DIGEST_LENGTH);
       }
       auto followIt =
           f.duplicateBlocks
               .end();  // hint is the item after the element to insert for c++11, and before the element for c++98
       f.duplicateBlocks.emplace_hint(followIt, std::make_pair(loc, fp));
-
-      freeReplyObject(r);
-      r = 0;
     }
+    freeReplyObject(r);
+    r = 0;
   }
 
 #undef check_and_copy_field
@@ -537,6 +954,7 @@ bool RedisMetaStore::getMeta(File &f, int getBlocks) {
 }
 
 bool RedisMetaStore::deleteMeta(File &f) {
+  CachedMetaInvalidation invalidation(this, f);
   char filename[PATH_MAX], vfilename[PATH_MAX], vlname[PATH_MAX];
   int nameLength = genFileKey(f.namespaceId, f.name, f.nameLength, filename);
   int vlnameLength = genFileVersionListKey(f.namespaceId, f.name, f.nameLength, vlname);
@@ -575,16 +993,18 @@ bool RedisMetaStore::deleteMeta(File &f) {
     return ret;
   }
 
+  Connection cxt(this);
+
   // delete a specific version
   if (isVersioned && versionToDelete != -1) {
     int curVersion = -1, numVersions = 0, versionToRemove = -1;
     // find the current version
-    redisReply *vr = (redisReply *)redisCommand(_cxt, "HGET %b ver", filename, (size_t)nameLength);
+    redisReply *vr = (redisReply *)redisCommand(cxt, "HGET %b ver", filename, (size_t)nameLength);
     if (vr == NULL || vr->type != REDIS_REPLY_STRING) {
       LOG(ERROR) << "Failed to find current version number of file " << f.name << " with previous version "
                  << f.version;
       if (vr == NULL) {
-        redisReconnect(_cxt);
+        redisReconnect(cxt);
       }
       freeReplyObject(vr);
       return false;
@@ -592,7 +1012,7 @@ bool RedisMetaStore::deleteMeta(File &f) {
     memcpy(&curVersion, vr->str, sizeof(int));
     freeReplyObject(vr);
     // find the number of versions
-    vr = (redisReply *)redisCommand(_cxt, "ZCARD %b", vlname, (size_t)vlnameLength);
+    vr = (redisReply *)redisCommand(cxt, "ZCARD %b", vlname, (size_t)vlnameLength);
     if (vr != NULL && vr->type == REDIS_REPLY_INTEGER) {
       numVersions = vr->integer;
     }
@@ -602,13 +1022,13 @@ bool RedisMetaStore::deleteMeta(File &f) {
       // rename the 2nd latest version as the latest one
       if (numVersions > 0) {
         // find the 2nd latest version
-        vr = (redisReply *)redisCommand(_cxt, "ZREVRANGEBYSCORE %b +inf -inf WITHSCORES LIMIT 0 1", vlname,
+        vr = (redisReply *)redisCommand(cxt, "ZREVRANGEBYSCORE %b +inf -inf WITHSCORES LIMIT 0 1", vlname,
                                         (size_t)vlnameLength);
         if (vr == NULL || vr->type != REDIS_REPLY_ARRAY || vr->elements < 2 ||
             vr->element[0]->type != REDIS_REPLY_STRING) {
           LOG(ERROR) << "Failed to find 2nd latest version of file " << f.name << " for replacing the current version";
           if (vr == NULL) {
-            redisReconnect(_cxt);
+            redisReconnect(cxt);
           }
           freeReplyObject(vr);
           return false;
@@ -617,13 +1037,13 @@ bool RedisMetaStore::deleteMeta(File &f) {
         freeReplyObject(vr);
         // rename 2nd latest version as the current one
         vnameLength = genVersionedFileKey(f.namespaceId, f.name, f.nameLength, versionToRemove, vfilename);
-        vr = (redisReply *)redisCommand(_cxt, "RENAME %b %b", vfilename, (size_t)vnameLength, filename,
+        vr = (redisReply *)redisCommand(cxt, "RENAME %b %b", vfilename, (size_t)vnameLength, filename,
                                         (size_t)nameLength);
         if (vr == NULL || strncmp(vr->str, "OK", 2) != 0) {
           LOG(ERROR) << "Failed to rename 2nd latest version of file " << f.name
                      << " to the current version, reply = " << (void *)vr << " result " << (vr ? vr->str : "NIL");
           if (vr == NULL) {
-            redisReconnect(_cxt);
+            redisReconnect(cxt);
           }
           freeReplyObject(vr);
           return false;
@@ -642,14 +1062,14 @@ bool RedisMetaStore::deleteMeta(File &f) {
     }
     if (versionToRemove != -1) {
       // remove the version from version list
-      vr = (redisReply *)redisCommand(_cxt, "ZREMRANGEBYSCORE %b %d %d", vlname, (size_t)vlnameLength, versionToRemove,
+      vr = (redisReply *)redisCommand(cxt, "ZREMRANGEBYSCORE %b %d %d", vlname, (size_t)vlnameLength, versionToRemove,
                                       versionToRemove);
       DLOG(INFO) << "Remove version " << versionToRemove << " from version list of file " << f.name;
       freeReplyObject(vr);
       // remove old version if not renamed to the current one
       if (curVersion != f.version) {
         vnameLength = genVersionedFileKey(f.namespaceId, f.name, f.nameLength, f.version, vfilename);
-        vr = (redisReply *)redisCommand(_cxt, "DEL %b", vfilename, (size_t)vnameLength);
+        vr = (redisReply *)redisCommand(cxt, "DEL %b", vfilename, (size_t)vnameLength);
         freeReplyObject(vr);
       }
       // let the caller handle the data (deletion), without removing the reverted index
@@ -657,13 +1077,12 @@ bool RedisMetaStore::deleteMeta(File &f) {
     }
   }
 
-  std::lock_guard<std::mutex> lk(_lock);
-  redisReply *r = (redisReply *)redisCommand(_cxt, "DEL %b", filename, (size_t)nameLength);
+  redisReply *r = (redisReply *)redisCommand(cxt, "DEL %b", filename, (size_t)nameLength);
 
   if (r == NULL || r->type != REDIS_REPLY_INTEGER || r->integer <= 0) {
     LOG(ERROR) << "Failed to delete file metadata of file " << f.name;
     if (r == NULL) {
-      redisReconnect(_cxt);
+      redisReconnect(cxt);
     }
     freeReplyObject(r);
     r = 0;
@@ -680,42 +1099,24 @@ bool RedisMetaStore::deleteMeta(File &f) {
   if (!genFileUuidKey(f.namespaceId, f.uuid, fidKey)) {
     LOG(WARNING) << "File uuid" << boost::uuids::to_string(f.uuid) << " is too long to generate a reverse key mapping";
   } else {
-    r = (redisReply *)redisCommand(_cxt, "DEL %s", fidKey);
+    r = (redisReply *)redisCommand(cxt, "DEL %s", fidKey);
   }
   if (r == NULL || r->type != REDIS_REPLY_INTEGER || r->integer <= 0) {
     LOG(WARNING) << "Failed to delete reverse mapping of file " << f.name << " (" << fidKey;
     if (r == NULL) {
-      redisReconnect(_cxt);
+      redisReconnect(cxt);
     }
     // ret = false;
   }
   freeReplyObject(r);
   r = 0;
 
-  // remove the file name from the file list of its directory;
-  // check the number of files remains in the directory;
-  // remove the directory from the directory list if the directory has no files left
-  std::string script =
-      "local ret = redis.call('SREM', KEYS[1], ARGV[1]); \
-        local val = redis.call('SCARD', KEYS[1]); \
-        if val == 0 then \
-            return redis.call('SREM', KEYS[2], KEYS[1]); \
-        end \
-        return ret;";
   // remove file from prefix set
-  r = (redisReply *)redisCommand(_cxt, "EVAL %s 2 %s %s %b", script.c_str(), prefix.c_str(), DIR_LIST_KEY, filename,
-                                 (size_t)nameLength);
-
-  if (r == NULL || r->type != REDIS_REPLY_INTEGER || r->integer <= 0) {
+  if (!removeFromDirectory(cxt, prefix, filename, nameLength)) {
     LOG(WARNING) << "Failed to delete the prefix record (" << prefix << ") of file " << f.name << " (" << filename
                  << ")";
-    if (r == NULL) {
-      redisReconnect(_cxt);
-    }
     // ret = false;
   }
-  freeReplyObject(r);
-  r = 0;
 
   return ret;
 }
@@ -735,16 +1136,18 @@ bool RedisMetaStore::renameMeta(File &sf, File &df) {
   if (!genFileUuidKey(sf.namespaceId, sf.uuid, sfidKey)) return false;
   if (!genFileUuidKey(df.namespaceId, df.uuid, dfidKey)) return false;
 
+  CachedMetaInvalidation sinvalidation(this, sf), dinvalidation(this, df);
+
   // update file names
-  std::lock_guard<std::mutex> lk(_lock);
+  Connection cxt(this);
   redisReply *r =
-      (redisReply *)redisCommand(_cxt, "RENAMENX %b %b", sfname, (size_t)snameLength, dfname, (size_t)dnameLength);
+      (redisReply *)redisCommand(cxt, "RENAMENX %b %b", sfname, (size_t)snameLength, dfname, (size_t)dnameLength);
   if (r == NULL || r->type != REDIS_REPLY_INTEGER || r->integer != 1) {
     LOG(ERROR) << "Failed to rename file from " << sf.name << " (" << (int)sf.namespaceId << ") to " << df.name << " ("
                << (int)df.namespaceId << "), "
                << (r == NULL || r->type != REDIS_REPLY_INTEGER ? "error" : "target name already exists");
     if (r == NULL) {
-      redisReconnect(_cxt);
+      redisReconnect(cxt);
     }
     freeReplyObject(r);
     r = 0;
@@ -755,7 +1158,7 @@ bool RedisMetaStore::renameMeta(File &sf, File &df) {
   r = 0;
 
   // create a uuid key to the new file name
-  r = (redisReply *)redisCommand(_cxt, "SET %s %b", dfidKey, dfname, (size_t)dnameLength);
+  r = (redisReply *)redisCommand(cxt, "SET %s %b", dfidKey, dfname, (size_t)dnameLength);
 
   DLOG(INFO) << "Add reverse mapping (" << dfidKey << ") for file " << dfname;
 
@@ -763,14 +1166,14 @@ bool RedisMetaStore::renameMeta(File &sf, File &df) {
     freeReplyObject(r);
     r = 0;
     // also update uuids
-    r = (redisReply *)redisCommand(_cxt, "DEL %s", sfidKey);
+    r = (redisReply *)redisCommand(cxt, "DEL %s", sfidKey);
   } else {
     freeReplyObject(r);
     r = 0;
     // undo the rename of file
-    r = (redisReply *)redisCommand(_cxt, "RENAME %b %b", dfname, (size_t)dnameLength, sfname, (size_t)snameLength);
+    r = (redisReply *)redisCommand(cxt, "RENAME %b %b", dfname, (size_t)dnameLength, sfname, (size_t)snameLength);
     if (r == NULL) {
-      redisReconnect(_cxt);
+      redisReconnect(cxt);
     }
     freeReplyObject(r);
     r = 0;
@@ -780,15 +1183,15 @@ bool RedisMetaStore::renameMeta(File &sf, File &df) {
   freeReplyObject(r);
   r = 0;
 
-  r = (redisReply *)redisCommand(_cxt, "HSET %b uuid %s", dfname, (size_t)dnameLength,
+  r = (redisReply *)redisCommand(cxt, "HSET %b uuid %s", dfname, (size_t)dnameLength,
                                  boost::uuids::to_string(df.uuid).c_str());
 
   if (r == NULL || r->type == REDIS_REPLY_ERROR) {
     if (r == NULL) {
-      redisReconnect(_cxt);
+      redisReconnect(cxt);
     }
     // undo the rename of file
-    r = (redisReply *)redisCommand(_cxt, "RENAME %b %b", dfname, (size_t)dnameLength, sfname, (size_t)snameLength);
+    r = (redisReply *)redisCommand(cxt, "RENAME %b %b", dfname, (size_t)dnameLength, sfname, (size_t)snameLength);
     freeReplyObject(r);
     r = 0;
     return false;
@@ -797,44 +1200,41 @@ bool RedisMetaStore::renameMeta(File &sf, File &df) {
   freeReplyObject(r);
   r = 0;
 
-  // remove file from prefix set
-  r = (redisReply *)redisCommand(_cxt, "SREM %s %b", sprefix.c_str(), sfname, (size_t)snameLength);
-
-  if (r == NULL || r->type != REDIS_REPLY_INTEGER || r->integer <= 0) {
+  // remove file from prefix set (and the source directory from the directory list and index if it becomes empty)
+  if (!removeFromDirectory(cxt, sprefix, sfname, snameLength)) {
     LOG(ERROR) << "Failed to delete the prefix record of source file " << sfname << " (" << sfidKey;
-    if (r == NULL) {
-      redisReconnect(_cxt);
-    }
   }
 
-  freeReplyObject(r);
-  r = 0;
-
-  // add file to new prefix set
-  r = (redisReply *)redisCommand(_cxt, "SADD %s %b", dprefix.c_str(), dfname, (size_t)dnameLength);
-
-  if (r == NULL || r->type != REDIS_REPLY_INTEGER || r->integer <= 0) {
-    LOG(ERROR) << "Failed to add the prefix record of dest file " << dfname << " (" << dfidKey;
-    if (r == NULL) {
-      redisReconnect(_cxt);
+  // add file to new prefix set (and the destination directory to the directory list and index)
+  int numReplies = appendAddToDirectoryCommands(cxt, dprefix, dfname, dnameLength);
+  for (int i = 0; i < numReplies; i++) {
+    if (redisGetReply(cxt, (void **)&r) != REDIS_OK || r == NULL) {
+      LOG(ERROR) << "Failed to add the prefix record of dest file " << dfname << " (" << dfidKey;
+      redisReconnect(cxt);
+      break;
+    }
+    if (r->type != REDIS_REPLY_INTEGER) {
+      LOG(ERROR) << "Failed to add the prefix record of dest file " << dfname << " (" << dfidKey;
     }
+    freeReplyObject(r);
+    r = 0;
   }
 
-  freeReplyObject(r);
-  r = 0;
-
   // TODO update the background task pending list
 
   return true;
 }
 
 bool RedisMetaStore::updateTimestamps(const File &f) {
-  std::lock_guard<std::mutex> lk(_lock);
+  // keep the cached metadata, as timestamps are updated on every read; other Proxies may see outdated timestamps
+  if (_metaCache) _metaCache->updateTimestamps(FileMetaCache::genKey(f.namespaceId, f.name, f.nameLength), f);
+
+  Connection cxt(this);
 
   char fname[PATH_MAX];
   int fnameLength = genFileKey(f.namespaceId, f.name, f.nameLength, fname);
 
-  redisReply *r = (redisReply *)redisCommand(_cxt, "HMSET %b atime %b mtime %b tctime %b", fname, (size_t)fnameLength,
+  redisReply *r = (redisReply *)redisCommand(cxt, "HMSET %b atime %b mtime %b tctime %b", fname, (size_t)fnameLength,
                                              &f.atime, (size_t)sizeof(time_t), &f.mtime, (size_t)sizeof(time_t),
                                              &f.tctime, (size_t)sizeof(time_t));
 
@@ -842,7 +1242,7 @@ bool RedisMetaStore::updateTimestamps(const File &f) {
     LOG(ERROR) << "Failed to update timestamps of file " << f.name << " (" << (int)f.namespaceId << "), "
                << (r == NULL || r->type != REDIS_REPLY_STATUS ? "error" : "reply is not \"OK\"");
     if (r == NULL) {
-      redisReconnect(_cxt);
+      redisReconnect(cxt);
     }
     freeReplyObject(r);
     r = 0;
@@ -856,45 +1256,64 @@ bool RedisMetaStore::updateTimestamps(const File &f) {
 }
 
 int RedisMetaStore::updateChunks(const File &f, int version) {
-  std::lock_guard<std::mutex> lk(_lock);
+  CachedMetaInvalidation invalidation(this, f);
+  Connection cxt(this);
 
   char fname[PATH_MAX];
-  // int nameLength = genFileKey(f.namespaceId, f.name, f.nameLength, fname);
-  genFileKey(f.namespaceId, f.name, f.nameLength, fname);
+  int nameLength = genFileKey(f.namespaceId, f.name, f.nameLength, fname);
 
   // check the version and set the chunk metadata if match
-  std::string script =
+  // ARGV: version, then (chunk id, container id, chunk size) of each chunk to update
+  // the packed chunk attributes begin with the format and the number of chunks (8 bytes), followed by the container
+  // ids and chunk sizes (see FileMetaCodec)
+  static const char *script =
       "local v = struct.unpack('I', redis.call('hget', KEYS[1], 'ver')); \
-            if v == tonumber(ARGV[1]) then \
-                return redis.call(";
-  script.append("'HMSET'");
-  script.append(",'");
-  script.append(fname);
-  script.append("'");
-  char cname[MAX_KEY_SIZE];
-  for (int i = 0; i < f.numChunks; i++) {
-    genChunkKeyPrefix(f.chunks[i].getChunkId(), cname);
-    script.append(",'");
-    script.append(cname);
-    script.append("-cid',struct.pack('I',");
-    script.append(std::to_string(f.containerIds[i]));
-    script.append("),'");
-    script.append(cname);
-    script.append("-size',struct.pack('I',");
-    script.append(std::to_string(f.chunks[i].size));
-    script.append(")");
-  }
-  script.append(
-      "); \
-            else \
+            if v ~= tonumber(ARGV[1]) then \
                 return 1; \
             end; \
-        return 2");
-  DLOG(INFO) << "Lua Script: " << script;
-  // container ids
-  redisReply *r = (redisReply *)redisCommand(_cxt, "EVAL %s 1 %s %d", script.c_str(), fname, f.version);
+            if redis.call('hexists', KEYS[1], '" FILE_META_FORMAT_FIELD "') == 1 then \
+                local p = redis.call('hget', KEYS[1], '" FILE_PACKED_CHUNKS_FIELD "'); \
+                if not p or string.len(p) < 8 then \
+                    return 2; \
+                end; \
+                local n = struct.unpack('I', p, 5); \
+                for i = 2, #ARGV, 3 do \
+                    local c = tonumber(ARGV[i]); \
+                    if c >= 0 and c < n then \
+                        local o = 8 + 4 * c; \
+                        p = string.sub(p, 1, o) .. struct.pack('I', tonumber(ARGV[i + 1])) .. string.sub(p, o + 5); \
+                        o = 8 + 4 * n + 4 * c; \
+                        p = string.sub(p, 1, o) .. struct.pack('I', tonumber(ARGV[i + 2])) .. string.sub(p, o + 5); \
+                    end; \
+                end; \
+                return redis.call('HMSET', KEYS[1], '" FILE_PACKED_CHUNKS_FIELD "', p); \
+            end; \
+            local fields = {}; \
+            for i = 2, #ARGV, 3 do \
+                table.insert(fields, 'c' .. ARGV[i] .. '-cid'); \
+                table.insert(fields, struct.pack('I', tonumber(ARGV[i + 1]))); \
+                table.insert(fields, 'c' .. ARGV[i] .. '-size'); \
+                table.insert(fields, struct.pack('I', tonumber(ARGV[i + 2]))); \
+            end; \
+            return redis.call('HMSET', KEYS[1], unpack(fields))";
+
+  RedisCommandArgs args("EVAL", script, strlen(script));
+  args.add(std::string("1"));
+  args.add(fname, nameLength);
+  args.add(std::to_string(f.version));
+  for (int i = 0; i < f.numChunks; i++) {
+    args.add(std::to_string(f.chunks[i].getChunkId()));
+    args.add(std::to_string(f.containerIds[i]));
+    args.add(std::to_string(f.chunks[i].size));
+  }
+  DLOG(INFO) << "Update " << f.numChunks << " chunks of file " << fname;
+
+  redisReply *r = 0;
+  if (f.numChunks > 0 && args.append(cxt) == REDIS_OK && redisGetReply(cxt, (void **)&r) != REDIS_OK) {
+    redisReconnect(cxt);
+  }
   int ret = 0;
-  if (!(r != NULL && r->type == REDIS_REPLY_STATUS && strcmp(r->str, "OK") == 0)) {
+  if (f.numChunks > 0 && !(r != NULL && r->type == REDIS_REPLY_STATUS && strcmp(r->str, "OK") == 0)) {
     if (r != NULL && r->type == REDIS_REPLY_INTEGER)
       ret = r->integer;
     else
@@ -911,251 +1330,380 @@ int RedisMetaStore::updateChunks(const File &f, int version) {
 }
 
 bool RedisMetaStore::getFileName(boost::uuids::uuid fuuid, File &f) {
-  std::lock_guard<std::mutex> lk(_lock);
+  Connection cxt(this);
 
   char fidKey[MAX_KEY_SIZE + 64];
   if (!genFileUuidKey(f.namespaceId, fuuid, fidKey)) return false;
-  return getFileName(fidKey, f);
+  return getFileName(cxt, fidKey, f);
+}
+
+/**
+ * Parse the reply of HMGET on the file attributes for file listing (see fileListAttributeFields)
+ **/
+static void parseFileListAttributes(const redisReply *metar, FileInfo &cur) {
+  unsigned long int stagedSize = 0;
+  // size
+  if (metar->element[0]->type == REDIS_REPLY_STRING && metar->element[0]->len == sizeof(unsigned long int))
+    memcpy(&cur.size, metar->element[0]->str, sizeof(unsigned long int));
+  else
+    cur.size = 0;
+  // creation time
+  if (metar->elements >= 2 && metar->element[1]->type == REDIS_REPLY_STRING && metar->element[1]->len == sizeof(time_t))
+    memcpy(&cur.ctime, metar->element[1]->str, sizeof(time_t));
+  else
+    cur.ctime = 0;
+  // last access time
+  if (metar->elements >= 3 && metar->element[2]->type == REDIS_REPLY_STRING && metar->element[2]->len == sizeof(time_t))
+    memcpy(&cur.atime, metar->element[2]->str, sizeof(time_t));
+  else
+    cur.atime = 0;
+  // last modify time
+  if (metar->elements >= 4 && metar->element[3]->type == REDIS_REPLY_STRING && metar->element[3]->len == sizeof(time_t))
+    memcpy(&cur.mtime, metar->element[3]->str, sizeof(time_t));
+  else
+    cur.mtime = 0;
+  // file version
+  if (metar->elements >= 5 && metar->element[4]->type == REDIS_REPLY_STRING && metar->element[4]->len == sizeof(int))
+    memcpy(&cur.version, metar->element[4]->str, sizeof(int));
+  else
+    cur.version = 0;
+  // delete marker
+  if (metar->elements >= 6 && metar->element[5]->type == REDIS_REPLY_STRING && metar->element[5]->len == 1)
+    cur.isDeleted = atoi(metar->element[5]->str);
+  else
+    cur.isDeleted = 0;
+  // md5 checksum
+  if (metar->elements >= 7 && metar->element[6]->type == REDIS_REPLY_STRING &&
+      metar->element[6]->len == MD5_DIGEST_LENGTH)
+    memcpy(&cur.md5, metar->element[6]->str, MD5_DIGEST_LENGTH);
+  // number of chunks
+  if (metar->elements >= 8 && metar->element[7]->type == REDIS_REPLY_STRING && metar->element[7]->len == sizeof(int))
+    memcpy(&cur.numChunks, metar->element[7]->str, sizeof(int));
+  // staged size
+  if (metar->elements >= 9 && metar->element[8]->type == REDIS_REPLY_STRING &&
+      metar->element[8]->len == sizeof(unsigned long int))
+    memcpy(&stagedSize, metar->element[8]->str, sizeof(unsigned long int));
+  // staged last modified time
+  if (metar->elements >= 10 && metar->element[9]->type == REDIS_REPLY_STRING &&
+      metar->element[9]->len == sizeof(time_t)) {
+    time_t mtime = 0;
+    memcpy(&mtime, metar->element[9]->str, sizeof(time_t));
+    // use staged file info if staged file is more updated
+    if (mtime > cur.mtime) {
+      cur.mtime = mtime;
+      cur.atime = mtime;
+      cur.size = stagedSize;
+    }
+  }
+  if (metar->elements >= 11 && metar->element[10]->type == REDIS_REPLY_STRING) {
+    cur.storageClass = std::string(metar->element[10]->str, metar->element[10]->len);
+  }
+}
+
+/**
+ * Parse the reply of ZRANGE on the version list of a file
+ **/
+static void parseFileListVersions(const redisReply *metar, FileInfo &cur) {
+  size_t total = metar->elements;
+  cur.numVersions = total;
+  try {
+    cur.versions = new VersionInfo[total];
+    for (size_t vi = 0; vi < total; vi++) {
+      if (metar->element[vi]->type != REDIS_REPLY_STRING) continue;
+      char *ofs = metar->element[vi]->str;
+      char *end = metar->element[vi]->str + metar->element[vi]->len;
+      for (int vj = 0; vj < 6 && ofs < end; vj++) {
+        if (ofs[0] != '-') {  // if the field is available (not blanked)
+          switch (vj) {
+            case 0:  // version number
+              cur.versions[vi].version = atoi(ofs);
+              break;
+            case 1:  // size
+              memcpy(&cur.versions[vi].size, ofs, sizeof(unsigned long int));
+              break;
+            case 2:  // mtime
+              memcpy(&cur.versions[vi].mtime, ofs, sizeof(time_t));
+              break;
+            case 3:  // md5
+              memcpy(cur.versions[vi].md5, ofs, MD5_DIGEST_LENGTH);
+              break;
+            case 4:  // delete mark
+              cur.versions[vi].isDeleted = atoi(ofs);
+              break;
+            case 5:  // number of chunks
+              memcpy(&cur.versions[vi].numChunks, ofs, sizeof(int));
+              break;
+          }
+        }
+        // find the next whitespace
+        ofs = vj == 5 ? NULL : (char *)memchr(ofs, ' ', metar->element[vi]->len - (metar->element[vi]->str - ofs));
+        if (ofs == NULL || ofs >= end) {
+          break;
+        }
+        // skip the whitespace
+        ofs += 1;
+      }
+      DLOG(INFO) << "Add version " << cur.versions[vi].version << " size " << cur.versions[vi].size << " mtime "
+                 << cur.versions[vi].mtime << " deleted " << cur.versions[vi].isDeleted << " to version list of file "
+                 << cur.name;
+    }
+  } catch (std::exception &e) {
+    LOG(ERROR) << "Cannot allocate memory for " << total << " version records";
+    cur.versions = 0;
+    cur.numVersions = 0;
+  }
 }
 
 unsigned int RedisMetaStore::getFileList(FileInfo **list, unsigned char namespaceId, bool withSize, bool withTime,
                                          bool withVersions, std::string prefix) {
-  std::lock_guard<std::mutex> lk(_lock);
+  Connection cxt(this);
 
   if (namespaceId == INVALID_NAMESPACE_ID) namespaceId = Config::getInstance().getProxyNamespaceId();
 
+  // collect the keys page by page, instead of blocking Redis with KEYS; a key may be returned more than once by scans
+  std::string cursor = "0";
+  std::vector<std::string> keys;
+  std::unordered_set<std::string> uniqueKeys;
+  do {
+    keys.clear();
+    if (!scanFileKeys(cxt, cursor, DEFAULT_FILE_LIST_PAGE_SIZE, namespaceId, prefix, keys)) return 0;
+    uniqueKeys.insert(keys.begin(), keys.end());
+  } while (cursor != "0");
+
+  if (uniqueKeys.empty()) return 0;
+
+  keys.assign(uniqueKeys.begin(), uniqueKeys.end());
+  uniqueKeys.clear();
+  *list = new FileInfo[keys.size()];
+
+  // get the file info in pipelined batches
+  unsigned int numFiles = 0;
+  std::vector<std::string> batch;
+  for (size_t i = 0; i < keys.size(); i += DEFAULT_FILE_LIST_PAGE_SIZE) {
+    batch.assign(keys.begin() + i, keys.begin() + std::min(keys.size(), i + DEFAULT_FILE_LIST_PAGE_SIZE));
+    numFiles += getFileInfoBatch(cxt, batch, list[0] + numFiles, withSize, withTime, withVersions);
+  }
+
+  return numFiles;
+}
+
+unsigned int RedisMetaStore::getFileListPage(FileInfo **list, std::string &cursor, unsigned int pageSize,
+                                             unsigned char namespaceId, bool withSize, bool withTime,
+                                             bool withVersions, std::string prefix) {
+  Connection cxt(this);
+
+  if (namespaceId == INVALID_NAMESPACE_ID) namespaceId = Config::getInstance().getProxyNamespaceId();
+  if (pageSize == 0) pageSize = DEFAULT_FILE_LIST_PAGE_SIZE;
+  pageSize = std::min(pageSize, MAX_FILE_LIST_PAGE_SIZE);
+
+  // the continuation token is the scan cursor, which is "0" at both the start and the end of a scan
+  std::string scanCursor = cursor.empty() ? "0" : cursor;
+  if (scanCursor.find_first_not_of("0123456789") != std::string::npos) {
+    LOG(WARNING) << "Invalid cursor " << cursor << " for listing files";
+    cursor.clear();
+    return 0;
+  }
+
+  std::vector<std::string> keys;
+  if (!scanFileKeys(cxt, scanCursor, pageSize, namespaceId, prefix, keys)) {
+    cursor.clear();
+    return 0;
+  }
+  cursor = scanCursor == "0" ? "" : scanCursor;
+
+  if (keys.empty()) return 0;
+
+  *list = new FileInfo[keys.size()];
+  return getFileInfoBatch(cxt, keys, *list, withSize, withTime, withVersions);
+}
+
+bool RedisMetaStore::scanFileKeys(redisContext *cxt, std::string &cursor, unsigned int count,
+                                  unsigned char namespaceId, const std::string &prefix,
+                                  std::vector<std::string> &keys) {
   std::string sprefix;
   sprefix.append(std::to_string(namespaceId)).append("_").append(prefix);
   sprefix = getFilePrefix(sprefix.c_str());
-  DLOG(INFO) << "prefix = " << prefix << " sprefix = " << sprefix;
+  DLOG(INFO) << "prefix = " << prefix << " sprefix = " << sprefix << " cursor = " << cursor;
+
+  // bound the number of scans per call, which may find few keys matching the prefix in each scan
+  size_t target = keys.size() + count;
+  for (int i = 0; i < MAX_FILE_LIST_SCANS_PER_CALL && keys.size() < target; i++) {
+    unsigned int remaining = target - keys.size();
+    redisReply *r = 0;
+    if (prefix == "" || prefix.back() != '/') {
+      // search all keys
+      r = (redisReply *)redisCommand(cxt, "SCAN %s MATCH %d_%s* COUNT %u", cursor.c_str(), (int)namespaceId,
+                                     prefix.c_str(), remaining);
+    } else {
+      // search prefix set
+      r = (redisReply *)redisCommand(cxt, "SSCAN %s %s COUNT %u", sprefix.c_str(), cursor.c_str(), remaining);
+    }
+    if (r == NULL || r->type != REDIS_REPLY_ARRAY || r->elements != 2 || r->element[0]->type != REDIS_REPLY_STRING ||
+        r->element[1]->type != REDIS_REPLY_ARRAY) {
+      LOG(ERROR) << "Failed to scan metadata store for files, r = " << (void *)r << " type = " << (r ? r->type : -1);
+      if (r == NULL) {
+        redisReconnect(cxt);
+      }
+      freeReplyObject(r);
+      return false;
+    }
 
-  int numFiles = 0;
-  redisReply *r = 0;
-  if (prefix == "" || prefix.back() != '/') {
-    // search all keys
-    r = (redisReply *)redisCommand(_cxt, "KEYS %d_%s*", (int)namespaceId, prefix.c_str());
-  } else {
-    // search prefix set
-    r = (redisReply *)redisCommand(_cxt, "SMEMBERS %s", sprefix.c_str());
+    cursor = r->element[0]->str;
+    for (size_t j = 0; j < r->element[1]->elements; j++) {
+      redisReply *key = r->element[1]->element[j];
+      if (key->type != REDIS_REPLY_STRING || isSystemKey(key->str)) continue;
+      keys.emplace_back(key->str, key->len);
+    }
+    freeReplyObject(r);
+
+    if (cursor == "0") break;
   }
-  if (r != NULL && r->type != REDIS_REPLY_ERROR) {
-    if (r->elements > 0) *list = new FileInfo[r->elements];
-    for (size_t i = 0; i < r->elements; i++) {
-      if (r->element[i]->type != REDIS_REPLY_STRING) continue;
-      if (isSystemKey(r->element[i]->str)) continue;
-      // full name in form of "namespaceId_filename"
-      if (!getNameFromFileKey(r->element[i]->str, r->element[i]->len, &list[0][numFiles].name,
-                              list[0][numFiles].nameLength, list[0][numFiles].namespaceId)) {
-        continue;
-      }
-      FileInfo &cur = list[0][numFiles];
-      // get file size and time if requested
-      if (withSize || withTime || withVersions) {
-        redisReply *metar = (redisReply *)redisCommand(
-            _cxt, "HMGET %s size ctime atime mtime ver dm md5 numC sg_size sg_mtime sc", r->element[i]->str);
-        if (metar == NULL || metar->type != REDIS_REPLY_ARRAY || metar->elements < 1) {
-          LOG(WARNING) << "Cannot get file size and time of file " << cur.name
-                       << ", reply type = " << (metar == NULL ? -1 : metar->type);
-          freeReplyObject(metar);
-          metar = 0;
-          continue;
-        } else {
-          unsigned long int stagedSize = 0;
-          // size
-          if (metar->element[0]->type == REDIS_REPLY_STRING && metar->element[0]->len == sizeof(unsigned long int))
-            memcpy(&cur.size, metar->element[0]->str, sizeof(unsigned long int));
-          else
-            cur.size = 0;
-          // creation time
-          if (metar->elements >= 2 && metar->element[1]->type == REDIS_REPLY_STRING &&
-              metar->element[1]->len == sizeof(time_t))
-            memcpy(&cur.ctime, metar->element[1]->str, sizeof(time_t));
-          else
-            cur.ctime = 0;
-          // last access time
-          if (metar->elements >= 3 && metar->element[2]->type == REDIS_REPLY_STRING &&
-              metar->element[2]->len == sizeof(time_t))
-            memcpy(&cur.atime, metar->element[2]->str, sizeof(time_t));
-          else
-            cur.atime = 0;
-          // last modify time
-          if (metar->elements >= 4 && metar->element[3]->type == REDIS_REPLY_STRING &&
-              metar->element[3]->len == sizeof(time_t))
-            memcpy(&cur.mtime, metar->element[3]->str, sizeof(time_t));
-          else
-            cur.mtime = 0;
-          // file version
-          if (metar->elements >= 5 && metar->element[4]->type == REDIS_REPLY_STRING &&
-              metar->element[4]->len == sizeof(int))
-            memcpy(&cur.version, metar->element[4]->str, sizeof(int));
-          else
-            cur.version = 0;
-          // delete marker
-          if (metar->elements >= 6 && metar->element[5]->type == REDIS_REPLY_STRING && metar->element[5]->len == 1)
-            cur.isDeleted = atoi(metar->element[5]->str);
-          else
-            cur.isDeleted = 0;
-          // md5 checksum
-          if (metar->elements >= 7 && metar->element[6]->type == REDIS_REPLY_STRING &&
-              metar->element[6]->len == MD5_DIGEST_LENGTH)
-            memcpy(&cur.md5, metar->element[6]->str, MD5_DIGEST_LENGTH);
-          // number of chunks
-          if (metar->elements >= 8 && metar->element[7]->type == REDIS_REPLY_STRING &&
-              metar->element[7]->len == sizeof(int))
-            memcpy(&cur.numChunks, metar->element[7]->str, sizeof(int));
-          // staged size
-          if (metar->elements >= 9 && metar->element[8]->type == REDIS_REPLY_STRING &&
-              metar->element[8]->len == sizeof(unsigned long int))
-            memcpy(&stagedSize, metar->element[8]->str, sizeof(unsigned long int));
-          // staged last modified time
-          if (metar->elements >= 10 && metar->element[9]->type == REDIS_REPLY_STRING &&
-              metar->element[9]->len == sizeof(time_t)) {
-            time_t mtime = 0;
-            memcpy(&mtime, metar->element[9]->str, sizeof(time_t));
-            // use staged file info if staged file is more updated
-            if (mtime > cur.mtime) {
-              cur.mtime = mtime;
-              cur.atime = mtime;
-              cur.size = stagedSize;
-            }
-          }
-          if (metar->elements >= 11 && metar->element[10]->type == REDIS_REPLY_STRING) {
-            cur.storageClass = std::string(metar->element[10]->str, metar->element[10]->len);
-          }
-        }
-        freeReplyObject(metar);
-        metar = 0;
-      }
-      // do not add delete marker to the list unless for queries on versions
-      if (!withVersions && cur.isDeleted) {
+
+  return true;
+}
+
+unsigned int RedisMetaStore::getFileInfoBatch(redisContext *cxt, const std::vector<std::string> &keys, FileInfo *list,
+                                              bool withSize, bool withTime, bool withVersions) {
+  bool withAttributes = withSize || withTime || withVersions;
+
+  // get file size and time if requested, all in one pipeline
+  if (withAttributes) {
+    for (size_t i = 0; i < keys.size(); i++) {
+      RedisCommandArgs args("HMGET", keys.at(i).data(), keys.at(i).size());
+      for (size_t j = 0; j < numFileListAttributeFields; j++)
+        args.add(fileListAttributeFields[j], strlen(fileListAttributeFields[j]));
+      args.append(cxt);
+    }
+  }
+
+  // read all replies before parsing, to keep the connection in sync
+  std::vector<RedisReplyPtr> replies;
+  for (size_t i = 0; withAttributes && i < keys.size(); i++) {
+    redisReply *reply = 0;
+    if (redisGetReply(cxt, (void **)&reply) != REDIS_OK) {
+      LOG(ERROR) << "Failed to get file size and time of files";
+      redisReconnect(cxt);
+      return 0;
+    }
+    replies.emplace_back(reply, freeReplyObject);
+  }
+
+  unsigned int numFiles = 0;
+  for (size_t i = 0; i < keys.size(); i++) {
+    FileInfo &cur = list[numFiles];
+    // full name in form of "namespaceId_filename"
+    if (!getNameFromFileKey(keys.at(i).data(), keys.at(i).size(), &cur.name, cur.nameLength, cur.namespaceId)) {
+      continue;
+    }
+    if (withAttributes) {
+      redisReply *metar = replies.at(i).get();
+      if (metar == NULL || metar->type != REDIS_REPLY_ARRAY || metar->elements < 1) {
+        LOG(WARNING) << "Cannot get file size and time of file " << cur.name
+                     << ", reply type = " << (metar == NULL ? -1 : metar->type);
+        free(cur.name);
+        cur.reset();
         continue;
       }
-      if (withVersions && cur.version > 0) {
-        char vlname[PATH_MAX];
-        int vlnameLength = genFileVersionListKey(cur.namespaceId, cur.name, cur.nameLength, vlname);
-        redisReply *metar = (redisReply *)redisCommand(_cxt, "ZRANGE %b 0 %d", vlname, vlnameLength, cur.version);
-        if (metar == NULL || metar->type != REDIS_REPLY_ARRAY || metar->elements < 1) {
-          DLOG(INFO) << "No version summary " << cur.name << ", reply type = " << (metar == NULL ? -1 : metar->type);
-          if (metar == NULL) {
-            redisReconnect(_cxt);
-          }
-        } else {
-          size_t total = metar->elements;
-          cur.numVersions = total;
-          try {
-            cur.versions = new VersionInfo[total];
-            for (size_t vi = 0; vi < total; vi++) {
-              if (metar->element[vi]->type != REDIS_REPLY_STRING) continue;
-              char *ofs = metar->element[vi]->str;
-              char *end = metar->element[vi]->str + metar->element[vi]->len;
-              for (int vj = 0; vj < 6 && ofs < end; vj++) {
-                if (ofs[0] != '-') {  // if the field is available (not blanked)
-                  switch (vj) {
-                    case 0:  // version number
-                      cur.versions[vi].version = atoi(ofs);
-                      break;
-                    case 1:  // size
-                      memcpy(&cur.versions[vi].size, ofs, sizeof(unsigned long int));
-                      break;
-                    case 2:  // mtime
-                      memcpy(&cur.versions[vi].mtime, ofs, sizeof(time_t));
-                      break;
-                    case 3:  // md5
-                      memcpy(cur.versions[vi].md5, ofs, MD5_DIGEST_LENGTH);
-                      break;
-                    case 4:  // delete mark
-                      cur.versions[vi].isDeleted = atoi(ofs);
-                      break;
-                    case 5:  // number of chunks
-                      memcpy(&cur.versions[vi].numChunks, ofs, sizeof(int));
-                      break;
-                  }
-                }
-                // find the next whitespace
-                ofs = vj == 5 ? NULL
-                              : (char *)memchr(ofs, ' ', metar->element[vi]->len - (metar->element[vi]->str - ofs));
-                if (ofs == NULL || ofs >= end) {
-                  break;
-                }
-                // skip the whitespace
-                ofs += 1;
-              }
-              DLOG(INFO) << "Add version " << cur.versions[vi].version << " size " << cur.versions[vi].size << " mtime "
-                         << cur.versions[vi].mtime << " deleted " << cur.versions[vi].isDeleted
-                         << " to version list of file " << cur.name;
-            }
-          } catch (std::exception &e) {
-            LOG(ERROR) << "Cannot allocate memory for " << total << " version records";
-            cur.versions = 0;
-          }
-        }
-        freeReplyObject(metar);
-        metar = 0;
-      }
-      numFiles++;
+      parseFileListAttributes(metar, cur);
     }
+    // do not add delete marker to the list unless for queries on versions
+    if (!withVersions && cur.isDeleted) {
+      free(cur.name);
+      cur.reset();
+      continue;
+    }
+    numFiles++;
   }
-  if (r == NULL) {
-    redisReconnect(_cxt);
+  replies.clear();
+
+  if (!withVersions) return numFiles;
+
+  // get the versions of files, all in one pipeline
+  std::vector<unsigned int> versioned;
+  for (unsigned int i = 0; i < numFiles; i++) {
+    FileInfo &cur = list[i];
+    if (cur.version <= 0) continue;
+    char vlname[PATH_MAX];
+    int vlnameLength = genFileVersionListKey(cur.namespaceId, cur.name, cur.nameLength, vlname);
+    if (redisAppendCommand(cxt, "ZRANGE %b 0 %d", vlname, (size_t)vlnameLength, cur.version) != REDIS_OK) {
+      LOG(ERROR) << "Failed to request versions of file " << cur.name;
+      break;
+    }
+    versioned.push_back(i);
+  }
+  for (size_t i = 0; i < versioned.size(); i++) {
+    FileInfo &cur = list[versioned.at(i)];
+    redisReply *metar = 0;
+    if (redisGetReply(cxt, (void **)&metar) != REDIS_OK) {
+      LOG(ERROR) << "Failed to get versions of file " << cur.name;
+      redisReconnect(cxt);
+      break;
+    }
+    if (metar == NULL || metar->type != REDIS_REPLY_ARRAY || metar->elements < 1) {
+      DLOG(INFO) << "No version summary " << cur.name << ", reply type = " << (metar == NULL ? -1 : metar->type);
+    } else {
+      parseFileListVersions(metar, cur);
+    }
+    freeReplyObject(metar);
   }
-  freeReplyObject(r);
-  r = 0;
+
   return numFiles;
 }
 
 unsigned int RedisMetaStore::getFolderList(std::vector<std::string> &list, unsigned char namespaceId,
                                            std::string prefix, bool skipSubfolders) {
-  std::lock_guard<std::mutex> lk(_lock);
+  Connection cxt(this);
 
-  // generate the prefix for pattern-based directory searching
+  // generate the prefix for range-based directory searching
   prefix.append("a");
   char filename[PATH_MAX];
   genFileKey(namespaceId, prefix.c_str(), prefix.size(), filename);
-  std::string pattern = getFilePrefix(filename, /* no ending slash */ true).append("*");
+  std::string dirPrefix = getFilePrefix(filename, /* no ending slash */ true);
 
-  std::string cursor = "0";
+  if (!_dirIndexReady && !buildDirectoryIndex(cxt)) {
+    LOG(WARNING) << "Directory index may be incomplete for listing folders under " << dirPrefix;
+  }
+
+  // search the directories within [dirPrefix, upper bound of dirPrefix) in the index, which is sorted by name
+  std::string min = std::string("[").append(dirPrefix);
+  std::string max = getLexUpperBound(dirPrefix);
   unsigned long int count = 0;
+  int pfsize = dirPrefix.size();
 
-  redisReply *r = 0;
-  do {
-    r = (redisReply *)redisCommand(_cxt, "SSCAN %s %s MATCH %s", DIR_LIST_KEY, cursor.c_str(), pattern.c_str());
+  while (true) {
+    redisReply *r = (redisReply *)redisCommand(cxt, "ZRANGEBYLEX %s %b %b LIMIT 0 %d", DIR_INDEX_KEY, min.c_str(),
+                                               min.size(), max.c_str(), max.size(), DIR_INDEX_PAGE_SIZE);
 
-    if (r == NULL || r->type != REDIS_REPLY_ARRAY || r->elements != 2 || r->element[1]->type != REDIS_REPLY_ARRAY) {
-      LOG(ERROR) << "Failed to scan metadata store for folders, r = " << (void *)r << " type = " << (r ? r->type : -1)
-                 << " elements " << (r ? r->elements : -1);
+    if (r == NULL || r->type != REDIS_REPLY_ARRAY) {
+      LOG(ERROR) << "Failed to search metadata store for folders, r = " << (void *)r
+                 << " type = " << (r ? r->type : -1);
       if (r == NULL) {
-        redisReconnect(_cxt);
+        redisReconnect(cxt);
       }
       freeReplyObject(r);
       return count;
     }
 
-    // update cursor
-    cursor = r->element[0]->str;
-
-    DLOG(INFO) << "Cursor = " << cursor << " num elements " << r->element[1]->elements;
+    DLOG(INFO) << "Search from " << min << " num elements " << r->elements;
 
     // add the matching folders
-    redisReply **listr = r->element[1]->element;
-    ssize_t pfsize = pattern.size();
-    for (size_t i = 0; i < r->element[1]->elements; i++) {
-      // avoid abnormal string with length < pfsize - 1
-      if (listr[i]->len < pfsize - 1) continue;
+    for (size_t i = 0; i < r->elements; i++) {
+      redisReply *dir = r->element[i];
+      // avoid abnormal string with length < pfsize
+      if (dir->len < pfsize) continue;
       // skip subfolders
-      if (skipSubfolders && strchr(listr[i]->str + pfsize - 1, '/') != 0) continue;
-      DLOG(INFO) << "Add " << std::string(listr[i]->str + pfsize - 1, listr[i]->len - pfsize + 1)
-                 << " to the result of " << pattern;
-      list.push_back(std::string(listr[i]->str + pfsize - 1, listr[i]->len - pfsize + 1));
+      if (skipSubfolders && memchr(dir->str + pfsize, '/', dir->len - pfsize) != 0) continue;
+      DLOG(INFO) << "Add " << std::string(dir->str + pfsize, dir->len - pfsize) << " to the result of " << dirPrefix;
+      list.push_back(std::string(dir->str + pfsize, dir->len - pfsize));
       count++;
     }
 
+    // continue after the last directory returned, until a page is not full
+    bool done = r->elements < DIR_INDEX_PAGE_SIZE;
+    if (!done) min = std::string("(").append(r->element[r->elements - 1]->str, r->element[r->elements - 1]->len);
     freeReplyObject(r);
-    r = 0;
-
-  } while (cursor != "0");
-
-  freeReplyObject(r);
-  r = 0;
+    if (done) break;
+  }
 
   return count;
 }
@@ -1166,26 +1714,26 @@ unsigned long int RedisMetaStore::getMaxNumKeysSupported() {
 }
 
 unsigned long int RedisMetaStore::getNumFiles() {
-  std::lock_guard<std::mutex> lk(_lock);
+  Connection cxt(this);
   unsigned long int count = 0;
-  redisReply *r = (redisReply *)redisCommand(_cxt, "DBSIZE");
+  redisReply *r = (redisReply *)redisCommand(cxt, "DBSIZE");
   if (r == NULL || r->type != REDIS_REPLY_INTEGER) {
     LOG(ERROR) << "Failed to get file count";
     if (r == NULL) {
-      redisReconnect(_cxt);
+      redisReconnect(cxt);
     }
   } else {
     count = r->integer;
     freeReplyObject(r);
     r = 0;
-    r = (redisReply *)redisCommand(_cxt, "SCARD %s", DIR_LIST_KEY);
+    r = (redisReply *)redisCommand(cxt, "SCARD %s", DIR_LIST_KEY);
     // exclude keys for directory sets
     if (r != NULL && r->type == REDIS_REPLY_INTEGER) {
       count -= r->integer;
     }
     freeReplyObject(r);
     r = 0;
-    r = (redisReply *)redisCommand(_cxt, "KEYS //sncc*");
+    r = (redisReply *)redisCommand(cxt, "KEYS //sncc*");
     // exclude system keys
     if (r != NULL && r->type == REDIS_REPLY_ARRAY) {
       count -= r->elements;
@@ -1199,16 +1747,16 @@ unsigned long int RedisMetaStore::getNumFiles() {
 }
 
 unsigned long int RedisMetaStore::getNumFilesToRepair() {
-  std::lock_guard<std::mutex> lk(_lock);
+  Connection cxt(this);
   // pop up files to repair
-  redisReply *r = (redisReply *)redisCommand(_cxt, "SCARD %s", FILE_REPAIR_KEY);
+  redisReply *r = (redisReply *)redisCommand(cxt, "SCARD %s", FILE_REPAIR_KEY);
 
   bool okay = r != NULL && (r->type == REDIS_REPLY_NIL || r->type == REDIS_REPLY_INTEGER);
 
   unsigned long int count = okay ? r->integer : -1;
 
   if (r == NULL) {
-    redisReconnect(_cxt);
+    redisReconnect(cxt);
   }
 
   freeReplyObject(r);
@@ -1218,16 +1766,16 @@ unsigned long int RedisMetaStore::getNumFilesToRepair() {
 }
 
 int RedisMetaStore::getFilesToRepair(int numFiles, File files[]) {
-  std::lock_guard<std::mutex> lk(_lock);
+  Connection cxt(this);
 
   // pop up files to repair
-  redisReply *r = (redisReply *)redisCommand(_cxt, "SPOP %s %d", FILE_REPAIR_KEY, numFiles);
+  redisReply *r = (redisReply *)redisCommand(cxt, "SPOP %s %d", FILE_REPAIR_KEY, numFiles);
 
   // retry with legacy command upon error, SPOP only supports multiple items for Redis >=3.2
   if (r != NULL && r->type == REDIS_REPLY_ERROR) {
     freeReplyObject(r);
     r = 0;
-    r = (redisReply *)redisCommand(_cxt, "SPOP %s", FILE_REPAIR_KEY);
+    r = (redisReply *)redisCommand(cxt, "SPOP %s", FILE_REPAIR_KEY);
   }
 
   bool okay =
@@ -1248,7 +1796,7 @@ int RedisMetaStore::getFilesToRepair(int numFiles, File files[]) {
     }
     // put the extra files back back to queue (best effort)
     for (; i < r->elements; i++) {
-      redisReply *br = (redisReply *)redisCommand(_cxt, "SADD %s %s" FILE_REPAIR_KEY, r->element[i]->str);
+      redisReply *br = (redisReply *)redisCommand(cxt, "SADD %s %s" FILE_REPAIR_KEY, r->element[i]->str);
       freeReplyObject(br);
       br = 0;
     }
@@ -1260,7 +1808,7 @@ int RedisMetaStore::getFilesToRepair(int numFiles, File files[]) {
       numFilesToRepair = 1;
     } else {
       // not enough memory, skip the repair for time being
-      redisReply *br = (redisReply *)redisCommand(_cxt, "SADD %s %s" FILE_REPAIR_KEY, r->str);
+      redisReply *br = (redisReply *)redisCommand(cxt, "SADD %s %s" FILE_REPAIR_KEY, r->str);
       freeReplyObject(br);
       br = 0;
     }
@@ -1272,7 +1820,7 @@ int RedisMetaStore::getFilesToRepair(int numFiles, File files[]) {
   }
 
   if (r == NULL) {
-    redisReconnect(_cxt);
+    redisReconnect(cxt);
   }
 
   freeReplyObject(r);
@@ -1282,12 +1830,20 @@ int RedisMetaStore::getFilesToRepair(int numFiles, File files[]) {
 
 bool RedisMetaStore::markFileAsRepaired(const File &file) { return markFileRepairStatus(file, false); }
 
+bool RedisMetaStore::markFilesAsRepaired(int numFiles, const File files[]) {
+  return markFilesStatus(numFiles, files, FILE_REPAIR_KEY, false, "repair");
+}
+
 bool RedisMetaStore::markFileAsNeedsRepair(const File &file) { return markFileRepairStatus(file, true); }
 
 bool RedisMetaStore::markFileRepairStatus(const File &file, bool needsRepair) {
   return markFileStatus(file, FILE_REPAIR_KEY, needsRepair, "repair");
 }
 
+bool RedisMetaStore::markFilesAsNeedsRepair(int numFiles, const File files[]) {
+  return markFilesStatus(numFiles, files, FILE_REPAIR_KEY, true, "repair");
+}
+
 bool RedisMetaStore::markFileAsPendingWriteToCloud(const File &file) {
   return markFileStatus(file, FILE_PENDING_WRITE_KEY, true, "pending write to cloud");
 }
@@ -1297,19 +1853,58 @@ bool RedisMetaStore::markFileAsWrittenToCloud(const File &file, bool removePendi
          (!removePending || markFileStatus(file, FILE_PENDING_WRITE_KEY, false, "pending write to cloud"));
 }
 
+bool RedisMetaStore::markFilesAsWrittenToCloud(int numFiles, const File files[], bool removePending) {
+  return markFilesStatus(numFiles, files, FILE_PENDING_WRITE_COMP_KEY, false, "pending completing write to cloud") &&
+         (!removePending || markFilesStatus(numFiles, files, FILE_PENDING_WRITE_KEY, false, "pending write to cloud"));
+}
+
+bool RedisMetaStore::markFilesStatus(int numFiles, const File files[], const char *listName, bool set,
+                                     const char *opName) {
+  if (numFiles <= 0) return true;
+
+  // add or remove all files in one command
+  RedisCommandArgs args(set ? "SADD" : "SREM", listName, strlen(listName));
+  char filename[PATH_MAX];
+  for (int i = 0; i < numFiles; i++) {
+    int nameLength = genVersionedFileKey(files[i].namespaceId, files[i].name, files[i].nameLength, files[i].version,
+                                         filename);
+    args.add(filename, nameLength);
+  }
+
+  Connection cxt(this);
+  redisReply *r = 0;
+  if (args.append(cxt) != REDIS_OK || redisGetReply(cxt, (void **)&r) != REDIS_OK) {
+    LOG(ERROR) << "Failed to " << (set ? "add" : "remove") << " " << numFiles << " files " << (set ? "to" : "from")
+               << " the " << opName << " list, failed to get reply";
+    redisReconnect(cxt);
+    freeReplyObject(r);
+    return false;
+  }
+
+  bool ret = r->type == REDIS_REPLY_INTEGER;
+  LOG_IF(ERROR, !ret) << "Failed to " << (set ? "add" : "remove") << " " << numFiles << " files "
+                      << (set ? "to" : "from") << " the " << opName << " list, reply is invalid";
+  DLOG_IF(INFO, ret) << r->integer << " of " << numFiles << " files " << (set ? " added to" : " removed from")
+                     << " the " << opName << " list";
+
+  freeReplyObject(r);
+  r = 0;
+  return ret;
+}
+
 bool RedisMetaStore::markFileStatus(const File &file, const char *listName, bool set, const char *opName) {
-  std::lock_guard<std::mutex> lk(_lock);
+  Connection cxt(this);
   char filename[PATH_MAX];
   int nameLength = genVersionedFileKey(file.namespaceId, file.name, file.nameLength, file.version, filename);
   redisReply *r =
-      (redisReply *)redisCommand(_cxt, "%s %s %b", set ? "SADD" : "SREM", listName, filename, (size_t)nameLength);
+      (redisReply *)redisCommand(cxt, "%s %s %b", set ? "SADD" : "SREM", listName, filename, (size_t)nameLength);
 
   bool ret = r != NULL && r->type == REDIS_REPLY_INTEGER;
   if (!ret) {
     LOG(ERROR) << "Failed to " << (set ? "add" : "remove") << " file " << file.name << " from the " << opName
                << " list, " << (r != NULL ? "reply is invalid" : "failed to get reply");
     if (r == NULL) {
-      redisReconnect(_cxt);
+      redisReconnect(cxt);
     }
   } else if (r->integer != 1) {
     DLOG(INFO) << "File " << file.name << "(" << filename << ")" << (set ? " already" : " not") << " in the " << opName
@@ -1328,11 +1923,12 @@ bool RedisMetaStore::markFileStatus(const File &file, const char *listName, bool
 }
 
 int RedisMetaStore::getFilesPendingWriteToCloud(int numFiles, File files[]) {
-  std::lock_guard<std::mutex> lk(_lock);
+  std::lock_guard<std::mutex> lk(_scanLock);
+  Connection cxt(this);
 
   int num = 0;
 
-  redisReply *r = (redisReply *)redisCommand(_cxt, "SCARD %s_copy", FILE_PENDING_WRITE_KEY);
+  redisReply *r = (redisReply *)redisCommand(cxt, "SCARD %s_copy", FILE_PENDING_WRITE_KEY);
 
   bool okay = r != NULL && r->type == REDIS_REPLY_INTEGER;
   bool empty = okay && r->integer == 0;
@@ -1348,7 +1944,7 @@ int RedisMetaStore::getFilesPendingWriteToCloud(int numFiles, File files[]) {
 
   // refill the set for scan
   if (empty) {
-    r = (redisReply *)redisCommand(_cxt, "SDIFFSTORE %s_copy %s %s_not_exists", FILE_PENDING_WRITE_KEY,
+    r = (redisReply *)redisCommand(cxt, "SDIFFSTORE %s_copy %s %s_not_exists", FILE_PENDING_WRITE_KEY,
                                    FILE_PENDING_WRITE_KEY, FILE_PENDING_WRITE_KEY);
 
     okay = r != NULL && r->type == REDIS_REPLY_INTEGER;
@@ -1366,46 +1962,64 @@ int RedisMetaStore::getFilesPendingWriteToCloud(int numFiles, File files[]) {
   // mark the set scanning is in-progress
   _endOfPendingWriteSet = false;
 
-  // try to pop a file name for write
-  r = (redisReply *)redisCommand(_cxt, "SPOP %s_copy", FILE_PENDING_WRITE_KEY);
+  // try to pop a batch of file names for write
+  r = (redisReply *)redisCommand(cxt, "SPOP %s_copy %d", FILE_PENDING_WRITE_KEY, numFiles);
+
+  // retry with legacy command upon error, SPOP only supports multiple items for Redis >=3.2
+  if (r != NULL && r->type == REDIS_REPLY_ERROR) {
+    freeReplyObject(r);
+    r = (redisReply *)redisCommand(cxt, "SPOP %s_copy", FILE_PENDING_WRITE_KEY);
+  }
 
-  okay = r != NULL && r->type == REDIS_REPLY_STRING;
+  std::vector<std::string> keys;
+  if (r != NULL && r->type == REDIS_REPLY_STRING) {
+    keys.emplace_back(r->str, r->len);
+  } else if (r != NULL && r->type == REDIS_REPLY_ARRAY) {
+    for (size_t i = 0; i < r->elements && i < (size_t)numFiles; i++) {
+      if (r->element[i]->type == REDIS_REPLY_STRING) keys.emplace_back(r->element[i]->str, r->element[i]->len);
+    }
+  }
 
-  std::string key;
-  if (okay) key.assign(r->str, r->len);
+  if (r == NULL) {
+    redisReconnect(cxt);
+  }
 
   freeReplyObject(r);
   r = 0;
 
-  if (!okay) {
-    if (r == NULL) {
-      redisReconnect(_cxt);
-    }
-    return num;
-  }
+  if (keys.empty()) return num;
 
-  // mark the file as pending to complete for write
-  r = (redisReply *)redisCommand(_cxt, "SMOVE %s %s %s", FILE_PENDING_WRITE_KEY, FILE_PENDING_WRITE_COMP_KEY,
-                                 key.c_str());
+  // mark the files as pending to complete for write, in one round trip
+  for (size_t i = 0; i < keys.size(); i++) {
+    redisAppendCommand(cxt, "SMOVE %s %s %b", FILE_PENDING_WRITE_KEY, FILE_PENDING_WRITE_COMP_KEY, keys.at(i).data(),
+                       keys.at(i).size());
+  }
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (redisGetReply(cxt, (void **)&r) != REDIS_OK) {
+      LOG(ERROR) << "Failed to mark files as pending to complete write to cloud, " << (r ? r->str : "NULL");
+      redisReconnect(cxt);
+      freeReplyObject(r);
+      r = 0;
+      break;
+    }
 
-  okay = r != NULL && r->type == REDIS_REPLY_INTEGER && r->integer == 1;
+    okay = r->type == REDIS_REPLY_INTEGER && r->integer == 1;
 
-  if (okay && getNameFromFileKey(key.data(), key.length(), &files[0].name, files[0].nameLength, files[0].namespaceId,
-                                 &files[0].version)) {
-    num++;
-  }
+    if (okay && getNameFromFileKey(keys.at(i).data(), keys.at(i).length(), &files[num].name, files[num].nameLength,
+                                   files[num].namespaceId, &files[num].version)) {
+      num++;
+    }
 
-  if (r == NULL) {
-    redisReconnect(_cxt);
+    freeReplyObject(r);
+    r = 0;
   }
 
-  freeReplyObject(r);
-  r = 0;
   return num;
 }
 
 bool RedisMetaStore::updateFileStatus(const File &file) {
-  std::lock_guard<std::mutex> lk(_lock);
+  CachedMetaInvalidation invalidation(this, file);
+  Connection cxt(this);
   char filename[PATH_MAX];
   int nameLength = genFileKey(file.namespaceId, file.name, file.nameLength, filename);
   bool ret = false;
@@ -1419,16 +2033,16 @@ bool RedisMetaStore::updateFileStatus(const File &file) {
                 redis.call('zrem', KEYS[1], ARGV[1]); \
             end; \
             return v ~= false;");
-    r = (redisReply *)redisCommand(_cxt, "EVAL %s 1 %s %s", script.c_str(), BG_TASK_PENDING_KEY, filename, nameLength);
+    r = (redisReply *)redisCommand(cxt, "EVAL %s 1 %s %s", script.c_str(), BG_TASK_PENDING_KEY, filename, nameLength);
     ret = r != NULL && r->type == REDIS_REPLY_INTEGER && r->integer == 1;
     if (ret) DLOG(INFO) << "File (task completed) " << file.name << " status updated";
   } else if (file.status == FileStatus::BG_TASK_PENDING) {
     // increment number of task by 1
-    r = (redisReply *)redisCommand(_cxt, "ZINCRBY %s 1 %b", BG_TASK_PENDING_KEY, filename, (size_t)nameLength);
+    r = (redisReply *)redisCommand(cxt, "ZINCRBY %s 1 %b", BG_TASK_PENDING_KEY, filename, (size_t)nameLength);
     ret = r != NULL && r->type == REDIS_REPLY_STRING;
     if (ret) DLOG(INFO) << "File (task pending) " << file.name << " status updated bg task = " << r->str;
   } else if (file.status == FileStatus::ALL_BG_TASKS_COMPLETED) {
-    r = (redisReply *)redisCommand(_cxt, "ZREM %s %b", BG_TASK_PENDING_KEY, filename, (size_t)nameLength);
+    r = (redisReply *)redisCommand(cxt, "ZREM %s %b", BG_TASK_PENDING_KEY, filename, (size_t)nameLength);
     ret = r != NULL && r->type == REDIS_REPLY_INTEGER && r->integer == 1;
     if (ret) {
       DLOG(INFO) << "File (all task completed) " << file.name << " status updated";
@@ -1439,7 +2053,7 @@ bool RedisMetaStore::updateFileStatus(const File &file) {
 
   // update the last task check time
   time_t tctime = time(NULL);
-  r = (redisReply *)redisCommand(_cxt, "HSET %b tctime %b", filename, (size_t)nameLength, &tctime,
+  r = (redisReply *)redisCommand(cxt, "HSET %b tctime %b", filename, (size_t)nameLength, &tctime,
                                  (size_t)sizeof(tctime));
 
   // report failure
@@ -1447,7 +2061,7 @@ bool RedisMetaStore::updateFileStatus(const File &file) {
     LOG(ERROR) << "Failed to update status of file " << file.name << ", [" << (r == 0 ? -1 : r->type) << "] "
                << (r == 0 ? "(NIL)" : r->str);
     if (r == NULL) {
-      redisReconnect(_cxt);
+      redisReconnect(cxt);
     }
   }
 
@@ -1458,8 +2072,9 @@ bool RedisMetaStore::updateFileStatus(const File &file) {
 }
 
 bool RedisMetaStore::getNextFileForTaskCheck(File &file) {
-  std::lock_guard<std::mutex> lk(_lock);
-  redisReply *r = (redisReply *)redisCommand(_cxt, "ZSCAN %s %s COUNT 1", BG_TASK_PENDING_KEY, _taskScanIt.c_str());
+  std::lock_guard<std::mutex> lk(_scanLock);
+  Connection cxt(this);
+  redisReply *r = (redisReply *)redisCommand(cxt, "ZSCAN %s %s COUNT 1", BG_TASK_PENDING_KEY, _taskScanIt.c_str());
 
   // the expected return value is
   // when there is something in the set: [0: next iterator (str), 1: [0: current element, 1: score, ...]]
@@ -1470,7 +2085,7 @@ bool RedisMetaStore::getNextFileForTaskCheck(File &file) {
   if (r == NULL || r->type != REDIS_REPLY_ARRAY || r->elements != 2 || r->element[0]->type != REDIS_REPLY_STRING) {
     LOG(ERROR) << "Failed to get a valid reply for next file to check";
     if (r == NULL) {
-      redisReconnect(_cxt);
+      redisReconnect(cxt);
     }
   } else {
     // update the next iterator
@@ -1498,13 +2113,53 @@ bool RedisMetaStore::getNextFileForTaskCheck(File &file) {
 }
 
 bool RedisMetaStore::lockFile(const File &file) {
-  std::lock_guard<std::mutex> lk(_lock);
-  return getLockOnFile(file, true);
+  Connection cxt(this);
+  return getLockOnFile(cxt, file, true);
+}
+
+bool RedisMetaStore::lockFile(const File &file, unsigned long int maxWaitUs) {
+  char key[PATH_MAX];
+  int keyLength = genFileLockKey(file.namespaceId, file.name, file.nameLength, key);
+  std::string lockKey(key, keyLength);
+
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + std::chrono::microseconds(maxWaitUs);
+
+  // register as a waiter before trying, so that no release is missed in between
+  std::unique_lock<std::mutex> lk(_lockWaitersLock);
+  auto waiter = _lockWaiters.emplace(lockKey, std::make_pair(0, 0)).first;
+  waiter->second.first++;
+
+  bool locked = false;
+  while (true) {
+    unsigned long int numReleases = waiter->second.second;
+    lk.unlock();
+    {
+      Connection cxt(this);
+      locked = acquireFileLock(cxt, file, lockKey, /* log failure */ false);
+    }
+    lk.lock();
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (locked || now >= deadline) break;
+    // wait for the lock to be released, and retry anyway after a while in case the release message is missed, e.g., the
+    // lease of the lock expires, or the subscription breaks
+    _lockReleased.wait_until(lk, std::min(deadline, now + std::chrono::milliseconds(FILE_LOCK_POLL_INTERVAL)),
+                             [&] { return waiter->second.second != numReleases; });
+  }
+
+  if (--waiter->second.first == 0) _lockWaiters.erase(waiter);
+  lk.unlock();
+
+  if (!locked) {
+    LOG(ERROR) << "Failed to lock file " << file.name << " after waiting for " << maxWaitUs << " us";
+  }
+
+  return locked;
 }
 
 bool RedisMetaStore::unlockFile(const File &file) {
-  std::lock_guard<std::mutex> lk(_lock);
-  return getLockOnFile(file, false);
+  Connection cxt(this);
+  return getLockOnFile(cxt, file, false);
 }
 
 std::tuple<int, std::string, int> extractJournalFieldKeyParts(const char *field, size_t fieldLength) {
@@ -1530,7 +2185,7 @@ std::tuple<int, std::string, int> extractJournalFieldKeyParts(const char *field,
 }
 
 bool RedisMetaStore::addChunkToJournal(const File &file, const Chunk &chunk, int containerId, bool isWrite) {
-  std::lock_guard<std::mutex> lk(_lock);
+  Connection cxt(this);
 
   char key[MAX_KEY_SIZE];
   int keyLength = genFileJournalKey(file.namespaceId, file.name, file.nameLength, file.version, key);
@@ -1551,12 +2206,12 @@ bool RedisMetaStore::addChunkToJournal(const File &file, const Chunk &chunk, int
   bool skipAdding = false;
   do {
     // keep scanning previous for records
-    r = (redisReply *)redisCommand(_cxt, "HSCAN %b %d MATCH %s-op*", key, (size_t)keyLength, cursor, cname);
+    r = (redisReply *)redisCommand(cxt, "HSCAN %b %d MATCH %s-op*", key, (size_t)keyLength, cursor, cname);
     if (r == NULL || r->type != REDIS_REPLY_ARRAY || r->elements < 1) {
       LOG(ERROR) << "Failed to add the journal record of chunk " << chunk.getChunkId() << " of file " << file.name
                  << " with namespace " << (int)file.namespaceId;
       freeReplyObject(r);
-      if (r == NULL) redisReconnect(_cxt);
+      if (r == NULL) redisReconnect(cxt);
       return false;
     }
     int numModifiedRecords = 0;
@@ -1581,7 +2236,7 @@ bool RedisMetaStore::addChunkToJournal(const File &file, const Chunk &chunk, int
         if (preValue->type != REDIS_REPLY_STRING) {
           continue;
         }
-        redisAppendCommand(_cxt, "HSET %b %b %s", key, (size_t)keyLength, preValue->str, preValue->len, "d");
+        redisAppendCommand(cxt, "HSET %b %b %s", key, (size_t)keyLength, preValue->str, preValue->len, "d");
         // if any previous write is to be superseded by a deletion
         if (extractedContainerId == containerId && !isWrite) {
           containerIdMatchedIdx = numModifiedRecords;
@@ -1595,7 +2250,7 @@ bool RedisMetaStore::addChunkToJournal(const File &file, const Chunk &chunk, int
 
     bool allCompleted = true;
     for (int ri = 0; ri < numModifiedRecords; ri++) {
-      bool opCompleted = redisGetReply(_cxt, (void **)&r) == REDIS_OK;
+      bool opCompleted = redisGetReply(cxt, (void **)&r) == REDIS_OK;
       allCompleted = allCompleted && opCompleted;
       // mark that a previous write is changed into a deletion
       if (containerIdMatchedIdx == ri && opCompleted) {
@@ -1624,7 +2279,7 @@ bool RedisMetaStore::addChunkToJournal(const File &file, const Chunk &chunk, int
          end \
          return -1; \
     ";
-  r = (redisReply *)redisCommand(_cxt, "EVAL %s 2 %b %s %s-size-%d %b %s-md5-%d %b %s-op-%d %s %s-status-%d %s %b",
+  r = (redisReply *)redisCommand(cxt, "EVAL %s 2 %b %s %s-size-%d %b %s-md5-%d %b %s-op-%d %s %s-status-%d %s %b",
                                  script.c_str(), key, (size_t)keyLength /* KEYS[1] */
                                  ,
                                  JL_LIST_KEY /* KEYS[2] */
@@ -1637,7 +2292,7 @@ bool RedisMetaStore::addChunkToJournal(const File &file, const Chunk &chunk, int
     freeReplyObject(r);
     LOG(ERROR) << "Failed to add the journal record of chunk " << chunk.getChunkId() << " of file " << file.name
                << " with namespace " << (int)file.namespaceId;
-    if (r == NULL) redisReconnect(_cxt);
+    if (r == NULL) redisReconnect(cxt);
     return false;
   }
   freeReplyObject(r);
@@ -1646,6 +2301,8 @@ bool RedisMetaStore::addChunkToJournal(const File &file, const Chunk &chunk, int
 
 bool RedisMetaStore::updateChunkInJournal(const File &file, const Chunk &chunk, bool isWrite, bool deleteRecord,
                                           int containerId) {
+  Connection cxt(this);
+
   char key[MAX_KEY_SIZE];
   int keyLength = genFileJournalKey(file.namespaceId, file.name, file.nameLength, file.version, key);
 
@@ -1669,7 +2326,7 @@ bool RedisMetaStore::updateChunkInJournal(const File &file, const Chunk &chunk,
                 return redis.call('SREM', KEYS[2], KEYS[3]); \
             end \
             return 2;";
-    r = (redisReply *)redisCommand(_cxt, "EVAL %s 3 %b %s %b %s-size-%d %s-md5-%d %s-op-%d %s-status-%d",
+    r = (redisReply *)redisCommand(cxt, "EVAL %s 3 %b %s %b %s-size-%d %s-md5-%d %s-op-%d %s-status-%d",
                                    script.c_str(), key, (size_t)keyLength, JL_LIST_KEY, filename, (size_t)nameLength,
                                    cname, containerId, cname, containerId, cname, containerId, cname, containerId);
     success = r != NULL && r->type == REDIS_REPLY_INTEGER && r->integer > 0;
@@ -1683,7 +2340,7 @@ bool RedisMetaStore::updateChunkInJournal(const File &file, const Chunk &chunk,
             end \
             return "
         ";";
-    r = (redisReply *)redisCommand(_cxt, "EVAL %s 1 %b %s-op-%d %s-status-%d %s %s", script.c_str(), key,
+    r = (redisReply *)redisCommand(cxt, "EVAL %s 1 %b %s-op-%d %s-status-%d %s %s", script.c_str(), key,
                                    (size_t)keyLength, cname, containerId, cname, containerId, opType, status);
     success = r != NULL && (r->type == REDIS_REPLY_STRING || r->type == REDIS_REPLY_STATUS) &&
               strncmp(r->str, "OK", r->len) == 0;
@@ -1695,7 +2352,7 @@ bool RedisMetaStore::updateChunkInJournal(const File &file, const Chunk &chunk,
     LOG(ERROR) << "Failed to " << (deleteRecord ? "delete" : "update") << " the journal record of chunk "
                << chunk.getChunkId() << " of file " << file.name << " with namespace " << (int)file.namespaceId
                << " version " << file.version << " in container " << containerId;
-    if (r == NULL) redisReconnect(_cxt);
+    if (r == NULL) redisReconnect(cxt);
     return false;
   }
 
@@ -1706,15 +2363,15 @@ bool RedisMetaStore::updateChunkInJournal(const File &file, const Chunk &chunk,
 void RedisMetaStore::getFileJournal(
     const FileInfo &file,
     std::vector<std::tuple<Chunk, int /* container id*/, bool /* isWrite */, bool /* isPre */>> &records) {
-  std::lock_guard<std::mutex> lk(_lock);
+  Connection cxt(this);
 
   char key[MAX_KEY_SIZE];
   int keyLength = genFileJournalKey(file.namespaceId, file.name, file.nameLength, file.version, key);
 
-  redisReply *r = (redisReply *)redisCommand(_cxt, "HGETALL %b", key, (size_t)keyLength);
+  redisReply *r = (redisReply *)redisCommand(cxt, "HGETALL %b", key, (size_t)keyLength);
   if (r == NULL) {
     LOG(ERROR) << "Failed to get the journal of file " << file.name << " in namespace " << (int)file.namespaceId;
-    redisReconnect(_cxt);
+    redisReconnect(cxt);
     return;
   }
 
@@ -1777,12 +2434,12 @@ void RedisMetaStore::getFileJournal(
 }
 
 int RedisMetaStore::getFilesWithJounal(FileInfo **list) {
-  std::lock_guard<std::mutex> lk(_lock);
+  Connection cxt(this);
 
-  redisReply *r = (redisReply *)redisCommand(_cxt, "SMEMBERS %s", JL_LIST_KEY);
+  redisReply *r = (redisReply *)redisCommand(cxt, "SMEMBERS %s", JL_LIST_KEY);
 
   if (r == NULL || r->type != REDIS_REPLY_ARRAY) {
-    if (r == NULL) redisReconnect(_cxt);
+    if (r == NULL) redisReconnect(cxt);
     LOG(ERROR) << "Failed to get the list of files with journals, r = " << (void *)r
                << " reply type = " << (int)(r ? r->type : -1) << ".";
     freeReplyObject(r);
@@ -1811,15 +2468,15 @@ int RedisMetaStore::getFilesWithJounal(FileInfo **list) {
 }
 
 bool RedisMetaStore::fileHasJournal(const File &file) {
-  std::lock_guard<std::mutex> lk(_lock);
+  Connection cxt(this);
 
   char filename[PATH_MAX];
   int nameLength = genVersionedFileKey(file.namespaceId, file.name, file.nameLength, file.version, filename);
 
-  redisReply *r = (redisReply *)redisCommand(_cxt, "SISMEMBER %s %b", JL_LIST_KEY, filename, (size_t)nameLength);
+  redisReply *r = (redisReply *)redisCommand(cxt, "SISMEMBER %s %b", JL_LIST_KEY, filename, (size_t)nameLength);
 
   if (r == NULL) {
-    redisReconnect(_cxt);
+    redisReconnect(cxt);
     return false;
   }
 
@@ -1830,6 +2487,12 @@ bool RedisMetaStore::fileHasJournal(const File &file) {
   return exists;
 }
 
+bool RedisMetaStore::getFileMetaCacheStats(FileMetaCacheStats &stats) {
+  if (_metaCache == NULL) return false;
+  stats = _metaCache->getStats();
+  return true;
+}
+
 int RedisMetaStore::genFileKey(unsigned char namespaceId, const char *name, int nameLength, char key[]) {
   return snprintf(key, PATH_MAX, "%d_%*s", namespaceId, nameLength, name);
 }
@@ -1896,8 +2559,8 @@ bool RedisMetaStore::getNameFromFileKey(const char *str, size_t len, char **name
   return true;
 }
 
-bool RedisMetaStore::getFileName(char name[], File &f) {
-  redisReply *r = (redisReply *)redisCommand(_cxt, "GET %s", name);
+bool RedisMetaStore::getFileName(redisContext *cxt, char name[], File &f) {
+  redisReply *r = (redisReply *)redisCommand(cxt, "GET %s", name);
   bool success = !(r == NULL || r->type != REDIS_REPLY_STRING);
   if (!success) {
     LOG(ERROR) << "Failed to get file name of " << name;
@@ -1908,7 +2571,7 @@ bool RedisMetaStore::getFileName(char name[], File &f) {
     f.name[r->len] = 0;
   }
   if (r == NULL) {
-    redisReconnect(_cxt);
+    redisReconnect(cxt);
   }
   freeReplyObject(r);
   r = 0;
@@ -1931,17 +2594,263 @@ std::string RedisMetaStore::getFilePrefix(const char name[], bool noEndingSlash)
   return prefix.append(name, slash - name);
 }
 
-bool RedisMetaStore::getLockOnFile(const File &file, bool lock) { return lockFile(file, lock, FILE_LOCK_KEY, "lock"); }
+int RedisMetaStore::appendAddToDirectoryCommands(redisContext *cxt, const std::string &prefix, const char *fileKey,
+                                                 int fileKeyLength) {
+  redisAppendCommand(cxt, "SADD %b %b", prefix.c_str(), prefix.size(), fileKey, (size_t)fileKeyLength);
+  // update global directory list and index (all directories share the same score, so they are sorted by name)
+  redisAppendCommand(cxt, "SADD %s %b", DIR_LIST_KEY, prefix.c_str(), prefix.size());
+  redisAppendCommand(cxt, "ZADD %s 0 %b", DIR_INDEX_KEY, prefix.c_str(), prefix.size());
+  return 3;
+}
+
+bool RedisMetaStore::removeFromDirectory(redisContext *cxt, const std::string &prefix, const char *fileKey,
+                                         int fileKeyLength) {
+  // remove the file name from the file list of its directory;
+  // check the number of files remains in the directory;
+  // remove the directory from the directory list and index if the directory has no files left
+  static const char *script =
+      "local ret = redis.call('SREM', KEYS[1], ARGV[1]); \
+            local val = redis.call('SCARD', KEYS[1]); \
+            if val == 0 then \
+                redis.call('ZREM', KEYS[3], KEYS[1]); \
+                return redis.call('SREM', KEYS[2], KEYS[1]); \
+            end; \
+            return ret";
+  redisReply *r = (redisReply *)redisCommand(cxt, "EVAL %s 3 %b %s %s %b", script, prefix.c_str(), prefix.size(),
+                                             DIR_LIST_KEY, DIR_INDEX_KEY, fileKey, (size_t)fileKeyLength);
+  bool okay = r != NULL && r->type == REDIS_REPLY_INTEGER && r->integer > 0;
+  if (r == NULL) {
+    redisReconnect(cxt);
+  }
+  freeReplyObject(r);
+  return okay;
+}
+
+bool RedisMetaStore::buildDirectoryIndex(redisContext *cxt) {
+  std::lock_guard<std::mutex> lk(_dirIndexLock);
+  if (_dirIndexReady) return true;
+
+  // replace the index with the directories in the directory list, unless the index of the current version is already
+  // built; afterwards, the index is updated along with the list. Comparing the sizes of the list and the index is not
+  // enough, as a stale directory in the index may hide a missing one
+  static const char *script =
+      "if redis.call('GET', KEYS[3]) == ARGV[1] then \
+                return 0; \
+            end; \
+            redis.call('ZUNIONSTORE', KEYS[2], 1, KEYS[1], 'WEIGHTS', 0); \
+            redis.call('SET', KEYS[3], ARGV[1]); \
+            return 1";
+
+  redisReply *r = (redisReply *)redisCommand(cxt, "EVAL %s 3 %s %s %s %s", script, DIR_LIST_KEY, DIR_INDEX_KEY,
+                                             DIR_INDEX_VERSION_KEY, DIR_INDEX_VERSION);
+  bool okay = r != NULL && r->type == REDIS_REPLY_INTEGER;
+  if (!okay) {
+    LOG(ERROR) << "Failed to build the directory index from the directory list";
+    if (r == NULL) {
+      redisReconnect(cxt);
+    }
+  } else if (r->integer == 1) {
+    LOG(INFO) << "Built the directory index (version " << DIR_INDEX_VERSION << ") from the directory list";
+  }
+  freeReplyObject(r);
+
+  _dirIndexReady = okay;
+  return okay;
+}
+
+bool RedisMetaStore::getLockOnFile(redisContext *cxt, const File &file, bool lock) {
+  char key[PATH_MAX];
+  int keyLength = genFileLockKey(file.namespaceId, file.name, file.nameLength, key);
+  std::string lockKey(key, keyLength);
+
+  if (lock) return acquireFileLock(cxt, file, lockKey, /* log failure */ true);
+
+  // release the lock only if it is still owned, and notify any waiters
+  static const char *script =
+      "if redis.call('GET', KEYS[1]) == ARGV[1] then \
+                redis.call('DEL', KEYS[1]); \
+                redis.call('PUBLISH', ARGV[2], KEYS[1]); \
+                return 1; \
+            end; \
+            return 0";
+
+  _heldLocksLock.lock();
+  _heldLocks.erase(lockKey);
+  _heldLocksLock.unlock();
+
+  redisReply *r = (redisReply *)redisCommand(cxt, "EVAL %s 1 %b %s %s", script, key, (size_t)keyLength,
+                                             _lockOwner.c_str(), FILE_LOCK_RELEASE_CHANNEL);
+
+  bool ret = r != NULL && r->type == REDIS_REPLY_INTEGER && r->integer == 1;
+  if (!ret) {
+    LOG(ERROR) << "Failed to unlock file " << file.name << ", "
+               << (r != NULL ? (r->type == REDIS_REPLY_INTEGER ? "lock is not held" : "reply is invalid")
+                             : "failed to get reply");
+    if (r == NULL) {
+      redisReconnect(cxt);
+    }
+  }
+
+  freeReplyObject(r);
+  r = 0;
+  return ret;
+}
+
+bool RedisMetaStore::acquireFileLock(redisContext *cxt, const File &file, const std::string &key, bool logFailure) {
+  redisReply *r = (redisReply *)redisCommand(cxt, "SET %b %s NX PX %d", key.c_str(), key.size(), _lockOwner.c_str(),
+                                             _lockLease);
+
+  // reply is nil if the lock is held by others (or by this instance)
+  bool ret = r != NULL && r->type == REDIS_REPLY_STATUS && strcmp(r->str, "OK") == 0;
+  if (ret) {
+    _heldLocksLock.lock();
+    _heldLocks.insert(key);
+    _heldLocksLock.unlock();
+  } else if (logFailure || r == NULL || r->type != REDIS_REPLY_NIL) {
+    LOG(ERROR) << "Failed to lock file " << file.name << ", "
+               << (r != NULL ? (r->type == REDIS_REPLY_NIL ? "repeated operation" : "reply is invalid")
+                             : "failed to get reply");
+  }
+  if (r == NULL) {
+    redisReconnect(cxt);
+  }
+
+  freeReplyObject(r);
+  r = 0;
+  return ret;
+}
+
+int RedisMetaStore::genFileLockKey(unsigned char namespaceId, const char *name, int nameLength, char key[]) {
+  return snprintf(key, PATH_MAX, "%s:%d_%*s", FILE_LOCK_KEY, namespaceId, nameLength, name);
+}
+
+void *RedisMetaStore::renewFileLocks(void *arg) {
+  RedisMetaStore *self = (RedisMetaStore *)arg;
+
+  // extend the lease only if the lock is still owned
+  static const char *script =
+      "if redis.call('GET', KEYS[1]) == ARGV[1] then \
+                return redis.call('PEXPIRE', KEYS[1], ARGV[2]); \
+            end; \
+            return 0";
+
+  std::string lease = std::to_string(self->_lockLease);
+  std::vector<std::string> keys;
+
+  std::unique_lock<std::mutex> lk(self->_heldLocksLock);
+  while (self->_running) {
+    // renew at one-third of the lease, so that a lease survives a failed renewal
+    self->_lockRenewalStopped.wait_for(lk, std::chrono::milliseconds(self->_lockLease / 3),
+                                       [self] { return !self->_running; });
+    if (!self->_running || self->_heldLocks.empty()) continue;
+    keys.assign(self->_heldLocks.begin(), self->_heldLocks.end());
+    lk.unlock();
+
+    std::vector<std::string> lost;
+    {
+      Connection cxt(self);
+      // renew all leases in one pipeline
+      for (size_t i = 0; i < keys.size(); i++) {
+        RedisCommandArgs args("EVAL", script, strlen(script));
+        args.add(std::string("1"));
+        args.add(keys.at(i));
+        args.add(self->_lockOwner);
+        args.add(lease);
+        args.append(cxt);
+      }
+      for (size_t i = 0; i < keys.size(); i++) {
+        redisReply *r = 0;
+        if (redisGetReply(cxt, (void **)&r) != REDIS_OK) {
+          LOG(ERROR) << "Failed to renew the leases of file locks";
+          redisReconnect(cxt);
+          break;
+        }
+        if (r != NULL && r->type == REDIS_REPLY_INTEGER && r->integer == 0) lost.push_back(keys.at(i));
+        freeReplyObject(r);
+      }
+    }
+
+    lk.lock();
+    for (size_t i = 0; i < lost.size(); i++) {
+      // the lock may be released just before the renewal
+      if (self->_heldLocks.erase(lost.at(i)) > 0) LOG(ERROR) << "Lost the file lock " << lost.at(i);
+    }
+  }
+
+  return NULL;
+}
+
+void *RedisMetaStore::subscribeNotifications(void *arg) {
+  RedisMetaStore *self = (RedisMetaStore *)arg;
+
+  redisContext *cxt = NULL;
+  while (self->_running) {
+    // (re)connect and subscribe for lock releases
+    if (cxt == NULL) {
+      cxt = self->connect();
+      // expose the connection for the destructor to shut down, unless it is already stopping
+      self->_subscriberLock.lock();
+      if (cxt && !self->_running) {
+        redisFree(cxt);
+        cxt = NULL;
+      }
+      self->_subscriberFd = cxt ? cxt->fd : -1;
+      self->_subscriberLock.unlock();
+      if (cxt == NULL && !self->_running) break;
+      redisReply *r = cxt ? (redisReply *)redisCommand(cxt, "SUBSCRIBE %s", FILE_LOCK_RELEASE_CHANNEL) : NULL;
+      bool okay = r != NULL && r->type == REDIS_REPLY_ARRAY;
+      freeReplyObject(r);
+      if (!okay) {
+        LOG_IF(WARNING, self->_running) << "Failed to subscribe for file lock releases, retry later";
+        self->closeSubscription(cxt);
+        if (self->_running) sleep(1);
+        continue;
+      }
+    }
+
+    redisReply *r = 0;
+    if (redisGetReply(cxt, (void **)&r) != REDIS_OK) {
+      LOG_IF(WARNING, self->_running) << "Lost the subscription for file lock releases";
+      self->closeSubscription(cxt);
+      continue;
+    }
+
+    // message format: "message", channel, lock key
+    if (r != NULL && r->type == REDIS_REPLY_ARRAY && r->elements == 3 && r->element[2]->type == REDIS_REPLY_STRING) {
+      std::string lockKey(r->element[2]->str, r->element[2]->len);
+      self->_lockWaitersLock.lock();
+      auto waiter = self->_lockWaiters.find(lockKey);
+      bool hasWaiters = waiter != self->_lockWaiters.end();
+      if (hasWaiters) waiter->second.second++;
+      self->_lockWaitersLock.unlock();
+      if (hasWaiters) self->_lockReleased.notify_all();
+    }
+    freeReplyObject(r);
+  }
+
+  self->closeSubscription(cxt);
+
+  return NULL;
+}
+
+void RedisMetaStore::closeSubscription(redisContext *&cxt) {
+  // forget the socket before closing it, so the destructor never shuts down a reused descriptor
+  _subscriberLock.lock();
+  _subscriberFd = -1;
+  _subscriberLock.unlock();
+  if (cxt) redisFree(cxt);
+  cxt = NULL;
+}
 
-bool RedisMetaStore::pinStagedFile(const File &file, bool lock) {
-  return lockFile(file, lock, FILE_PIN_STAGED_KEY, "pin");
+bool RedisMetaStore::pinStagedFile(redisContext *cxt, const File &file, bool lock) {
+  return lockFile(cxt, file, lock, FILE_PIN_STAGED_KEY, "pin");
 }
 
-bool RedisMetaStore::lockFile(const File &file, bool lock, const char *type, const char *name) {
+bool RedisMetaStore::lockFile(redisContext *cxt, const File &file, bool lock, const char *type, const char *name) {
   char filename[PATH_MAX];
   int nameLength = genFileKey(file.namespaceId, file.name, file.nameLength, filename);
   redisReply *r =
-      (redisReply *)redisCommand(_cxt, "%s %s %b", lock ? "SADD" : "SREM", type, filename, (size_t)nameLength);
+      (redisReply *)redisCommand(cxt, "%s %s %b", lock ? "SADD" : "SREM", type, filename, (size_t)nameLength);
 
   bool ret = r != NULL && r->type == REDIS_REPLY_INTEGER && r->integer == 1;
   if (!ret) {
@@ -1949,7 +2858,7 @@ bool RedisMetaStore::lockFile(const File &file, bool lock, const char *type, con
                << (r != NULL ? (r->type == REDIS_REPLY_INTEGER ? "repeated operation" : "reply is invalid")
                              : "failed to get reply");
     if (r == NULL) {
-      redisReconnect(_cxt);
+      redisReconnect(cxt);
     }
   }
 
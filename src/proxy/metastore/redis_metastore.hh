@@ -3,14 +3,22 @@
 #ifndef __REDIS_METASTORE_HH__
 #define __REDIS_METASTORE_HH__
 
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <hiredis/hiredis.h>
 #include "metastore.hh"
 
 #include <boost/uuid/uuid.hpp>
 
+typedef std::unique_ptr<redisReply, void (*)(void *)> RedisReplyPtr;
+
 class RedisMetaStore : public MetaStore {
 public:
     RedisMetaStore();
@@ -26,6 +34,11 @@ public:
      **/
     bool getMeta(File &f, int getBlocks = 3);
 
+    /**
+     * See MetaStore::getMetaBatch()
+     **/
+    int getMetaBatch(int numFiles, File files[], bool found[], int getBlocks = 3);
+
     /**
      * See MetaStore::deleteMeta()
      **/
@@ -56,6 +69,11 @@ public:
      **/
     unsigned int getFileList(FileInfo **list, unsigned char namespaceId = INVALID_NAMESPACE_ID, bool withSize = true, bool withTime = true, bool withVersions = false, std::string prefix = "");
 
+    /**
+     * See MetaStore::getFileListPage()
+     **/
+    unsigned int getFileListPage(FileInfo **list, std::string &cursor, unsigned int pageSize = DEFAULT_FILE_LIST_PAGE_SIZE, unsigned char namespaceId = INVALID_NAMESPACE_ID, bool withSize = true, bool withTime = true, bool withVersions = false, std::string prefix = "");
+
     /**
      * See MetaStore::getFolderList()
      **/
@@ -86,11 +104,21 @@ public:
      **/
     bool markFileAsNeedsRepair(const File &file);
 
+    /**
+     * See MetaStore::markFilesAsNeedsRepair()
+     **/
+    bool markFilesAsNeedsRepair(int numFiles, const File files[]);
+
     /**
      * See MetaStore::markFileAsRepaired()
      **/
     bool markFileAsRepaired(const File &file);
 
+    /**
+     * See MetaStore::markFilesAsRepaired()
+     **/
+    bool markFilesAsRepaired(int numFiles, const File files[]);
+
     /**
      * See MetaStore::markFileAsPendingWriteToCloud()
      **/
@@ -101,6 +129,11 @@ public:
      **/
     bool markFileAsWrittenToCloud(const File &file, bool removePending = false);
 
+    /**
+     * See MetaStore::markFilesAsWrittenToCloud()
+     **/
+    bool markFilesAsWrittenToCloud(int numFiles, const File files[], bool removePending = false);
+
     /**
      * See MetaStore::getFilesPendingWriteToCloud()
      **/
@@ -121,6 +154,11 @@ public:
      **/
     bool lockFile(const File &file);
 
+    /**
+     * See MetaStore::lockFile(const File &, unsigned long int)
+     **/
+    bool lockFile(const File &file, unsigned long int maxWaitUs);
+
     /**
      * See MetaStore::unlockFile()
      **/
@@ -151,13 +189,120 @@ public:
      **/
     bool fileHasJournal(const File &file);
 
+    /**
+     * See MetaStore::getFileMetaCacheStats()
+     **/
+    bool getFileMetaCacheStats(FileMetaCacheStats &stats);
+
 private:
-    redisContext *_cxt;
-    std::mutex _lock;
-    
+    /**
+     * Connection to Redis borrowed from the connection pool, which returns to the pool when it goes out of scope
+     *
+     * @remark a method should borrow at most one connection at a time, and pass it to the helper functions it calls
+     **/
+    class Connection {
+    public:
+        Connection(RedisMetaStore *store);
+        ~Connection();
+
+        operator redisContext *() const { return _cxt; }
+
+    private:
+        RedisMetaStore *_store;
+        redisContext *_cxt;
+    };
+
+    /**
+     * Open a new connection to Redis
+     *
+     * @return the connection, NULL if failed
+     **/
+    redisContext *connect();
+
+    /**
+     * Borrow an idle connection, open a new one if none is idle, or wait for one if the max. number of connections are in use
+     *
+     * @return the connection
+     **/
+    redisContext *getConnection();
+
+    /**
+     * Return a borrowed connection to the pool
+     *
+     * @param[in] cxt   the connection
+     **/
+    void releaseConnection(redisContext *cxt);
+
+    std::mutex _connectionsLock;                        /**< lock on the connection pool (not held during Redis operations) */
+    std::condition_variable _connectionReleased;        /**< signal on a connection returning to the pool */
+    std::vector<redisContext *> _idleConnections;       /**< idle connections */
+    int _numConnections;                                /**< number of connections opened */
+    int _maxNumConnections;                             /**< max. number of connections */
+
+    /**
+     * Lease-based file locks
+     *
+     * A file lock is a key with the owner token as its value and the lease as its TTL. The leases of the locks held are
+     * renewed in background, and a message is published on unlock to wake up any Proxy waiting for the lock.
+     **/
+    static void *renewFileLocks(void *arg);
+    static void *subscribeNotifications(void *arg);
+    void closeSubscription(redisContext *&cxt);
+    int genFileLockKey(unsigned char namespaceId, const char *name, int nameLength, char key[]);
+    bool acquireFileLock(redisContext *cxt, const File &file, const std::string &key, bool logFailure);
+
+    std::string _lockOwner;                             /**< owner token of the file locks held by this instance */
+    int _lockLease;                                     /**< lease of file locks (in milliseconds) */
+    std::mutex _heldLocksLock;                          /**< lock on the held file locks */
+    std::condition_variable _lockRenewalStopped;        /**< signal on stopping the lease renewal */
+    std::set<std::string> _heldLocks;                   /**< keys of the file locks held */
+    std::mutex _lockWaitersLock;                        /**< lock on the file lock waiters */
+    std::condition_variable _lockReleased;              /**< signal on a file lock released */
+    std::map<std::string, std::pair<int, unsigned long int>> _lockWaiters; /**< [lock key] -> (number of waiters, number of releases seen) */
+    std::atomic<bool> _running;                         /**< whether the background threads are running */
+    pthread_t _lockRenewer;                             /**< thread for renewing the leases of file locks */
+    pthread_t _subscriber;                              /**< thread for receiving file lock releases */
+    std::mutex _subscriberLock;                         /**< lock on the socket of the subscriber */
+    int _subscriberFd;                                  /**< socket of the subscriber, shut down on destruction to unblock its reads; -1 if not connected */
+
+    /**
+     * Invalidation of the cached metadata of a file once it goes out of scope, i.e., after the metadata is changed
+     **/
+    class CachedMetaInvalidation {
+    public:
+        CachedMetaInvalidation(RedisMetaStore *store, const File &f);
+        ~CachedMetaInvalidation();
+
+    private:
+        RedisMetaStore *_store;
+        std::string _key;
+    };
+
+    /**
+     * Get the file metadata cache shared by all instances in this process, created by the first instance
+     *
+     * @return the shared cache, NULL if disabled
+     **/
+    static FileMetaCache *acquireMetaCache();
+
+    /**
+     * Release the shared file metadata cache, destroyed after the last instance releases it
+     **/
+    static void releaseMetaCache();
+
+    static std::mutex _sharedMetaCacheLock;             /**< lock on the shared file metadata cache and its reference count */
+    static FileMetaCache *_sharedMetaCache;             /**< file metadata cache shared by all instances (e.g., one per Proxy) in this process */
+    static int _sharedMetaCacheRefs;                    /**< number of instances holding the shared file metadata cache */
+
+    FileMetaCache *_metaCache;                          /**< cache of file metadata shared in the process, NULL if disabled (including when multiple Proxies share the metadata store) */
+
+    std::mutex _scanLock;                               /**< lock on the scan states below */
     std::string _taskScanIt;
     bool _endOfPendingWriteSet;
 
+    std::mutex _dirIndexLock;                           /**< lock on building the directory index */
+    std::atomic<bool> _dirIndexReady;                   /**< whether the directory index has been checked against its version */
+
 
     int genFileKey(unsigned char namespaceId, const char *name, int nameLength, char key[]);
     int genVersionedFileKey(unsigned char namespaceId, const char *name, int nameLength, int version, char key[]);
@@ -170,18 +315,82 @@ private:
     const char *getBlockKeyPrefix(bool unique);
     bool getNameFromFileKey(const char *str, size_t len, char **name, int &nameLength, unsigned char &namespaceId, int *version = 0);
     bool markFileStatus(const File &file, const char *listName, bool set, const char *opName);
+    bool markFilesStatus(int numFiles, const File files[], const char *listName, bool set, const char *opName);
     bool markFileRepairStatus(const File &file, bool needsRepair);
 
-    bool getFileName(char name[], File &f);
+    bool getMeta(redisContext *cxt, File &f, int getBlocks);
+    int getMetaBatch(redisContext *cxt, int numFiles, File files[], bool found[], int getBlocks);
+
+    /**
+     * Append the commands of the first round trip to get the metadata of a file
+     *
+     * @return number of replies to read for the commands
+     **/
+    int appendGetMetaCommands(redisContext *cxt, const File &f, int getBlocks);
+
+    /**
+     * Parse the metadata of a file from the replies of the commands appended by appendGetMetaCommands(), and get the remaining metadata (in the legacy layout) if needed
+     **/
+    bool getMeta(redisContext *cxt, File &f, int getBlocks, std::vector<RedisReplyPtr> &replies);
+    bool getFileName(redisContext *cxt, char name[], File &f);
     bool isSystemKey(const char *key);
     bool isVersionedFileKey(const char *key);
 
     std::string getFilePrefix(const char name[], bool noEndingSlash = false);
 
-    bool getLockOnFile(const File &file, bool lock);
-    bool pinStagedFile(const File &file, bool pine);
+    /**
+     * Append the commands to add a file to its directory, and the directory to the directory list and index (i.e., pipelined)
+     *
+     * @return number of replies to read for the commands
+     **/
+    int appendAddToDirectoryCommands(redisContext *cxt, const std::string &prefix, const char *fileKey, int fileKeyLength);
+
+    /**
+     * Remove a file from its directory, and the directory from the directory list and index once it has no files left
+     *
+     * @return whether the file is removed from the directory
+     **/
+    bool removeFromDirectory(redisContext *cxt, const std::string &prefix, const char *fileKey, int fileKeyLength);
+
+    /**
+     * Rebuild the directory index from the directory list, unless the index of the current version (DIR_INDEX_VERSION) is already built (e.g., by another Proxy)
+     *
+     * @return whether the directory index is built
+     **/
+    bool buildDirectoryIndex(redisContext *cxt);
+
+    /**
+     * Scan for the keys of files, continuing from a cursor
+     *
+     * @param[in] cxt           connection to use
+     * @param[in,out] cursor    scan cursor, "0" to start; set to "0" when the scan completes
+     * @param[in] count         the approx. number of keys to collect before returning
+     * @param[in] namespaceId   namespace id of the files
+     * @param[in] prefix        prefix of the file names
+     * @param[out] keys         keys found
+     *
+     * @return whether the scan succeeded
+     **/
+    bool scanFileKeys(redisContext *cxt, std::string &cursor, unsigned int count, unsigned char namespaceId, const std::string &prefix, std::vector<std::string> &keys);
+
+    /**
+     * Get the file info of a batch of files in pipelined commands
+     *
+     * @param[in] cxt           connection to use
+     * @param[in] keys          keys of the files
+     * @param[out] list         file info holders, at least as many as the keys
+     * @param[in] withSize      whether to include file size
+     * @param[in] withTime      whether to include file timestamps
+     * @param[in] withVersions  whether to include versions (and delete markers)
+     *
+     * @return the number of file info filled
+     **/
+    unsigned int getFileInfoBatch(redisContext *cxt, const std::vector<std::string> &keys, FileInfo *list, bool withSize, bool withTime, bool withVersions);
+
+    bool getLockOnFile(redisContext *cxt, const File &file, bool lock);
+    bool pinStagedFile(redisContext *cxt, const File &file, bool pine);
 
-    bool lockFile(const File &file, bool lock, const char *type, const char *name);
+    bool lockFile(redisContext *cxt, const File &file, bool lock, const char *type, const char *name);
 };
 
 #endif // define __REDIS_METASTORE_HH__
@@ -15,6 +15,7 @@
 #include "proxy.hh"
 
 #define BG_WRITE_TO_CLOUD_TAG "<BG WRITE TO CLOUD> "
+#define BG_WRITE_TO_CLOUD_BATCH_SIZE (16)  // number of files popped for background write at a time
 
 Proxy::Proxy() : Proxy(0, 0) {}
 
@@ -56,10 +57,15 @@ Proxy::Proxy(ProxyCoordinator *coordinator, std::map<int, std::string> *map, BgC
     case MetaStoreType::REDIS:
       _metastore = new RedisMetaStore();
       break;
+    case MetaStoreType::LOCAL:
+      _metastore = new LocalMetaStore();
+      break;
     default:
       _metastore = new RedisMetaStore();
       break;
   }
+  // measure the latency of metadata operations
+  _metastore = new InstrumentedMetaStore(_metastore);
 
   // set as running
   _running = true;
@@ -70,6 +76,10 @@ Proxy::Proxy(ProxyCoordinator *coordinator, std::map<int, std::string> *map, BgC
   _repairChunkManager = new ChunkManager(_containerToAgentMap, _repairio, _bgChunkHandler, _metastore);
   _tcChunkManager = new ChunkManager(_containerToAgentMap, _tcio, _bgChunkHandler);
 
+  // stripe workers shared by all file requests
+  _stripeReadWorkers = new StripeWorkerPool(config.getProxyNumDecodeWorkers(), "stripe read");
+  _stripeWriteWorkers = new StripeWorkerPool(config.getProxyNumEncodeWorkers(), "stripe write");
+
   // auto file recovery
   _ongoingRepairCnt = 0;
   if (enableAutoRepair) pthread_create(&_rt, NULL, Proxy::backgroundRepair, this);
@@ -105,6 +115,10 @@ Proxy::~Proxy() {
 
   LOG(WARNING) << "Terminating Proxy ...";
 
+  // release stripe workers (after completing the pending stripes)
+  delete _stripeReadWorkers;
+  delete _stripeWriteWorkers;
+
   // release chunk manager and chunk-related handler
   delete _chunkManager;
   if (Config::getInstance().autoFileRecovery()) pthread_join(_rt, NULL);
@@ -140,7 +154,13 @@ void Proxy::updateAgentStatus() { _coordinator->updateAgentStatus(); }
 
 int Proxy::getAgentStatus(ProxyCoordinator::AgentInfo **info) { return _coordinator->getAgentStatus(info); }
 
-bool Proxy::getProxyStatus(SysInfo &info) { return _coordinator->getProxyStatus(info); }
+bool Proxy::getProxyStatus(SysInfo &info) {
+  // export the metadata operation latencies together with the status
+  std::map<std::string, double> stats;
+  InstrumentedMetaStore::getLatencyStats(stats);
+  if (!stats.empty()) _statsSaver.saveStatsRecord(stats, "metastore latency", "");
+  return _coordinator->getProxyStatus(info);
+}
 
 void Proxy::getStorageUsage(unsigned long int &usage, unsigned long int &capacity) {
   _coordinator->getStorageUsage(usage, capacity);
@@ -176,13 +196,21 @@ void *Proxy::backgroundRepair(void *arg) {
                                        /* withVersions */ true);
       int batchStartIdx = 0, numChunksInBatch = 0;
       File file;
+      // files found to need repair, which are added to the repair list in batches
+      File filesToRepair[batchSize];
+      int numFilesToRepair = 0;
 
 #define checkFile(__FL__)                                                                                              \
   do {                                                                                                                 \
     DLOG(INFO) << "Check file " << file.name << " version " << file.version << " for missing chunk at " << time(NULL); \
     if (fileScanIntv > 0 && lastFileScan + fileScanIntv <= curTime &&                                                  \
         self->needsRepair(__FL__, /* updateStatusFirst */ i == 0)) {                                                   \
-      self->_metastore->markFileAsNeedsRepair(__FL__);                                                                 \
+      filesToRepair[numFilesToRepair].copyName(__FL__);                                                                \
+      filesToRepair[numFilesToRepair].copyVersionControlInfo(__FL__);                                                  \
+      if (++numFilesToRepair == batchSize) {                                                                           \
+        self->_metastore->markFilesAsNeedsRepair(numFilesToRepair, filesToRepair);                                     \
+        numFilesToRepair = 0;                                                                                          \
+      }                                                                                                                \
       DLOG(INFO) << "Add file " << __FL__.name << " of version " << __FL__.version << " for missing chunk at "         \
                  << time(NULL);                                                                                        \
     }                                                                                                                  \
@@ -208,6 +236,9 @@ void *Proxy::backgroundRepair(void *arg) {
 
 #undef checkFile
 
+      // add the remaining files to the repair list
+      if (numFilesToRepair > 0) self->_metastore->markFilesAsNeedsRepair(numFilesToRepair, filesToRepair);
+
       DLOG(INFO) << "Complete scanning at " << time(NULL);
       // update time of last scan
       if (lastFileScan + fileScanIntv <= time(NULL)) lastFileScan = time(NULL);
@@ -223,22 +254,42 @@ void *Proxy::backgroundRepair(void *arg) {
         int numToRepair = 0;
         do {
           File files[batchSize];
+          bool found[batchSize];
           numToRepair = self->_metastore->getFilesToRepair(batchSize, files);
+          // get the metadata of the whole batch at once, to skip files that are deleted or need no repair without
+          // locking them one by one
+          if (numToRepair > 0)
+            self->_metastore->getMetaBatch(numToRepair, files, found, /* get blocks (none) */ 0);
           self->_ongoingRepairCnt += numToRepair;
-          // repair file
+          // repair files with the metadata prefetched; files repaired are moved to the front, and marked as repaired
+          // in one batch
+          int numRepaired = 0;
           for (int i = 0; i < numToRepair; i++) {
+            if (!found[i] || !self->hasFailedChunks(files[i], /* updateStatusFirst */ i == 0)) {
+              DLOG(INFO) << "Skip repairing file " << files[i].name << " version " << files[i].version << ", "
+                         << (found[i] ? "no failed chunks" : "metadata not found");
+              continue;
+            }
             // if is locked for repair and repair suceed, remove from under
-            // repair list; otherwise, put it back to the list for pending
-            // repair (retry)
-            if (self->repairFile(files[i], /* isBg */ true)) {
+            // repair list; otherwise, put the remaining files back to the
+            // list for pending repair (retry)
+            if (self->repairFile(files[i], /* isBg */ true, /* metaPrefetched */ true)) {
               DLOG(INFO) << "Repair file " << files[i].name << " at " << time(NULL);
+              if (numRepaired != i) {
+                files[numRepaired].copyName(files[i]);
+                files[numRepaired].copyVersionControlInfo(files[i]);
+              }
+              numRepaired++;
             } else {
               // self->_metastore->markFileAsNeedsRepair(files[i]);
+              if (i + 1 < numToRepair)
+                self->_metastore->markFilesAsNeedsRepair(numToRepair - i - 1, files + i + 1);
               self->_ongoingRepairCnt -= numToRepair;
               numToRepair = 0;
               break;
             }
           }
+          if (numRepaired > 0) self->_metastore->markFilesAsRepaired(numRepaired, files);
           self->_ongoingRepairCnt -= numToRepair;
         } while (numToRepair > 0);
         DLOG(INFO) << "End repair at " << time(NULL);
@@ -290,14 +341,20 @@ bool Proxy::needsRepair(File &f, bool updateStatusFirst) {
     return false;
   }
 
-  bool chunkIndices[rf.numChunks];
   // recover if there are chunk failures, and the file has not been modified
   // since last repair check
-  return _coordinator->checkContainerLiveness(rf.containerIds, rf.numChunks, chunkIndices, updateStatusFirst,
-                                              /* checkAllFailures */ false) > 0 &&
+  return hasFailedChunks(rf, updateStatusFirst) &&
          rf.mtime + Config::getInstance().getFileRecoverInterval() < time(NULL);
 }
 
+bool Proxy::hasFailedChunks(const File &f, bool updateStatusFirst) {
+  if (f.numChunks <= 0) return false;
+
+  bool chunkIndices[f.numChunks];
+  return _coordinator->checkContainerLiveness(f.containerIds, f.numChunks, chunkIndices, updateStatusFirst,
+                                              /* checkAllFailures */ false) > 0;
+}
+
 bool Proxy::batchedChunkScan(const FileInfo *list, const int numFiles, const int curIdx, int &numChunksInBatch,
                              int &batchStartIdx) {
   // report error if list is not provided, curIdx is beyond the list, or
@@ -632,11 +689,32 @@ void *Proxy::journalCheck(void *arg) {
 
   FileInfo *fileList = nullptr;
   int numFiles = 0;
+  unsigned long int numLockWaits = 0;
+  unsigned long int numMetaLookups = 0;
+  FileMetaCacheStats metaCacheStats;
+  std::string metaStoreStatsFile = Config::getInstance().getProxyMetaStoreStatsFile();
 
   while (self->_running && reqCheckIntv > 0) {
     // sleep-wait until next interval
     sleep(std::max((long int)0, lastCheckTime + reqCheckIntv - time(NULL)));
 
+    // report the file lock wait time
+    if (self->_lockWaitTimes.getCount() != numLockWaits) {
+      numLockWaits = self->_lockWaitTimes.getCount();
+      LOG(INFO) << "File lock wait time: " << self->_lockWaitTimes.toString();
+    }
+
+    // report the file metadata cache hit rate and memory usage
+    if (self->getFileMetaCacheStats(metaCacheStats) &&
+        metaCacheStats.numHits + metaCacheStats.numMisses != numMetaLookups) {
+      numMetaLookups = metaCacheStats.numHits + metaCacheStats.numMisses;
+      LOG(INFO) << "File metadata cache: " << metaCacheStats.toString();
+    }
+
+    // report the latencies of metadata operations
+    DLOG(INFO) << "Metadata store latencies:" << InstrumentedMetaStore::toString();
+    if (!metaStoreStatsFile.empty()) InstrumentedMetaStore::dumpPrometheusText(metaStoreStatsFile);
+
     // get all files with journal
     numFiles = self->_metastore->getFilesWithJounal(&fileList);
     for (int fidx = 0; fidx < numFiles; fidx++) {
@@ -820,19 +898,34 @@ void *Proxy::stagingBGWrite(void *param) {
 
     // pop files pending for backgroud write
     while (self->_running) {
-      File wf[1];
-      int numFiles = self->_metastore->getFilesPendingWriteToCloud(1, wf);
+      File wf[BG_WRITE_TO_CLOUD_BATCH_SIZE];
+      int numFiles = self->_metastore->getFilesPendingWriteToCloud(BG_WRITE_TO_CLOUD_BATCH_SIZE, wf);
 
       if (numFiles <= 0) {
         DLOG(INFO) << BG_WRITE_TO_CLOUD_TAG << "No Pending files to write";
         break;
       }
 
-      if (self->bgwriteFileToCloud(*wf)) {
-        LOG(INFO) << BG_WRITE_TO_CLOUD_TAG << "Background write task added, file: " << wf->name;
-      } else {
-        LOG(ERROR) << BG_WRITE_TO_CLOUD_TAG << "Failed to add background write task, file: " << wf->name;
+      // files written are moved to the front, and marked as written in one batch
+      int numWritten = 0;
+      for (int i = 0; i < numFiles; i++) {
+        // put the files not yet written back to the pending list
+        if (!self->_running) {
+          self->_metastore->markFileAsPendingWriteToCloud(wf[i]);
+          continue;
+        }
+        if (self->bgwriteFileToCloud(wf[i])) {
+          LOG(INFO) << BG_WRITE_TO_CLOUD_TAG << "Background write task added, file: " << wf[i].name;
+          if (numWritten != i) {
+            wf[numWritten].copyName(wf[i]);
+            wf[numWritten].copyVersionControlInfo(wf[i]);
+          }
+          numWritten++;
+        } else {
+          LOG(ERROR) << BG_WRITE_TO_CLOUD_TAG << "Failed to add background write task, file: " << wf[i].name;
+        }
       }
+      if (numWritten > 0) self->_metastore->markFilesAsWrittenToCloud(numWritten, wf);
 
       // TODO rate limiting (avoid overload)
     }
@@ -966,7 +1059,7 @@ bool Proxy::bgwriteFileToCloud(File &f) {
             << " millseconds)";
   LOG(INFO) << "Write back file " << f.name << ", completes";
 
-  _metastore->markFileAsWrittenToCloud(f);
+  // the file is marked as written to cloud by the caller, together with other files in the batch
   unpinStagedFile(f);
   unlockFile(f);
 
@@ -985,6 +1078,8 @@ std::map<std::string, double> Proxy::genStatsMap(const boost::timer::cpu_times &
   stats["data (s)"] = dataT.wall * 1.0 / 1e9;
   stats["data (MB/s)"] = (dataSize * 1.0 / (1 << 20)) / (dataT.wall * 1.0 / 1e9);
   stats["fileSize"] = (dataSize * 1.0 / (1 << 20));
+  // breakdown of the metadata time by operation
+  InstrumentedMetaStore::getThreadOpTimes(stats);
 
   return stats;
 }
@@ -21,6 +21,8 @@
 #include "metastore/all.hh"
 #include "staging/staging.hh"
 #include "stats_saver.hh"
+#include "stripe_worker_pool.hh"
+#include "../common/latency_histogram.hh"
 
 class Proxy {
 public:
@@ -157,9 +159,11 @@ public:
    *
    * @param[in] f file to repair, containing the name
    * @param[in] isBg whether the repair is triggered by background thread
+   * @param[in] metaPrefetched whether f already holds the file metadata (without blocks) read before locking; if so,
+   *the metadata is not read again, and the repaired chunks are committed only if the file version is unchanged
    * @return whether the redundancy of the file is restored
    **/
-  virtual bool repairFile(const File &f, bool isBg = false);
+  virtual bool repairFile(const File &f, bool isBg = false, bool metaPrefetched = false);
 
   /****************************/
   /* File Metadata Operations */
@@ -228,6 +232,25 @@ public:
               unsigned char namespaceId = INVALID_NAMESPACE_ID,
               std::string prefix = "");
 
+  /**
+   * Get a page of the list of files
+   *
+   * @param[out] list        pointer to the list of files in the page
+   * @param[in,out] cursor   continuation token, empty for the first page; set to that of the next page, or empty after the last page
+   * @param[in] pageSize     approx. number of files per page
+   * @param[in] withSize     whether to include file size
+   * @param[in] namespaceId  namespace id of files to list
+   * @param[in] prefix       prefix of files to list
+   *
+   * @return number of files in the page
+   **/
+  virtual unsigned int
+  getFileListPage(FileInfo **list, std::string &cursor,
+                  unsigned int pageSize = DEFAULT_FILE_LIST_PAGE_SIZE,
+                  bool withSize = true, bool withVersions = false,
+                  unsigned char namespaceId = INVALID_NAMESPACE_ID,
+                  std::string prefix = "");
+
   /**
    * Get the list of folders
    *
@@ -302,6 +325,22 @@ public:
    **/
   virtual int getBackgroundTaskProgress(std::string *&task, int *&progress);
 
+  /**
+   * Get the time spent on waiting for file locks
+   *
+   * @return histogram of the time spent on acquiring file locks
+   **/
+  const LatencyHistogram &getLockWaitTimes() const { return _lockWaitTimes; }
+
+  /**
+   * Get the statistics of the file metadata cache
+   *
+   * @param[out] stats    hits, misses, and memory usage of the cache
+   *
+   * @return whether the cache is enabled
+   **/
+  bool getFileMetaCacheStats(FileMetaCacheStats &stats) { return _metastore->getFileMetaCacheStats(stats); }
+
 protected:
   /************************/
   /* [Internal] Data Type */
@@ -353,9 +392,101 @@ protected:
   bool writeFileStripes(File &f, File &wf, int spareContainers[],
                         int numSelected);
 
+  /**
+   * Stripe write in progress (for pipelining in writeFileStripes())
+   **/
+  struct StripeWriteTask {
+    Proxy *proxy;             /**< proxy instance */
+    int stripeIdx;            /**< index of the stripe in file */
+    bool isAppend;            /**< whether the stripe is appended (instead of overwritten) */
+    File stripe;              /**< stripe to write */
+    int *spareContainers;     /**< containers selected for the stripe */
+    int numSelected;          /**< number of containers in spareContainers */
+    unsigned char *stripebuf; /**< temporary data buffer of the stripe (if any) */
+    bool emptyStripe;         /**< whether the stripe is empty (i.e., fully deduplicated) */
+    BMWriteStripe *bmStripe;  /**< benchmark of the stripe (if any) */
+    StripeWorkerPool::Task work; /**< task encoding and sending the stripe */
+    bool okay;                /**< whether the stripe write is successful */
+  };
+
+  /**
+   * Encode and send a stripe
+   *
+   * @param[in] arg    pointer to the StripeWriteTask
+   *
+   * @return always NULL
+   **/
+  static void *writeFileStripeInBackground(void *arg);
+
+  /**
+   * Wait for a stripe write to complete, copy the stripe metadata to the
+   *file, and release the task
+   *
+   * @param[in] task                   stripe write task
+   * @param[in,out] wf                 file containing stripes to write
+   * @param[in] startIdx               index of the first stripe to write
+   * @param[in] numStripes             number of stripes in file
+   * @param[in] numChunksPerStripe     number of chunks per stripe
+   * @param[in,out] writesize          number of bytes written, increased by
+   *the stripe length on success
+   * @param[in,out] postWriteProcessTime timer for post-write processing
+   *
+   * @return whether the stripe write is successful
+   **/
+  bool finishStripeWrite(StripeWriteTask *task, File &wf, int startIdx,
+                         int numStripes, int numChunksPerStripe,
+                         unsigned long &writesize,
+                         boost::timer::cpu_timer &postWriteProcessTime);
+
+  /**
+   * Clean up the chunks of a stripe written, on failure to write a file
+   *
+   * @param[in] wf                     file containing stripes written
+   * @param[in] stripeIdx              index of the stripe to clean up
+   * @param[in] numChunksPerStripe     number of chunks per stripe
+   * @param[in] isAppend               whether the stripe is appended (the chunks are deleted) or
+   *overwritten (the chunks are reverted)
+   **/
+  void cleanUpStripeWrite(File &wf, int stripeIdx, int numChunksPerStripe, bool isAppend);
+
   bool copyFileStripeMeta(File &dst, File &src, int stripeId, const char *op);
   void unsetCopyFileStripeMeta(File &copy);
 
+  /**
+   * Stripe read in progress (for read-ahead in readFile())
+   **/
+  struct StripeReadTask {
+    Proxy *proxy;        /**< proxy instance */
+    int stripeIdx;       /**< index of the stripe in file */
+    File stripe;         /**< stripe to read */
+    bool *chunkIndices;  /**< chunk liveness indicators */
+    unsigned char *dst;  /**< location of the stripe data in the file data buffer */
+    unsigned char *tempBuffer; /**< temporary buffer the stripe is decoded into before copying to dst (if any) */
+    StripeWorkerPool::Task work; /**< task fetching and decoding the stripe */
+    bool okay;           /**< whether the stripe read is successful */
+  };
+
+  /**
+   * Fetch and decode a stripe
+   *
+   * @param[in] arg    pointer to the StripeReadTask
+   *
+   * @return always NULL
+   **/
+  static void *readFileStripeInBackground(void *arg);
+
+  /**
+   * Wait for a stripe read to complete, copy any data in temporary buffer to
+   *the file data buffer, and release the task
+   *
+   * @param[in] task            stripe read task
+   * @param[in,out] bytesRead   number of bytes read, increased by the stripe
+   *size on success
+   *
+   * @return whether the stripe read is successful
+   **/
+  bool finishStripeRead(StripeReadTask *task, unsigned long int &bytesRead);
+
   /**
    * Modify file via overwrite / append
    *
@@ -417,6 +548,7 @@ protected:
   // repair
   static void *backgroundRepair(void *arg);
   bool needsRepair(File &f, bool updateStatusFirst);
+  bool hasFailedChunks(const File &f, bool updateStatusFirst);
   /**
    * Check and perform batched chunk checksum scan
    *
@@ -489,6 +621,11 @@ protected:
 
   // statistics
   StatsSaver _statsSaver; /**< statistics saving modulde */
+  LatencyHistogram _lockWaitTimes; /**< time spent on acquiring file locks */
+
+  // stripe workers
+  StripeWorkerPool *_stripeReadWorkers;  /**< workers fetching and decoding stripes for file reads */
+  StripeWorkerPool *_stripeWriteWorkers; /**< workers encoding and sending stripes for file writes */
 
   // background threads
   pthread_t _ct;   /**< thread for coordinator */
@@ -1,5 +1,7 @@
 // SPDX-License-Identifier: Apache-2.0
 
+#include <deque>
+
 #include "proxy.hh"
 
 #include "../common/config.hh"
@@ -547,7 +549,6 @@ bool Proxy::writeFileStripes(File &f, File &wf, int spareContainers[], int numSe
     return false;
   }
 
-  unsigned char *stripebuf = 0;
   int numStripes = f.size / maxDataStripeSize;
   numStripes += (f.size % maxDataStripeSize == 0) ? 0 : 1;
   int numChunksPerStripe = numContainers * numChunksPerContainer;
@@ -565,20 +566,43 @@ bool Proxy::writeFileStripes(File &f, File &wf, int spareContainers[], int numSe
   dataWriteTime.stop();
   postWriteProcessTime.stop();
 
-  // write the data stripe-by-stripe
+  // write the data stripe-by-stripe: deduplicate each stripe in order on this thread, then encode and send up to
+  // 'numEncodeWorkers' stripes concurrently on the stripe write workers (with chunks transferred by the I/O workers)
   int startIdx = f.offset / maxDataStripeSize;
   int endIdx = (f.offset + f.length + maxDataStripeSize - 1) / maxDataStripeSize;
+  int numEncodeWorkers = Config::getInstance().getProxyNumEncodeWorkers();
+  std::deque<StripeWriteTask *> stripeWrites;
 
   DLOG(INFO) << "Write stripe " << startIdx << " to " << endIdx << " of file " << wf.name;
 
   std::string filename = std::string(wf.name, wf.nameLength);
   unsigned long writesize = 0u;
+  bool okay = true;
+  int issuedEndIdx = startIdx;  // end of stripes issued for write (to clean up on failure)
+
   for (int i = startIdx; i < endIdx; i++) {
     bool isAppend = i >= f.numStripes;
 
+    // wait for the earliest stripe write to complete if all encode workers are busy (back-pressure)
+    if ((int)stripeWrites.size() >= numEncodeWorkers) {
+      dataWriteTime.resume();
+      okay = finishStripeWrite(stripeWrites.front(), wf, startIdx, numStripes, numChunksPerStripe, writesize,
+                               postWriteProcessTime);
+      dataWriteTime.stop();
+      stripeWrites.pop_front();
+      if (!okay) {
+        LOG(ERROR) << "Failed to write file " << f.name << " to backend";
+        break;
+      }
+    }
+
     prepareWriteTime.resume();
 
-    File swf;  // stripe to write
+    StripeWriteTask *task = new StripeWriteTask();
+    task->proxy = this;
+    task->stripeIdx = i;
+    task->isAppend = isAppend;
+    File &swf = task->stripe;  // stripe to write
     swf.copyVersionControlInfo(wf);
 
     wf.offset = i * maxDataStripeSize;
@@ -598,60 +622,54 @@ bool Proxy::writeFileStripes(File &f, File &wf, int spareContainers[], int numSe
       }
     }
 
-#define CLEAN_UP_PREVIOUS_STRIPES(__END_IDX__)                                                 \
-  do {                                                                                         \
-    if (i > startIdx) {                                                                        \
-      memmove(wf.containerIds, wf.containerIds + startIdx * numChunksPerStripe,                \
-              (__END_IDX__ - startIdx) * numChunksPerStripe);                                  \
-      for (int j = startIdx * numChunksPerStripe; j < __END_IDX__ * numChunksPerStripe; j++) { \
-        wf.chunks[j - startIdx * numChunksPerStripe] = wf.chunks[j];                           \
-        wf.chunks[j].freeData = false;                                                         \
-      }                                                                                        \
-      wf.numChunks = numChunksPerStripe * (__END_IDX__ - startIdx);                            \
-      bool chunkIndicator[wf.numChunks] = {true};                                              \
-      if (isAppend) {                                                                          \
-        _chunkManager->deleteFile(wf, chunkIndicator);                                         \
-      } else {                                                                                 \
-        _chunkManager->revertFile(wf, chunkIndicator);                                         \
-      }                                                                                        \
-    }                                                                                          \
-  } while (0)
-
     if (prepareWrite(wf, swf, spareContainers, numSelected, isAppend) == false) {
+      prepareWriteTime.stop();
       swf.data = 0;
-      // clean up previous data
-      if (i > startIdx) CLEAN_UP_PREVIOUS_STRIPES((i - 1));
-      return false;
+      delete task;
+      okay = false;
+      break;
     }
 
+    // keep a copy of the containers selected for this stripe, as the list is reused for the next stripe
+    task->numSelected = numSelected;
+    task->spareContainers = new int[numSelected];
+    memcpy(task->spareContainers, spareContainers, numSelected * sizeof(int));
+
     // make a shadow copy of data for file processing
     swf.data = wf.data;
 
     // benchmark
     BMWrite *bmWrite = dynamic_cast<BMWrite *>(Benchmark::getInstance().at(swf.reqId));
-    BMWriteStripe *bmStripe = NULL;
     bool benchmark = bmWrite && bmWrite->isStripeOn();
     if (benchmark) {
-      bmStripe = &(bmWrite->at(swf.stripeId));
-      bmStripe->setMeta(swf.stripeId, swf.length, bmWrite);
+      task->bmStripe = &(bmWrite->at(swf.stripeId));
+      task->bmStripe->setMeta(swf.stripeId, swf.length, bmWrite);
       // TAGPT (start): process stripe
-      bmStripe->overallTime.markStart();
-      bmStripe->preparation.markStart();
+      task->bmStripe->overallTime.markStart();
+      task->bmStripe->preparation.markStart();
     }
 
     // use buffer if the data buffer will be modified
     // (e.g., appending coding specific info), or the stripe needs padding
     bool useBuffer = _chunkManager->willModifyDataBuffer(f.storageClass) || swf.length != maxDataStripeSize;
     if (useBuffer) {
-      // adjust the buffer size for last stripe with unaligned size
-      if (stripebuf == 0)
-        stripebuf = (unsigned char *)calloc(
-            _chunkManager->getDataStripeSize(wf.codingMeta.coding, wf.codingMeta.n, wf.codingMeta.k, maxDataStripeSize),
-            1);
+      // allocate a buffer for each stripe in flight, as stripes are encoded concurrently
+      task->stripebuf = (unsigned char *)calloc(
+          _chunkManager->getDataStripeSize(wf.codingMeta.coding, wf.codingMeta.n, wf.codingMeta.k, maxDataStripeSize),
+          1);
+      if (task->stripebuf == 0) {
+        LOG(ERROR) << "Out of memory for writing stripes for file " << f.name;
+        prepareWriteTime.stop();
+        swf.data = 0;
+        delete[] task->spareContainers;
+        delete task;
+        okay = false;
+        break;
+      }
       // copy data to temp buffer
-      memcpy(stripebuf, swf.data + swf.offset, swf.length);
+      memcpy(task->stripebuf, swf.data + swf.offset, swf.length);
       // point to the temp buffer instead of shadowing the original data buffer
-      swf.data = stripebuf;
+      swf.data = task->stripebuf;
     } else {
       // directly advance to the start of the current data stripe
       swf.data += swf.offset;
@@ -661,14 +679,19 @@ bool Proxy::writeFileStripes(File &f, File &wf, int spareContainers[], int numSe
 
     dedupScanTime.resume();
     // scan for duplicate blocks
-    std::map<BlockLocation::InObjectLocation, std::pair<Fingerprint, int>> stripeFps;
     std::string commitId;
     if (!dedupStripe(swf, wf.uniqueBlocks, wf.duplicateBlocks, commitId)) {
-      return false;
+      dedupScanTime.stop();
+      swf.data = 0;
+      free(task->stripebuf);
+      delete[] task->spareContainers;
+      delete task;
+      okay = false;
+      break;
     }
     dedupScanTime.stop();
 
-    bool emptyStripe = swf.length == 0;
+    task->emptyStripe = swf.length == 0;
 
     dedupPostProcessTime.resume();
     // save the fingerprints to file
@@ -678,22 +701,75 @@ bool Proxy::writeFileStripes(File &f, File &wf, int spareContainers[], int numSe
     wf.commitIds.push_back(commitId);
     dedupPostProcessTime.stop();
 
-    dataWriteTime.resume();
     // TODO journaling / copy-on-write for overwrite to avoid file corruption
     // due to unexpected termination write the stripe (as part of the file)
-    if (!emptyStripe && _chunkManager->writeFileStripe(swf, spareContainers, numSelected,
-                                                       /* alignDataBuf */ false,
-                                                       /* isOverwrite */ !isAppend) == false) {
-      LOG(ERROR) << "Failed to write file " << f.name << " to backend";
-      swf.data = 0;
-      // clean up previous data
-      CLEAN_UP_PREVIOUS_STRIPES(i);
-      free(stripebuf);
-      return false;
+    // encode and send the stripe on the stripe write workers
+    task->okay = true;
+    if (!task->emptyStripe) {
+      _stripeWriteWorkers->submitTask(&task->work, writeFileStripeInBackground, task);
+    }
+    stripeWrites.push_back(task);
+    issuedEndIdx = i + 1;
+  }
+
+  // wait for all outstanding stripe writes
+  dataWriteTime.resume();
+  while (!stripeWrites.empty()) {
+    StripeWriteTask *task = stripeWrites.front();
+    stripeWrites.pop_front();
+    if (!finishStripeWrite(task, wf, startIdx, numStripes, numChunksPerStripe, writesize, postWriteProcessTime)) {
+      LOG_IF(ERROR, okay) << "Failed to write file " << f.name << " to backend";
+      okay = false;
+    }
+  }
+  dataWriteTime.stop();
+
+  if (!okay) {
+    // clean up data of the stripes issued, i.e., delete appended stripes and revert overwritten ones
+    for (int i = startIdx; i < issuedEndIdx; i++) {
+      cleanUpStripeWrite(wf, i, numChunksPerStripe, /* isAppend */ i >= f.numStripes);
+    }
+    return false;
+  }
+
+  LOG(INFO) << " Write file " << f.name << ", (dedup-scan) = " << (dedupScanTime.elapsed().wall * 1.0 / 1e6) << " ms"
+            << ", (dedup-post-process) = " << (dedupPostProcessTime.elapsed().wall * 1.0 / 1e6) << " ms"
+            << ", (prepare-write) = " << (prepareWriteTime.elapsed().wall * 1.0 / 1e6) << " ms"
+            << ", (data-write) = " << (dataWriteTime.elapsed().wall * 1.0 / 1e6) << " ms"
+            << ", (post-write-process) = " << (postWriteProcessTime.elapsed().wall * 1.0 / 1e6) << " ms";
+
+  wf.numStripes = numStripes;
+
+  std::cout << "real write size " << writesize << std::endl;
+
+  return true;
+}
+
+void *Proxy::writeFileStripeInBackground(void *arg) {
+  StripeWriteTask *task = (StripeWriteTask *)arg;
+  task->okay = task->proxy->_chunkManager->writeFileStripe(task->stripe, task->spareContainers, task->numSelected,
+                                                           /* alignDataBuf */ false,
+                                                           /* isOverwrite */ !task->isAppend);
+  return NULL;
+}
+
+bool Proxy::finishStripeWrite(StripeWriteTask *task, File &wf, int startIdx, int numStripes, int numChunksPerStripe,
+                              unsigned long &writesize, boost::timer::cpu_timer &postWriteProcessTime) {
+  StripeWorkerPool::waitForTask(&task->work);
+
+  File &swf = task->stripe;
+  int i = task->stripeIdx;
+  bool emptyStripe = task->emptyStripe;
+  bool okay = task->okay;
+
+  postWriteProcessTime.resume();
+  if (!okay) {
+    // mark the chunks of the failed stripe as not written
+    for (int cidx = 0; cidx < numChunksPerStripe; cidx++) {
+      wf.containerIds[i * numChunksPerStripe + cidx] = INVALID_CONTAINER_ID;
     }
-    dataWriteTime.stop();
+  } else {
     writesize += swf.length;
-    postWriteProcessTime.resume();
     // process metadata
     if (!emptyStripe && swf.numChunks != numChunksPerStripe) {
       LOG(WARNING) << "Expected num of chunks in stripe: " << numChunksPerStripe << ", but actually got "
@@ -730,31 +806,52 @@ bool Proxy::writeFileStripes(File &f, File &wf, int spareContainers[], int numSe
       memcpy(wf.codingMeta.codingState + i * swf.codingMeta.codingStateSize, swf.codingMeta.codingState,
              swf.codingMeta.codingStateSize);
     }
-    postWriteProcessTime.stop();
+  }
+  postWriteProcessTime.stop();
 
-    // clean up
-    swf.data = 0;
+  // clean up
+  swf.data = 0;
+  free(task->stripebuf);
+  delete[] task->spareContainers;
 
-    // TAGPT (end): process stripe
-    if (benchmark) {
-      bmStripe->overallTime.markEnd();
-    }
+  // TAGPT (end): process stripe
+  if (okay && task->bmStripe) {
+    task->bmStripe->overallTime.markEnd();
   }
 
-  LOG(INFO) << " Write file " << f.name << ", (dedup-scan) = " << (dedupScanTime.elapsed().wall * 1.0 / 1e6) << " ms"
-            << ", (dedup-post-process) = " << (dedupPostProcessTime.elapsed().wall * 1.0 / 1e6) << " ms"
-            << ", (prepare-write) = " << (prepareWriteTime.elapsed().wall * 1.0 / 1e6) << " ms"
-            << ", (data-write) = " << (dataWriteTime.elapsed().wall * 1.0 / 1e6) << " ms"
-            << ", (post-write-process) = " << (postWriteProcessTime.elapsed().wall * 1.0 / 1e6) << " ms";
-
-  wf.numStripes = numStripes;
+  delete task;
 
-  std::cout << "real write size " << writesize << std::endl;
+  return okay;
+}
 
-  free(stripebuf);
+void Proxy::cleanUpStripeWrite(File &wf, int stripeIdx, int numChunksPerStripe, bool isAppend) {
+  // shadow the chunks of the stripe in the file
+  File cf;
+  cf.copyNameAndSize(wf);
+  cf.copyVersionControlInfo(wf);
+  cf.copyStoragePolicy(wf);
+  cf.numChunks = numChunksPerStripe;
+  cf.chunks = wf.chunks + stripeIdx * numChunksPerStripe;
+  cf.containerIds = wf.containerIds + stripeIdx * numChunksPerStripe;
+
+  // only clean up the chunks written, i.e., skip failed or empty stripes
+  bool chunkIndicator[numChunksPerStripe];
+  bool written = false;
+  for (int cidx = 0; cidx < numChunksPerStripe; cidx++) {
+    chunkIndicator[cidx] =
+        cf.containerIds[cidx] != INVALID_CONTAINER_ID && cf.containerIds[cidx] != UNUSED_CONTAINER_ID;
+    written = written || chunkIndicator[cidx];
+  }
+  if (written) {
+    if (isAppend) {
+      _chunkManager->deleteFile(cf, chunkIndicator);
+    } else {
+      _chunkManager->revertFile(cf, chunkIndicator);
+    }
+  }
 
-#undef CLEAN_UP_PREVIOUS_STRIPES
-  return true;
+  // clean up (avoid double free)
+  unsetCopyFileStripeMeta(cf);
 }
 
 bool Proxy::dedupStripe(File &swf, std::map<BlockLocation::InObjectLocation, std::pair<Fingerprint, int>> &uniqueFps,
@@ -1053,28 +1150,35 @@ bool Proxy::readFile(File &f, bool isPartial) {
   // read unique data first
 
   // read the unique data in the range
-  bool chunkIndices[numChunksPerStripe];
   // adjust such that rf.data always points to the (virtual) start of file
   rf.data -= f.offset;
-  // decode stripe by stripe
+  // decode stripes, with up to 'readAhead' stripes being fetched and decoded concurrently
   bool okay = true;
   int startStripe = isPartial ? f.offset / maxDataStripeSize : 0;
   int endStripe =
       isPartial && f.offset + f.length <= rf.size ? (f.offset + f.length) / maxDataStripeSize : rf.numStripes;
   int currStripeId = 0;
-  unsigned char *tmpBuffer = 0;
-  unsigned long int bufferSize = 0;
+  int readAhead = Config::getInstance().getProxyNumReadAheadStripes();
+  std::deque<StripeReadTask *> stripeReads;
 
   for (int i = startStripe; i < endStripe; i++, currStripeId++) {
-    File srf;
+    // wait for the earliest stripe read to complete if the read-ahead window is full
+    if ((int)stripeReads.size() >= readAhead) {
+      okay = finishStripeRead(stripeReads.front(), bytesRead);
+      stripeReads.pop_front();
+      if (!okay) break;
+    }
+
+    StripeReadTask *task = new StripeReadTask();
+    task->proxy = this;
+    task->stripeIdx = i;
+    File &srf = task->stripe;
 
     // copy the stripe metadata
     if (copyFileStripeMeta(srf, rf, i, "read") == false) {
-      if (preallocated) {
-        rf.data = 0;
-      }
-      clean_external_filemeta();
-      return false;
+      delete task;
+      okay = false;
+      break;
     }
     srf.blockId = f.blockId;
     srf.stripeId = currStripeId;
@@ -1084,80 +1188,55 @@ bool Proxy::readFile(File &f, bool isPartial) {
     srf.length = srf.size;
     // skip empty (i.e., fully deduplicated) stripes
     if (srf.chunks[0].size == 0) {
-      if (preallocated) {
-        rf.data = 0;
-      }
       unsetCopyFileStripeMeta(srf);
+      delete task;
       continue;
     }
     // check for alive containers
-    _coordinator->checkContainerLiveness(srf.containerIds, srf.numChunks, chunkIndices);
+    task->chunkIndices = new bool[numChunksPerStripe];
+    _coordinator->checkContainerLiveness(srf.containerIds, srf.numChunks, task->chunkIndices);
     // read the data from stripe
     unsigned long int actualDataStripeSize = _chunkManager->getDataStripeSize(cmeta.coding, cmeta.n, cmeta.k, srf.size);
     std::cout << "read from local, actual data stripe size is " << actualDataStripeSize << std::endl;
     bool unalignedStripe =
         i + 1 == rf.numStripes && (rf.size % maxDataStripeSize != 0);  // last stripe may be unaligned
-    bool useTempBuffer = unalignedStripe || actualDataStripeSize > maxDataStripeSize;
-    if (useTempBuffer) {
-      // allocate buffer on first use, or when the size is not sufficiently
-      // large
-      if (tmpBuffer == 0 || bufferSize < actualDataStripeSize || bufferSize < maxDataStripeSize) {
-        free(tmpBuffer);
-        bufferSize = std::max(actualDataStripeSize, maxDataStripeSize);
-        DLOG(INFO) << bufferSize;
-        tmpBuffer = static_cast<unsigned char *>(calloc(bufferSize, 1));
-        if (tmpBuffer == 0) {
-          LOG(ERROR) << "Out of memory for reading stripes for file " << f.name;
-          unlockFile(rf);
-          clean_external_filemeta();
-          unsetCopyFileStripeMeta(srf);
-          return false;
-        }
+    task->dst = rf.data + i * maxDataStripeSize;
+    task->tempBuffer = 0;
+    if (unalignedStripe || actualDataStripeSize > maxDataStripeSize) {
+      // decode into a temporary buffer, and copy the data to the file data buffer afterwards
+      task->tempBuffer = static_cast<unsigned char *>(calloc(std::max(actualDataStripeSize, maxDataStripeSize), 1));
+      if (task->tempBuffer == 0) {
+        LOG(ERROR) << "Out of memory for reading stripes for file " << f.name;
+        delete[] task->chunkIndices;
+        unsetCopyFileStripeMeta(srf);
+        delete task;
+        okay = false;
+        break;
       }
-      // zero out the zone to use
-      memset(tmpBuffer, 0, actualDataStripeSize);
-      // assigned it to the stripe
-      srf.data = tmpBuffer;
-    } else {  // aligned stripes
-      srf.data = rf.data + i * maxDataStripeSize;
-    }
-    if (_chunkManager->readFileStripe(srf, chunkIndices) == false) {
-      LOG(ERROR) << "Failed to read file " << f.name << " from backend (stripe " << i << ")";
-      okay = false;
+      srf.data = task->tempBuffer;
+    } else {  // aligned stripes, decode directly into the file data buffer
+      srf.data = task->dst;
     }
-    if (useTempBuffer) {
-      // copy data back to the original file data buffer
-      // directly copy all data read
-      std::cout << "use tempbuffer and copy full data" << std::endl;
-      std::cout << i << " "
-                << "srf size: " << srf.size << std::endl;
-      memcpy(rf.data + i * maxDataStripeSize, srf.data, srf.size);
-      bytesRead += srf.size;
-      // if buffer is replaced by lower level functions, free the new buffer and
-      // reset to tmp buffer pointer to avoid double free
-      if (srf.data != tmpBuffer) {
-        tmpBuffer = 0;
-        bufferSize = 0;
-        free(srf.data);
-      }
+    // fetch and decode the stripe on the stripe read workers
+    _stripeReadWorkers->submitTask(&task->work, readFileStripeInBackground, task);
+    stripeReads.push_back(task);
+  }
+
+  // wait for all outstanding stripe reads
+  while (!stripeReads.empty()) {
+    okay = finishStripeRead(stripeReads.front(), bytesRead) && okay;
+    stripeReads.pop_front();
+  }
+
+  // skip once read failed
+  if (!okay) {
+    if (preallocated) {
+      rf.data = 0;
     } else {
-      bytesRead += srf.size;
-    }
-    // unset the data reference to the original file data buffer or the temp
-    // buffer
-    srf.data = 0;
-    // clean up (avoid double free)
-    unsetCopyFileStripeMeta(srf);
-    // skip once read failed
-    if (!okay) {
-      if (preallocated) {
-        rf.data = 0;
-      } else {
-        rf.data += f.offset;
-      }
-      clean_external_filemeta();
-      return false;
+      rf.data += f.offset;
     }
+    clean_external_filemeta();
+    return false;
   }
   // make it back to the actual data buffer starting address
   rf.data += f.offset;
@@ -1318,8 +1397,6 @@ bool Proxy::readFile(File &f, bool isPartial) {
   }
 
   cleanup.start();
-  free(tmpBuffer);
-
   clean_external_filemeta();
   cleanup.stop();
 
@@ -1873,7 +1950,7 @@ bool Proxy::copyFile(File &sf, File &df) {
   return true;
 }
 
-bool Proxy::repairFile(const File &f, bool isBg) {
+bool Proxy::repairFile(const File &f, bool isBg, bool metaPrefetched) {
   File rf;
   boost::timer::cpu_timer mytimer;
 
@@ -1893,8 +1970,21 @@ bool Proxy::repairFile(const File &f, bool isBg) {
   // TAGPT (start): getMeta
   if (bmRepair) bmRepair->getMeta.setStart(bmRepair->proxyOverallTime.getStart());
 
-  // lock file and get metadata for repair
-  if (lockFileAndGetMeta(rf, "repair") == false) return false;
+  // lock file and get metadata for repair, or reuse the prefetched metadata
+  if (metaPrefetched) {
+    if (lockFile(rf) == false) {
+      LOG(ERROR) << "Failed to lock file " << rf.name << " for repair";
+      return false;
+    }
+    rf.numStripes = f.numStripes;
+    rf.copyFileChecksum(f);
+    rf.copyStoragePolicy(f);
+    rf.copyChunkInfo(f);
+    rf.codingMeta.copyMeta(f.codingMeta);
+    rf.copyStagedInfo(f);
+  } else if (lockFileAndGetMeta(rf, "repair") == false) {
+    return false;
+  }
 
   LOG(INFO) << "Repair file " << f.name << ", metadata found";
 
@@ -2013,12 +2103,26 @@ bool Proxy::repairFile(const File &f, bool isBg) {
   // TAGPT (start): update meta
   if (bmRepair) bmRepair->updateMeta.setStart(bmRepair->dataRepair.getEnd());
 
-  rf.genUUID();
-  // update metadata
-  if (_metastore->putMeta(rf) == false) {
-    LOG(ERROR) << "Failed to update file metadata after repair for file " << f.name;
-    unlockFile(rf);
-    return false;
+  // update metadata; for prefetched metadata, update the chunks only if the file is not changed since the prefetch
+  if (metaPrefetched) {
+    int ret = _metastore->updateChunks(rf, rf.version);
+    if (ret == 1) {
+      LOG(WARNING) << "Skip updating file metadata after repair for file " << f.name << ", version " << rf.version
+                   << " is outdated";
+      unlockFile(rf);
+      return true;
+    } else if (ret != 0) {
+      LOG(ERROR) << "Failed to update file metadata after repair for file " << f.name;
+      unlockFile(rf);
+      return false;
+    }
+  } else {
+    rf.genUUID();
+    if (_metastore->putMeta(rf) == false) {
+      LOG(ERROR) << "Failed to update file metadata after repair for file " << f.name;
+      unlockFile(rf);
+      return false;
+    }
   }
   LOG(INFO) << "Repair file " << f.name << ", (meta, update) duration = " << mytimer.elapsed().wall * 1.0 / 1e6
             << " milliseconds";
@@ -2173,6 +2277,12 @@ unsigned int Proxy::getFileList(FileInfo **list, bool withSize, bool withVersion
   return _metastore->getFileList(list, namespaceId, withSize, withSize, withVersions, prefix);
 }
 
+unsigned int Proxy::getFileListPage(FileInfo **list, std::string &cursor, unsigned int pageSize, bool withSize,
+                                    bool withVersions, unsigned char namespaceId, std::string prefix) {
+  if (namespaceId == INVALID_NAMESPACE_ID) namespaceId = DEFAULT_NAMESPACE_ID;
+  return _metastore->getFileListPage(list, cursor, pageSize, namespaceId, withSize, withSize, withVersions, prefix);
+}
+
 unsigned int Proxy::getFolderList(std::vector<std::string> &list, unsigned char namespaceId, std::string prefix) {
   if (namespaceId == INVALID_NAMESPACE_ID) namespaceId = DEFAULT_NAMESPACE_ID;
   return _metastore->getFolderList(list, namespaceId, prefix,
@@ -2191,6 +2301,45 @@ bool Proxy::getNumFilesToRepair(unsigned long int &count, unsigned long &repair)
   return count >= repair;
 }
 
+void *Proxy::readFileStripeInBackground(void *arg) {
+  StripeReadTask *task = (StripeReadTask *)arg;
+  task->okay = task->proxy->_chunkManager->readFileStripe(task->stripe, task->chunkIndices);
+  return NULL;
+}
+
+bool Proxy::finishStripeRead(StripeReadTask *task, unsigned long int &bytesRead) {
+  StripeWorkerPool::waitForTask(&task->work);
+
+  File &srf = task->stripe;
+  bool okay = task->okay;
+  // the buffer assigned to the stripe before the read, which lower level functions may replace
+  unsigned char *buffer = task->tempBuffer ? task->tempBuffer : task->dst;
+  if (!okay) {
+    LOG(ERROR) << "Failed to read file " << srf.name << " from backend (stripe " << task->stripeIdx << ")";
+  } else {
+    if (srf.data != task->dst) {
+      // copy data back to the original file data buffer
+      memcpy(task->dst, srf.data, srf.size);
+    }
+    bytesRead += srf.size;
+  }
+  // free the temporary buffer, and any buffer replacing it
+  if (srf.data != buffer) {
+    free(srf.data);
+  }
+  free(task->tempBuffer);
+
+  // unset the data reference to the original file data buffer or the temp
+  // buffer
+  srf.data = 0;
+  // clean up (avoid double free)
+  unsetCopyFileStripeMeta(srf);
+  delete[] task->chunkIndices;
+  delete task;
+
+  return okay;
+}
+
 void Proxy::unsetCopyFileStripeMeta(File &copy) {
   copy.chunks = 0;
   copy.containerIds = 0;
@@ -2199,19 +2348,15 @@ void Proxy::unsetCopyFileStripeMeta(File &copy) {
 }
 
 bool Proxy::lockFile(const File &f) {
-  int retryIntv = Config::getInstance().getRetryInterval();
-  int numRetry = Config::getInstance().getNumRetry();
+  Config &config = Config::getInstance();
 
-  bool locked = false;
+  // wait for the lock up to the configured time, or the total time of retries by default
+  unsigned long int maxWaitUs = config.getProxyFileLockWait() * 1000ul;
+  if (maxWaitUs == 0) maxWaitUs = std::max(config.getRetryInterval(), 0) * (unsigned long int)config.getNumRetry();
 
-  // try locking the file
-  for (int j = 0; j < numRetry; j++) {
-    locked = _metastore->lockFile(f);
-    if (locked) break;
-    // sleep before retry (avoid error when usleep more than 1e6 us)
-    if (retryIntv >= 1e6) sleep(retryIntv / 1e6);
-    usleep(retryIntv % (int)1e6);
-  }
+  boost::timer::cpu_timer lockT;
+  bool locked = _metastore->lockFile(f, maxWaitUs);
+  _lockWaitTimes.record(lockT.elapsed().wall / 1000);
 
   return locked;
 }
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <glog/logging.h>
+
+#include "stripe_worker_pool.hh"
+
+StripeWorkerPool::StripeWorkerPool(int numWorkers, const char *name) {
+    _name = name;
+    _running = true;
+    _numWorkers = 0;
+    _workers = new pthread_t[numWorkers > 0? numWorkers : 1];
+    for (int i = 0; i < numWorkers; i++) {
+        if (pthread_create(&_workers[_numWorkers], 0, runWorker, this) != 0) {
+            LOG(WARNING) << "Failed to create " << _name << " worker " << i;
+            continue;
+        }
+        _numWorkers++;
+    }
+    LOG_IF(WARNING, _numWorkers == 0) << "No " << _name << " workers, stripes are processed by the requesting threads";
+}
+
+StripeWorkerPool::~StripeWorkerPool() {
+    // let the workers finish all pending tasks before exit
+    _tasksLock.lock();
+    _running = false;
+    _tasksLock.unlock();
+    _newTask.notify_all();
+    for (int i = 0; i < _numWorkers; i++)
+        pthread_join(_workers[i], 0);
+    delete [] _workers;
+}
+
+void StripeWorkerPool::submitTask(Task *task, void *(*func)(void *), void *arg) {
+    task->func = func;
+    task->arg = arg;
+    task->pending = true;
+    // run in the calling thread if there is no worker
+    if (_numWorkers == 0) {
+        completeTask(task);
+        return;
+    }
+    _tasksLock.lock();
+    _tasks.push_back(task);
+    _tasksLock.unlock();
+    _newTask.notify_one();
+}
+
+void StripeWorkerPool::waitForTask(Task *task) {
+    std::unique_lock<std::mutex> lk (task->completionLock);
+    task->completed.wait(lk, [task] { return !task->pending; });
+}
+
+void *StripeWorkerPool::runWorker(void *arg) {
+    StripeWorkerPool *self = (StripeWorkerPool *) arg;
+    std::unique_lock<std::mutex> lk (self->_tasksLock);
+    while (true) {
+        self->_newTask.wait(lk, [self] { return !self->_running || !self->_tasks.empty(); });
+        // stop only when there is no more pending task
+        if (self->_tasks.empty())
+            break;
+        Task *task = self->_tasks.front();
+        self->_tasks.pop_front();
+        // no longer modifying the queue, unlock to allow task submission
+        lk.unlock();
+        completeTask(task);
+        // lock before waiting for task again
+        lk.lock();
+    }
+    return 0;
+}
+
+void StripeWorkerPool::completeTask(Task *task) {
+    task->func(task->arg);
+    // notify the waiting request
+    task->completionLock.lock();
+    task->pending = false;
+    task->completed.notify_all();
+    task->completionLock.unlock();
+}
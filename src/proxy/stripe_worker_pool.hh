@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __STRIPE_WORKER_POOL_HH__
+#define __STRIPE_WORKER_POOL_HH__
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <pthread.h>
+
+/**
+ * Bounded pool of persistent workers processing stripes (e.g., fetch and
+ * decode, or encode and send) for the requests being served
+ *
+ * Requests submit their stripes as tasks and wait for them in order, so the
+ * number of stripes in flight is bounded by both the window of each request
+ * and the number of workers shared by all requests.
+ **/
+class StripeWorkerPool {
+public:
+    /**
+     * Stripe task, which is embedded in the stripe read/write states of a request
+     **/
+    struct Task {
+        void *(*func)(void *);                  /**< function to process the stripe */
+        void *arg;                              /**< argument to the function */
+        bool pending;                           /**< whether the task is not completed yet */
+        std::mutex completionLock;              /**< lock for completion status */
+        std::condition_variable completed;      /**< signaled upon task completion */
+
+        Task() : func(0), arg(0), pending(false) {}
+    };
+
+    /**
+     * Constructor
+     *
+     * @param[in] numWorkers        number of workers
+     * @param[in] name              name of the pool (for logging)
+     **/
+    StripeWorkerPool(int numWorkers, const char *name);
+    ~StripeWorkerPool();
+
+    /**
+     * Submit a task to the workers, or run it in the calling thread if there is no worker
+     *
+     * @param[in] task              task to submit, which must stay valid until waitForTask() returns
+     * @param[in] func              function to process the stripe
+     * @param[in] arg               argument to the function
+     **/
+    void submitTask(Task *task, void *(*func)(void *), void *arg);
+
+    /**
+     * Wait for a task to complete
+     *
+     * @param[in] task              task submitted
+     **/
+    static void waitForTask(Task *task);
+
+private:
+    const char *_name;                                          /**< name of the pool */
+    bool _running;                                              /**< whether the pool is running */
+    int _numWorkers;                                            /**< number of workers */
+    pthread_t *_workers;                                        /**< workers */
+
+    std::deque<Task *> _tasks;                                  /**< pending tasks */
+    std::mutex _tasksLock;                                      /**< lock for pending tasks */
+    std::condition_variable _newTask;                           /**< new task arrived */
+
+    /**
+     * Main loop of workers
+     *
+     * @param[in] arg               the pool
+     *
+     * @return always 0
+     **/
+    static void *runWorker(void *arg);
+
+    static void completeTask(Task *task);
+};
+
+#endif // define __STRIPE_WORKER_POOL_HH__
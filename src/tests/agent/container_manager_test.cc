@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include <glog/logging.h>
+#include <aws/core/Aws.h>
+
+extern "C" {
+#include <oss_c_sdk/aos_http_io.h>
+}
+
+#include "../../common/config.hh"
+#include "../../ds/chunk.hh"
+#include "../../agent/container_manager.hh"
+
+/**
+ * Container Manager Test
+ *
+ * Test flow:
+ * 1. Init the container manager on the containers configured
+ * 2. Put chunks over all containers at once, which are processed by the containers concurrently
+ * 3. Get the chunks from all containers at once
+ * 4. Check chunks existence, in the containers specified only
+ * 5. Put chunks with one to an unknown container
+ *    - Expect put failure, and the chunks stored in the other containers are removed
+ * 6. Delete chunks with one in an unknown container
+ *    - Expect the chunks in the other containers are removed
+ *
+ * Usage: ./container_manager_test
+ **/
+
+#define NUM_CONTAINER Config::getInstance().getNumContainers()
+#define NUM_CHUNK_PER_CONTAINER (3)
+#define CHUNK_SIZE (1024)
+
+/**
+ * Check whether each chunk exists in a container
+ *
+ * @return whether all chunks are found (or all not found) as expected
+ **/
+static bool checkChunks(ContainerManager &cm, int containerId[], Chunk chunks[], int numChunks, bool expected, const char *step) {
+    for (int i = 0; i < numChunks; i++) {
+        if (cm.hasChunks(&containerId[i], &chunks[i], 1) != expected) {
+            printf(">> Failed to %s chunk %s in container %d after %s\n", expected? "find" : "detect non-existing", chunks[i].getChunkName().c_str(), containerId[i], step);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Config &config = Config::getInstance();
+    config.setConfigPath();
+
+    // configure logging
+    if (!config.glogToConsole()) {
+        FLAGS_log_dir = config.getGlogDir().c_str();
+        printf("Output log to %s\n", config.getGlogDir().c_str());
+    } else {
+        FLAGS_logtostderr = true;
+        printf("Output log to console\n");
+    }
+    FLAGS_minloglevel = config.getLogLevel();
+    google::InitGoogleLogging(argv[0]);
+
+    // init aws sdk
+    Aws::SDKOptions options;
+    Aws::InitAPI(options);
+    // init aliyun sdk
+    if (aos_http_io_initialize(NULL, 0) != AOSE_OK) {
+        LOG(ERROR) << "Failed to init Aliyun OSS interface";
+        return 1;
+    }
+
+    printf("Start Container Manager Test\n");
+    printf("====================\n");
+
+    ContainerManager *cm = new ContainerManager();
+
+    const int numChunks = NUM_CONTAINER * NUM_CHUNK_PER_CONTAINER;
+    int *containerId = new int[numChunks], *otherContainerId = new int[numChunks];
+    Chunk *chunks = new Chunk[numChunks], *readChunks = new Chunk[numChunks];
+
+    // spread the chunks over all containers, and find an id not used by any container
+    int unknownContainerId = 0;
+    for (int i = 0; i < NUM_CONTAINER; i++)
+        unknownContainerId = std::max(unknownContainerId, config.getContainerId(i) + 1);
+    boost::uuids::basic_random_generator<boost::mt19937> gen;
+    boost::uuids::uuid fileuuid = gen();
+    for (int i = 0; i < numChunks; i++) {
+        containerId[i] = config.getContainerId(i % NUM_CONTAINER);
+        otherContainerId[i] = config.getContainerId((i + 1) % NUM_CONTAINER);
+        chunks[i].setId(/* namespace id */ 1, fileuuid, i);
+        chunks[i].size = CHUNK_SIZE;
+        chunks[i].data = (unsigned char *) malloc (CHUNK_SIZE * sizeof(unsigned char));
+        memset(chunks[i].data, 'a' + i % 26, CHUNK_SIZE);
+        chunks[i].computeMD5();
+    }
+
+    bool okay = true;
+
+    // put chunks to all containers
+    if (!cm->putChunks(containerId, chunks, numChunks)) {
+        printf(">> Failed to put chunks to %d containers\n", NUM_CONTAINER);
+        okay = false;
+    } else {
+        printf("> Put %d chunks to %d containers\n", numChunks, NUM_CONTAINER);
+    }
+
+    // get chunks from all containers
+    for (int i = 0; i < numChunks; i++)
+        readChunks[i].copyMeta(chunks[i], /* copySize */ false);
+    if (okay && !cm->getChunks(containerId, readChunks, numChunks)) {
+        printf(">> Failed to get chunks from %d containers\n", NUM_CONTAINER);
+        okay = false;
+    }
+    for (int i = 0; i < numChunks && okay; i++) {
+        if (readChunks[i].size != chunks[i].size || memcmp(readChunks[i].data, chunks[i].data, CHUNK_SIZE) != 0) {
+            printf(">> Chunk %s content mismatch\n", chunks[i].getChunkName().c_str());
+            okay = false;
+        }
+    }
+    if (okay)
+        printf("> Get %d chunks from %d containers\n", numChunks, NUM_CONTAINER);
+
+    // check the chunks are put to the containers specified only
+    okay = okay && checkChunks(*cm, containerId, chunks, numChunks, /* expected */ true, "put");
+    okay = okay && (NUM_CONTAINER == 1 || checkChunks(*cm, otherContainerId, chunks, numChunks, /* expected */ false, "put to other containers"));
+    if (okay)
+        printf("> Check chunks in the containers specified\n");
+
+    // put chunks with the last one to an unknown container, expect the chunks stored removed
+    okay = okay && cm->deleteChunks(containerId, chunks, numChunks) && checkChunks(*cm, containerId, chunks, numChunks, /* expected */ false, "delete");
+    int lastContainerId = containerId[numChunks - 1];
+    containerId[numChunks - 1] = unknownContainerId;
+    if (okay && cm->putChunks(containerId, chunks, numChunks)) {
+        printf(">> Failed to detect put to unknown container %d\n", unknownContainerId);
+        okay = false;
+    }
+    okay = okay && checkChunks(*cm, containerId, chunks, numChunks - 1, /* expected */ false, "failed put");
+    if (okay)
+        printf("> Remove chunks stored after a failed put\n");
+
+    // delete chunks with the last one in an unknown container, expect the chunks in the other containers removed
+    containerId[numChunks - 1] = lastContainerId;
+    okay = okay && cm->putChunks(containerId, chunks, numChunks);
+    containerId[numChunks - 1] = unknownContainerId;
+    okay = okay && cm->deleteChunks(containerId, chunks, numChunks) && checkChunks(*cm, containerId, chunks, numChunks - 1, /* expected */ false, "delete");
+    containerId[numChunks - 1] = lastContainerId;
+    okay = okay && checkChunks(*cm, containerId + numChunks - 1, chunks + numChunks - 1, 1, /* expected */ true, "delete in an unknown container");
+    okay = okay && cm->deleteChunks(containerId, chunks, numChunks);
+    if (okay)
+        printf("> Delete chunks with one in an unknown container\n");
+
+    delete cm;
+
+    delete [] containerId;
+    delete [] otherContainerId;
+    delete [] chunks;
+    delete [] readChunks;
+
+    aos_http_io_deinitialize();
+    Aws::ShutdownAPI(options);
+
+    printf("End of Container Manager Test\n");
+    printf("====================\n");
+
+    // 0 if okay is true, 1 otherwise
+    return !okay;
+}
@@ -3,6 +3,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <linux/limits.h>
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
@@ -31,6 +33,14 @@ extern "C" {
  * 8. Move chunks within containers
  * 9. Delete chunks in containers
  * 10. Check chunks existence
+ * 11. Migrate chunk files of a fs container (in a separate directory) from the
+ *     flat layout, from another fs_dir_levels, and after a partial migration,
+ *     and recover the usage after an unclean shutdown
+ * 12. Reopen a segment container (in a separate directory) seeded with
+ *     segments of overwritten, deleted, and expired chunks, and a torn record,
+ *     and check the chunks and versions after compaction, and after replaying
+ *     the records (including the relocated ones) after an older checkpoint,
+ *     up to a torn record or a record with a corrupted header
  *
  * Expect all operations to finish successfully
  *
@@ -41,6 +51,424 @@ extern "C" {
 #define NUM_CONTAINER Config::getInstance().getNumContainers()
 #define NUM_CHUNK (6)
 #define CHUNK_SIZE (1024)
+#define NUM_MIGRATION_CHUNK (8)
+
+/**
+ * Get the path of a chunk file in the layout of fs containers, i.e., under
+ * levels of subdirectories named by the bytes of the 32-bit FNV-1a hash of
+ * the chunk name
+ **/
+static std::string getFsChunkPath(const std::string &dir, const std::string &name, int levels) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < name.size(); i++) {
+        hash ^= (unsigned char) name[i];
+        hash *= 16777619u;
+    }
+    std::string path = dir + "/";
+    char subdir[4];
+    for (int i = 0; i < levels; i++) {
+        snprintf(subdir, sizeof(subdir), "%02x/", (hash >> (i * 8)) & 0xff);
+        path += subdir;
+    }
+    return path + name;
+}
+
+static bool writeFsChunkFile(const std::string &path, char c, int size) {
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(boost::filesystem::path(path).parent_path(), ec);
+    FILE *f = fopen(path.c_str(), "w");
+    if (f == NULL)
+        return false;
+    std::string data(size, c);
+    bool okay = fwrite(data.data(), 1, size, f) == (size_t) size;
+    return fclose(f) == 0 && okay;
+}
+
+static bool moveFsChunkFile(const std::string &from, const std::string &to) {
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(boost::filesystem::path(to).parent_path(), ec);
+    return rename(from.c_str(), to.c_str()) == 0;
+}
+
+static bool writeFsSummary(const std::string &dir, int levels, unsigned long int usage, bool clean) {
+    FILE *f = fopen((dir + "/.summary").c_str(), "w");
+    if (f == NULL)
+        return false;
+    fprintf(f, "levels %d\nusage %lu\nclean %d\n", levels, usage, clean? 1 : 0);
+    return fclose(f) == 0;
+}
+
+/**
+ * Check the chunk files are all (and only) in the layout of a fs container,
+ * and the container reports the expected data and usage
+ **/
+static bool checkFsChunks(Container *c, const std::string &dir, int levels, Chunk chunks[], const std::string versions[], char data[], unsigned long int usage) {
+    for (int i = 0; i < NUM_MIGRATION_CHUNK; i++) {
+        std::string path = getFsChunkPath(dir, chunks[i].getChunkName(), levels);
+        for (int l = 0; l <= 3; l++) {
+            std::string other = getFsChunkPath(dir, chunks[i].getChunkName(), l);
+            if (l != levels && (boost::filesystem::exists(other) || boost::filesystem::exists(other + "." + versions[i]))) {
+                printf(">> Chunk file %s is not moved to %s\n", other.c_str(), path.c_str());
+                return false;
+            }
+        }
+        if (!boost::filesystem::exists(path) || (!versions[i].empty() && !boost::filesystem::exists(path + "." + versions[i]))) {
+            printf(">> Chunk file %s (or its old version %s) not found\n", path.c_str(), versions[i].c_str());
+            return false;
+        }
+        Chunk readChunk;
+        readChunk.copyMeta(chunks[i]);
+        if (!c->getChunk(readChunk, /* skipVerification */ true) || readChunk.size != chunks[i].size || std::string((char *) readChunk.data, readChunk.size) != std::string(readChunk.size, data[i])) {
+            printf(">> Failed to get chunk %s after migration\n", chunks[i].getChunkName().c_str());
+            return false;
+        }
+    }
+    // check the usage tracked by the container (fs containers do not scan the directory on usage updates)
+    unsigned long int current = c->getUsage(true);
+    if (current != usage) {
+        printf(">> Failed to get the expected usage (%lu) after migration, but get %lu instead\n", usage, current);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Migrate chunk files of a fs container to the configured number of levels of subdirectories
+ **/
+static bool testFsMigration(const std::string &dir, int id, unsigned long int capacity, int chunkSize) {
+    const int levels = Config::getInstance().getAgentFsDirLevels();
+    const int otherLevels = levels == 1? 2 : 1;
+    const int oldChunkSize = chunkSize / 2 + 1;
+
+    Chunk chunks[NUM_MIGRATION_CHUNK];
+    std::string versions[NUM_MIGRATION_CHUNK];
+    char data[NUM_MIGRATION_CHUNK];
+    unsigned long int usage = 0;
+
+    boost::filesystem::remove_all(dir);
+    boost::filesystem::create_directories(dir);
+
+    // seed the flat layout, with old versions of the even chunks
+    boost::uuids::basic_random_generator<boost::mt19937> gen;
+    boost::uuids::uuid fileuuid = gen();
+    for (int i = 0; i < NUM_MIGRATION_CHUNK; i++) {
+        chunks[i].setId(/* namespace id */ 1, fileuuid, i);
+        chunks[i].size = chunkSize + i;
+        data[i] = 'a' + i;
+        usage += chunks[i].size;
+        std::string path = getFsChunkPath(dir, chunks[i].getChunkName(), 0);
+        bool okay = writeFsChunkFile(path, data[i], chunks[i].size);
+        if (i % 2 == 0) {
+            versions[i] = std::to_string(time(NULL) - i);
+            okay = writeFsChunkFile(path + "." + versions[i], 'A' + i, oldChunkSize) && okay;
+        }
+        if (!okay) {
+            printf(">> Failed to seed chunk file %s\n", path.c_str());
+            return false;
+        }
+    }
+
+    // migrate from the flat layout, without a summary
+    Container *c = new FsContainer(id, dir.c_str(), capacity);
+    bool okay = checkFsChunks(c, dir, levels, chunks, versions, data, usage);
+    delete c;
+    if (!okay)
+        return false;
+    printf("> Migrate chunk files from the flat layout to %d levels of subdirectories\n", levels);
+
+    // migrate after a change of fs_dir_levels, i.e., from the layout recorded in the summary
+    for (int i = 0; i < NUM_MIGRATION_CHUNK && okay; i++) {
+        std::string from = getFsChunkPath(dir, chunks[i].getChunkName(), levels);
+        std::string to = getFsChunkPath(dir, chunks[i].getChunkName(), otherLevels);
+        okay = moveFsChunkFile(from, to) && (versions[i].empty() || moveFsChunkFile(from + "." + versions[i], to + "." + versions[i]));
+    }
+    if (!okay || !writeFsSummary(dir, otherLevels, usage, /* clean */ true)) {
+        printf(">> Failed to move chunk files to %d levels of subdirectories\n", otherLevels);
+        return false;
+    }
+    c = new FsContainer(id, dir.c_str(), capacity);
+    okay = checkFsChunks(c, dir, levels, chunks, versions, data, usage);
+    delete c;
+    if (!okay)
+        return false;
+    printf("> Migrate chunk files from %d to %d levels of subdirectories\n", otherLevels, levels);
+
+    // retry a partial migration, i.e., the odd chunks are left in the flat layout, and the layout in the summary is unknown
+    for (int i = 1; i < NUM_MIGRATION_CHUNK && okay; i += 2)
+        okay = moveFsChunkFile(getFsChunkPath(dir, chunks[i].getChunkName(), levels), getFsChunkPath(dir, chunks[i].getChunkName(), 0));
+    if (!okay || !writeFsSummary(dir, -1, usage / 2, /* clean */ true)) {
+        printf(">> Failed to move chunk files back to the flat layout\n");
+        return false;
+    }
+    c = new FsContainer(id, dir.c_str(), capacity);
+    okay = checkFsChunks(c, dir, levels, chunks, versions, data, usage);
+    delete c;
+    if (!okay)
+        return false;
+    printf("> Retry a partial migration of chunk files\n");
+
+    // recover the usage after an unclean shutdown, i.e., the usage in the summary is outdated
+    if (!writeFsSummary(dir, levels, usage / 2, /* clean */ false)) {
+        printf(">> Failed to write the summary\n");
+        return false;
+    }
+    c = new FsContainer(id, dir.c_str(), capacity);
+    okay = checkFsChunks(c, dir, levels, chunks, versions, data, usage);
+    printf("> Recover usage after an unclean shutdown\n");
+
+    // revert the even chunks to the old versions migrated
+    for (int i = 0; i < NUM_MIGRATION_CHUNK && okay; i += 2) {
+        strncpy(chunks[i].chunkVersion, versions[i].c_str(), CHUNK_VERSION_MAX_LEN);
+        if (!c->revertChunk(chunks[i])) {
+            printf(">> Failed to revert chunk %s to version %s after migration\n", chunks[i].getChunkName().c_str(), versions[i].c_str());
+            okay = false;
+            break;
+        }
+        usage += oldChunkSize - chunks[i].size;
+        chunks[i].size = oldChunkSize;
+        data[i] = 'A' + i;
+        versions[i].clear();
+    }
+    okay = okay && checkFsChunks(c, dir, levels, chunks, versions, data, usage);
+    delete c;
+    if (!okay)
+        return false;
+    printf("> Revert chunks to the old versions migrated\n");
+
+    // load the usage from the summary saved on clean shutdown
+    c = new FsContainer(id, dir.c_str(), capacity);
+    okay = checkFsChunks(c, dir, levels, chunks, versions, data, usage);
+    delete c;
+
+    boost::filesystem::remove_all(dir);
+
+    return okay;
+}
+
+/**
+ * Record header in segment files, as SegmentContainer::RecordHeader
+ **/
+struct SegmentRecordHeader {
+    uint32_t magic;
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t nameLength;
+    uint16_t auxLength;
+    uint16_t reserved2;
+    uint32_t dataLength;
+    int64_t timestamp;
+    uint32_t srcSegment;
+    uint32_t checksum;
+    uint64_t srcOffset;
+    unsigned char md5[MD5_DIGEST_LENGTH];
+};
+
+#define SEGMENT_PUT_RECORD (1)
+#define SEGMENT_DELETE_RECORD (2)
+
+/**
+ * Append a record to a segment file, or only part of it (a torn record), or one with its header changed after the checksum is computed (a corrupted record) if asked
+ **/
+static bool appendSegmentRecord(const std::string &path, uint8_t type, const std::string &name, const std::string &aux, char c, int size, time_t timestamp, bool torn = false, bool corrupted = false) {
+    SegmentRecordHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = SEGMENT_RECORD_MAGIC;
+    header.type = type;
+    header.nameLength = name.size();
+    header.auxLength = aux.size();
+    header.dataLength = size;
+    header.timestamp = timestamp;
+    std::string data(size, c);
+    MD5Calculator md5;
+    unsigned int md5Length = MD5_DIGEST_LENGTH;
+    if (!md5.appendData((const unsigned char *) data.data(), size) || !md5.finalize(header.md5, md5Length))
+        return false;
+    boost::crc_32_type crc;
+    crc.process_bytes(&header, sizeof(header));
+    crc.process_bytes(name.data(), name.size());
+    crc.process_bytes(aux.data(), aux.size());
+    header.checksum = crc.checksum();
+    if (corrupted)
+        header.timestamp ^= 1;
+
+    std::string record = std::string((char *) &header, sizeof(header)) + name + aux + data;
+    if (torn)
+        record.resize(sizeof(header) + name.size() + aux.size() + size / 2);
+
+    FILE *f = fopen(path.c_str(), "a");
+    if (f == NULL)
+        return false;
+    bool okay = fwrite(record.data(), 1, record.size(), f) == record.size();
+    return fclose(f) == 0 && okay;
+}
+
+/**
+ * Check the chunks in a segment container, a chunk is expected to be missing if its data is 0
+ **/
+static bool checkSegmentChunks(Container *c, Chunk chunks[], int numChunks, const char data[], const int sizes[]) {
+    for (int i = 0; i < numChunks; i++) {
+        Chunk readChunk;
+        readChunk.copyMeta(chunks[i]);
+        bool found = c->getChunk(readChunk, /* skipVerification */ true);
+        if (data[i] == 0 && found) {
+            printf(">> Failed to detect non-existing chunk %s\n", chunks[i].getChunkName().c_str());
+            return false;
+        }
+        if (data[i] != 0 && (!found || readChunk.size != sizes[i] || std::string((char *) readChunk.data, readChunk.size) != std::string(sizes[i], data[i]))) {
+            printf(">> Failed to get chunk %s with data '%c'\n", chunks[i].getChunkName().c_str(), data[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool revertSegmentChunk(Container *c, Chunk &chunk, const std::string &version) {
+    strncpy(chunk.chunkVersion, version.c_str(), CHUNK_VERSION_MAX_LEN);
+    return c->revertChunk(chunk);
+}
+
+/**
+ * Reopen a segment container on segments seeded, compacted, and checkpointed
+ **/
+static bool testSegmentContainer(const std::string &dir, int id, unsigned long int capacity) {
+    // chunks a-g, where b keeps an old version, a keeps an expired one, c is deleted, d is moved to g, and f is torn
+    enum { A = 0, B, C, D, E, F, G, NUM_SEGMENT_TEST_CHUNK };
+    Chunk chunks[NUM_SEGMENT_TEST_CHUNK];
+    char data[NUM_SEGMENT_TEST_CHUNK] = { 'b', 'd', 0, 'f', 'g', 0, 0 };
+    int sizes[NUM_SEGMENT_TEST_CHUNK];
+    const int smallSize = CHUNK_SIZE, largeSize = CHUNK_SIZE * 64;
+    time_t now = time(NULL);
+    std::string expiredVersion = std::to_string(now - SEGMENT_OLD_CHUNK_TTL * 2), oldVersion = std::to_string(now);
+    std::string segment0 = dir + "/segment_00000000", segment1 = dir + "/segment_00000001", checkpoint = dir + "/.index";
+
+    boost::filesystem::remove_all(dir);
+    boost::filesystem::create_directories(dir);
+
+    boost::uuids::basic_random_generator<boost::mt19937> gen;
+    boost::uuids::uuid fileuuid = gen();
+    for (int i = 0; i < NUM_SEGMENT_TEST_CHUNK; i++) {
+        chunks[i].setId(/* namespace id */ 1, fileuuid, i);
+        sizes[i] = smallSize;
+    }
+
+    // seed a sealed segment, mostly garbage after the old version of a expires, and the active segment with a torn record
+    bool okay = appendSegmentRecord(segment0, SEGMENT_PUT_RECORD, chunks[A].getChunkName(), "", 'a', largeSize, now)
+        && appendSegmentRecord(segment0, SEGMENT_PUT_RECORD, chunks[A].getChunkName(), expiredVersion, 'b', smallSize, now - SEGMENT_OLD_CHUNK_TTL * 2)
+        && appendSegmentRecord(segment0, SEGMENT_PUT_RECORD, chunks[B].getChunkName(), "", 'c', smallSize, now)
+        && appendSegmentRecord(segment0, SEGMENT_PUT_RECORD, chunks[B].getChunkName(), oldVersion, 'd', smallSize, now)
+        && appendSegmentRecord(segment0, SEGMENT_PUT_RECORD, chunks[C].getChunkName(), "", 'e', largeSize, now)
+        && appendSegmentRecord(segment0, SEGMENT_DELETE_RECORD, chunks[C].getChunkName(), "", 0, 0, now)
+        && appendSegmentRecord(segment0, SEGMENT_PUT_RECORD, chunks[D].getChunkName(), "", 'f', smallSize, now)
+        && appendSegmentRecord(segment1, SEGMENT_PUT_RECORD, chunks[E].getChunkName(), "", 'g', smallSize, now)
+        && appendSegmentRecord(segment1, SEGMENT_PUT_RECORD, chunks[F].getChunkName(), "", 'h', smallSize, now, /* torn */ true);
+    if (!okay) {
+        printf(">> Failed to seed segment files in %s\n", dir.c_str());
+        return false;
+    }
+
+    // replay the segments without a checkpoint
+    SegmentContainer *c = new SegmentContainer(id, dir.c_str(), capacity);
+    okay = checkSegmentChunks(c, chunks, NUM_SEGMENT_TEST_CHUNK, data, sizes);
+    // keep the checkpoint saved after replay, to replay the changes below again later
+    okay = okay && boost::filesystem::exists(checkpoint);
+    if (okay)
+        boost::filesystem::copy_file(checkpoint, checkpoint + ".old");
+    if (!okay) {
+        printf(">> Failed to replay the seeded segments\n");
+        delete c;
+        return false;
+    }
+    printf("> Replay segments without a checkpoint\n");
+
+    // overwrite the torn record, move a chunk, and compact
+    std::string buf(smallSize, 'h');
+    Chunk chunk;
+    chunk.copyMeta(chunks[F]);
+    chunk.size = smallSize;
+    chunk.data = (unsigned char *) buf.data();
+    chunk.freeData = false;
+    chunk.computeMD5();
+    okay = c->putChunk(chunk) && c->moveChunk(chunks[D], chunks[G]);
+    data[F] = 'h';
+    data[G] = 'f';
+    data[D] = 0;
+    if (okay)
+        c->compact();
+    okay = okay && checkSegmentChunks(c, chunks, NUM_SEGMENT_TEST_CHUNK, data, sizes);
+    if (okay && boost::filesystem::exists(segment0)) {
+        printf(">> Failed to remove the compacted segment %s\n", segment0.c_str());
+        okay = false;
+    }
+    if (okay && revertSegmentChunk(c, chunks[A], expiredVersion)) {
+        printf(">> Failed to remove the expired version %s of chunk %s\n", expiredVersion.c_str(), chunks[A].getChunkName().c_str());
+        okay = false;
+    }
+    delete c;
+    if (!okay)
+        return false;
+    printf("> Compact segments\n");
+
+    // reopen with the checkpoint saved on shutdown, and revert to an old version relocated
+    c = new SegmentContainer(id, dir.c_str(), capacity);
+    okay = checkSegmentChunks(c, chunks, NUM_SEGMENT_TEST_CHUNK, data, sizes) && revertSegmentChunk(c, chunks[B], oldVersion);
+    data[B] = 'c';
+    okay = okay && checkSegmentChunks(c, chunks, NUM_SEGMENT_TEST_CHUNK, data, sizes);
+    delete c;
+    if (!okay) {
+        printf(">> Failed to reopen the segment container and revert chunk %s\n", chunks[B].getChunkName().c_str());
+        return false;
+    }
+    printf("> Reopen segments after compaction\n");
+
+    // replay the changes (and relocations) after the older checkpoint, up to a torn record at the end
+    boost::filesystem::rename(checkpoint + ".old", checkpoint);
+    if (!appendSegmentRecord(segment1, SEGMENT_PUT_RECORD, chunks[C].getChunkName(), "", 'x', smallSize, now, /* torn */ true)) {
+        printf(">> Failed to append a torn record to %s\n", segment1.c_str());
+        return false;
+    }
+    c = new SegmentContainer(id, dir.c_str(), capacity);
+    okay = checkSegmentChunks(c, chunks, NUM_SEGMENT_TEST_CHUNK, data, sizes);
+    if (okay && (revertSegmentChunk(c, chunks[A], expiredVersion) || revertSegmentChunk(c, chunks[B], oldVersion))) {
+        printf(">> Failed to detect reverted or expired versions after replay\n");
+        okay = false;
+    }
+    // overwrite the torn record
+    buf.assign(smallSize, 'i');
+    chunk.copyMeta(chunks[C]);
+    chunk.size = smallSize;
+    chunk.data = (unsigned char *) buf.data();
+    chunk.freeData = false;
+    chunk.computeMD5();
+    okay = okay && c->putChunk(chunk);
+    data[C] = 'i';
+    delete c;
+    if (!okay)
+        return false;
+    c = new SegmentContainer(id, dir.c_str(), capacity);
+    okay = checkSegmentChunks(c, chunks, NUM_SEGMENT_TEST_CHUNK, data, sizes);
+    delete c;
+    if (!okay)
+        return false;
+    printf("> Replay segments after a checkpoint\n");
+
+    // stop replay at a complete record with a corrupted header
+    if (!appendSegmentRecord(segment1, SEGMENT_PUT_RECORD, chunks[C].getChunkName(), "", 'y', smallSize, now, /* torn */ false, /* corrupted */ true)) {
+        printf(">> Failed to append a corrupted record to %s\n", segment1.c_str());
+        return false;
+    }
+    c = new SegmentContainer(id, dir.c_str(), capacity);
+    okay = checkSegmentChunks(c, chunks, NUM_SEGMENT_TEST_CHUNK, data, sizes);
+    delete c;
+    if (!okay) {
+        printf(">> Failed to detect the record with a corrupted header\n");
+        return false;
+    }
+    printf("> Replay segments up to a record with a corrupted header\n");
+
+    boost::filesystem::remove_all(dir);
+
+    return okay;
+}
 
 int main(int argc, char **argv) {
     Config &config = Config::getInstance();
@@ -95,6 +523,9 @@ int main(int argc, char **argv) {
         case ContainerType::FS_CONTAINER:
             c[i] = new FsContainer(i, cstr.c_str(), capacity);
             break;
+        case ContainerType::SEGMENT_CONTAINER:
+            c[i] = new SegmentContainer(i, cstr.c_str(), capacity);
+            break;
         case ContainerType::AWS_CONTAINER:
             c[i] = new AwsContainer(cid, cstr, region, keyId, key, capacity, "", proxyIP, proxyPort);
             break;
@@ -181,16 +612,6 @@ int main(int argc, char **argv) {
             }
         }
 
-        // release the allocated resources
-        for (int i = 0; i < NUM_CHUNK; i++) {
-            free(chunks[i + NUM_CHUNK].data);
-            free(chunks[i + NUM_CHUNK * 2].data);
-            chunks[i + NUM_CHUNK].data = 0;
-            chunks[i + NUM_CHUNK * 2].data = 0;
-            chunks[i + NUM_CHUNK].size = 0;
-            chunks[i + NUM_CHUNK * 2].size = 0;
-        }
-
         // revert chunks
         for (int i = 0; i < NUM_CHUNK && okay; i++) {
             if (c[i % NUM_CONTAINER]->revertChunk(chunks[i + NUM_CHUNK]) == false) {
@@ -200,6 +621,12 @@ int main(int argc, char **argv) {
             }
             printf("> Revert chunk %s %s\n", chunks[i + NUM_CHUNK].getChunkName().c_str(), chunks[i + NUM_CHUNK].getChunkVersion());
         }
+
+        // release the allocated resources (after revert, which needs the chunk versions)
+        for (int i = 0; i < NUM_CHUNK; i++) {
+            chunks[i + NUM_CHUNK].release();
+            chunks[i + NUM_CHUNK * 2].release();
+        }
     }
     */
 
@@ -336,6 +763,22 @@ int main(int argc, char **argv) {
         printf("> Check chunk %s no longer exists\n", chunks[i + NUM_CHUNK].getChunkName().c_str());
     }
 
+    // migrate chunk files of a fs container, in a directory next to the first fs container
+    for (int i = 0; i < NUM_CONTAINER && okay; i++) {
+        if (config.getContainerType(i) != ContainerType::FS_CONTAINER)
+            continue;
+        okay = testFsMigration(config.getContainerPath(i) + "_migration", NUM_CONTAINER, config.getContainerCapacity(i), chunkSize);
+        break;
+    }
+
+    // reopen a segment container, in a directory next to the first segment container
+    for (int i = 0; i < NUM_CONTAINER && okay; i++) {
+        if (config.getContainerType(i) != ContainerType::SEGMENT_CONTAINER)
+            continue;
+        okay = testSegmentContainer(config.getContainerPath(i) + "_reopen", NUM_CONTAINER, config.getContainerCapacity(i));
+        break;
+    }
+
     // release resources 
     for (int i = 0; i < NUM_CONTAINER; i++) {
         delete c[i];
@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <boost/timer/timer.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <glog/logging.h>
+
+#include "../../common/config.hh"
+#include "../../common/define.hh"
+#include "../../common/latency_histogram.hh"
+#include "../../ds/chunk.hh"
+#include "../../agent/container/fs.hh"
+#include "../../agent/container/segment.hh"
+
+/**
+ * File System Container I/O Benchmark
+ *
+ * Report the per-chunk latency and throughput of chunk writes and reads on a
+ * file system container, using the I/O engine and sync settings in agent.ini
+ * (misc.fs_io_engine, misc.fs_io_depth, misc.flush_on_close, and
+ * misc.fs_sync_batching). Run once per setting to compare them.
+ *
+ * The chunks can also be put into a segment container, which packs chunks
+ * into segment files (misc.segment_size), to compare the throughput (ops/s)
+ * of small chunks against a file system container.
+ *
+ * Test flow
+ * 1. Each worker prepares its own chunks with random data
+ * 2. All workers write their chunks (putChunk)
+ * 3. All workers read their chunks (getChunk), and check the data read
+ * 4. Report the latency (avg., p50, p99) and throughput (MB/s and ops/s) in each step, and remove the chunks
+ *
+ * Note reads via the buffered I/O engine may be served from the page cache.
+ *
+ **/
+
+enum BenchmarkOp {
+    PUT_CHUNK,
+    GET_CHUNK,
+
+    NUM_BENCHMARK_OPS
+};
+
+static const char *opNames[NUM_BENCHMARK_OPS] = { "putChunk", "getChunk" };
+
+static int chunkSize = 8 << 20;
+static int numChunksPerWorker = 16;
+static int numWorkers = 1;
+static std::string dir = "./fs_io_benchmark";
+static std::string containerType = "fs";
+
+static Container *container = NULL;
+static LatencyHistogram latencies[NUM_BENCHMARK_OPS];
+static pthread_barrier_t opStart, opEnd;
+
+struct WorkerArg {
+    int id;                                 /**< worker id */
+    std::vector<Chunk> chunks;              /**< chunks of the worker */
+    unsigned long int numFailedOps;         /**< number of failed operations */
+};
+
+void usage(char *prog) {
+    printf("Usage: %s [chunk size in bytes (default: %d)] [num. of chunks per worker (default: %d)] [num. of workers (default: %d)] [container directory (default: %s)] [container type: fs, segment (default: %s)]\n", prog, chunkSize, numChunksPerWorker, numWorkers, dir.c_str(), containerType.c_str());
+}
+
+static bool initChunk(Chunk &chunk, boost::uuids::uuid fuuid, int chunkId) {
+    chunk.setId(0, fuuid, chunkId);
+    chunk.fileVersion = 0;
+    if (!chunk.allocateData(chunkSize))
+        return false;
+    for (int i = 0; i < chunkSize; i++)
+        chunk.data[i] = rand() & 0xff;
+    chunk.computeMD5();
+    return true;
+}
+
+static bool runOp(BenchmarkOp op, Chunk &chunk) {
+    switch (op) {
+    case PUT_CHUNK:
+        return container->putChunk(chunk);
+    case GET_CHUNK:
+        {
+            Chunk rchunk;
+            rchunk.copyMeta(chunk, /* copySize */ false);
+            return container->getChunk(rchunk) && rchunk.size == chunk.size && memcmp(rchunk.data, chunk.data, chunk.size) == 0;
+        }
+    default:
+        break;
+    }
+    return false;
+}
+
+void *runWorker(void *arg) {
+    WorkerArg *warg = (WorkerArg *) arg;
+
+    for (int op = 0; op < NUM_BENCHMARK_OPS; op++) {
+        pthread_barrier_wait(&opStart);
+        for (Chunk &chunk : warg->chunks) {
+            boost::timer::cpu_timer mytimer;
+            if (!runOp((BenchmarkOp) op, chunk))
+                warg->numFailedOps++;
+            latencies[op].record(mytimer.elapsed().wall / 1000);
+        }
+        pthread_barrier_wait(&opEnd);
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if ((argc > 1 && atoi(argv[1]) <= 0) || (argc > 2 && atoi(argv[2]) <= 0) || (argc > 3 && atoi(argv[3]) <= 0) || (argc > 5 && strcmp(argv[5], "fs") != 0 && strcmp(argv[5], "segment") != 0)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (argc > 1) chunkSize = atoi(argv[1]);
+    if (argc > 2) numChunksPerWorker = atoi(argv[2]);
+    if (argc > 3) numWorkers = atoi(argv[3]);
+    if (argc > 4) dir = argv[4];
+    if (argc > 5) containerType = argv[5];
+
+    Config &config = Config::getInstance();
+    config.setConfigPath();
+
+    if (!config.glogToConsole()) {
+        FLAGS_log_dir = config.getGlogDir().c_str();
+        printf("Output log to %s\n", config.getGlogDir().c_str());
+    } else {
+        FLAGS_logtostderr = true;
+        printf("Output log to console\n");
+    }
+    FLAGS_minloglevel = config.getLogLevel();
+    google::InitGoogleLogging(argv[0]);
+
+    printf("Start FS Container I/O Benchmark\n");
+    printf("================================\n");
+    printf("Chunk size = %dB, num. of chunks per worker = %d, num. of workers = %d, directory = %s, container type = %s\n", chunkSize, numChunksPerWorker, numWorkers, dir.c_str(), containerType.c_str());
+    printf("I/O engine = %s, I/O depth = %d, flush on close = %d, sync batching = %d, segment size = %dMiB\n"
+        , config.getAgentFsIoEngine() == FsIoEngine::DIRECT_FS_IO? "direct" : "buffered"
+        , config.getAgentFsIoDepth()
+        , config.getAgentFlushOnClose()
+        , config.getAgentFsSyncBatching()
+        , config.getAgentSegmentSize()
+    );
+
+    unsigned long int capacity = (unsigned long int) chunkSize * numChunksPerWorker * numWorkers * 2;
+    if (containerType == "segment")
+        container = new SegmentContainer(0, dir.c_str(), capacity);
+    else
+        container = new FsContainer(0, dir.c_str(), capacity);
+
+    std::vector<pthread_t> workers (numWorkers);
+    std::vector<WorkerArg> args (numWorkers);
+    boost::uuids::uuid fuuid = boost::uuids::random_generator()();
+
+    for (int i = 0; i < numWorkers; i++) {
+        args[i].id = i;
+        args[i].chunks = std::vector<Chunk>(numChunksPerWorker);
+        args[i].numFailedOps = 0;
+        for (int j = 0; j < numChunksPerWorker; j++) {
+            if (!initChunk(args[i].chunks[j], fuuid, i * numChunksPerWorker + j)) {
+                printf("> Failed to allocate memory for the chunks!!\n");
+                return 1;
+            }
+        }
+    }
+
+    pthread_barrier_init(&opStart, NULL, numWorkers + 1);
+    pthread_barrier_init(&opEnd, NULL, numWorkers + 1);
+
+    for (int i = 0; i < numWorkers; i++)
+        pthread_create(&workers[i], NULL, runWorker, &args[i]);
+
+    double totalMB = chunkSize * 1.0 / (1 << 20) * numChunksPerWorker * numWorkers;
+    int numOps = numChunksPerWorker * numWorkers;
+    printf("%-10s %10s %10s %12s %12s %12s\n", "op", "MB/s", "ops/s", "avg (us)", "p50 (us)", "p99 (us)");
+    for (int op = 0; op < NUM_BENCHMARK_OPS; op++) {
+        pthread_barrier_wait(&opStart);
+        boost::timer::cpu_timer mytimer;
+        pthread_barrier_wait(&opEnd);
+        double elapsed = mytimer.elapsed().wall * 1.0 / 1e9;
+        printf("%-10s %10.1f %10.1f %12.1f %12lu %12lu\n"
+            , opNames[op]
+            , totalMB / elapsed
+            , numOps / elapsed
+            , latencies[op].getAvg()
+            , latencies[op].getPercentile(50)
+            , latencies[op].getPercentile(99)
+        );
+    }
+
+    unsigned long int numFailedOps = 0;
+    for (int i = 0; i < numWorkers; i++) {
+        pthread_join(workers[i], NULL);
+        numFailedOps += args[i].numFailedOps;
+    }
+
+    pthread_barrier_destroy(&opStart);
+    pthread_barrier_destroy(&opEnd);
+
+    // clean up the chunks
+    for (int i = 0; i < numWorkers; i++)
+        for (Chunk &chunk : args[i].chunks)
+            container->deleteChunk(chunk);
+    delete container;
+
+    if (numFailedOps > 0)
+        printf("> %lu operations failed!!\n", numFailedOps);
+
+    printf("End of FS Container I/O Benchmark\n");
+
+    return numFailedOps == 0? 0 : 1;
+}
@@ -0,0 +1,543 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <boost/timer/timer.hpp>
+#include <glog/logging.h>
+
+#include "../../common/config.hh"
+#include "../../common/define.hh"
+#include "../../common/chunk_buffer_pool.hh"
+#include "../../common/coding/coding.hh"
+#include "../../common/coding/decoding_plan.hh"
+#include "../../common/coding/all.hh"
+#include "../../common/coding/coding_generator.hh"
+
+/**
+ * Coding Benchmark
+ *
+ * Measure the throughput of the coding schemes, independent of the network and storage.
+ *
+ * For each combination of coding scheme, (n, k), chunk size, and number of threads,
+ * 1. encode: encode a stripe of k data chunks (in place, as ChunkManager does)
+ * 2. decode: decode the k data chunks with e erasures of data chunks, for e = 1 .. n-k
+ * 3. repair: repair a single lost chunk, where the lost chunk rotates over all n chunks
+ *
+ * Each thread runs the operation on its own data using a shared coding instance.
+ * The benchmark reports the aggregated throughput (GB/s and ns/byte over the data
+ * encoded, decoded, or repaired), the number of chunks read per operation, and the
+ * number of allocations per operation, i.e., operator new calls, and buffers
+ * requested from / allocated by the chunk buffer pool (decode outputs are
+ * allocated once and reused, as plain malloc() is not counted).
+ *
+ * Results are printed as a table, CSV, or JSON lines (one object per result) for
+ * tracking regressions and choosing the storage class parameters.
+ **/
+
+#define DEFAULT_MIN_BYTES_PER_THREAD  (256UL << 20)
+
+static std::atomic<unsigned long int> numNewCalls(0);
+
+void *operator new(size_t size) {
+    numNewCalls++;
+    void *ptr = malloc(size == 0? 1 : size);
+    if (ptr == NULL)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t size) noexcept {
+    free(ptr);
+}
+
+enum BenchmarkOp {
+    ENCODE,
+    DECODE,
+    REPAIR
+};
+
+static const char *BenchmarkOpName[] = { "encode", "decode", "repair" };
+
+enum OutputFormat {
+    TABLE,
+    CSV,
+    JSON
+};
+
+struct BenchmarkConfig {
+    std::vector<int> schemes;
+    std::vector<std::pair<int, int> > params;     // (n, k)
+    std::vector<unsigned long int> chunkSizes;
+    std::vector<int> numThreads;
+    unsigned long int rounds;                      // 0 for auto
+    OutputFormat format;
+};
+
+struct BenchmarkTask {
+    Coding *code;
+    BenchmarkOp op;
+    int numErasures;
+    unsigned long int chunkSize;
+    unsigned long int rounds;
+    pthread_barrier_t *barrier;
+
+    bool okay;
+    bool decodable;                     // whether the erasures are decodable (may not be for non-MDS codes, e.g., LRC)
+    unsigned long int bytes;            // bytes encoded, decoded, or repaired
+    unsigned long int bytesRead;        // bytes of chunks read as inputs
+};
+
+struct BenchmarkResult {
+    int scheme;
+    int n;
+    int k;
+    unsigned long int chunkSize;
+    int numThreads;
+    BenchmarkOp op;
+    int numErasures;
+    unsigned long int rounds;
+    bool okay;
+    bool decodable;
+    unsigned long int bytes;
+    double seconds;
+    double chunksReadPerOp;
+    double newCallsPerOp;
+    double bufferRequestsPerOp;
+    double bufferAllocsPerOp;
+};
+
+void usage(char *prog) {
+    printf(
+        "Usage: %s [-s schemes] [-p n:k,...] [-c chunk sizes] [-t num. of threads] [-r rounds] [-f table|csv|json]\n"
+        "  -s  coding schemes, e.g., rs,cauchyrs,lrc (default: all)\n"
+        "  -p  coding parameters (default: 6:4,9:6,12:8,16:12)\n"
+        "  -c  chunk sizes in bytes, with optional K/M suffix (default: 64K,1M,4M)\n"
+        "  -t  number of threads (default: 1,4)\n"
+        "  -r  number of operations per thread (default: auto, about %luMB of data per thread)\n"
+        "  -f  output format (default: table)\n"
+        , prog, DEFAULT_MIN_BYTES_PER_THREAD >> 20
+    );
+}
+
+std::vector<std::string> split(const char *list) {
+    std::vector<std::string> items;
+    std::string s(list);
+    size_t start = 0, end = 0;
+    while ((end = s.find(',', start)) != std::string::npos) {
+        items.push_back(s.substr(start, end - start));
+        start = end + 1;
+    }
+    items.push_back(s.substr(start));
+    return items;
+}
+
+unsigned long int parseSize(const std::string &s) {
+    char *end = NULL;
+    unsigned long int size = strtoul(s.c_str(), &end, 10);
+    if (*end == 'K' || *end == 'k')
+        size <<= 10;
+    else if (*end == 'M' || *end == 'm')
+        size <<= 20;
+    return size;
+}
+
+bool parseArgs(int argc, char **argv, BenchmarkConfig &config) {
+    int opt = 0;
+    while ((opt = getopt(argc, argv, "s:p:c:t:r:f:h")) != -1) {
+        std::vector<std::string> items;
+        switch (opt) {
+        case 's':
+            config.schemes.clear();
+            items = split(optarg);
+            for (size_t i = 0; i < items.size(); i++) {
+                int c = 0;
+                for (; c < CodingScheme::UNKNOWN_CODE && strcasecmp(CodingSchemeName[c], items.at(i).c_str()) != 0; c++);
+                if (c == CodingScheme::UNKNOWN_CODE) {
+                    printf("Unknown coding scheme %s\n", items.at(i).c_str());
+                    return false;
+                }
+                config.schemes.push_back(c);
+            }
+            break;
+        case 'p':
+            config.params.clear();
+            items = split(optarg);
+            for (size_t i = 0; i < items.size(); i++) {
+                int n = 0, k = 0;
+                if (sscanf(items.at(i).c_str(), "%d:%d", &n, &k) != 2 || n <= 0 || k <= 0 || n < k) {
+                    printf("Invalid coding parameters %s\n", items.at(i).c_str());
+                    return false;
+                }
+                config.params.push_back(std::make_pair(n, k));
+            }
+            break;
+        case 'c':
+            config.chunkSizes.clear();
+            items = split(optarg);
+            for (size_t i = 0; i < items.size(); i++) {
+                unsigned long int size = parseSize(items.at(i));
+                if (size == 0) {
+                    printf("Invalid chunk size %s\n", items.at(i).c_str());
+                    return false;
+                }
+                config.chunkSizes.push_back(size);
+            }
+            break;
+        case 't':
+            config.numThreads.clear();
+            items = split(optarg);
+            for (size_t i = 0; i < items.size(); i++) {
+                int t = atoi(items.at(i).c_str());
+                if (t <= 0) {
+                    printf("Invalid number of threads %s\n", items.at(i).c_str());
+                    return false;
+                }
+                config.numThreads.push_back(t);
+            }
+            break;
+        case 'r':
+            config.rounds = strtoul(optarg, NULL, 10);
+            break;
+        case 'f':
+            if (strcmp(optarg, "table") == 0) {
+                config.format = OutputFormat::TABLE;
+            } else if (strcmp(optarg, "csv") == 0) {
+                config.format = OutputFormat::CSV;
+            } else if (strcmp(optarg, "json") == 0) {
+                config.format = OutputFormat::JSON;
+            } else {
+                printf("Unknown output format %s\n", optarg);
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+    return optind == argc;
+}
+
+bool runEncode(BenchmarkTask *task, data_t *data, length_t dataSize) {
+    std::vector<Chunk> stripe;
+    for (unsigned long int r = 0; r < task->rounds; r++) {
+        if (!task->code->encode(data, dataSize, stripe, NULL, /* inPlace */ true))
+            return false;
+        stripe.clear();
+    }
+    task->bytes = task->rounds * dataSize;
+    return true;
+}
+
+bool runDecode(BenchmarkTask *task, std::vector<Chunk> &stripe, length_t dataSize) {
+    Coding *code = task->code;
+    num_t k = code->getNumDataChunks();
+
+    // lose the first e data chunks
+    std::vector<chunk_id_t> failedChunks;
+    for (int i = 0; i < task->numErasures; i++)
+        failedChunks.push_back(i);
+
+    DecodingPlan plan;
+    if (!code->preDecode(failedChunks, plan, NULL)) {
+        task->decodable = false;
+        return true;
+    }
+
+    std::vector<chunk_id_t> inputChunkIds = plan.getInputChunkIds();
+    num_t numInputChunks = plan.getMinNumInputChunks();
+    std::vector<Chunk> inputChunks(numInputChunks);
+    for (num_t i = 0; i < numInputChunks; i++)
+        inputChunks.at(i).copy(stripe.at(inputChunkIds.at(i)));
+
+    data_t *decodedData = (data_t *) malloc(k * task->chunkSize);
+    length_t decodedSize = 0;
+    bool okay = true;
+    for (unsigned long int r = 0; r < task->rounds && okay; r++) {
+        okay = code->decode(inputChunks, &decodedData, decodedSize, plan, NULL);
+    }
+    free(decodedData);
+
+    task->bytes = task->rounds * dataSize;
+    task->bytesRead = task->rounds * numInputChunks * task->chunkSize;
+    return okay;
+}
+
+bool runRepair(BenchmarkTask *task, std::vector<Chunk> &stripe) {
+    Coding *code = task->code;
+    num_t n = code->getNumChunks();
+
+    // plans and inputs for repairing each chunk
+    std::vector<DecodingPlan> plans(n);
+    std::vector<std::vector<Chunk> > inputChunks(n);
+    for (num_t f = 0; f < n; f++) {
+        std::vector<chunk_id_t> failedChunks(1, f);
+        if (!code->preDecode(failedChunks, plans.at(f), NULL, /* isRepair */ true))
+            return false;
+        std::vector<chunk_id_t> inputChunkIds = plans.at(f).getInputChunkIds();
+        num_t numInputChunks = plans.at(f).getMinNumInputChunks();
+        inputChunks.at(f).resize(numInputChunks);
+        for (num_t i = 0; i < numInputChunks; i++)
+            inputChunks.at(f).at(i).copy(stripe.at(inputChunkIds.at(i)));
+    }
+
+    data_t *repairedData = (data_t *) malloc(task->chunkSize);
+    length_t repairedSize = 0;
+    bool okay = true;
+    task->bytesRead = 0;
+    for (unsigned long int r = 0; r < task->rounds && okay; r++) {
+        num_t f = r % n;
+        okay = code->decode(inputChunks.at(f), &repairedData, repairedSize, plans.at(f), NULL, /* isRepair */ true, std::vector<chunk_id_t>(1, f));
+        task->bytesRead += inputChunks.at(f).size() * task->chunkSize;
+    }
+    free(repairedData);
+
+    task->bytes = task->rounds * task->chunkSize;
+    return okay;
+}
+
+void *runTask(void *arg) {
+    BenchmarkTask *task = (BenchmarkTask *) arg;
+    Coding *code = task->code;
+    length_t dataSize = task->chunkSize * code->getNumDataChunks();
+
+    task->okay = false;
+    task->decodable = true;
+    task->bytes = 0;
+    task->bytesRead = 0;
+
+    // prepare the data and the encoded stripe
+    data_t *data = NULL;
+    std::vector<Chunk> stripe;
+    bool ready = posix_memalign((void **) &data, CHUNK_BUFFER_ALIGNMENT, dataSize) == 0;
+    if (ready) {
+        for (length_t i = 0; i < dataSize; i++)
+            data[i] = rand();
+        ready = code->encode(data, dataSize, stripe, NULL);
+    }
+
+    // wait for all threads to be ready, and the start signal
+    pthread_barrier_wait(task->barrier);
+    pthread_barrier_wait(task->barrier);
+
+    if (ready) {
+        switch (task->op) {
+        case BenchmarkOp::ENCODE:
+            task->okay = runEncode(task, data, dataSize);
+            break;
+        case BenchmarkOp::DECODE:
+            task->okay = runDecode(task, stripe, dataSize);
+            break;
+        case BenchmarkOp::REPAIR:
+            task->okay = runRepair(task, stripe);
+            break;
+        }
+    }
+
+    pthread_barrier_wait(task->barrier);
+
+    stripe.clear();
+    free(data);
+    return NULL;
+}
+
+BenchmarkResult runBenchmark(int scheme, int n, int k, unsigned long int chunkSize, int numThreads, BenchmarkOp op, int numErasures, unsigned long int rounds, Coding *code) {
+    BenchmarkResult result;
+    result.scheme = scheme;
+    result.n = n;
+    result.k = k;
+    result.chunkSize = chunkSize;
+    result.numThreads = numThreads;
+    result.op = op;
+    result.numErasures = numErasures;
+    result.okay = true;
+    result.decodable = true;
+    result.bytes = 0;
+    result.seconds = 0;
+
+    // operate on about the same amount of data per thread for all chunk sizes
+    if (rounds == 0) {
+        unsigned long int bytesPerOp = op == BenchmarkOp::REPAIR? chunkSize : chunkSize * k;
+        rounds = std::max(1UL, DEFAULT_MIN_BYTES_PER_THREAD / bytesPerOp);
+    }
+    result.rounds = rounds;
+
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, numThreads + 1);
+
+    BenchmarkTask tasks[numThreads];
+    pthread_t threads[numThreads];
+    for (int i = 0; i < numThreads; i++) {
+        tasks[i].code = code;
+        tasks[i].op = op;
+        tasks[i].numErasures = numErasures;
+        tasks[i].chunkSize = chunkSize;
+        tasks[i].rounds = rounds;
+        tasks[i].barrier = &barrier;
+        pthread_create(&threads[i], NULL, runTask, &tasks[i]);
+    }
+
+    // wait for all threads to prepare the inputs
+    pthread_barrier_wait(&barrier);
+
+    ChunkBufferPoolStats startStats = ChunkBufferPool::getInstance().getStats();
+    unsigned long int startNewCalls = numNewCalls;
+    boost::timer::cpu_timer mytimer;
+
+    // start the operations
+    pthread_barrier_wait(&barrier);
+
+    // wait for all threads to complete the operations
+    pthread_barrier_wait(&barrier);
+
+    result.seconds = mytimer.elapsed().wall * 1.0 / 1e9;
+    unsigned long int newCalls = numNewCalls - startNewCalls;
+    ChunkBufferPoolStats endStats = ChunkBufferPool::getInstance().getStats();
+
+    unsigned long int bytesRead = 0;
+    for (int i = 0; i < numThreads; i++) {
+        pthread_join(threads[i], NULL);
+        result.okay &= tasks[i].okay;
+        result.decodable &= tasks[i].decodable;
+        result.bytes += tasks[i].bytes;
+        bytesRead += tasks[i].bytesRead;
+    }
+    pthread_barrier_destroy(&barrier);
+
+    double numOps = rounds * numThreads;
+    result.chunksReadPerOp = bytesRead * 1.0 / chunkSize / numOps;
+    result.newCallsPerOp = newCalls / numOps;
+    result.bufferRequestsPerOp = (endStats.numRequests - startStats.numRequests) / numOps;
+    result.bufferAllocsPerOp = (endStats.numAllocs - startStats.numAllocs) / numOps;
+
+    return result;
+}
+
+void printHeader(OutputFormat format) {
+    switch (format) {
+    case OutputFormat::TABLE:
+        printf("%-9s %4s %4s %10s %7s %-7s %8s %10s %9s %9s %11s %8s %10s %10s\n"
+            , "scheme", "n", "k", "chunk", "threads", "op", "erasures", "rounds"
+            , "GB/s", "ns/byte", "chunks/op", "new/op", "bufreq/op", "bufalloc/op");
+        break;
+    case OutputFormat::CSV:
+        printf("scheme,n,k,chunk_size,threads,op,erasures,rounds,ok,decodable,bytes,seconds,gbps,ns_per_byte,chunks_read_per_op,new_per_op,buffer_requests_per_op,buffer_allocs_per_op\n");
+        break;
+    case OutputFormat::JSON:
+        break;
+    }
+}
+
+void printResult(OutputFormat format, const BenchmarkResult &r) {
+    double gbps = r.seconds > 0? r.bytes / r.seconds / 1e9 : 0;
+    double nsPerByte = r.bytes > 0? r.seconds * 1e9 / r.bytes : 0;
+    switch (format) {
+    case OutputFormat::TABLE:
+        if (!r.okay || !r.decodable) {
+            printf("%-9s %4d %4d %10lu %7d %-7s %8d %10s\n"
+                , CodingSchemeName[r.scheme], r.n, r.k, r.chunkSize, r.numThreads, BenchmarkOpName[r.op], r.numErasures, r.okay? "(not decodable)" : "(failed)");
+            break;
+        }
+        printf("%-9s %4d %4d %10lu %7d %-7s %8d %10lu %9.3lf %9.4lf %11.2lf %8.2lf %10.2lf %10.2lf\n"
+            , CodingSchemeName[r.scheme], r.n, r.k, r.chunkSize, r.numThreads, BenchmarkOpName[r.op], r.numErasures, r.rounds
+            , gbps, nsPerByte, r.chunksReadPerOp, r.newCallsPerOp, r.bufferRequestsPerOp, r.bufferAllocsPerOp);
+        break;
+    case OutputFormat::CSV:
+        printf("%s,%d,%d,%lu,%d,%s,%d,%lu,%d,%d,%lu,%.6lf,%.6lf,%.6lf,%.4lf,%.4lf,%.4lf,%.4lf\n"
+            , CodingSchemeName[r.scheme], r.n, r.k, r.chunkSize, r.numThreads, BenchmarkOpName[r.op], r.numErasures, r.rounds, r.okay, r.decodable
+            , r.bytes, r.seconds, gbps, nsPerByte, r.chunksReadPerOp, r.newCallsPerOp, r.bufferRequestsPerOp, r.bufferAllocsPerOp);
+        break;
+    case OutputFormat::JSON:
+        printf("{\"scheme\":\"%s\",\"n\":%d,\"k\":%d,\"chunk_size\":%lu,\"threads\":%d,\"op\":\"%s\",\"erasures\":%d,\"rounds\":%lu,\"ok\":%s,\"decodable\":%s"
+            ",\"bytes\":%lu,\"seconds\":%.6lf,\"gbps\":%.6lf,\"ns_per_byte\":%.6lf,\"chunks_read_per_op\":%.4lf"
+            ",\"new_per_op\":%.4lf,\"buffer_requests_per_op\":%.4lf,\"buffer_allocs_per_op\":%.4lf}\n"
+            , CodingSchemeName[r.scheme], r.n, r.k, r.chunkSize, r.numThreads, BenchmarkOpName[r.op], r.numErasures, r.rounds, r.okay? "true" : "false", r.decodable? "true" : "false"
+            , r.bytes, r.seconds, gbps, nsPerByte, r.chunksReadPerOp, r.newCallsPerOp, r.bufferRequestsPerOp, r.bufferAllocsPerOp);
+        break;
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    BenchmarkConfig bconfig;
+    for (int c = 0; c < CodingScheme::UNKNOWN_CODE; c++)
+        bconfig.schemes.push_back(c);
+    bconfig.params = { {6, 4}, {9, 6}, {12, 8}, {16, 12} };
+    bconfig.chunkSizes = { 64UL << 10, 1UL << 20, 4UL << 20 };
+    bconfig.numThreads = { 1, 4 };
+    bconfig.rounds = 0;
+    bconfig.format = OutputFormat::TABLE;
+
+    if (!parseArgs(argc, argv, bconfig)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Config &config = Config::getInstance();
+    config.setConfigPath();
+
+    if (!config.glogToConsole()) {
+        FLAGS_log_dir = config.getGlogDir().c_str();
+    } else {
+        FLAGS_logtostderr = true;
+    }
+    // keep the output clean for parsing
+    FLAGS_minloglevel = std::max(config.getLogLevel(), (int) google::WARNING);
+    google::InitGoogleLogging(argv[0]);
+
+    printHeader(bconfig.format);
+
+    bool okay = true;
+    for (size_t s = 0; s < bconfig.schemes.size(); s++) {
+        for (size_t p = 0; p < bconfig.params.size(); p++) {
+            int n = bconfig.params.at(p).first, k = bconfig.params.at(p).second;
+            CodingOptions options;
+            options.setN(n);
+            options.setK(k);
+            Coding *code = CodingGenerator::genCoding(bconfig.schemes.at(s), options);
+            if (code == NULL) {
+                printf("Failed to init coding scheme %s with n=%d, k=%d\n", CodingSchemeName[bconfig.schemes.at(s)], n, k);
+                okay = false;
+                continue;
+            }
+            for (size_t c = 0; c < bconfig.chunkSizes.size(); c++) {
+                for (size_t t = 0; t < bconfig.numThreads.size(); t++) {
+                    BenchmarkResult result;
+                    // encode
+                    result = runBenchmark(bconfig.schemes.at(s), n, k, bconfig.chunkSizes.at(c), bconfig.numThreads.at(t), BenchmarkOp::ENCODE, 0, bconfig.rounds, code);
+                    printResult(bconfig.format, result);
+                    okay &= result.okay;
+                    // decode with 1 .. n-k erasures
+                    for (int e = 1; e <= n - k; e++) {
+                        result = runBenchmark(bconfig.schemes.at(s), n, k, bconfig.chunkSizes.at(c), bconfig.numThreads.at(t), BenchmarkOp::DECODE, e, bconfig.rounds, code);
+                        printResult(bconfig.format, result);
+                        okay &= result.okay;
+                    }
+                    // single-chunk repair
+                    if (n > k) {
+                        result = runBenchmark(bconfig.schemes.at(s), n, k, bconfig.chunkSizes.at(c), bconfig.numThreads.at(t), BenchmarkOp::REPAIR, 1, bconfig.rounds, code);
+                        printResult(bconfig.format, result);
+                        okay &= result.okay;
+                    }
+                }
+            }
+            delete code;
+        }
+    }
+
+    return okay? 0 : 1;
+}
@@ -34,6 +34,22 @@ bool parameterValidationTest(int codingScheme, CodingOptions options, bool isVal
     return (okay && isValid) || (!okay && !isValid);
 }
 
+/**
+ * Get a decoding plan for the failed chunks. For non-MDS codes (e.g., LRC), some
+ * patterns of up to n-k failures are not decodable, so fewer chunks are marked as
+ * failed (from the back) until a plan is found.
+ **/
+bool getDecodingPlan(Coding *code, std::vector<chunk_id_t> &failedChunks, DecodingPlan &plan, data_t *codingState, bool isMDS) {
+    plan.release();
+    while (!code->preDecode(failedChunks, plan, codingState)) {
+        if (isMDS || failedChunks.empty())
+            return false;
+        failedChunks.pop_back();
+        plan.release();
+    }
+    return true;
+}
+
 /**
  * Test functions in Coding
  * @remark this function read the whole file into memory for testing, make sure the memory size of your machine is large enough to handle the file
@@ -59,6 +75,7 @@ bool codingTest(CodingOptions options, coding_param_t r, const char *codename, C
     std::vector<Chunk> decodeInput;
     std::vector<Chunk> recoveryInput;
     std::vector<Chunk> stripe;
+    std::vector<Chunk> inPlaceStripe;
     std::vector<chunk_id_t> inputChunksInPlan;
     std::vector<chunk_id_t> repairTargets;
     std::vector<chunk_id_t> failedChunks;
@@ -75,6 +92,9 @@ bool codingTest(CodingOptions options, coding_param_t r, const char *codename, C
     num_t startidx = 0;
 
     bool isRS = false;
+    bool isLRC = false;
+    LRCCode *lrc = 0;
+    std::vector<chunk_id_t> localGroupPeers;
 
     bool isRSCAR = options.repairUsingCAR();
     bool tolerateDoubleFailure = n - k >= 2;
@@ -98,12 +118,19 @@ bool codingTest(CodingOptions options, coding_param_t r, const char *codename, C
     rewind(f);
 
     // expected values
-    if (strcmp("RS", codename) == 0) {
+    if (strcmp("RS", codename) == 0 || strcmp("CauchyRS", codename) == 0) {
         numChunksPerNode = 1;
         chunkSize = (fsize + k - 1) / k;
         numDataChunks = k;
         numCodeChunks = n - k;
         isRS = true;
+    } else if (strcmp("LRC", codename) == 0) {
+        numChunksPerNode = 1;
+        chunkSize = (fsize + k - 1) / k;
+        numDataChunks = k;
+        numCodeChunks = n - k;
+        isLRC = true;
+        lrc = dynamic_cast<LRCCode *>(code);
     } else {
         fclose(f);
         return false;
@@ -198,6 +225,24 @@ bool codingTest(CodingOptions options, coding_param_t r, const char *codename, C
     duration = mytimer.elapsed();
     printf(" Encoding speed = %.3lf MB/s\n", (fsize * 1.0 / (1 << 20))  / (duration.wall * 1.0 / 1e9));
 
+    // encode again with data chunks referencing the input data, and check all chunks are the same
+    mytimer.start();
+    if (code->encode(fdata, fsize, inPlaceStripe, &codingState, /* inPlace */ true) == false) {
+        printf("  Failed to encode data in place\n");
+        okay = false;
+        goto CODE_TEST_EXIT;
+    }
+    duration = mytimer.elapsed();
+    printf(" Encoding (in place) speed = %.3lf MB/s\n", (fsize * 1.0 / (1 << 20))  / (duration.wall * 1.0 / 1e9));
+    for (size_t i = 0; i < stripe.size(); i++) {
+        if (inPlaceStripe.size() != stripe.size() || inPlaceStripe.at(i).size != stripe.at(i).size || memcmp(inPlaceStripe.at(i).data, stripe.at(i).data, stripe.at(i).size) != 0) {
+            printf("  Incorrect chunk %lu encoded in place\n", i);
+            okay = false;
+            goto CODE_TEST_EXIT;
+        }
+    }
+    inPlaceStripe.clear();
+
     // --------------- //
     //  test decoding  //
     // --------------- //
@@ -216,8 +261,7 @@ bool codingTest(CodingOptions options, coding_param_t r, const char *codename, C
     }
 
     // get the decoding plan
-    plan.release();
-    if (code->preDecode(failedChunks, plan, codingState) == false) {
+    if (getDecodingPlan(code, failedChunks, plan, codingState, !isLRC) == false) {
         printf("  Failed to find a decoding plan!\n");
         okay = false;
         goto CODE_TEST_EXIT;
@@ -298,6 +342,24 @@ bool codingTest(CodingOptions options, coding_param_t r, const char *codename, C
             printf("   Number of chunks selected is %u instead of %u for single failiure under RS\n", numChunksSelected, numDataChunks);
         }
 
+        // only the other chunks in the local group are read under LRC, if any
+        if (isLRC) {
+            num_t numExpectedChunks = numDataChunks;
+            if (lrc->getLocalGroup(failedNode[0]) >= 0) {
+                numExpectedChunks = 0;
+                for (chunk_id_t i = 0; i < n; i++) {
+                    if (i != failedNode[0] && lrc->getLocalGroup(i) == lrc->getLocalGroup(failedNode[0]))
+                        numExpectedChunks++;
+                }
+            }
+            if (numChunksSelected != numExpectedChunks) {
+                printf("   Number of chunks selected is %u instead of %u for single failure under LRC\n", numChunksSelected, numExpectedChunks);
+                okay = false;
+                goto CODE_TEST_EXIT;
+            }
+            printf("   Repair reads %u chunks\n", numChunksSelected);
+        }
+
         // prepare recovery inputs
         recoveryInput.clear();
         recoveryInput.resize(numChunksSelected);
@@ -389,8 +451,7 @@ bool codingTest(CodingOptions options, coding_param_t r, const char *codename, C
         }
 
         // get the decoding plan
-        plan.release();
-        if (!code->preDecode(failedChunks, plan, codingState)) {
+        if (!getDecodingPlan(code, failedChunks, plan, codingState, !isLRC)) {
             printf("  Failed to find a plan for decoding after repairing single failure!\n");
             okay = false;
             goto CODE_TEST_EXIT;
@@ -495,9 +556,30 @@ bool codingTest(CodingOptions options, coding_param_t r, const char *codename, C
             // try using the recovered data to decode
             decodeInput.clear();
             decodeInput.resize(numDataChunks);
+            if (isLRC) {
+                // use the recovered chunks in place of as many data chunks as possible
+                failedChunks.clear();
+                for (chunk_id_t i = 0; i < k; i++) {
+                    if (i != failedNode[0] && i != failedNode[1])
+                        failedChunks.push_back(i);
+                }
+                while (failedChunks.size() > (size_t) n - k)
+                    failedChunks.pop_back();
+                if (!getDecodingPlan(code, failedChunks, plan, codingState, /* isMDS */ false)) {
+                    printf("  Failed to find a plan for decoding after repairing double failure!\n");
+                    okay = false;
+                    goto CODE_TEST_EXIT;
+                }
+                numChunksSelected = plan.getMinNumInputChunks();
+                inputChunksInPlan = plan.getInputChunkIds();
+                decodeInput.resize(numChunksSelected);
+                for (num_t i = 0; i < numChunksSelected; i++) {
+                    decodeInput.at(i).copy(stripe.at(inputChunksInPlan.at(i)));
+                }
+            }
             startidx = (failedNode[0] >= n - k)? n - k : 0;
-            bool notBoth = true;
-            for (num_t i = startidx; i < k + startidx - (notBoth? 1 : 0); i++) {
+            bool notBoth = !isLRC;
+            for (num_t i = startidx; i < k + startidx - (notBoth? 1 : 0) && !isLRC; i++) {
                 // check if the second recovered input is included
                 notBoth &= (failedNode[1] != i);
                 // copy all chunks on the node
@@ -608,6 +690,20 @@ int main(int argc, char *argv[]) {
                 pass = codingTest(options, r, "RS", code, argv[i]);
             delete code;
             printf("\n");
+
+            printf("> CauchyRS, n=%d, k=%d, r=%d\n", n, k, r);
+            code = CodingGenerator::genCoding(CodingScheme::CAUCHY_RS, options);
+            for (int i = 2; i < argc && pass; i++)
+                pass = codingTest(options, r, "CauchyRS", code, argv[i]);
+            delete code;
+            printf("\n");
+
+            printf("> LRC, n=%d, k=%d, r=%d\n", n, k, r);
+            code = CodingGenerator::genCoding(CodingScheme::LRC, options);
+            for (int i = 2; i < argc && pass; i++)
+                pass = codingTest(options, r, "LRC", code, argv[i]);
+            delete code;
+            printf("\n");
             
             if (!pass)
                 break;
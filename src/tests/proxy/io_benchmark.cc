@@ -0,0 +1,215 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <map>
+
+#include <boost/timer/timer.hpp>
+#include <glog/logging.h>
+#include <zmq.hpp>
+
+#include "../../common/config.hh"
+#include "../../common/define.hh"
+#include "../../common/io.hh"
+#include "../../ds/chunk_event.hh"
+#include "../../proxy/io.hh"
+
+/**
+ * Proxy I/O Benchmark
+ *
+ * Compare the chunk request fan-out of one stripe using
+ * (i) one new thread per chunk request, and
+ * (ii) the persistent I/O workers of ProxyIO, or its asynchronous transport if enabled (misc.async_data_transport).
+ *
+ * Test flow
+ * 1. Run a dummy agent which acknowledges every chunk (delete) request after an optional delay
+ * 2. Issue the chunk requests of each stripe to the dummy agent, and wait for all replies before the next stripe
+ * 3. Report the number of stripes completed per second for both approaches
+ *
+ **/
+
+#define AGENT_ADDR     "tcp://127.0.0.1:57999"
+#define WORKER_ADDR    "inproc://io_benchmark_workers"
+
+static int numStripes = 1000;
+static int numReqsPerStripe = 10;
+static int agentDelay = 0;  // in microseconds
+static bool running = true;
+
+void usage(char *prog) {
+    printf("Usage: %s [num. of stripes (default: %d)] [num. of chunk requests per stripe (default: %d)] [agent processing delay in us (default: %d)]\n", prog, numStripes, numReqsPerStripe, agentDelay);
+}
+
+void *runDummyAgentWorker(void *arg) {
+    zmq::context_t *cxt = (zmq::context_t *) arg;
+    zmq::socket_t socket(*cxt, ZMQ_REP);
+    socket.setsockopt(ZMQ_RCVTIMEO, 500);
+    socket.connect(WORKER_ADDR);
+
+    while (running) {
+        ChunkEvent request, reply;
+        if (IO::getChunkEventMessage(socket, request) == 0)
+            continue;
+        if (agentDelay > 0)
+            usleep(agentDelay);
+        reply.id = request.id;
+        reply.opcode = Opcode::DEL_CHUNK_REP_SUCCESS;
+        IO::sendChunkEventMessage(socket, reply);
+    }
+
+    socket.close();
+    return 0;
+}
+
+void *runDummyAgent(void *arg) {
+    zmq::context_t *cxt = (zmq::context_t *) arg;
+    zmq::socket_t frontend(*cxt, ZMQ_ROUTER);
+    zmq::socket_t backend(*cxt, ZMQ_DEALER);
+    frontend.bind(AGENT_ADDR);
+    backend.bind(WORKER_ADDR);
+    try {
+        zmq::proxy(frontend, backend, NULL);
+    } catch (std::exception &e) {
+    }
+    frontend.close();
+    backend.close();
+    return 0;
+}
+
+void prepareRequests(ChunkEvent events[], ProxyIO::RequestMeta meta[], ProxyIO *io, int numReqs) {
+    for (int i = 0; i < numReqs; i++) {
+        events[i].id = i;
+        events[i].opcode = Opcode::DEL_CHUNK_REQ;
+        events[i].numChunks = 1;
+        events[i].chunks = new Chunk[1];
+        events[i].chunks[0].setId(0, boost::uuids::uuid(), i);
+        events[i].containerIds = new int[1];
+        events[i].containerIds[0] = i;
+        meta[i].containerId = i;
+        meta[i].io = io;
+        meta[i].request = &events[i];
+        meta[i].reply = &events[i + numReqs];
+    }
+}
+
+bool checkReplies(ProxyIO::RequestMeta meta[], void *ret[], int numReqs) {
+    for (int i = 0; i < numReqs; i++) {
+        if (ret[i] != 0 || meta[i].reply->opcode != Opcode::DEL_CHUNK_REP_SUCCESS)
+            return false;
+        // clean up for the next round
+        meta[i].reply->release();
+        meta[i].reply->reset();
+    }
+    return true;
+}
+
+double runWithThreads(ProxyIO *io) {
+    ChunkEvent events[numReqsPerStripe * 2];
+    ProxyIO::RequestMeta meta[numReqsPerStripe];
+    pthread_t wt[numReqsPerStripe];
+    void *ret[numReqsPerStripe];
+
+    prepareRequests(events, meta, io, numReqsPerStripe);
+
+    boost::timer::cpu_timer mytimer;
+    for (int s = 0; s < numStripes; s++) {
+        for (int i = 0; i < numReqsPerStripe; i++)
+            pthread_create(&wt[i], NULL, ProxyIO::sendChunkRequestToAgent, &meta[i]);
+        for (int i = 0; i < numReqsPerStripe; i++)
+            pthread_join(wt[i], &ret[i]);
+        if (!checkReplies(meta, ret, numReqsPerStripe)) {
+            printf("> Failed to get all replies for stripe %d!!\n", s);
+            return -1;
+        }
+    }
+    return numStripes / (mytimer.elapsed().wall * 1.0 / 1e9);
+}
+
+double runWithIOWorkers(ProxyIO *io) {
+    ChunkEvent events[numReqsPerStripe * 2];
+    ProxyIO::RequestMeta meta[numReqsPerStripe];
+    void *ret[numReqsPerStripe];
+
+    prepareRequests(events, meta, io, numReqsPerStripe);
+
+    boost::timer::cpu_timer mytimer;
+    for (int s = 0; s < numStripes; s++) {
+        for (int i = 0; i < numReqsPerStripe; i++)
+            io->submitChunkRequest(&meta[i]);
+        for (int i = 0; i < numReqsPerStripe; i++)
+            ret[i] = ProxyIO::waitForChunkRequest(&meta[i]);
+        if (!checkReplies(meta, ret, numReqsPerStripe)) {
+            printf("> Failed to get all replies for stripe %d!!\n", s);
+            return -1;
+        }
+    }
+    return numStripes / (mytimer.elapsed().wall * 1.0 / 1e9);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && (atoi(argv[1]) <= 0 || (argc > 2 && atoi(argv[2]) <= 0) || (argc > 3 && atoi(argv[3]) < 0))) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (argc > 1) numStripes = atoi(argv[1]);
+    if (argc > 2) numReqsPerStripe = atoi(argv[2]);
+    if (argc > 3) agentDelay = atoi(argv[3]);
+
+    Config &config = Config::getInstance();
+    config.setConfigPath();
+
+    if (!config.glogToConsole()) {
+        FLAGS_log_dir = config.getGlogDir().c_str();
+        printf("Output log to %s\n", config.getGlogDir().c_str());
+    } else {
+        FLAGS_logtostderr = true;
+        printf("Output log to console\n");
+    }
+    FLAGS_minloglevel = config.getLogLevel();
+    google::InitGoogleLogging(argv[0]);
+
+    printf("Start Proxy I/O Benchmark\n");
+    printf("=========================\n");
+    printf("Num. of stripes = %d, num. of requests per stripe = %d, agent delay = %dus, num. of I/O workers = %d, async transport = %s\n", numStripes, numReqsPerStripe, agentDelay, config.getProxyNumIOWorkers(), config.useAsyncDataTransport()? "true" : "false");
+
+    // run the dummy agent
+    zmq::context_t cxt(1);
+    pthread_t at, awt[numReqsPerStripe];
+    pthread_create(&at, NULL, runDummyAgent, &cxt);
+    for (int i = 0; i < numReqsPerStripe; i++)
+        pthread_create(&awt[i], NULL, runDummyAgentWorker, &cxt);
+
+    // all containers map to the dummy agent
+    std::map<int, std::string> containerToAgentMap;
+    for (int i = 0; i < numReqsPerStripe; i++)
+        containerToAgentMap.insert(std::make_pair(i, std::string(AGENT_ADDR)));
+    ProxyIO *io = new ProxyIO(&containerToAgentMap);
+
+    double threadRate = runWithThreads(io);
+    double workerRate = runWithIOWorkers(io);
+
+    delete io;
+
+    // stop the dummy agent
+    running = false;
+    for (int i = 0; i < numReqsPerStripe; i++)
+        pthread_join(awt[i], NULL);
+    cxt.close();
+    pthread_join(at, NULL);
+
+    if (threadRate < 0 || workerRate < 0) {
+        printf("> Benchmark failed!!\n");
+        return 1;
+    }
+
+    printf("%-24s %12s\n", "mode", "stripes/s");
+    printf("%-24s %12.2lf\n", "thread-per-request", threadRate);
+    printf("%-24s %12.2lf\n", config.useAsyncDataTransport()? "async-transport" : "io-workers", workerRate);
+    printf("%-24s %11.2lf%%\n", "improvement", (workerRate / threadRate - 1) * 100);
+
+    printf("End of Proxy I/O Benchmark\n");
+
+    return 0;
+}
@@ -0,0 +1,286 @@
+// SPDX-License-Identifier: Apache-2.0
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <boost/timer/timer.hpp>
+#include <glog/logging.h>
+
+#include "../../common/config.hh"
+#include "../../common/define.hh"
+#include "../../proxy/metastore/metastore.hh"
+#include "../../proxy/metastore/redis_metastore.hh"
+#include "../../proxy/metastore/local_metastore.hh"
+
+/**
+ * MetaStore Concurrency Benchmark
+ *
+ * Report the throughput of metadata operations issued by concurrent workers
+ * sharing one metadata store instance, as the number of workers increases.
+ *
+ * Test flow
+ * 1. Each worker prepares its own set of files
+ * 2. All workers write the file metadata (putMeta) for the given number of rounds
+ * 3. All workers read the file metadata (getMeta) for the given number of rounds
+ * 4. All workers lock and unlock the files (lockFile, unlockFile) for the given number of rounds
+ * 5. Report the number of operations completed per second in each step, and remove the file metadata
+ *
+ * Steps 1-5 are repeated with 1, 2, 4, ... workers up to the max. number of workers.
+ *
+ * For Redis, the average memory used per file (MEMORY USAGE) is also reported,
+ * e.g., to compare the metadata layouts (packed_file_meta).
+ *
+ **/
+
+enum BenchmarkOp {
+    PUT_META,
+    GET_META,
+    LOCK_FILE,
+
+    NUM_BENCHMARK_OPS
+};
+
+static const char *opNames[NUM_BENCHMARK_OPS] = { "putMeta", "getMeta", "lock+unlock" };
+
+static const int numFilesPerWorker = 16;
+static int maxNumWorkers = 16;
+static int numRounds = 64;
+
+static MetaStore *metastore = NULL;
+static double bytesPerFile = -1;
+static pthread_barrier_t opStart, opEnd;
+
+struct WorkerArg {
+    int id;                                 /**< worker id */
+    File *files;                            /**< files of the worker */
+    unsigned long int numFailedOps;         /**< number of failed operations */
+};
+
+void usage(char *prog) {
+    printf("Usage: %s [max. num. of workers (default: %d)] [num. of rounds (default: %d)]\n", prog, maxNumWorkers, numRounds);
+}
+
+static MetaStore *newMetaStore() {
+    Config &config = Config::getInstance();
+
+    switch (config.getProxyMetaStoreType()) {
+    case MetaStoreType::REDIS:
+        return new RedisMetaStore();
+    case MetaStoreType::LOCAL:
+        return new LocalMetaStore();
+    default:
+        break;
+    }
+    return new RedisMetaStore();
+}
+
+static void initFile(File &f, int workerId, int fileId) {
+    Config &config = Config::getInstance();
+
+    int k = config.getK();
+    int n = config.getN();
+    unsigned long int chunkSize = config.getMaxChunkSize();
+
+    // file name and uuid
+    std::string name = std::string("metastore_benchmark_") + std::to_string(workerId) + "_" + std::to_string(fileId);
+    f.setName(name.c_str(), name.size());
+    f.namespaceId = config.getProxyNamespaceId();
+    f.genUUID();
+
+    // file size (up to 16 stripes)
+    f.size = chunkSize * k * (fileId + 1);
+    f.numStripes = fileId + 1;
+    f.numChunks = f.numStripes * n;
+    f.initChunksAndContainerIds();
+    for (int c = 0; c < f.numChunks; c++) {
+        f.chunks[c].setId(f.namespaceId, f.uuid, c);
+        f.chunks[c].size = chunkSize;
+        f.containerIds[c] = c % n;
+    }
+
+    // file timestamps
+    time_t now = time(NULL);
+    f.setTimeStamps(now, now, now);
+
+    // file version
+    f.version = 0;
+
+    // file coding scheme
+    f.codingMeta.coding = config.getCodingScheme();
+    f.codingMeta.k = k;
+    f.codingMeta.n = n;
+    f.storageClass = config.getDefaultStorageClass();
+}
+
+static double getRedisMemoryPerFile(File *files, int numFiles) {
+    Config &config = Config::getInstance();
+    redisContext *cxt = redisConnect(config.getProxyMetaStoreIP().c_str(), config.getProxyMetaStorePort());
+    if (cxt == NULL || cxt->err) {
+        redisFree(cxt);
+        return -1;
+    }
+    unsigned long int total = 0;
+    for (int i = 0; i < numFiles; i++) {
+        // file key format: namespaceId_name
+        std::string key = std::to_string(files[i].namespaceId).append("_").append(files[i].name, files[i].nameLength);
+        redisReply *r = (redisReply *) redisCommand(cxt, "MEMORY USAGE %b", key.c_str(), key.size());
+        if (r == NULL || r->type != REDIS_REPLY_INTEGER) {
+            freeReplyObject(r);
+            redisFree(cxt);
+            return -1;
+        }
+        total += r->integer;
+        freeReplyObject(r);
+    }
+    redisFree(cxt);
+    return total * 1.0 / numFiles;
+}
+
+static bool runOp(BenchmarkOp op, File &f) {
+    switch (op) {
+    case PUT_META:
+        return metastore->putMeta(f);
+    case GET_META:
+        {
+            File rf;
+            rf.setName(f.name, f.nameLength);
+            rf.namespaceId = f.namespaceId;
+            return metastore->getMeta(rf);
+        }
+    case LOCK_FILE:
+        return metastore->lockFile(f) && metastore->unlockFile(f);
+    default:
+        break;
+    }
+    return false;
+}
+
+void *runWorker(void *arg) {
+    WorkerArg *warg = (WorkerArg *) arg;
+
+    for (int op = 0; op < NUM_BENCHMARK_OPS; op++) {
+        pthread_barrier_wait(&opStart);
+        for (int r = 0; r < numRounds; r++)
+            for (int i = 0; i < numFilesPerWorker; i++)
+                if (!runOp((BenchmarkOp) op, warg->files[i]))
+                    warg->numFailedOps++;
+        pthread_barrier_wait(&opEnd);
+    }
+
+    return 0;
+}
+
+static bool runBenchmark(int numWorkers, double rates[]) {
+    Config &config = Config::getInstance();
+    std::vector<pthread_t> workers (numWorkers);
+    std::vector<WorkerArg> args (numWorkers);
+    File *files = new File[numWorkers * numFilesPerWorker];
+
+    for (int i = 0; i < numWorkers; i++) {
+        args[i].id = i;
+        args[i].files = files + i * numFilesPerWorker;
+        args[i].numFailedOps = 0;
+        for (int j = 0; j < numFilesPerWorker; j++)
+            initFile(args[i].files[j], i, j);
+    }
+
+    pthread_barrier_init(&opStart, NULL, numWorkers + 1);
+    pthread_barrier_init(&opEnd, NULL, numWorkers + 1);
+
+    for (int i = 0; i < numWorkers; i++)
+        pthread_create(&workers[i], NULL, runWorker, &args[i]);
+
+    unsigned long int numOps = (unsigned long int) numWorkers * numFilesPerWorker * numRounds;
+    for (int op = 0; op < NUM_BENCHMARK_OPS; op++) {
+        pthread_barrier_wait(&opStart);
+        boost::timer::cpu_timer mytimer;
+        pthread_barrier_wait(&opEnd);
+        rates[op] = numOps / (mytimer.elapsed().wall * 1.0 / 1e9);
+        // measure the memory usage once the metadata of all files are written
+        if (op == PUT_META && numWorkers == 1 && config.getProxyMetaStoreType() == MetaStoreType::REDIS)
+            bytesPerFile = getRedisMemoryPerFile(files, numWorkers * numFilesPerWorker);
+    }
+
+    unsigned long int numFailedOps = 0;
+    for (int i = 0; i < numWorkers; i++) {
+        pthread_join(workers[i], NULL);
+        numFailedOps += args[i].numFailedOps;
+    }
+
+    pthread_barrier_destroy(&opStart);
+    pthread_barrier_destroy(&opEnd);
+
+    // clean up the file metadata
+    for (int i = 0; i < numWorkers * numFilesPerWorker; i++)
+        metastore->deleteMeta(files[i]);
+    delete [] files;
+
+    if (numFailedOps > 0)
+        printf("> %lu operations failed with %d workers!!\n", numFailedOps, numWorkers);
+
+    return numFailedOps == 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && (atoi(argv[1]) <= 0 || (argc > 2 && atoi(argv[2]) <= 0))) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (argc > 1) maxNumWorkers = atoi(argv[1]);
+    if (argc > 2) numRounds = atoi(argv[2]);
+
+    Config &config = Config::getInstance();
+    config.setConfigPath();
+
+    if (!config.glogToConsole()) {
+        FLAGS_log_dir = config.getGlogDir().c_str();
+        printf("Output log to %s\n", config.getGlogDir().c_str());
+    } else {
+        FLAGS_logtostderr = true;
+        printf("Output log to console\n");
+    }
+    FLAGS_minloglevel = config.getLogLevel();
+    google::InitGoogleLogging(argv[0]);
+
+    printf("Start MetaStore Benchmark\n");
+    printf("=========================\n");
+    printf("Max. num. of workers = %d, num. of rounds = %d, num. of files per worker = %d, num. of metastore connections = %d\n", maxNumWorkers, numRounds, numFilesPerWorker, config.getProxyMetaStoreNumConnections());
+
+    metastore = newMetaStore();
+
+    bool okay = true;
+    double baseRates[NUM_BENCHMARK_OPS];
+
+    printf("%-8s", "workers");
+    for (int op = 0; op < NUM_BENCHMARK_OPS; op++)
+        printf(" %14s %8s", (std::string(opNames[op]) + "/s").c_str(), "scale");
+    printf("\n");
+
+    for (int numWorkers = 1; okay && numWorkers <= maxNumWorkers; numWorkers = numWorkers < maxNumWorkers && numWorkers * 2 > maxNumWorkers ? maxNumWorkers : numWorkers * 2) {
+        double rates[NUM_BENCHMARK_OPS];
+        okay = runBenchmark(numWorkers, rates);
+        if (numWorkers == 1)
+            memcpy(baseRates, rates, sizeof(rates));
+        printf("%-8d", numWorkers);
+        for (int op = 0; op < NUM_BENCHMARK_OPS; op++)
+            printf(" %14.2lf %7.2lfx", rates[op], rates[op] / baseRates[op]);
+        printf("\n");
+    }
+
+    delete metastore;
+
+    if (bytesPerFile >= 0)
+        printf("Avg. Redis memory per file (%.1lf stripes on avg.) = %.1lf bytes, packed file metadata = %s\n", (numFilesPerWorker + 1) / 2.0, bytesPerFile, config.usePackedFileMeta()? "true" : "false");
+
+    if (!okay) {
+        printf("> Benchmark failed!!\n");
+        return 1;
+    }
+
+    printf("End of MetaStore Benchmark\n");
+
+    return 0;
+}
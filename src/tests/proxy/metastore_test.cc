@@ -2,6 +2,10 @@
 
 #include <stdlib.h>
 #include <map>
+#include <set>
+#include <thread>
+
+#include <openssl/sha.h>
 
 #include <boost/timer/timer.hpp>
 
@@ -9,14 +13,23 @@
 #include "../../common/config.hh"
 #include "../../common/checksum_calculator.hh"
 #include "../../proxy/metastore/metastore.hh"
+#include "../../proxy/metastore/file_meta_codec.hh"
 #include "../../proxy/metastore/redis_metastore.hh"
+#include "../../proxy/metastore/local_metastore.hh"
 
 static const size_t numFilesToTest = 1024;
+static const size_t numPackedFilesToTest = 64;
+static const char *folderFileNames[] = {
+    "folder_test/f", "folder_test/a/f", "folder_test/a/b/f", "folder_test/c/f", "folder_testx/f", "folder_test2/g/f"
+};
+static const size_t numFolderFilesToTest = sizeof(folderFileNames) / sizeof(folderFileNames[0]);
 static const int maxFileNameLength = 1024;
 static const unsigned long maxFileSize = (unsigned long) (1 << 30) * 4; // 4GB
 static int chunkSize = (1 << 20); // 1MB
 
 static File f[numFilesToTest];
+static File pf[numPackedFilesToTest];
+static File df[numFolderFilesToTest];
 static MetaStore *metastore = NULL;
 static std::map<int, std::map<std::string, File*>> fileMapByNamespace;
 
@@ -26,6 +39,11 @@ static void updateFiles();
 static bool compareFile(size_t, const File&, const File&);
 static void exitWithError();
 static void readAndCheckFileMeta();
+static void readAndCheckFileMetaInBatches();
+static void initPackedFiles();
+static bool compareChunksAndBlocks(size_t, const File&, const File&);
+static bool convertToLegacyLayout(const File&);
+static bool checkFolderList(MetaStore*, const char*, bool, const std::set<std::string>&);
 
 int main(int argc, char **argv) {
 
@@ -33,12 +51,17 @@ int main(int argc, char **argv) {
      * Tests for metastore
      *
      * 1. File metadata write
-     * 2. File metadata update
+     * 2. File metadata update (and read from cache, and in batches)
      * 3. File lock
      * 4. File unlock
      * 5. File listing
      * 6. File metadata delete
      * 7. File repair list
+     * 8. File repair list in batches (mark, get and unmark)
+     * 9. Packed chunk and block metadata encoding
+     * 10. Chunk and block metadata migration from the legacy layout to the packed layout (Redis)
+     * 11. Folder listing (and rebuilding the directory index for Redis)
+     * 12. Sharing of the local metastore among instances in a process, and locking its directory against other stores (Local)
      *
      **/
 
@@ -97,6 +120,18 @@ int main(int argc, char **argv) {
             metastore->putMeta(f[i]);
         // read back and check
         readAndCheckFileMeta();
+        // read back again, from the file metadata cache if enabled
+        FileMetaCacheStats before, after;
+        if (metastore->getFileMetaCacheStats(before)) {
+            readAndCheckFileMeta();
+            metastore->getFileMetaCacheStats(after);
+            if (after.numHits == before.numHits) {
+                printf(">> File metadata not read from cache (0 hits in %lu reads)\n", numFilesToTest);
+                exitWithError();
+            }
+        }
+        // read back in batches
+        readAndCheckFileMetaInBatches();
     }
 
     printf("> Test %d completes: Update metadata of %lu files in %.3lf seconds\n", ++testCount, numFilesToTest, mytimer.elapsed().wall / 1e9);
@@ -144,6 +179,28 @@ int main(int argc, char **argv) {
                 printf(">> Failed to unlock file %lu (second attempt)\n", i);
                 exitWithError();
             }
+        // lock should succeed once the file is unlocked by others, without waiting until timeout
+        if (numFilesToTest > 0) {
+            if (!metastore->lockFile(f[0])) {
+                printf(">> Failed to lock file 0 before waiting\n");
+                exitWithError();
+            }
+            std::thread unlocker([]() {
+                usleep(100 * 1000);
+                metastore->unlockFile(f[0]);
+            });
+            boost::timer::cpu_timer waitT;
+            bool locked = metastore->lockFile(f[0], /* max. wait (us) */ 10 * 1000 * 1000);
+            unlocker.join();
+            if (!locked || waitT.elapsed().wall / 1e9 >= 5) {
+                printf(">> Failed to lock file 0 on unlock by others (locked = %d, waited %.3lf seconds)\n", locked, waitT.elapsed().wall / 1e9);
+                exitWithError();
+            }
+            if (!metastore->unlockFile(f[0])) {
+                printf(">> Failed to unlock file 0 after waiting\n");
+                exitWithError();
+            }
+        }
     }
     printf("> Test %d completes: Unlock %lu files in %.3lf seconds\n", ++testCount, numFilesToTest, mytimer.elapsed().wall / 1e9);
 
@@ -212,6 +269,29 @@ int main(int argc, char **argv) {
             }
             
         }
+        // list the files page by page
+        for (auto &ns : fileMapByNamespace) {
+            std::set<std::string> listed;
+            std::string cursor;
+            do {
+                flist = NULL;
+                fileCount = metastore->getFileListPage(&flist, cursor, /* page size */ 7, ns.first);
+                for (size_t fc = 0; fc < fileCount; fc++) {
+                    std::string fname (flist[fc].name, flist[fc].nameLength);
+                    if (ns.second.count(fname) == 0) {
+                        printf(">> Failed to find the file %s from a page of file list in namespace %d\n", fname.c_str(), ns.first);
+                        exitWithError();
+                    }
+                    listed.insert(fname);
+                }
+                delete [] flist;
+                flist = NULL;
+            } while (!cursor.empty());
+            if (listed.size() != ns.second.size()) {
+                printf(">> Number of files listed by pages in namespace %d mismatched (%lu vs %lu)\n", ns.first, listed.size(), ns.second.size());
+                exitWithError();
+            }
+        }
         // total number of files obtained from the metastore
         if (totalFileCount != numFilesToTest) {
             printf(">> Number of files in metadata store mismatched (%lu vs %lu)\n", totalFileCount, numFilesToTest);
@@ -289,6 +369,251 @@ int main(int argc, char **argv) {
     }
     printf("> Test %d completes: Mark and unmark %lu files for repair in %.3lf seconds\n", ++testCount, numFilesToTest, mytimer.elapsed().wall / 1e9);
 
+    // test 8: file repair list in batches
+    mytimer.start();
+    {
+        const int batchSize = 64;
+        // mark files for repair
+        for (size_t i = 0; i < numFilesToTest; i += batchSize) {
+            int num = std::min((size_t) batchSize, numFilesToTest - i);
+            if (!metastore->markFilesAsNeedsRepair(num, f + i)) {
+                printf(">> Failed to mark files %lu to %lu for repair\n", i, i + num - 1);
+                exitWithError();
+            }
+        }
+        // check the number of files to repair
+        if (metastore->getNumFilesToRepair() != numFilesToTest) {
+            printf(">> Number of files to repair mismatched (%lu vs %lu)\n", metastore->getNumFilesToRepair(), numFilesToTest);
+            exitWithError();
+        }
+        // get all files to repair in batches
+        std::set<std::string> popped;
+        int num = 0;
+        do {
+            File rf[batchSize];
+            num = metastore->getFilesToRepair(batchSize, rf);
+            for (int i = 0; i < num; i++) {
+                if (fileMapByNamespace[rf[i].namespaceId].count(std::string(rf[i].name, rf[i].nameLength)) == 0) {
+                    printf(">> Got a non-existing file in namespace %d from metastore for repair\n", rf[i].namespaceId);
+                    exitWithError();
+                }
+                popped.insert(std::to_string(rf[i].namespaceId).append("_").append(rf[i].name, rf[i].nameLength));
+            }
+        } while (num > 0);
+        // check the files to repair
+        if (popped.size() != numFilesToTest || metastore->getNumFilesToRepair() != 0) {
+            printf(">> Number of files to repair mismatched (%lu popped and %lu left vs %lu)\n", popped.size(), metastore->getNumFilesToRepair(), numFilesToTest);
+            exitWithError();
+        }
+        // mark files for repair again, and unmark them in batches
+        for (size_t i = 0; i < numFilesToTest; i += batchSize) {
+            int num = std::min((size_t) batchSize, numFilesToTest - i);
+            if (!metastore->markFilesAsNeedsRepair(num, f + i) || !metastore->markFilesAsRepaired(num, f + i)) {
+                printf(">> Failed to mark and unmark files %lu to %lu for repair\n", i, i + num - 1);
+                exitWithError();
+            }
+        }
+        if (metastore->getNumFilesToRepair() != 0) {
+            printf(">> Number of files to repair mismatched (%lu vs 0) after unmarking in batches\n", metastore->getNumFilesToRepair());
+            exitWithError();
+        }
+    }
+    printf("> Test %d completes: Mark and get %lu files for repair in batches in %.3lf seconds\n", ++testCount, numFilesToTest, mytimer.elapsed().wall / 1e9);
+
+    // test 9: packed chunk and block metadata encoding
+    mytimer.start();
+    {
+        initPackedFiles();
+        for (size_t i = 0; i < numPackedFilesToTest; i++) {
+            std::string chunks, uniqueBlocks, duplicateBlocks;
+            FileMetaCodec::encodeChunks(pf[i], chunks);
+            FileMetaCodec::encodeBlocks(pf[i], /* is unique */ true, uniqueBlocks);
+            FileMetaCodec::encodeBlocks(pf[i], /* is unique */ false, duplicateBlocks);
+            // decode into a file with the chunks allocated
+            File rf;
+            rf.copyNameAndSize(pf[i]);
+            rf.numChunks = pf[i].numChunks;
+            rf.initChunksAndContainerIds();
+            if (
+                !FileMetaCodec::decodeChunks(chunks.data(), chunks.size(), rf) ||
+                !FileMetaCodec::decodeBlocks(uniqueBlocks.data(), uniqueBlocks.size(), /* is unique */ true, rf) ||
+                !FileMetaCodec::decodeBlocks(duplicateBlocks.data(), duplicateBlocks.size(), /* is unique */ false, rf)
+            ) {
+                printf(">> Failed to decode the packed metadata of file %lu\n", i);
+                exitWithError();
+            }
+            for (int c = 0; c < rf.numChunks; c++)
+                rf.chunks[c].setId(pf[i].namespaceId, pf[i].uuid, c);
+            if (!compareChunksAndBlocks(i, pf[i], rf)) {
+                exitWithError();
+            }
+            // reject truncated encodings, and chunks which do not match the file
+            if (
+                FileMetaCodec::decodeChunks(chunks.data(), chunks.size() - 1, rf) ||
+                FileMetaCodec::decodeBlocks(uniqueBlocks.data(), uniqueBlocks.size() - 1, /* is unique */ true, rf)
+            ) {
+                printf(">> Failed to reject the truncated packed metadata of file %lu\n", i);
+                exitWithError();
+            }
+            rf.numChunks--;
+            if (FileMetaCodec::decodeChunks(chunks.data(), chunks.size(), rf)) {
+                printf(">> Failed to reject the packed chunk metadata of file %lu with a mismatched number of chunks\n", i);
+                exitWithError();
+            }
+            rf.numChunks++;
+        }
+        // write and read back through the metadata store
+        for (size_t i = 0; i < numPackedFilesToTest; i++) {
+            if (!metastore->putMeta(pf[i])) {
+                printf(">> Failed to put file %lu metadata with blocks\n", i);
+                exitWithError();
+            }
+            File rf;
+            rf.copyNameAndSize(pf[i]);
+            if (!metastore->getMeta(rf) || !compareFile(i, pf[i], rf) || !compareChunksAndBlocks(i, pf[i], rf)) {
+                printf(">> Failed to get file %lu metadata with blocks\n", i);
+                exitWithError();
+            }
+        }
+    }
+    printf("> Test %d completes: Encode and decode the chunks and blocks of %lu files in %.3lf seconds\n", ++testCount, numPackedFilesToTest, mytimer.elapsed().wall / 1e9);
+
+    // test 10: chunk and block metadata migration from the legacy layout to the packed layout
+    mytimer.start();
+    if (config.getProxyMetaStoreType() == MetaStoreType::REDIS && config.usePackedFileMeta()) {
+        for (size_t i = 0; i < numPackedFilesToTest; i++) {
+            // rewrite the metadata in the legacy layout, i.e., one field per chunk or block
+            if (!convertToLegacyLayout(pf[i])) {
+                printf(">> Failed to convert file %lu metadata to the legacy layout\n", i);
+                exitWithError();
+            }
+            // read the legacy layout
+            File lf;
+            lf.copyNameAndSize(pf[i]);
+            if (!metastore->getMeta(lf) || !compareFile(i, pf[i], lf) || !compareChunksAndBlocks(i, pf[i], lf)) {
+                printf(">> Failed to get file %lu metadata in the legacy layout\n", i);
+                exitWithError();
+            }
+            // the next write converts the metadata to the packed layout
+            if (!metastore->putMeta(lf)) {
+                printf(">> Failed to put file %lu metadata read from the legacy layout\n", i);
+                exitWithError();
+            }
+        }
+        // read the packed layout
+        for (size_t i = 0; i < numPackedFilesToTest; i++) {
+            File rf;
+            rf.copyNameAndSize(pf[i]);
+            if (!metastore->getMeta(rf) || !compareFile(i, pf[i], rf) || !compareChunksAndBlocks(i, pf[i], rf)) {
+                printf(">> Failed to get file %lu metadata converted to the packed layout\n", i);
+                exitWithError();
+            }
+        }
+        // check the legacy fields are removed
+        redisContext *cxt = redisConnect(config.getProxyMetaStoreIP().c_str(), config.getProxyMetaStorePort());
+        for (size_t i = 0; cxt != NULL && !cxt->err && i < numPackedFilesToTest; i++) {
+            std::string key = std::to_string(pf[i].namespaceId).append("_").append(pf[i].name, pf[i].nameLength);
+            redisReply *r = (redisReply *) redisCommand(cxt, "HMGET %b c0-cid ub0 db0 pc", key.data(), key.size());
+            bool converted = r != NULL && r->type == REDIS_REPLY_ARRAY && r->elements == 4 &&
+                    r->element[0]->type == REDIS_REPLY_NIL &&
+                    r->element[1]->type == REDIS_REPLY_NIL &&
+                    r->element[2]->type == REDIS_REPLY_NIL &&
+                    r->element[3]->type == REDIS_REPLY_STRING;
+            freeReplyObject(r);
+            if (!converted) {
+                printf(">> File %lu metadata not fully converted to the packed layout\n", i);
+                exitWithError();
+            }
+        }
+        redisFree(cxt);
+    }
+    printf("> Test %d completes: Migrate the chunks and blocks of %lu files to the packed layout in %.3lf seconds\n", ++testCount, numPackedFilesToTest, mytimer.elapsed().wall / 1e9);
+
+    for (size_t i = 0; i < numPackedFilesToTest; i++)
+        metastore->deleteMeta(pf[i]);
+
+    // test 11: folder listing
+    mytimer.start();
+    {
+        for (size_t i = 0; i < numFolderFilesToTest; i++) {
+            df[i].setName(folderFileNames[i], strlen(folderFileNames[i]));
+            df[i].namespaceId = config.getProxyNamespaceId();
+            df[i].genUUID();
+            df[i].size = 1;
+            df[i].version = 0;
+            if (!metastore->putMeta(df[i])) {
+                printf(">> Failed to put the metadata of file %s for folder listing\n", folderFileNames[i]);
+                exitWithError();
+            }
+        }
+        // folders are listed by their names after the prefix (up to the last '/'), e.g., "folder_test" as "" and "folder_testx" as "x" for prefix "folder_test/"
+        if (
+            !checkFolderList(metastore, "folder_test/", /* skip subfolders */ true, {"", "x"}) ||
+            !checkFolderList(metastore, "folder_test/", /* skip subfolders */ false, {"", "/a", "/a/b", "/c", "x", "2/g"}) ||
+            !checkFolderList(metastore, "folder_test/a/", /* skip subfolders */ false, {"", "/b"}) ||
+            !checkFolderList(metastore, "folder_none/", /* skip subfolders */ false, {})
+        ) {
+            exitWithError();
+        }
+        // a folder is no longer listed once its last file is removed
+        metastore->deleteMeta(df[3]);
+        if (!checkFolderList(metastore, "folder_test/", /* skip subfolders */ false, {"", "/a", "/a/b", "x", "2/g"})) {
+            exitWithError();
+        }
+        // the directory index is rebuilt from the directory list, dropping stale folders, once its version mismatches
+        if (config.getProxyMetaStoreType() == MetaStoreType::REDIS) {
+            redisContext *cxt = redisConnect(config.getProxyMetaStoreIP().c_str(), config.getProxyMetaStorePort());
+            std::string stale = std::string("//pf_").append(std::to_string(config.getProxyNamespaceId())).append("_folder_test/stale");
+            redisReply *r = cxt && !cxt->err ? (redisReply *) redisCommand(cxt, "ZADD //snccDirIndex 0 %b", stale.data(), stale.size()) : NULL;
+            freeReplyObject(r);
+            r = cxt && !cxt->err ? (redisReply *) redisCommand(cxt, "DEL //snccDirIndexVer") : NULL;
+            bool okay = r != NULL && r->type == REDIS_REPLY_INTEGER;
+            freeReplyObject(r);
+            redisFree(cxt);
+            MetaStore *store = okay ? newMetaStore() : NULL;
+            okay = okay && checkFolderList(store, "folder_test/", /* skip subfolders */ false, {"", "/a", "/a/b", "x", "2/g"});
+            delete store;
+            if (!okay) {
+                printf(">> Failed to rebuild the directory index\n");
+                exitWithError();
+            }
+        }
+    }
+    printf("> Test %d completes: List folders of %lu files in %.3lf seconds\n", ++testCount, numFolderFilesToTest, mytimer.elapsed().wall / 1e9);
+
+    for (size_t i = 0; i < numFolderFilesToTest; i++)
+        metastore->deleteMeta(df[i]);
+
+    // test 12: local metastore sharing
+    if (config.getProxyMetaStoreType() == MetaStoreType::LOCAL) {
+        mytimer.start();
+        // metadata put by one instance is seen by another instance on the same path
+        MetaStore *store = newMetaStore();
+        File sf, rsf;
+        sf.setName(folderFileNames[0], strlen(folderFileNames[0]));
+        sf.namespaceId = config.getProxyNamespaceId();
+        sf.genUUID();
+        sf.size = 1;
+        sf.version = 0;
+        rsf.setName(folderFileNames[0], strlen(folderFileNames[0]));
+        rsf.namespaceId = config.getProxyNamespaceId();
+        bool okay = store->putMeta(sf) && metastore->getMeta(rsf) && rsf.size == sf.size;
+        okay = okay && metastore->deleteMeta(sf) && !store->getMeta(rsf);
+        delete store;
+        if (!okay) {
+            printf(">> Failed to share the local metastore between instances\n");
+            exitWithError();
+        }
+        // another store cannot open the directory in use
+        LocalKVStore kvstore;
+        if (kvstore.open(config.getProxyMetaStorePath(), /* sync writes */ false)) {
+            kvstore.close();
+            printf(">> Failed to lock the directory of the local metastore\n");
+            exitWithError();
+        }
+        printf("> Test %d completes: Share the local metastore in %.3lf seconds\n", ++testCount, mytimer.elapsed().wall / 1e9);
+    }
+
     printf("End of MetaStore Test\n");
     printf("=====================\n");
 
@@ -301,6 +626,11 @@ MetaStore *newMetaStore() {
     switch (config.getProxyMetaStoreType()) {
     case MetaStoreType::REDIS:
         return new RedisMetaStore();
+    case MetaStoreType::LOCAL:
+        return new LocalMetaStore();
+    default:
+        break;
+    }
     return new RedisMetaStore();
 }
 
@@ -464,6 +794,180 @@ static void updateFiles() {
     }
 }
 
+static void initPackedFiles() {
+    Config &config = Config::getInstance();
+
+    int n = config.getN();
+
+    for (size_t i = 0; i < numPackedFilesToTest; i++) {
+        std::string name = std::string("packed_file_meta_test_").append(std::to_string(i));
+        pf[i].setName(name.c_str(), name.size());
+        pf[i].genUUID();
+        pf[i].namespaceId = rand() % 255;
+        pf[i].version = 0;
+        pf[i].codingMeta.coding = rand() % UNKNOWN_CODE;
+        pf[i].codingMeta.k = config.getK();
+        pf[i].codingMeta.n = n;
+
+        // chunks, with checksums and corruption marks
+        pf[i].numStripes = i % 8 + 1;
+        pf[i].numChunks = pf[i].numStripes * n;
+        pf[i].size = (unsigned long) pf[i].numStripes * chunkSize;
+        pf[i].initChunksAndContainerIds();
+        for (int c = 0; c < pf[i].numChunks; c++) {
+            pf[i].chunks[c].setId(pf[i].namespaceId, pf[i].uuid, c);
+            pf[i].chunks[c].size = rand() % chunkSize + 1;
+            for (int j = 0; j < MD5_DIGEST_LENGTH; j++)
+                pf[i].chunks[c].md5[j] = rand() % 256;
+            pf[i].containerIds[c] = rand() % 256;
+            pf[i].chunksCorrupted[c] = rand() % 5 == 0;
+        }
+
+        // unique and duplicate blocks, with fingerprints of various lengths
+        unsigned long int offset = 0;
+        for (size_t b = 0; b < i % 16; b++) {
+            unsigned int length = rand() % 4096 + 1;
+            char fp[SHA256_DIGEST_LENGTH];
+            for (int j = 0; j < SHA256_DIGEST_LENGTH; j++)
+                fp[j] = rand() % 256;
+            Fingerprint fingerprint;
+            fingerprint.set(fp, b % 2 == 0 ? SHA256_DIGEST_LENGTH : b);
+            BlockLocation::InObjectLocation loc(offset, length);
+            if (b % 3 == 0) {
+                pf[i].duplicateBlocks.insert(std::make_pair(loc, fingerprint));
+            } else {
+                pf[i].uniqueBlocks.insert(std::make_pair(loc, std::make_pair(fingerprint, (int) (rand() % 65536))));
+            }
+            offset += length;
+        }
+    }
+}
+
+static bool compareChunksAndBlocks(size_t i, const File &origin, const File &retrieved) {
+    if (origin.numChunks != retrieved.numChunks) {
+        printf("File %lu num. of chunks mismatched (%d vs %d)\n", i, retrieved.numChunks, origin.numChunks);
+        return false;
+    }
+    for (int c = 0; c < origin.numChunks; c++) {
+        if (origin.containerIds[c] != retrieved.containerIds[c] || origin.chunks[c].size != retrieved.chunks[c].size) {
+            printf("File %lu chunk %d container id or size mismatched (%d vs %d, %d vs %d)\n", i, c, retrieved.containerIds[c], origin.containerIds[c], retrieved.chunks[c].size, origin.chunks[c].size);
+            return false;
+        }
+        if (memcmp(origin.chunks[c].md5, retrieved.chunks[c].md5, MD5_DIGEST_LENGTH) != 0) {
+            printf("File %lu chunk %d md5 mismatched (%s vs %s)\n"
+                , i, c
+                , ChecksumCalculator::toHex(retrieved.chunks[c].md5, MD5_DIGEST_LENGTH).c_str()
+                , ChecksumCalculator::toHex(origin.chunks[c].md5, MD5_DIGEST_LENGTH).c_str()
+            );
+            return false;
+        }
+        if (origin.chunksCorrupted[c] != retrieved.chunksCorrupted[c]) {
+            printf("File %lu chunk %d corruption mark mismatched (%d vs %d)\n", i, c, retrieved.chunksCorrupted[c], origin.chunksCorrupted[c]);
+            return false;
+        }
+    }
+    if (origin.uniqueBlocks.size() != retrieved.uniqueBlocks.size() || origin.duplicateBlocks.size() != retrieved.duplicateBlocks.size()) {
+        printf("File %lu num. of blocks mismatched (%lu vs %lu unique, %lu vs %lu duplicate)\n"
+            , i
+            , retrieved.uniqueBlocks.size(), origin.uniqueBlocks.size()
+            , retrieved.duplicateBlocks.size(), origin.duplicateBlocks.size()
+        );
+        return false;
+    }
+    for (auto oit = origin.uniqueBlocks.begin(), rit = retrieved.uniqueBlocks.begin(); oit != origin.uniqueBlocks.end(); oit++, rit++) {
+        if (!(oit->first == rit->first) || oit->second.first != rit->second.first || oit->second.second != rit->second.second) {
+            printf("File %lu unique block at %lu mismatched\n", i, oit->first._offset);
+            return false;
+        }
+    }
+    for (auto oit = origin.duplicateBlocks.begin(), rit = retrieved.duplicateBlocks.begin(); oit != origin.duplicateBlocks.end(); oit++, rit++) {
+        if (!(oit->first == rit->first) || oit->second != rit->second) {
+            printf("File %lu duplicate block at %lu mismatched\n", i, oit->first._offset);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool convertToLegacyLayout(const File &file) {
+    Config &config = Config::getInstance();
+
+    redisContext *cxt = redisConnect(config.getProxyMetaStoreIP().c_str(), config.getProxyMetaStorePort());
+    if (cxt == NULL || cxt->err) {
+        redisFree(cxt);
+        return false;
+    }
+
+    std::string key = std::to_string(file.namespaceId).append("_").append(file.name, file.nameLength);
+    char field[64];
+    int numCommands = 0;
+
+    // per-chunk fields: container id, size, checksum, and corruption mark
+    for (int c = 0; c < file.numChunks; c++) {
+        std::string bad = std::to_string(file.chunksCorrupted[c] ? 1 : 0);
+        snprintf(field, sizeof(field), "c%d", c);
+        redisAppendCommand(cxt, "HSET %b %s-cid %b %s-size %b %s-md5 %b %s-bad %b"
+            , key.data(), key.size()
+            , field, &file.containerIds[c], sizeof(int)
+            , field, &file.chunks[c].size, sizeof(int)
+            , field, file.chunks[c].md5, (size_t) MD5_DIGEST_LENGTH
+            , field, bad.data(), bad.size()
+        );
+        numCommands++;
+    }
+    // per-block fields: logical offset, length, fingerprint, (and physical offset for unique blocks)
+    size_t bid = 0;
+    for (auto it = file.uniqueBlocks.begin(); it != file.uniqueBlocks.end(); it++, bid++) {
+        std::string value;
+        value.append((const char *) &it->first._offset, sizeof(unsigned long int))
+            .append((const char *) &it->first._length, sizeof(unsigned int))
+            .append(it->second.first.get())
+            .append((const char *) &it->second.second, sizeof(int));
+        snprintf(field, sizeof(field), "ub%lu", bid);
+        redisAppendCommand(cxt, "HSET %b %s %b", key.data(), key.size(), field, value.data(), value.size());
+        numCommands++;
+    }
+    bid = 0;
+    for (auto it = file.duplicateBlocks.begin(); it != file.duplicateBlocks.end(); it++, bid++) {
+        std::string value;
+        value.append((const char *) &it->first._offset, sizeof(unsigned long int))
+            .append((const char *) &it->first._length, sizeof(unsigned int))
+            .append(it->second.get());
+        snprintf(field, sizeof(field), "db%lu", bid);
+        redisAppendCommand(cxt, "HSET %b %s %b", key.data(), key.size(), field, value.data(), value.size());
+        numCommands++;
+    }
+    // remove the packed fields
+    redisAppendCommand(cxt, "HDEL %b mfmt pc pub pdb", key.data(), key.size());
+    numCommands++;
+
+    bool okay = true;
+    for (int i = 0; i < numCommands; i++) {
+        redisReply *r = NULL;
+        okay = redisGetReply(cxt, (void **) &r) == REDIS_OK && r != NULL && r->type != REDIS_REPLY_ERROR && okay;
+        freeReplyObject(r);
+    }
+    redisFree(cxt);
+
+    return okay;
+}
+
+static bool checkFolderList(MetaStore *store, const char *prefix, bool skipSubfolders, const std::set<std::string> &expected) {
+    Config &config = Config::getInstance();
+
+    std::vector<std::string> list;
+    unsigned int count = store->getFolderList(list, config.getProxyNamespaceId(), prefix, skipSubfolders);
+    std::set<std::string> folders(list.begin(), list.end());
+    if (count != list.size() || list.size() != folders.size() || folders != expected) {
+        printf(">> Folders listed under prefix \"%s\" (skip subfolders = %d) mismatched:", prefix, skipSubfolders);
+        for (auto &folder : list)
+            printf(" \"%s\"", folder.c_str());
+        printf(" (expected %lu folders)\n", expected.size());
+        return false;
+    }
+    return true;
+}
+
 static bool compareFile(size_t i, const File &origin, const File &retrieved) {
     // file name
     if (origin.nameLength != retrieved.nameLength || strcmp(origin.name, retrieved.name) != 0) {
@@ -610,10 +1114,37 @@ static void exitWithError() {
     // clean up files
     for (size_t i = 0; i < numFilesToTest; i++)
         metastore->deleteMeta(f[i]);
+    for (size_t i = 0; i < numPackedFilesToTest; i++)
+        metastore->deleteMeta(pf[i]);
+    for (size_t i = 0; i < numFolderFilesToTest; i++)
+        if (df[i].name)
+            metastore->deleteMeta(df[i]);
     // exit with non-zero value
     exit(1);
 }
 
+static void readAndCheckFileMetaInBatches() {
+    const size_t batchSize = 64;
+    for (size_t i = 0; i < numFilesToTest; i += batchSize) {
+        size_t num = std::min(batchSize, numFilesToTest - i);
+        // get metadata
+        File rf[batchSize];
+        bool found[batchSize];
+        for (size_t j = 0; j < num; j++)
+            rf[j].copyNameAndSize(f[i + j]);
+        if (metastore->getMetaBatch(num, rf, found) != (int) num) {
+            printf(">> Failed to get the metadata of files %lu to %lu in a batch\n", i, i + num - 1);
+            exitWithError();
+        }
+        // check metadata
+        for (size_t j = 0; j < num; j++) {
+            if (!found[j] || !compareFile(i + j, f[i + j], rf[j])) {
+                exitWithError();
+            }
+        }
+    }
+}
+
 static void readAndCheckFileMeta() {
     for (size_t i = 0; i < numFilesToTest; i++) {
         // get metadata